@@ -23,7 +23,7 @@
 //
 //---------------------------------------------------------------------------------
 //
-// Version 2.10alpha
+// Version 2.11alpha
 //
 
 #ifndef _lcms2_H
@@ -81,7 +81,7 @@ extern "C" {
 #endif
 
 // Version/release
-#define LCMS_VERSION        2100
+#define LCMS_VERSION        2110
 
 // I will give the chance of redefining basic types for compilers that are not fully C99 compliant
 #ifndef CMS_BASIC_TYPES_ALREADY_DEFINED
@@ -1185,6 +1185,9 @@ CMSAPI cmsToneCurve*     CMSEXPORT cmsJoinToneCurve(cmsContext ContextID, const
 CMSAPI cmsBool           CMSEXPORT cmsSmoothToneCurve(cmsToneCurve* Tab, cmsFloat64Number lambda);
 CMSAPI cmsFloat32Number  CMSEXPORT cmsEvalToneCurveFloat(const cmsToneCurve* Curve, cmsFloat32Number v);
 CMSAPI cmsUInt16Number   CMSEXPORT cmsEvalToneCurve16(const cmsToneCurve* Curve, cmsUInt16Number v);
+CMSAPI void              CMSEXPORT cmsEvalToneCurve16Array(const cmsToneCurve* Curve, const cmsUInt16Number In[], cmsUInt16Number Out[], cmsUInt32Number n);
+CMSAPI void              CMSEXPORT cmsEvalToneCurve8Array(const cmsToneCurve* Curve, const cmsUInt8Number In[], cmsUInt8Number Out[], cmsUInt32Number n);
+CMSAPI void              CMSEXPORT cmsEvalToneCurveFloatArray(const cmsToneCurve* Curve, const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number n);
 CMSAPI cmsBool           CMSEXPORT cmsIsToneCurveMultisegment(const cmsToneCurve* InGamma);
 CMSAPI cmsBool           CMSEXPORT cmsIsToneCurveLinear(const cmsToneCurve* Curve);
 CMSAPI cmsBool           CMSEXPORT cmsIsToneCurveMonotonic(const cmsToneCurve* t);
@@ -1218,6 +1221,8 @@ CMSAPI cmsStage*         CMSEXPORT cmsPipelineGetPtrToLastStage(const cmsPipelin
 
 CMSAPI void              CMSEXPORT cmsPipelineEval16(const cmsUInt16Number In[], cmsUInt16Number Out[], const cmsPipeline* lut);
 CMSAPI void              CMSEXPORT cmsPipelineEvalFloat(const cmsFloat32Number In[], cmsFloat32Number Out[], const cmsPipeline* lut);
+CMSAPI void              CMSEXPORT cmsPipelineEval16Batch(const cmsUInt16Number In[], cmsUInt16Number Out[], cmsUInt32Number nPixels, const cmsPipeline* lut);
+CMSAPI void              CMSEXPORT cmsPipelineEvalFloatBatch(const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number nPixels, const cmsPipeline* lut);
 CMSAPI cmsBool           CMSEXPORT cmsPipelineEvalReverseFloat(cmsFloat32Number Target[], cmsFloat32Number Result[], cmsFloat32Number Hint[], const cmsPipeline* lut);
 CMSAPI cmsBool           CMSEXPORT cmsPipelineCat(cmsPipeline* l1, const cmsPipeline* l2);
 CMSAPI cmsBool           CMSEXPORT cmsPipelineSetSaveAs8bitsFlag(cmsPipeline* lut, cmsBool On);
@@ -1265,12 +1270,30 @@ typedef cmsInt32Number (* cmsSAMPLERFLOAT)(CMSREGISTER const cmsFloat32Number In
                                            CMSREGISTER cmsFloat32Number Out[],
                                            CMSREGISTER void * Cargo);
 
+// Batch samplers get nNodes consecutive nodes at once. In[] holds the inputs of all nodes, one after another, and
+// Out[] the outputs, which are initialized to current contents of the table.
+typedef cmsInt32Number (* cmsSAMPLER16_BATCH)   (CMSREGISTER const cmsUInt16Number In[],
+                                                 CMSREGISTER cmsUInt16Number Out[],
+                                                 cmsUInt32Number nNodes,
+                                                 CMSREGISTER void * Cargo);
+
+typedef cmsInt32Number (* cmsSAMPLERFLOAT_BATCH)(CMSREGISTER const cmsFloat32Number In[],
+                                                 CMSREGISTER cmsFloat32Number Out[],
+                                                 cmsUInt32Number nNodes,
+                                                 CMSREGISTER void * Cargo);
+
 // Use this flag to prevent changes being written to destination
 #define SAMPLER_INSPECT     0x01000000
 
+// Use this flag if the sampler can be called from several threads at once. The grid is then split across
+// the threads given by the parallelization plug-in, and the order in which nodes are visited is undefined.
+#define SAMPLER_REENTRANT   0x02000000
+
 // For CLUT only
 CMSAPI cmsBool           CMSEXPORT cmsStageSampleCLut16bit(cmsStage* mpe,    cmsSAMPLER16 Sampler, void* Cargo, cmsUInt32Number dwFlags);
 CMSAPI cmsBool           CMSEXPORT cmsStageSampleCLutFloat(cmsStage* mpe, cmsSAMPLERFLOAT Sampler, void* Cargo, cmsUInt32Number dwFlags);
+CMSAPI cmsBool           CMSEXPORT cmsStageSampleCLut16bitBatch(cmsStage* mpe, cmsSAMPLER16_BATCH Sampler, void* Cargo, cmsUInt32Number dwFlags);
+CMSAPI cmsBool           CMSEXPORT cmsStageSampleCLutFloatBatch(cmsStage* mpe, cmsSAMPLERFLOAT_BATCH Sampler, void* Cargo, cmsUInt32Number dwFlags);
 
 // Slicers
 CMSAPI cmsBool           CMSEXPORT cmsSliceSpace16(cmsUInt32Number nInputs, const cmsUInt32Number clutPoints[],
@@ -1444,6 +1467,7 @@ CMSAPI cmsBool           CMSEXPORT cmsIsTag(cmsHPROFILE hProfile, cmsTagSignatur
 // Read and write pre-formatted data
 CMSAPI void*             CMSEXPORT cmsReadTag(cmsHPROFILE hProfile, cmsTagSignature sig);
 CMSAPI cmsBool           CMSEXPORT cmsWriteTag(cmsHPROFILE hProfile, cmsTagSignature sig, const void* data);
+CMSAPI cmsBool           CMSEXPORT cmsProfilePreloadTags(cmsHPROFILE hProfile);
 CMSAPI cmsBool           CMSEXPORT cmsLinkTag(cmsHPROFILE hProfile, cmsTagSignature sig, cmsTagSignature dest);
 CMSAPI cmsTagSignature   CMSEXPORT cmsTagLinkedTo(cmsHPROFILE hProfile, cmsTagSignature sig);
 
@@ -1531,6 +1555,7 @@ typedef struct _cms_io_handler cmsIOHANDLER;
 CMSAPI cmsIOHANDLER*     CMSEXPORT cmsOpenIOhandlerFromFile(cmsContext ContextID, const char* FileName, const char* AccessMode);
 CMSAPI cmsIOHANDLER*     CMSEXPORT cmsOpenIOhandlerFromStream(cmsContext ContextID, FILE* Stream);
 CMSAPI cmsIOHANDLER*     CMSEXPORT cmsOpenIOhandlerFromMem(cmsContext ContextID, void *Buffer, cmsUInt32Number size, const char* AccessMode);
+CMSAPI cmsIOHANDLER*     CMSEXPORT cmsOpenIOhandlerFromMappedFile(cmsContext ContextID, const char* FileName);
 CMSAPI cmsIOHANDLER*     CMSEXPORT cmsOpenIOhandlerFromNULL(cmsContext ContextID);
 CMSAPI cmsIOHANDLER*     CMSEXPORT cmsGetProfileIOhandler(cmsHPROFILE hProfile);
 CMSAPI cmsBool           CMSEXPORT cmsCloseIOhandler(cmsIOHANDLER* io);
@@ -1673,6 +1698,15 @@ CMSAPI cmsUInt32Number  CMSEXPORT cmsGetSupportedIntentsTHR(cmsContext ContextID
 // Copy alpha channels when transforming           
 #define cmsFLAGS_COPY_ALPHA               0x04000000 // Alpha channels are copied on cmsDoTransform()
 
+// Split cmsDoTransform() work across several threads. Results are the same as serial execution
+#define cmsFLAGS_PARALLEL                 0x08000000
+
+// Floating point transforms may evaluate parametric curves by table lookup. Error stays below 1E-5 in 0..1
+#define cmsFLAGS_APPROXIMATE_CURVES       0x10000000
+
+// Collect statistics on this transform, see cmsGetTransformStats()
+#define cmsFLAGS_STATS                    0x20000000
+
 // Fine-tune control over number of gridpoints
 #define cmsFLAGS_GRIDPOINTS(n)           (((n) & 0xFF) << 16)
 
@@ -1745,6 +1779,31 @@ CMSAPI cmsHTRANSFORM    CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextI
 
 CMSAPI void             CMSEXPORT cmsDeleteTransform(cmsHTRANSFORM hTransform);
 
+// Shared transforms. Once a limit is set, transforms created on the context with same profiles (as per profile ID),
+// intents, black point compensation, adaptation states, flags and formats return a same handle, which is freed
+// when deleted as many times as created. Changing formats or cache size on a shared handle affects all users
+// already holding it, and takes it out of the cache, so later requests get a new transform.
+typedef struct {
+
+    cmsUInt32Number Entries;
+    cmsUInt32Number MaxEntries;
+    cmsUInt32Number Hits;
+    cmsUInt32Number Misses;
+    cmsUInt32Number Evictions;
+
+} cmsSharedTransformStats;
+
+CMSAPI cmsUInt32Number  CMSEXPORT cmsSetSharedTransformLimit(cmsContext ContextID, cmsUInt32Number MaxEntries);
+CMSAPI void             CMSEXPORT cmsGetSharedTransformStats(cmsContext ContextID, cmsSharedTransformStats* Stats);
+
+// Optimization budget. Tells how many pixels the transforms created afterwards on the context are expected to convert.
+// Below the number of CLUT nodes the pipeline is not resampled, well above it high resolution precalculation is used.
+// Zero, the default, means no budget. Returns the previous value.
+CMSAPI cmsUInt32Number  CMSEXPORT cmsSetOptimizationBudget(cmsContext ContextID, cmsUInt32Number ExpectedPixels);
+
+// A same transform may be applied from any number of threads at once. Calls do not write to the transform,
+// except for the statistics and cache counters, which are updated under a lock. Changing formats, cache size
+// or the transform itself while other threads are using it is not supported.
 CMSAPI void             CMSEXPORT cmsDoTransform(cmsHTRANSFORM Transform,
                                                  const void * InputBuffer,
                                                  void * OutputBuffer,
@@ -1796,6 +1855,110 @@ CMSAPI cmsBool          CMSEXPORT cmsChangeBuffersFormat(cmsHTRANSFORM hTransfor
                                                          cmsUInt32Number InputFormat,
                                                          cmsUInt32Number OutputFormat);
 
+// Hashed color cache for 16 bits transforms. Zero entries restores the 1-pixel cache
+CMSAPI cmsBool          CMSEXPORT cmsSetTransformCacheSize(cmsHTRANSFORM hTransform, cmsUInt32Number nEntries);
+CMSAPI cmsBool          CMSEXPORT cmsGetTransformCacheStats(cmsHTRANSFORM hTransform, cmsUInt32Number* Hits, cmsUInt32Number* Misses);
+
+// Transform statistics. Those are collected on transforms created with cmsFLAGS_STATS, and on all transforms of
+// a context having a statistics callback. Times are in seconds. Runtime counters cover the whole transform life.
+#define cmsMAX_OPTIMIZATION_STEPS   16
+
+typedef struct {
+
+    cmsFloat64Number LinkTime;              // Linking the profiles into a pipeline
+    cmsFloat64Number OptimizeTime;          // Whole pipeline optimization, steps below included
+    cmsUInt32Number  nOptimizationSteps;    // Optimizations tried. Plug-ins come first, then the built-in ones
+    cmsFloat64Number StepTime[cmsMAX_OPTIMIZATION_STEPS];
+    cmsInt32Number   Optimization;          // Index of the step that took the pipeline, -1 if none did
+    cmsUInt32Number  GridPoints;            // Of the first CLUT on the final pipeline, 0 if there is none
+
+    cmsUInt32Number  nTransforms;           // Only on context totals, number of transforms created
+    cmsUInt32Number  Calls;                 // Calls to cmsDoTransform() and friends, modulo 2^32
+    cmsFloat64Number Pixels;                // Pixels transformed on those calls
+    cmsFloat64Number TransformTime;         // Time taken by those calls
+    cmsFloat64Number CacheHits;             // Pixels taken from the 1-pixel or the hashed cache
+    cmsFloat64Number CacheMisses;           // Pixels the cached transforms had to evaluate
+
+} cmsTransformStats;
+
+// Events for the statistics callback. Creation comes with the creation times, deletion with the final counters
+#define cmsSTATS_TRANSFORM_CREATED  0
+#define cmsSTATS_TRANSFORM_DELETED  1
+
+typedef void (* cmsTransformStatsFn)(cmsContext ContextID, cmsHTRANSFORM hTransform, cmsUInt32Number Event,
+                                     const cmsTransformStats* Stats, void* UserData);
+
+CMSAPI cmsBool          CMSEXPORT cmsGetTransformStats(cmsHTRANSFORM hTransform, cmsTransformStats* Stats);
+CMSAPI void             CMSEXPORT cmsSetTransformStatsCallback(cmsContext ContextID, cmsTransformStatsFn Fn, void* UserData);
+
+// Sums over the transforms of the context with statistics. Runtime counters are added when transforms are deleted
+CMSAPI void             CMSEXPORT cmsGetContextTransformStats(cmsContext ContextID, cmsTransformStats* Stats);
+
+// Transform introspection. Tells which worker and which pipeline evaluators were picked, and what the final pipeline
+// looks like. Meant for logging and for catching performance regressions; new codes may appear in future versions
+#define cmsWORKER_PLUGIN                    0   // A transform plug-in took over
+#define cmsWORKER_NULL                      1   // cmsFLAGS_NULLTRANSFORM, only formatters
+#define cmsWORKER_NULL_FLOAT                2
+#define cmsWORKER_PRECALCULATED             3   // cmsFLAGS_NOCACHE
+#define cmsWORKER_PRECALCULATED_GAMUTCHECK  4
+#define cmsWORKER_CACHED                    5   // 1-pixel or hashed cache
+#define cmsWORKER_CACHED_GAMUTCHECK         6
+#define cmsWORKER_FLOAT                     7
+#define cmsWORKER_FUSED                     8   // Formatters are folded into the worker
+
+#define cmsEVAL_PIPELINE                    0   // Not optimized, stages are evaluated one after another
+#define cmsEVAL_PLUGIN                      1   // Set by an optimization plug-in
+#define cmsEVAL_IDENTITY                    2
+#define cmsEVAL_CURVES8                     3   // Joined curves, tables of 256 entries
+#define cmsEVAL_CURVES16                    4   // Joined curves, tables of 65536 entries
+#define cmsEVAL_MATSHAPER8                  5   // Matrix-shaper in fixed point, 8 bits
+#define cmsEVAL_PRELIN8                     6   // Prelinearization curves and CLUT, 8 bits
+#define cmsEVAL_PRELIN16                    7   // Same, 16 bits
+#define cmsEVAL_CLUT                        8   // The CLUT interpolation alone
+#define cmsEVAL_MATSHAPER_FLOAT             9   // Shaper-matrix-shaper in floating point
+
+#define cmsMAX_STAGE_INFO                   32
+
+typedef struct {
+
+    cmsStageSignature Type;
+    cmsStageSignature Implements;
+    cmsUInt32Number   InputChannels;
+    cmsUInt32Number   OutputChannels;
+    cmsUInt32Number   GridPoints;               // CLUT only, points on first dimension
+    cmsUInt32Number   Entries;                  // CLUT nodes, or entries of the largest table of a curve set
+    char              Interpolation[32];        // Routine name, empty if the stage doesn't interpolate
+    char              BatchInterpolation[32];   // Same, for many pixels at once
+    cmsUInt32Number   MemorySize;               // Bytes held by the stage
+
+} cmsStageInfo;
+
+typedef struct {
+
+    cmsUInt32Number   Worker;                   // cmsWORKER_*
+    cmsBool           Parallel;                 // Calls are split across threads, see cmsFLAGS_PARALLEL
+    cmsUInt32Number   CacheSize;                // Entries of the hashed cache, 0 if none
+    cmsUInt32Number   Eval16;                   // cmsEVAL_*, evaluator for 16 bits
+    cmsUInt32Number   EvalFloat;                // cmsEVAL_*, evaluator for floating point
+    cmsBool           Batch;                    // Pipeline evaluates many pixels at once
+    cmsUInt32Number   InputChannels;
+    cmsUInt32Number   OutputChannels;
+    cmsUInt32Number   nStages;                  // May be above cmsMAX_STAGE_INFO, only the first ones are listed
+    cmsStageInfo      Stages[cmsMAX_STAGE_INFO];
+    cmsUInt32Number   OptimizationSize;         // Bytes held by the optimized evaluator
+    cmsUInt32Number   MemorySize;               // Bytes held by the whole transform, gamut check included
+
+} cmsTransformInfo;
+
+CMSAPI cmsBool          CMSEXPORT cmsGetTransformInfo(cmsHTRANSFORM hTransform, cmsTransformInfo* Info);
+
+// Saved transforms. The optimized pipeline is stored, so loading does not need the profiles nor resampling.
+// Formats and flags are kept. Transforms with gamut check or profile sequence cannot be saved
+CMSAPI cmsUInt32Number  CMSEXPORT cmsSaveTransformToIOhandler(cmsHTRANSFORM hTransform, cmsIOHANDLER* io);
+CMSAPI cmsBool          CMSEXPORT cmsSaveTransformToMem(cmsHTRANSFORM hTransform, void* MemPtr, cmsUInt32Number* BytesNeeded);
+CMSAPI cmsHTRANSFORM    CMSEXPORT cmsLoadTransformFromIOhandler(cmsContext ContextID, cmsIOHANDLER* io);
+CMSAPI cmsHTRANSFORM    CMSEXPORT cmsLoadTransformFromMem(cmsContext ContextID, const void* MemPtr, cmsUInt32Number dwSize);
+
 
 
 // PostScript ColorRenderingDictionary and ColorSpaceArray ----------------------------------------------------
@@ -203,6 +203,7 @@ typedef void*    (* _cmsDupUserDataFn)(cmsContext ContextID, const void* Data);
 #define cmsPluginOptimizationSig             0x6F707448     // 'optH'
 #define cmsPluginTransformSig                0x7A666D48     // 'xfmH'
 #define cmsPluginMutexSig                    0x6D747A48     // 'mtxH'
+#define cmsPluginParallelizationSig          0x70726C48     // 'prlH'
 
 typedef struct _cmsPluginBaseStruct {
 
@@ -274,6 +275,24 @@ typedef union {
     _cmsInterpFnFloat    LerpFloat;         // Forward interpolation in floating point
 } cmsInterpFunction;
 
+// Batch versions of above. Interpolate nPixels in one call. Input holds nInputs values per pixel and Output 
+// gets nOutputs values per pixel, all of them contiguous. Results are same as calling the one-pixel interpolator 
+// on each pixel.
+typedef void (* _cmsInterpFn16Batch)(const cmsUInt16Number Input[],
+                                     cmsUInt16Number Output[],
+                                     cmsUInt32Number nPixels,
+                                     const struct _cms_interp_struc* p);
+
+typedef void (* _cmsInterpFnFloatBatch)(const cmsFloat32Number Input[],
+                                        cmsFloat32Number Output[],
+                                        cmsUInt32Number nPixels,
+                                        const struct _cms_interp_struc* p);
+
+typedef union {
+    _cmsInterpFn16Batch    Lerp16;
+    _cmsInterpFnFloatBatch LerpFloat;
+} cmsInterpBatchFunction;
+
 // Flags for interpolator selection
 #define CMS_LERP_FLAGS_16BITS             0x0000        // The default
 #define CMS_LERP_FLAGS_FLOAT              0x0001        // Requires different implementation
@@ -300,6 +319,8 @@ typedef struct _cms_interp_struc {  // Used on all interpolations. Supplied by l
     const void *Table;                // Points to the actual interpolation table
     cmsInterpFunction Interpolation;  // Points to the function to do the interpolation
 
+    cmsInterpBatchFunction InterpolationBatch;  // Same, on many pixels at once. Always set by lcms2
+
  } cmsInterpParams;
 
 // Interpolators factory
@@ -366,10 +387,39 @@ typedef cmsFormatter (* cmsFormatterFactory)(cmsUInt32Number Type,           //
                                              cmsFormatterDirection Dir,
                                              cmsUInt32Number dwFlags);      // precision
 
-// Plug-in may implement an arbitrary number of formatters
+// Line formatters. Same as above, but on nPixels pixels in a single call. Values holds T_CHANNELS(Type) values
+// per pixel, one pixel after another. Stride is the bytes per plane on planar formats. Return the pointer past
+// the last pixel, as the one-pixel formatters do.
+typedef cmsUInt8Number* (* cmsFormatter16Line)(struct _cmstransform_struct* CMMcargo,
+                                               cmsUInt16Number Values[],
+                                               cmsUInt8Number*  Buffer,
+                                               cmsUInt32Number  nPixels,
+                                               cmsUInt32Number  Stride);
+
+typedef cmsUInt8Number* (* cmsFormatterFloatLine)(struct _cmstransform_struct* CMMcargo,
+                                                  cmsFloat32Number Values[],
+                                                  cmsUInt8Number*  Buffer,
+                                                  cmsUInt32Number  nPixels,
+                                                  cmsUInt32Number  Stride);
+
+typedef union {
+    cmsFormatter16Line    Line16;
+    cmsFormatterFloatLine LineFloat;
+
+} cmsLineFormatter;
+
+typedef cmsLineFormatter (* cmsLineFormatterFactory)(cmsUInt32Number Type,
+                                                     cmsFormatterDirection Dir,
+                                                     cmsUInt32Number dwFlags);
+
+// Plug-in may implement an arbitrary number of formatters. Line formatters are optional, and only looked at
+// on plug-ins expecting version 2.11 or higher, since older plug-ins have no such field. If a plug-in handles
+// a format one pixel at time but has no line formatter for it, the built-in line formatters are not used for
+// that format.
 typedef struct {
-    cmsPluginBase          base;
-    cmsFormatterFactory    FormattersFactory;
+    cmsPluginBase           base;
+    cmsFormatterFactory     FormattersFactory;
+    cmsLineFormatterFactory LineFormattersFactory;
 
 } cmsPluginFormatters;
 
@@ -496,6 +546,15 @@ CMSAPI cmsStage* CMSEXPORT _cmsStageAllocPlaceholder(cmsContext ContextID,
                                 _cmsStageDupElemFn    DupElemPtr,         // Points to a fn that duplicates the stage
                                 _cmsStageFreeElemFn   FreePtr,            // Points to a fn that sets the element free
                                 void*                 Data);              // A generic pointer to whatever memory needed by the element
+
+// Optional batch evaluator of a stage. Works on nPixels at once in planar layout: channel c of pixel i is found
+// at In[c * Stride + i], and results are to be stored the same way in Out. Stages lacking a batch evaluator are
+// evaluated pixel by pixel by means of EvalPtr, so this is only needed for speed. Results should be identical.
+typedef void (* _cmsStageEvalBatchFn)(const cmsFloat32Number In[], cmsFloat32Number Out[],
+                                      cmsUInt32Number nPixels, cmsUInt32Number Stride, const cmsStage* mpe);
+
+CMSAPI void CMSEXPORT _cmsStageSetEvalBatch(cmsStage* mpe, _cmsStageEvalBatchFn EvalBatchPtr);
+
 typedef struct {
       cmsPluginBase     base;
       cmsTagTypeHandler Handler;
@@ -509,6 +568,7 @@ typedef struct {
 typedef struct {
     cmsUInt32Number nCurves;
     cmsToneCurve**  TheCurves;
+    cmsBool         Approximate;    // Float evaluation may use cached tables instead of the exact curves
 
 } _cmsStageToneCurvesData;
 
@@ -545,6 +605,12 @@ typedef void     (* _cmsOPTeval16Fn)(CMSREGISTER const cmsUInt16Number In[],
                                      CMSREGISTER cmsUInt16Number Out[],
                                      CMSREGISTER const void* Data);
 
+// Same, but evaluating nPixels contiguous pixels at once. In and Out are chunky arrays.
+typedef void     (* _cmsOPTeval16BatchFn)(const cmsUInt16Number In[],
+                                          cmsUInt16Number Out[],
+                                          cmsUInt32Number nPixels,
+                                          const void* Data);
+
 
 typedef cmsBool  (* _cmsOPToptimizeFn)(cmsPipeline** Lut,
                                        cmsUInt32Number  Intent,
@@ -561,6 +627,11 @@ CMSAPI void CMSEXPORT _cmsPipelineSetOptimizationParameters(cmsPipeline* Lut,
                                                _cmsFreeUserDataFn FreePrivateDataFn,
                                                _cmsDupUserDataFn DupPrivateDataFn);
 
+// Optionally, a batch evaluator working on the same private data may be set. It has to be called after
+// _cmsPipelineSetOptimizationParameters, which resets it. If none is set, Eval16 is called once per pixel.
+CMSAPI void CMSEXPORT _cmsPipelineSetOptimizationBatch(cmsPipeline* Lut,
+                                               _cmsOPTeval16BatchFn Eval16Batch);
+
 typedef struct {
       cmsPluginBase     base;
 
@@ -587,6 +658,9 @@ typedef void     (* _cmsTransformFn)(struct _cmstransform_struct *CMMcargo,   //
                                      cmsUInt32Number Stride);                 // Stride in bytes to the next plana in planar formats
 
 
+// Transform workers may be called on a same transform from many threads at once, including the threads of
+// cmsFLAGS_PARALLEL. The transform is read-only during the call: anything written must go to the stack or to a
+// workspace (see below). User data set by the factory is shared by all calls, so it should be read-only as well.
 typedef void     (*_cmsTransform2Fn)(struct _cmstransform_struct *CMMcargo,
                                      const void* InputBuffer,
                                      void* OutputBuffer,
@@ -615,11 +689,20 @@ typedef cmsBool  (* _cmsTransform2Factory)(_cmsTransform2Fn* xform,
 CMSAPI void   CMSEXPORT _cmsSetTransformUserData(struct _cmstransform_struct *CMMcargo, void* ptr, _cmsFreeUserDataFn FreePrivateDataFn);
 CMSAPI void * CMSEXPORT _cmsGetTransformUserData(struct _cmstransform_struct *CMMcargo);
 
+// Scratch memory for workers. The block is private to the caller until released, and is kept by the transform
+// for later calls, so once all threads have got one no more allocations take place. Returns NULL if out of memory.
+CMSAPI void*  CMSEXPORT _cmsGetTransformWorkspace(struct _cmstransform_struct *CMMcargo, cmsUInt32Number Size);
+CMSAPI void   CMSEXPORT _cmsReleaseTransformWorkspace(struct _cmstransform_struct *CMMcargo, void* Workspace);
+
 
 // Retrieve formatters
 CMSAPI void   CMSEXPORT _cmsGetTransformFormatters16   (struct _cmstransform_struct *CMMcargo, cmsFormatter16* FromInput, cmsFormatter16* ToOutput);
 CMSAPI void   CMSEXPORT _cmsGetTransformFormattersFloat(struct _cmstransform_struct *CMMcargo, cmsFormatterFloat* FromInput, cmsFormatterFloat* ToOutput);
 
+// Line formatters of the transform. Any of them may be NULL
+CMSAPI void   CMSEXPORT _cmsGetTransformLineFormatters16   (struct _cmstransform_struct *CMMcargo, cmsFormatter16Line* FromInput, cmsFormatter16Line* ToOutput);
+CMSAPI void   CMSEXPORT _cmsGetTransformLineFormattersFloat(struct _cmstransform_struct *CMMcargo, cmsFormatterFloatLine* FromInput, cmsFormatterFloatLine* ToOutput);
+
 typedef struct {
       cmsPluginBase     base;
 
@@ -654,6 +737,35 @@ CMSAPI void    CMSEXPORT _cmsDestroyMutex(cmsContext ContextID, void* mtx);
 CMSAPI cmsBool CMSEXPORT _cmsLockMutex(cmsContext ContextID, void* mtx);
 CMSAPI void    CMSEXPORT _cmsUnlockMutex(cmsContext ContextID, void* mtx);
 
+//----------------------------------------------------------------------------------------------------------
+// Parallelization
+
+// A job is an independent piece of work. Jobs never share output memory, so they can run in any order
+typedef void     (* _cmsParallelJobFn)(void* Cargo);
+
+// Runs nJobs calls to Job, one per element of Cargo[], and returns when all of them have finished.
+// Host applications may use their own thread pool here instead of letting lcms to spawn threads.
+// Returning FALSE means nothing has been run, and lcms will do the work serially on the calling thread.
+typedef cmsBool  (* _cmsParallelRunFn)(cmsContext ContextID,
+                                      cmsUInt32Number nJobs,
+                                      _cmsParallelJobFn Job,
+                                      void* Cargo[]);
+
+typedef struct {
+      cmsPluginBase     base;
+
+      cmsUInt32Number   MaxWorkers;       // Maximum number of jobs to split the work in. 0 = number of CPUs
+      _cmsParallelRunFn RunJobs;          // Entry point. NULL = use the built-in threads
+
+}  cmsPluginParallelization;
+
+// Runs jobs using the parallelization plug-in of the context, or the built-in threads if none. Always completes
+// all jobs, in the worst case serially on the calling thread.
+CMSAPI void            CMSEXPORT _cmsRunParallelJobs(cmsContext ContextID, cmsUInt32Number nJobs, _cmsParallelJobFn Job, void* Cargo[]);
+
+// Maximum number of jobs worth splitting the work into
+CMSAPI cmsUInt32Number CMSEXPORT _cmsGetMaxWorkers(cmsContext ContextID);
+
 
 #ifndef CMS_USE_CPP_API
 #   ifdef __cplusplus
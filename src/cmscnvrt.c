@@ -799,7 +799,7 @@ cmsPipeline*  BlackPreservingKOnlyIntents(cmsContext     ContextID,
         goto Error;
 
     // Sample it. We cannot afford pre/post linearization this time.
-    if (!cmsStageSampleCLut16bit(CLUT, BlackPreservingGrayOnlySampler, (void*) &bp, 0))
+    if (!cmsStageSampleCLut16bit(CLUT, BlackPreservingGrayOnlySampler, (void*) &bp, (dwFlags & cmsFLAGS_PARALLEL) ? SAMPLER_REENTRANT : 0))
         goto Error;
 
     // Get rid of xform and tone curve
@@ -822,28 +822,25 @@ Error:
 typedef struct {
 
     cmsPipeline*     cmyk2cmyk;     // The original transform
-    cmsHTRANSFORM    hProofOutput;  // Output CMYK to Lab (last profile)
     cmsHTRANSFORM    cmyk2Lab;      // The input chain
     cmsToneCurve*    KTone;         // Black-to-black tone curve
     cmsPipeline*     LabK2cmyk;     // The output profile
-    cmsFloat64Number MaxError;
 
-    cmsHTRANSFORM    hRoundTrip;
     cmsFloat64Number MaxTAC;
 
 
 } PreserveKPlaneParams;
 
 
-// The CLUT will be stored at 16 bits, but calculations are performed at cmsFloat32Number precision
+// The CLUT will be stored at 16 bits, but calculations are performed at cmsFloat32Number precision.
+// Parameters are read only, so this sampler is reentrant.
 static
 int BlackPreservingSampler(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Number Out[], CMSREGISTER void* Cargo)
 {
     int i;
     cmsFloat32Number Inf[4], Outf[4];
     cmsFloat32Number LabK[4];
-    cmsFloat64Number SumCMY, SumCMYK, Error, Ratio;
-    cmsCIELab ColorimetricLab, BlackPreservingLab;
+    cmsFloat64Number SumCMY, SumCMYK, Ratio;
     PreserveKPlaneParams* bp = (PreserveKPlaneParams*) Cargo;
 
     // Convert from 16 bits to floating point
@@ -873,10 +870,6 @@ int BlackPreservingSampler(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER c
         return TRUE;
     }
 
-    // K differ, measure and keep Lab measurement for further usage
-    // this is done in relative colorimetric intent
-    cmsDoTransform(bp->hProofOutput, Out, &ColorimetricLab, 1);
-
     // Is not black only and the transform doesn't keep black.
     // Obtain the Lab of output CMYK. After that we have Lab + K
     cmsDoTransform(bp ->cmyk2Lab, Outf, LabK, 1);
@@ -911,12 +904,6 @@ int BlackPreservingSampler(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER c
     Out[2] = _cmsQuickSaturateWord(Outf[2] * Ratio * 65535.0);     // Y
     Out[3] = _cmsQuickSaturateWord(Outf[3] * 65535.0);
 
-    // Estimate the error (this goes 16 bits to Lab DBL)
-    cmsDoTransform(bp->hProofOutput, Out, &BlackPreservingLab, 1);
-    Error = cmsDeltaE(&ColorimetricLab, &BlackPreservingLab);
-    if (Error > bp -> MaxError)
-        bp->MaxError = Error;
-
     return TRUE;
 }
 
@@ -986,25 +973,15 @@ cmsPipeline* BlackPreservingKPlaneIntents(cmsContext     ContextID,
                                    dwFlags);
     if (bp.KTone == NULL) goto Cleanup;
 
-    // To measure the output, Last profile to Lab
+    // Last profile to Lab, in the 0..1 range
     hLab = cmsCreateLab4ProfileTHR(ContextID, NULL);
-    bp.hProofOutput = cmsCreateTransformTHR(ContextID, hProfiles[nProfiles-1],
-                                         CHANNELS_SH(4)|BYTES_SH(2), hLab, TYPE_Lab_DBL,
-                                         INTENT_RELATIVE_COLORIMETRIC,
-                                         cmsFLAGS_NOCACHE|cmsFLAGS_NOOPTIMIZE);
-    if ( bp.hProofOutput == NULL) goto Cleanup;
-
-    // Same as anterior, but lab in the 0..1 range
     bp.cmyk2Lab = cmsCreateTransformTHR(ContextID, hProfiles[nProfiles-1],
                                          FLOAT_SH(1)|CHANNELS_SH(4)|BYTES_SH(4), hLab,
                                          FLOAT_SH(1)|CHANNELS_SH(3)|BYTES_SH(4),
                                          INTENT_RELATIVE_COLORIMETRIC,
                                          cmsFLAGS_NOCACHE|cmsFLAGS_NOOPTIMIZE);
-    if (bp.cmyk2Lab == NULL) goto Cleanup;
     cmsCloseProfile(hLab);
-
-    // Error estimation (for debug only)
-    bp.MaxError = 0;
+    if (bp.cmyk2Lab == NULL) goto Cleanup;
 
     // How many gridpoints are we going to use?
     nGridPoints = _cmsReasonableGridpointsByColorspace(cmsSigCmykData, dwFlags);
@@ -1016,13 +993,12 @@ cmsPipeline* BlackPreservingKPlaneIntents(cmsContext     ContextID,
     if (!cmsPipelineInsertStage(Result, cmsAT_BEGIN, CLUT))
         goto Cleanup;
 
-    cmsStageSampleCLut16bit(CLUT, BlackPreservingSampler, (void*) &bp, 0);
+    cmsStageSampleCLut16bit(CLUT, BlackPreservingSampler, (void*) &bp, (dwFlags & cmsFLAGS_PARALLEL) ? SAMPLER_REENTRANT : 0);
 
 Cleanup:
 
     if (bp.cmyk2cmyk) cmsPipelineFree(bp.cmyk2cmyk);
     if (bp.cmyk2Lab) cmsDeleteTransform(bp.cmyk2Lab);
-    if (bp.hProofOutput) cmsDeleteTransform(bp.hProofOutput);
 
     if (bp.KTone) cmsFreeToneCurve(bp.KTone);
     if (bp.LabK2cmyk) cmsPipelineFree(bp.LabK2cmyk);
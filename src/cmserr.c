@@ -25,6 +25,18 @@
 
 #include "lcms2_internal.h"
 
+#if !defined(CMS_NO_PTHREADS) && !defined(CMS_IS_WINDOWS_)
+#include <unistd.h>
+#endif
+
+#ifdef CMS_SIMD_X86
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#endif
+
 
 // This function is here to help applications to prevent mixing lcms versions on header and shared objects.
 int CMSEXPORT cmsGetEncodedCMMversion(void)
@@ -661,3 +673,358 @@ void CMSEXPORT _cmsUnlockMutex(cmsContext ContextID, void* mtx)
         ptr ->UnlockMutexPtr(ContextID, mtx);
     }
 }
+
+//--------------------------------------------------------------------------------------------------
+// Parallelization
+
+// Pointers to parallelization functions in Context0. Zero workers means as many as CPUs
+_cmsParallelizationPluginChunkType _cmsParallelizationPluginChunk = { 0, NULL };
+
+// Allocate and init parallelization container.
+void _cmsAllocParallelizationPluginChunk(struct _cmsContext_struct* ctx, 
+                                        const struct _cmsContext_struct* src)
+{
+    static _cmsParallelizationPluginChunkType ParallelizationChunk = { 0, NULL };
+    void* from;
+
+    if (src != NULL) {
+        from = src ->chunks[ParallelizationPlugin];       
+    }
+    else {
+       from = &ParallelizationChunk;
+    }
+
+    ctx ->chunks[ParallelizationPlugin] = _cmsSubAllocDup(ctx ->MemPool, from, sizeof(_cmsParallelizationPluginChunkType));   
+}
+
+// Register a way to run jobs in parallel
+cmsBool  _cmsRegisterParallelizationPlugin(cmsContext ContextID, cmsPluginBase* Data)
+{
+    cmsPluginParallelization* Plugin = (cmsPluginParallelization*) Data;
+    _cmsParallelizationPluginChunkType* ctx = ( _cmsParallelizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, ParallelizationPlugin);
+
+    if (Data == NULL) {
+
+        // Back to built-in threads
+        ctx ->MaxWorkers = 0;
+        ctx ->RunJobs = NULL;
+        return TRUE;
+    }
+
+    ctx ->MaxWorkers = Plugin ->MaxWorkers;
+    ctx ->RunJobs    = Plugin ->RunJobs;
+
+    // All is ok
+    return TRUE;
+}
+
+
+// Number of processors online. It is computed only once, a race here is harmless as all threads
+// would get the same value.
+static
+cmsUInt32Number CountProcessors(void)
+{
+    static cmsUInt32Number nProcessors = 0;
+
+    if (nProcessors == 0) {
+
+#if defined(CMS_NO_PTHREADS)
+        nProcessors = 1;
+#elif defined(CMS_IS_WINDOWS_)
+        SYSTEM_INFO si;
+
+        GetSystemInfo(&si);
+        nProcessors = si.dwNumberOfProcessors > 0 ? (cmsUInt32Number) si.dwNumberOfProcessors : 1;
+#elif defined(_SC_NPROCESSORS_ONLN)
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        nProcessors = n > 0 ? (cmsUInt32Number) n : 1;
+#else
+        nProcessors = 1;
+#endif
+    }
+
+    return nProcessors;
+}
+
+
+#ifndef CMS_NO_PTHREADS
+
+// Built-in threads. Each job but the first one gets its own thread, the first one runs
+// on the calling thread. Threads are joined before returning.
+typedef struct {
+
+    _cmsParallelJobFn Job;
+    void* Cargo;
+
+} _cmsThreadJob;
+
+#ifdef CMS_IS_WINDOWS_
+
+typedef HANDLE _cmsThread;
+
+static
+DWORD WINAPI ThreadEntry(LPVOID Param)
+{
+    _cmsThreadJob* t = (_cmsThreadJob*) Param;
+
+    t ->Job(t ->Cargo);
+    return 0;
+}
+
+static
+cmsBool StartThread(_cmsThread* Thread, _cmsThreadJob* t)
+{
+    *Thread = CreateThread(NULL, 0, ThreadEntry, (LPVOID) t, 0, NULL);
+    return *Thread != NULL;
+}
+
+static
+void JoinThread(_cmsThread Thread)
+{
+    WaitForSingleObject(Thread, INFINITE);
+    CloseHandle(Thread);
+}
+
+#else
+
+typedef pthread_t _cmsThread;
+
+static
+void* ThreadEntry(void* Param)
+{
+    _cmsThreadJob* t = (_cmsThreadJob*) Param;
+
+    t ->Job(t ->Cargo);
+    return NULL;
+}
+
+static
+cmsBool StartThread(_cmsThread* Thread, _cmsThreadJob* t)
+{
+    return pthread_create(Thread, NULL, ThreadEntry, (void*) t) == 0;
+}
+
+static
+void JoinThread(_cmsThread Thread)
+{
+    pthread_join(Thread, NULL);
+}
+
+#endif
+
+static
+cmsBool defRunJobs(cmsContext ContextID, cmsUInt32Number nJobs, _cmsParallelJobFn Job, void* Cargo[])
+{
+    _cmsThread*    Threads;
+    _cmsThreadJob* Jobs;
+    cmsBool*       Started;
+    cmsUInt32Number i;
+
+    Threads = (_cmsThread*) _cmsCalloc(ContextID, nJobs, sizeof(_cmsThread));
+    Jobs    = (_cmsThreadJob*) _cmsCalloc(ContextID, nJobs, sizeof(_cmsThreadJob));
+    Started = (cmsBool*) _cmsCalloc(ContextID, nJobs, sizeof(cmsBool));
+
+    if (Threads == NULL || Jobs == NULL || Started == NULL) {
+
+        if (Threads) _cmsFree(ContextID, Threads);
+        if (Jobs)    _cmsFree(ContextID, Jobs);
+        if (Started) _cmsFree(ContextID, Started);
+        return FALSE;
+    }
+
+    for (i=1; i < nJobs; i++) {
+
+        Jobs[i].Job   = Job;
+        Jobs[i].Cargo = Cargo[i];
+
+        Started[i] = StartThread(&Threads[i], &Jobs[i]);
+
+        // If the system refuses to give us more threads, do the work here
+        if (!Started[i])
+            Job(Cargo[i]);
+    }
+
+    // The calling thread does its share
+    Job(Cargo[0]);
+
+    for (i=1; i < nJobs; i++) {
+
+        if (Started[i])
+            JoinThread(Threads[i]);
+    }
+
+    _cmsFree(ContextID, Threads);
+    _cmsFree(ContextID, Jobs);
+    _cmsFree(ContextID, Started);
+    return TRUE;
+}
+
+#endif
+
+
+// How many jobs are worth to run at once
+cmsUInt32Number CMSEXPORT _cmsGetMaxWorkers(cmsContext ContextID)
+{
+    _cmsParallelizationPluginChunkType* ptr = (_cmsParallelizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, ParallelizationPlugin);
+
+    if (ptr ->MaxWorkers != 0)
+        return ptr ->MaxWorkers;
+
+#ifdef CMS_NO_PTHREADS
+    // No threads and no one to provide them
+    if (ptr ->RunJobs == NULL) return 1;
+#endif
+
+    return CountProcessors();
+}
+
+
+// Run a set of independent jobs and wait for all of them to finish
+void CMSEXPORT _cmsRunParallelJobs(cmsContext ContextID, cmsUInt32Number nJobs, _cmsParallelJobFn Job, void* Cargo[])
+{
+    _cmsParallelizationPluginChunkType* ptr = (_cmsParallelizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, ParallelizationPlugin);
+    cmsUInt32Number i;
+
+    if (nJobs > 1) {
+
+        if (ptr ->RunJobs != NULL) {
+
+            if (ptr ->RunJobs(ContextID, nJobs, Job, Cargo)) return;
+        }
+#ifndef CMS_NO_PTHREADS
+        else {
+
+            if (defRunJobs(ContextID, nJobs, Job, Cargo)) return;
+        }
+#endif
+    }
+
+    // Serial fallback
+    for (i=0; i < nJobs; i++)
+        Job(Cargo[i]);
+}
+
+//--------------------------------------------------------------------------------------------------
+// CPU features
+
+// Used by testbed to force other code paths
+static cmsUInt32Number CPUFeaturesMask = 0xFFFFFFFFU;
+
+#ifdef CMS_SIMD_X86
+
+static
+void CPUID(cmsUInt32Number Leaf, cmsUInt32Number SubLeaf, cmsUInt32Number Regs[4])
+{
+#ifdef _MSC_VER
+    int r[4];
+
+    __cpuidex(r, (int) Leaf, (int) SubLeaf);
+
+    Regs[0] = (cmsUInt32Number) r[0];
+    Regs[1] = (cmsUInt32Number) r[1];
+    Regs[2] = (cmsUInt32Number) r[2];
+    Regs[3] = (cmsUInt32Number) r[3];
+#else
+    unsigned int a, b, c, d;
+
+    __cpuid_count(Leaf, SubLeaf, a, b, c, d);
+
+    Regs[0] = a; Regs[1] = b; Regs[2] = c; Regs[3] = d;
+#endif
+}
+
+// AVX registers are only usable if the operating system saves them on context switches
+static
+cmsBool OSSavesYMM(void)
+{
+#ifdef _MSC_VER
+    return (_xgetbv(0) & 6) == 6;
+#else
+    cmsUInt32Number eax, edx;
+
+    // xgetbv, written as bytes because old assemblers don't know about it
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a" (eax), "=d" (edx) : "c" (0));
+    return (eax & 6) == 6;
+#endif
+}
+
+#endif
+
+static
+cmsUInt32Number DetectCPUFeatures(void)
+{
+    cmsUInt32Number Features = 0;
+
+#ifdef CMS_SIMD_X86
+    cmsUInt32Number r[4];
+    cmsUInt32Number MaxLeaf;
+
+    CPUID(0, 0, r);
+    MaxLeaf = r[0];
+    if (MaxLeaf < 1) return 0;
+
+    CPUID(1, 0, r);
+
+    if (r[3] & (1U << 26)) Features |= cmsCPU_SSE2;
+
+    // OSXSAVE and AVX, then F16C in same leaf and AVX2 in leaf 7
+    if ((r[2] & (1U << 27)) && (r[2] & (1U << 28)) && OSSavesYMM()) {
+
+        if (r[2] & (1U << 29)) Features |= cmsCPU_F16C;
+
+        if (MaxLeaf >= 7) {
+
+            CPUID(7, 0, r);
+            if (r[1] & (1U << 5)) Features |= cmsCPU_AVX2;
+        }
+    }
+#endif
+
+    return Features;
+}
+
+// Features are detected only once. The high bit marks "not yet detected", a race here is harmless
+// because all threads would store the same value.
+cmsUInt32Number CMSEXPORT _cmsGetCPUFeatures(void)
+{
+    static cmsUInt32Number Features = 0x80000000U;
+
+    if (Features == 0x80000000U)
+        Features = DetectCPUFeatures();
+
+    return Features & CPUFeaturesMask;
+}
+
+cmsUInt32Number CMSEXPORT _cmsSetCPUFeaturesMask(cmsUInt32Number Mask)
+{
+    cmsUInt32Number Old = CPUFeaturesMask;
+
+    CPUFeaturesMask = Mask;
+    return Old;
+}
+
+//--------------------------------------------------------------------------------------------------
+// Timing, for transform statistics. A monotonic clock is used where available, CPU time otherwise
+
+cmsFloat64Number _cmsGetTime(void)
+{
+#if defined(CMS_IS_WINDOWS_)
+    LARGE_INTEGER Count, Freq;
+
+    if (QueryPerformanceFrequency(&Freq) && QueryPerformanceCounter(&Count))
+        return (cmsFloat64Number) Count.QuadPart / (cmsFloat64Number) Freq.QuadPart;
+
+    return (cmsFloat64Number) clock() / CLOCKS_PER_SEC;
+
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return (cmsFloat64Number) ts.tv_sec + ts.tv_nsec * 1E-9;
+
+    return (cmsFloat64Number) clock() / CLOCKS_PER_SEC;
+#else
+    return (cmsFloat64Number) clock() / CLOCKS_PER_SEC;
+#endif
+}
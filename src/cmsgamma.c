@@ -215,7 +215,9 @@ cmsToneCurve* AllocateToneCurveStruct(cmsContext ContextID, cmsUInt32Number nEnt
                                       const cmsUInt16Number* Values)
 {
     cmsToneCurve* p;
-    cmsUInt32Number i;
+    cmsUInt8Number* Block;
+    cmsUInt32Number i, Size;
+    cmsUInt32Number Samples[MAX_INPUT_DIMENSIONS];
 
     // We allow huge tables, which are then restricted for smoothing operations
     if (nEntries > 65530) {
@@ -228,37 +230,52 @@ cmsToneCurve* AllocateToneCurveStruct(cmsContext ContextID, cmsUInt32Number nEnt
         return NULL;
     }
 
-    // Allocate all required pointers, etc.
-    p = (cmsToneCurve*) _cmsMallocZero(ContextID, sizeof(cmsToneCurve));
-    if (!p) return NULL;
-
-    // In this case, there are no segments
-    if (nSegments == 0) {
-        p ->Segments = NULL;
-        p ->Evals = NULL;
+    // Curves are created and destroyed in big numbers when building transforms, so the structure, the
+    // 16-bit table, the interpolation parameters and the per-segment arrays are all kept in a single block.
+    // This saves many small allocations and keeps everything needed for evaluation close together.
+    if (nSegments > 0xFFFFU) {
+        cmsSignalError(ContextID, cmsERROR_RANGE, "Couldn't create tone curve of more than 65535 segments");
+        return NULL;
     }
-    else {
-        p ->Segments = (cmsCurveSegment*) _cmsCalloc(ContextID, nSegments, sizeof(cmsCurveSegment));
-        if (p ->Segments == NULL) goto Error;
 
-        p ->Evals    = (cmsParametricCurveEvaluator*) _cmsCalloc(ContextID, nSegments, sizeof(cmsParametricCurveEvaluator));
-        if (p ->Evals == NULL) goto Error;
-    }
+    Size = _cmsALIGNMEM(sizeof(cmsToneCurve)) + _cmsALIGNMEM(sizeof(cmsInterpParams)) +
+           _cmsALIGNMEM(nEntries * sizeof(cmsUInt16Number)) +
+           _cmsALIGNMEM(nSegments * sizeof(cmsCurveSegment)) +
+           _cmsALIGNMEM(nSegments * sizeof(cmsParametricCurveEvaluator)) +
+           _cmsALIGNMEM(nSegments * sizeof(cmsInterpParams*));
 
-    p -> nSegments = nSegments;
+    Block = (cmsUInt8Number*) _cmsMallocZero(ContextID, Size);
+    if (Block == NULL) return NULL;
+
+    p = (cmsToneCurve*) Block;
+    Block += _cmsALIGNMEM(sizeof(cmsToneCurve));
+
+    p ->InterpParams = (cmsInterpParams*) Block;
+    Block += _cmsALIGNMEM(sizeof(cmsInterpParams));
 
     // This 16-bit table contains a limited precision representation of the whole curve and is kept for
     // increasing xput on certain operations.
-    if (nEntries == 0) {
-        p ->Table16 = NULL;
-    }
-    else {
-       p ->Table16 = (cmsUInt16Number*)  _cmsCalloc(ContextID, nEntries, sizeof(cmsUInt16Number));
-       if (p ->Table16 == NULL) goto Error;
+    if (nEntries > 0) {
+        p ->Table16 = (cmsUInt16Number*) Block;
+        Block += _cmsALIGNMEM(nEntries * sizeof(cmsUInt16Number));
     }
 
     p -> nEntries  = nEntries;
 
+    // In this case, there are no segments
+    if (nSegments > 0) {
+
+        p ->Segments = (cmsCurveSegment*) Block;
+        Block += _cmsALIGNMEM(nSegments * sizeof(cmsCurveSegment));
+
+        p ->Evals = (cmsParametricCurveEvaluator*) Block;
+        Block += _cmsALIGNMEM(nSegments * sizeof(cmsParametricCurveEvaluator));
+
+        p ->SegInterp = (cmsInterpParams**) Block;
+    }
+
+    p -> nSegments = nSegments;
+
     // Initialize members if requested
     if (Values != NULL && (nEntries > 0)) {
 
@@ -272,15 +289,8 @@ cmsToneCurve* AllocateToneCurveStruct(cmsContext ContextID, cmsUInt32Number nEnt
 
         _cmsParametricCurvesCollection *c;
 
-        p ->SegInterp = (cmsInterpParams**) _cmsCalloc(ContextID, nSegments, sizeof(cmsInterpParams*));
-        if (p ->SegInterp == NULL) goto Error;
-
         for (i=0; i < nSegments; i++) {
 
-            // Type 0 is a special marker for table-based curves
-            if (Segments[i].Type == 0)
-                p ->SegInterp[i] = _cmsComputeInterpParams(ContextID, Segments[i].nGridPoints, 1, 1, NULL, CMS_LERP_FLAGS_FLOAT);
-
             memmove(&p ->Segments[i], &Segments[i], sizeof(cmsCurveSegment));
 
             if (Segments[i].Type == 0 && Segments[i].SampledPoints != NULL)
@@ -288,6 +298,11 @@ cmsToneCurve* AllocateToneCurveStruct(cmsContext ContextID, cmsUInt32Number nEnt
             else
                 p ->Segments[i].SampledPoints = NULL;
 
+            // Type 0 is a special marker for table-based curves. The table is set once here, so
+            // evaluation never writes on the curve and can be done from several threads at once.
+            if (Segments[i].Type == 0)
+                p ->SegInterp[i] = _cmsComputeInterpParams(ContextID, Segments[i].nGridPoints, 1, 1, p ->Segments[i].SampledPoints, CMS_LERP_FLAGS_FLOAT);
+
 
             c = GetParametricCurveByType(ContextID, Segments[i].Type, NULL);
             if (c != NULL)
@@ -295,15 +310,12 @@ cmsToneCurve* AllocateToneCurveStruct(cmsContext ContextID, cmsUInt32Number nEnt
         }
     }
 
-    p ->InterpParams = _cmsComputeInterpParams(ContextID, p ->nEntries, 1, 1, p->Table16, CMS_LERP_FLAGS_16BITS);
-    if (p->InterpParams != NULL)
+    Samples[0] = p ->nEntries;
+    if (_cmsInitInterpParams(ContextID, p ->InterpParams, Samples, 1, 1, p->Table16, CMS_LERP_FLAGS_16BITS))
         return p;
 
-Error:
-    if (p -> Segments) _cmsFree(ContextID, p ->Segments);
-    if (p -> Evals) _cmsFree(ContextID, p -> Evals);
-    if (p ->Table16) _cmsFree(ContextID, p ->Table16);
-    _cmsFree(ContextID, p);
+    p ->InterpParams ->ContextID = ContextID;
+    cmsFreeToneCurve(p);
     return NULL;
 }
 
@@ -683,9 +695,6 @@ cmsFloat64Number EvalSegmentedFn(const cmsToneCurve *g, cmsFloat64Number R)
 
                 cmsFloat32Number R1 = (cmsFloat32Number)(R - g->Segments[i].x0) / (g->Segments[i].x1 - g->Segments[i].x0);
 
-                // Setup the table (TODO: clean that)
-                g->SegInterp[i]->Table = g->Segments[i].SampledPoints;
-
                 g->SegInterp[i]->Interpolation.LerpFloat(&R1, &Out32, g->SegInterp[i]);
                 Out = (cmsFloat64Number) Out32;
 
@@ -862,11 +871,7 @@ void CMSEXPORT cmsFreeToneCurve(cmsToneCurve* Curve)
 
     ContextID = Curve ->InterpParams->ContextID;
 
-    _cmsFreeInterpParams(Curve ->InterpParams);
-
-    if (Curve -> Table16)
-        _cmsFree(ContextID, Curve ->Table16);
-
+    // Table16, segment arrays and interpolation parameters live in the same block as the curve
     if (Curve ->Segments) {
 
         cmsUInt32Number i;
@@ -880,15 +885,12 @@ void CMSEXPORT cmsFreeToneCurve(cmsToneCurve* Curve)
             if (Curve ->SegInterp[i] != 0)
                 _cmsFreeInterpParams(Curve->SegInterp[i]);
         }
-
-        _cmsFree(ContextID, Curve ->Segments);
-        _cmsFree(ContextID, Curve ->SegInterp);
     }
 
-    if (Curve -> Evals)
-        _cmsFree(ContextID, Curve -> Evals);
+    if (Curve ->FloatTable)
+        _cmsFree(ContextID, Curve ->FloatTable);
 
-    if (Curve) _cmsFree(ContextID, Curve);
+    _cmsFree(ContextID, Curve);
 }
 
 // Utility function, free 3 gamma tables
@@ -1366,6 +1368,134 @@ cmsFloat32Number CMSEXPORT cmsEvalToneCurveFloat(const cmsToneCurve* Curve, cmsF
     return (cmsFloat32Number) EvalSegmentedFn(Curve, v);
 }
 
+// Approximate evaluation ------------------------------------------------------------------------------------
+
+// Segmented curves are evaluated in floating point by calling the segment functions, which for the usual
+// parametric types means a pow() per sample. When the caller allows it, a table of FLOAT_TABLE_INTERVALS
+// intervals covering 0..1 is used instead, with linear interpolation. The table is checked against the exact
+// curve at the middle of each interval, and any interval where the error would exceed FLOAT_TABLE_MAX_ERROR is
+// left to the exact evaluation. Those are typically the first intervals of pure gamma curves with exponent
+// below 1, whose slope is infinite at zero. The max error of the approximate evaluation is therefore
+// FLOAT_TABLE_MAX_ERROR plus a little rounding, for smooth segments. Values outside 0..1 are always exact.
+
+#define FLOAT_TABLE_INTERVALS  4096
+#define FLOAT_TABLE_MAX_ERROR  1E-5
+
+typedef struct {
+
+    cmsUInt32Number  ExactBelow;                          // Intervals below this one are evaluated exactly
+    cmsFloat32Number Values[FLOAT_TABLE_INTERVALS + 2];   // One extra entry, so 1.0 needs no special case
+
+} _cmsCurveFloatTable;
+
+
+static
+_cmsCurveFloatTable* BuildFloatTable(const cmsToneCurve* Curve)
+{
+    _cmsCurveFloatTable* t;
+    cmsUInt32Number i;
+    cmsFloat64Number Mid, Err;
+
+    t = (_cmsCurveFloatTable*) _cmsMalloc(Curve ->InterpParams ->ContextID, sizeof(_cmsCurveFloatTable));
+    if (t == NULL) return NULL;
+
+    for (i=0; i <= FLOAT_TABLE_INTERVALS; i++)
+        t ->Values[i] = (cmsFloat32Number) EvalSegmentedFn(Curve, (cmsFloat64Number) i / FLOAT_TABLE_INTERVALS);
+
+    t ->Values[FLOAT_TABLE_INTERVALS + 1] = t ->Values[FLOAT_TABLE_INTERVALS];
+
+    // Find the last interval that is not good enough. Everything up to it goes exact. Segment breaks
+    // and kinks are caught as well, since the midpoint check fails on those.
+    t ->ExactBelow = 0;
+    for (i=0; i < FLOAT_TABLE_INTERVALS; i++) {
+
+        Mid = EvalSegmentedFn(Curve, (i + 0.5) / FLOAT_TABLE_INTERVALS);
+        Err = fabs(Mid - 0.5 * ((cmsFloat64Number) t ->Values[i] + t ->Values[i+1]));
+
+        if (!(Err <= FLOAT_TABLE_MAX_ERROR))
+            t ->ExactBelow = i + 1;
+    }
+
+    return t;
+}
+
+
+// The table is built on first use. Several threads may race to do that; all of them build a table, only one is
+// published and the others are thrown away. Once published, the table never changes, so no lock is needed.
+static
+const _cmsCurveFloatTable* GetFloatTable(const cmsToneCurve* Curve)
+{
+    // The cached table is not part of the curve value, so this is fine on a const curve
+    void** Slot = (void**) &((cmsToneCurve*) Curve) ->FloatTable;
+    _cmsCurveFloatTable* t;
+
+    t = (_cmsCurveFloatTable*) _cmsAtomicLoadPtr(Slot);
+    if (t != NULL) return t;
+
+    t = BuildFloatTable(Curve);
+    if (t == NULL) return NULL;
+
+    if (!_cmsAtomicCompareExchangePtr(Slot, NULL, t)) {
+
+        _cmsFree(Curve ->InterpParams ->ContextID, t);
+        t = (_cmsCurveFloatTable*) _cmsAtomicLoadPtr(Slot);
+    }
+
+    return t;
+}
+
+
+// Same as cmsEvalToneCurveFloat, but allowed to use the float table. See above for the error bounds
+cmsFloat32Number CMSEXPORT _cmsEvalToneCurveFloatApprox(const cmsToneCurve* Curve, cmsFloat32Number v)
+{
+    const _cmsCurveFloatTable* t;
+    cmsFloat32Number x, f;
+    cmsUInt32Number i;
+
+    _cmsAssert(Curve != NULL);
+
+    // 16-bit curves are tables already, and out of range or NaN values go exact
+    if (Curve ->nSegments == 0 || !(v >= 0 && v <= 1))
+        return cmsEvalToneCurveFloat(Curve, v);
+
+    t = GetFloatTable(Curve);
+    if (t == NULL)
+        return cmsEvalToneCurveFloat(Curve, v);
+
+    x = v * FLOAT_TABLE_INTERVALS;
+    i = (cmsUInt32Number) x;
+
+    if (i < t ->ExactBelow)
+        return (cmsFloat32Number) EvalSegmentedFn(Curve, v);
+
+    f = x - (cmsFloat32Number) i;
+    return t ->Values[i] + f * (t ->Values[i+1] - t ->Values[i]);
+}
+
+// Bytes held by the curve, including the cached float table if built
+cmsUInt32Number _cmsToneCurveMemorySize(const cmsToneCurve* Curve)
+{
+    cmsUInt32Number i, Size;
+
+    Size = _cmsALIGNMEM(sizeof(cmsToneCurve)) + _cmsALIGNMEM(sizeof(cmsInterpParams)) +
+           _cmsALIGNMEM(Curve ->nEntries * sizeof(cmsUInt16Number)) +
+           _cmsALIGNMEM(Curve ->nSegments * sizeof(cmsCurveSegment)) +
+           _cmsALIGNMEM(Curve ->nSegments * sizeof(cmsParametricCurveEvaluator)) +
+           _cmsALIGNMEM(Curve ->nSegments * sizeof(cmsInterpParams*));
+
+    for (i=0; i < Curve ->nSegments; i++) {
+
+        Size += Curve ->Segments[i].nGridPoints * sizeof(cmsFloat32Number);
+        if (Curve ->SegInterp[i] != NULL)
+            Size += sizeof(cmsInterpParams);
+    }
+
+    if (_cmsAtomicLoadPtr((void**) &((cmsToneCurve*) Curve) ->FloatTable) != NULL)
+        Size += sizeof(_cmsCurveFloatTable);
+
+    return Size;
+}
+
 // We need xput over here
 cmsUInt16Number CMSEXPORT cmsEvalToneCurve16(const cmsToneCurve* Curve, cmsUInt16Number v)
 {
@@ -1377,6 +1507,77 @@ cmsUInt16Number CMSEXPORT cmsEvalToneCurve16(const cmsToneCurve* Curve, cmsUInt1
     return out;
 }
 
+// Array versions. Same results as evaluating each value by the functions above, but the interpolation
+// kernel is called once for the whole run. In and Out may be the same buffer.
+void CMSEXPORT cmsEvalToneCurve16Array(const cmsToneCurve* Curve, const cmsUInt16Number In[], cmsUInt16Number Out[], cmsUInt32Number n)
+{
+    _cmsAssert(Curve != NULL);
+
+    if (n == 0) return;
+
+    _cmsAssert(In != NULL);
+    _cmsAssert(Out != NULL);
+
+    Curve ->InterpParams ->InterpolationBatch.Lerp16(In, Out, n, Curve ->InterpParams);
+}
+
+// 8 bits values have only 256 possible inputs, so for long runs a full table is built and then just indexed
+void CMSEXPORT cmsEvalToneCurve8Array(const cmsToneCurve* Curve, const cmsUInt8Number In[], cmsUInt8Number Out[], cmsUInt32Number n)
+{
+    cmsUInt16Number Ramp[256];
+    cmsUInt8Number  Table[256];
+    cmsUInt32Number i;
+
+    _cmsAssert(Curve != NULL);
+
+    if (n < 256) {
+
+        for (i=0; i < n; i++)
+            Out[i] = FROM_16_TO_8(cmsEvalToneCurve16(Curve, FROM_8_TO_16(In[i])));
+        return;
+    }
+
+    for (i=0; i < 256; i++)
+        Ramp[i] = FROM_8_TO_16(i);
+
+    cmsEvalToneCurve16Array(Curve, Ramp, Ramp, 256);
+
+    for (i=0; i < 256; i++)
+        Table[i] = FROM_16_TO_8(Ramp[i]);
+
+    for (i=0; i < n; i++)
+        Out[i] = Table[In[i]];
+}
+
+// 16-bit based curves go across the 16 bits kernel in chunks, segmented curves are evaluated one by one
+void CMSEXPORT cmsEvalToneCurveFloatArray(const cmsToneCurve* Curve, const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number n)
+{
+    cmsUInt16Number Tmp[256];
+    cmsUInt32Number i, j, Len;
+
+    _cmsAssert(Curve != NULL);
+
+    if (Curve ->nSegments > 0) {
+
+        for (i=0; i < n; i++)
+            Out[i] = (cmsFloat32Number) EvalSegmentedFn(Curve, In[i]);
+        return;
+    }
+
+    for (i=0; i < n; i += Len) {
+
+        Len = n - i < 256 ? n - i : 256;
+
+        for (j=0; j < Len; j++)
+            Tmp[j] = _cmsQuickSaturateWord(In[i + j] * 65535.0);
+
+        cmsEvalToneCurve16Array(Curve, Tmp, Tmp, Len);
+
+        for (j=0; j < Len; j++)
+            Out[i + j] = (cmsFloat32Number) (Tmp[j] / 65535.0);
+    }
+}
+
 
 // Least squares fitting.
 // A mathematical procedure for finding the best-fitting curve to a given set of points by
@@ -290,7 +290,8 @@ cmsPipeline* _cmsCreateGamutCheckPipeline(cmsContext ContextID,
                                           cmsUInt32Number Intents[],
                                           cmsFloat64Number AdaptationStates[],
                                           cmsUInt32Number nGamutPCSposition,
-                                          cmsHPROFILE hGamut)
+                                          cmsHPROFILE hGamut,
+                                          cmsUInt32Number dwFlags)
 {
     cmsHPROFILE hLab;
     cmsPipeline* Gamut;
@@ -393,7 +394,8 @@ cmsPipeline* _cmsCreateGamutCheckPipeline(cmsContext ContextID,
                 Gamut = NULL;
             } 
             else {
-                cmsStageSampleCLut16bit(CLUT, GamutSampler, (void*) &Chain, 0);
+                // Transforms in the chain have no cache, so the sampler can run on several threads
+                cmsStageSampleCLut16bit(CLUT, GamutSampler, (void*) &Chain, (dwFlags & cmsFLAGS_PARALLEL) ? SAMPLER_REENTRANT : 0);
             }
         }
     }
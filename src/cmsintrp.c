@@ -26,6 +26,10 @@
 
 #include "lcms2_internal.h"
 
+#ifdef CMS_SIMD_X86
+#include <immintrin.h>
+#endif
+
 // This module incorporates several interpolation routines, for 1 to 8 channels on input and
 // up to 65535 channels on output. The user may change those by using the interpolation plug-in
 
@@ -38,6 +42,11 @@
 
 // Interpolation routines by default
 static cmsInterpFunction DefaultInterpolatorsFactory(cmsUInt32Number nInputChannels, cmsUInt32Number nOutputChannels, cmsUInt32Number dwFlags);
+static cmsInterpBatchFunction DefaultBatchInterpolatorsFactory(cmsUInt32Number nInputChannels, cmsUInt32Number nOutputChannels, cmsUInt32Number dwFlags);
+
+// Batch interpolation, one pixel at time
+static void Eval16Batch(const cmsUInt16Number Input[], cmsUInt16Number Output[], cmsUInt32Number nPixels, const cmsInterpParams* p);
+static void EvalFloatBatch(const cmsFloat32Number Input[], cmsFloat32Number Output[], cmsUInt32Number nPixels, const cmsInterpParams* p);
 
 // This is the default factory
 _cmsInterpPluginChunkType _cmsInterpPluginChunk = { NULL };
@@ -87,6 +96,7 @@ cmsBool _cmsSetInterpolationRoutine(cmsContext ContextID, cmsInterpParams* p)
     _cmsInterpPluginChunkType* ptr = (_cmsInterpPluginChunkType*) _cmsContextGetClientChunk(ContextID, InterpPlugin);
 
     p ->Interpolation.Lerp16 = NULL;
+    p ->InterpolationBatch.Lerp16 = NULL;
 
    // Invoke factory, possibly in the Plug-in
     if (ptr ->Interpolators != NULL)
@@ -94,38 +104,49 @@ cmsBool _cmsSetInterpolationRoutine(cmsContext ContextID, cmsInterpParams* p)
     
     // If unsupported by the plug-in, go for the LittleCMS default.
     // If happens only if an extern plug-in is being used
-    if (p ->Interpolation.Lerp16 == NULL)
+    if (p ->Interpolation.Lerp16 == NULL) {
+
         p ->Interpolation = DefaultInterpolatorsFactory(p ->nInputs, p ->nOutputs, p ->dwFlags);
 
+        // Some default interpolators have specialized batch kernels as well
+        p ->InterpolationBatch = DefaultBatchInterpolatorsFactory(p ->nInputs, p ->nOutputs, p ->dwFlags);
+    }
+
     // Check for valid interpolator (we just check one member of the union)
     if (p ->Interpolation.Lerp16 == NULL) {
             return FALSE;
     }
 
+    // Anything else is evaluated on batches one pixel at time
+    if (p ->InterpolationBatch.Lerp16 == NULL) {
+
+        if (p ->dwFlags & CMS_LERP_FLAGS_FLOAT)
+            p ->InterpolationBatch.LerpFloat = EvalFloatBatch;
+        else
+            p ->InterpolationBatch.Lerp16 = Eval16Batch;
+    }
+
     return TRUE;
 }
 
 
-// This function precalculates as many parameters as possible to speed up the interpolation.
-cmsInterpParams* _cmsComputeInterpParamsEx(cmsContext ContextID,
-                                           const cmsUInt32Number nSamples[],
-                                           cmsUInt32Number InputChan, cmsUInt32Number OutputChan,
-                                           const void *Table,
-                                           cmsUInt32Number dwFlags)
+// This function precalculates as many parameters as possible to speed up the interpolation. The parameters
+// are stored in a zeroed object given by the caller, so it can be part of a bigger memory block.
+cmsBool _cmsInitInterpParams(cmsContext ContextID,
+                             cmsInterpParams* p,
+                             const cmsUInt32Number nSamples[],
+                             cmsUInt32Number InputChan, cmsUInt32Number OutputChan,
+                             const void *Table,
+                             cmsUInt32Number dwFlags)
 {
-    cmsInterpParams* p;
     cmsUInt32Number i;
 
     // Check for maximum inputs
     if (InputChan > MAX_INPUT_DIMENSIONS) {
              cmsSignalError(ContextID, cmsERROR_RANGE, "Too many input channels (%d channels, max=%d)", InputChan, MAX_INPUT_DIMENSIONS);
-            return NULL;
+            return FALSE;
     }
 
-    // Creates an empty object
-    p = (cmsInterpParams*) _cmsMallocZero(ContextID, sizeof(cmsInterpParams));
-    if (p == NULL) return NULL;
-
     // Keep original parameters
     p -> dwFlags  = dwFlags;
     p -> nInputs  = InputChan;
@@ -148,11 +169,31 @@ cmsInterpParams* _cmsComputeInterpParamsEx(cmsContext ContextID,
 
     if (!_cmsSetInterpolationRoutine(ContextID, p)) {
          cmsSignalError(ContextID, cmsERROR_UNKNOWN_EXTENSION, "Unsupported interpolation (%d->%d channels)", InputChan, OutputChan);
+        return FALSE;
+    }
+
+    // All seems ok
+    return TRUE;
+}
+
+// Same as anterior, but the parameters get their own memory block
+cmsInterpParams* _cmsComputeInterpParamsEx(cmsContext ContextID,
+                                           const cmsUInt32Number nSamples[],
+                                           cmsUInt32Number InputChan, cmsUInt32Number OutputChan,
+                                           const void *Table,
+                                           cmsUInt32Number dwFlags)
+{
+    cmsInterpParams* p;
+
+    // Creates an empty object
+    p = (cmsInterpParams*) _cmsMallocZero(ContextID, sizeof(cmsInterpParams));
+    if (p == NULL) return NULL;
+
+    if (!_cmsInitInterpParams(ContextID, p, nSamples, InputChan, OutputChan, Table, dwFlags)) {
         _cmsFree(ContextID, p);
         return NULL;
     }
 
-    // All seems ok
     return p;
 }
 
@@ -197,7 +238,7 @@ void LinLerp1D(CMSREGISTER const cmsUInt16Number Value[],
 {
     cmsUInt16Number y1, y0;
     int cell0, rest;
-    int val3;
+    cmsUInt32Number val3;
     const cmsUInt16Number* LutTable = (cmsUInt16Number*) p ->Table;
 
     // if last value...
@@ -207,8 +248,9 @@ void LinLerp1D(CMSREGISTER const cmsUInt16Number Value[],
     }
     else
     {
+        // Unsigned, as tables of more than 32768 entries would overflow an int
         val3 = p->Domain[0] * Value[0];
-        val3 = _cmsToFixedDomain(val3);    // To fixed 15.16
+        val3 += (val3 + 0x7fff) / 0xffff;  // To fixed 16.16
 
         cell0 = FIXED_TO_INT(val3);             // Cell is 16 MSB bits
         rest = FIXED_REST_TO_INT(val3);        // Rest is 16 LSB bits
@@ -220,6 +262,19 @@ void LinLerp1D(CMSREGISTER const cmsUInt16Number Value[],
     }
 }
 
+// Same, on a run of values. This is what tone curves use when evaluated on arrays
+static CMS_NO_SANITIZE
+void LinLerp1DBatch(const cmsUInt16Number Input[],
+                    cmsUInt16Number Output[],
+                    cmsUInt32Number nPixels,
+                    const cmsInterpParams* p)
+{
+    cmsUInt32Number i;
+
+    for (i=0; i < nPixels; i++)
+        LinLerp1D(Input + i, Output + i, p);
+}
+
 // To prevent out of bounds indexing
 cmsINLINE cmsFloat32Number fclamp(cmsFloat32Number v) 
 {
@@ -837,6 +892,564 @@ void TetrahedralInterp16(CMSREGISTER const cmsUInt16Number Input[],
 }
 
 
+// Batch interpolation ------------------------------------------------------------------------------------------------
+
+// Generic batch evaluation, just calls the one-pixel interpolator once per pixel. This is used for
+// anything without a specialized batch kernel, including the interpolators supplied by plug-ins.
+static
+void Eval16Batch(const cmsUInt16Number Input[],
+                 cmsUInt16Number Output[],
+                 cmsUInt32Number nPixels,
+                 const cmsInterpParams* p)
+{
+    _cmsInterpFn16 Lerp16 = p ->Interpolation.Lerp16;
+    cmsUInt32Number nIn  = p ->nInputs;
+    cmsUInt32Number nOut = p ->nOutputs;
+    cmsUInt32Number i;
+
+    for (i=0; i < nPixels; i++) {
+
+        Lerp16(Input, Output, p);
+        Input  += nIn;
+        Output += nOut;
+    }
+}
+
+static
+void EvalFloatBatch(const cmsFloat32Number Input[],
+                    cmsFloat32Number Output[],
+                    cmsUInt32Number nPixels,
+                    const cmsInterpParams* p)
+{
+    _cmsInterpFnFloat LerpFloat = p ->Interpolation.LerpFloat;
+    cmsUInt32Number nIn  = p ->nInputs;
+    cmsUInt32Number nOut = p ->nOutputs;
+    cmsUInt32Number i;
+
+    for (i=0; i < nPixels; i++) {
+
+        LerpFloat(Input, Output, p);
+        Input  += nIn;
+        Output += nOut;
+    }
+}
+
+// Plain C tetrahedral batch. The call is direct, so the compiler is free to inline the one-pixel kernel
+// and keep the table and domain in registers across pixels.
+static
+void TetrahedralInterp16Batch(const cmsUInt16Number Input[],
+                              cmsUInt16Number Output[],
+                              cmsUInt32Number nPixels,
+                              const cmsInterpParams* p)
+{
+    cmsUInt32Number nOut = p ->nOutputs;
+    cmsUInt32Number i;
+
+    for (i=0; i < nPixels; i++) {
+
+        TetrahedralInterp16(Input, Output, p);
+        Input  += 3;
+        Output += nOut;
+    }
+}
+
+static
+void TetrahedralInterpFloatBatch(const cmsFloat32Number Input[],
+                                 cmsFloat32Number Output[],
+                                 cmsUInt32Number nPixels,
+                                 const cmsInterpParams* p)
+{
+    cmsUInt32Number nOut = p ->nOutputs;
+    cmsUInt32Number i;
+
+    for (i=0; i < nPixels; i++) {
+
+        TetrahedralInterpFloat(Input, Output, p);
+        Input  += 3;
+        Output += nOut;
+    }
+}
+
+
+#ifdef CMS_SIMD_X86
+
+// SIMD tetrahedral kernels. Those evaluate one pixel per lane. Instead of branching, each lane walks
+// its own tetrahedron from the base node to the opposite node, one axis at time in decreasing order
+// of the fractional parts. The table is read by gathers.
+//
+// Float kernels select the tetrahedron by the same rules as TetrahedralInterpFloat, including ties,
+// and add the terms in same order, so results are bit-identical. In the 16 bits kernel any valid order
+// is fine, as integer arithmetic gives same result on ties whatever the tetrahedron.
+
+// Pixels processed per iteration
+#define SSE2_LANES  4
+#define AVX2_LANES  8
+
+static CMS_TARGET_AVX2
+void TetrahedralInterpFloatBatchAVX2(const cmsFloat32Number Input[],
+                                     cmsFloat32Number Output[],
+                                     cmsUInt32Number nPixels,
+                                     const cmsInterpParams* p)
+{
+    const cmsFloat32Number* LutTable = (const cmsFloat32Number*) p ->Table;
+    cmsUInt32Number TotalOut = p ->nOutputs;
+    cmsUInt32Number i, j, OutChan;
+    cmsFloat32Number Tmp[AVX2_LANES];
+
+    const __m256  One   = _mm256_set1_ps(1.0F);
+    const __m256  Tiny  = _mm256_set1_ps(1.0e-9F);
+    const __m256  DomX  = _mm256_set1_ps((cmsFloat32Number) p ->Domain[0]);
+    const __m256  DomY  = _mm256_set1_ps((cmsFloat32Number) p ->Domain[1]);
+    const __m256  DomZ  = _mm256_set1_ps((cmsFloat32Number) p ->Domain[2]);
+    const __m256i OptaX = _mm256_set1_epi32((int) p ->opta[2]);
+    const __m256i OptaY = _mm256_set1_epi32((int) p ->opta[1]);
+    const __m256i OptaZ = _mm256_set1_epi32((int) p ->opta[0]);
+    const __m256i Next  = _mm256_set1_epi32(1);
+
+    for (i=0; i + AVX2_LANES <= nPixels; i += AVX2_LANES) {
+
+        const cmsFloat32Number* In = Input + 3 * i;
+        __m256  vx, vy, vz, px, py, pz, rx, ry, rz;
+        __m256  gxy, gyz, gxz, gzx, gyx, gzy;
+        __m256  m1, m2, m3, m4, m5, m6, Taken;
+        __m256  XFirst, XSecond, YFirst, YSecond, ZFirst, ZSecond;
+        __m256i x0, y0, z0, X1, Y1, Z1;
+        __m256i v0, v1, v2, v3, A, B;
+
+        vx = _mm256_setr_ps(In[0], In[3], In[6], In[9],  In[12], In[15], In[18], In[21]);
+        vy = _mm256_setr_ps(In[1], In[4], In[7], In[10], In[13], In[16], In[19], In[22]);
+        vz = _mm256_setr_ps(In[2], In[5], In[8], In[11], In[14], In[17], In[20], In[23]);
+
+        // fclamp(). min() returns the second operand on NaN, the mask takes care of them afterwards
+        vx = _mm256_andnot_ps(_mm256_cmp_ps(vx, Tiny, _CMP_NGE_UQ), _mm256_min_ps(vx, One));
+        vy = _mm256_andnot_ps(_mm256_cmp_ps(vy, Tiny, _CMP_NGE_UQ), _mm256_min_ps(vy, One));
+        vz = _mm256_andnot_ps(_mm256_cmp_ps(vz, Tiny, _CMP_NGE_UQ), _mm256_min_ps(vz, One));
+
+        px = _mm256_mul_ps(vx, DomX);
+        py = _mm256_mul_ps(vy, DomY);
+        pz = _mm256_mul_ps(vz, DomZ);
+
+        // Values are positive, so truncation is floor
+        x0 = _mm256_cvttps_epi32(px); rx = _mm256_sub_ps(px, _mm256_cvtepi32_ps(x0));
+        y0 = _mm256_cvttps_epi32(py); ry = _mm256_sub_ps(py, _mm256_cvtepi32_ps(y0));
+        z0 = _mm256_cvttps_epi32(pz); rz = _mm256_sub_ps(pz, _mm256_cvtepi32_ps(z0));
+
+        // Step to next node, zero if at the upper edge
+        X1 = _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(vx, One, _CMP_GE_OQ)), OptaX);
+        Y1 = _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(vy, One, _CMP_GE_OQ)), OptaY);
+        Z1 = _mm256_andnot_si256(_mm256_castps_si256(_mm256_cmp_ps(vz, One, _CMP_GE_OQ)), OptaZ);
+
+        v0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(x0, OptaX), 
+                                               _mm256_mullo_epi32(y0, OptaY)), 
+                                               _mm256_mullo_epi32(z0, OptaZ));
+
+        // The six tetrahedra, in the order they are checked by the scalar code
+        gxy = _mm256_cmp_ps(rx, ry, _CMP_GE_OQ);
+        gyz = _mm256_cmp_ps(ry, rz, _CMP_GE_OQ);
+        gxz = _mm256_cmp_ps(rx, rz, _CMP_GE_OQ);
+        gzx = _mm256_cmp_ps(rz, rx, _CMP_GE_OQ);
+        gyx = _mm256_cmp_ps(ry, rx, _CMP_GE_OQ);
+        gzy = _mm256_cmp_ps(rz, ry, _CMP_GE_OQ);
+
+        m1 = _mm256_and_ps(gxy, gyz);                                       // x, y, z
+        Taken = m1;
+        m2 = _mm256_andnot_ps(Taken, _mm256_and_ps(gxz, gzy));              // x, z, y
+        Taken = _mm256_or_ps(Taken, m2);
+        m3 = _mm256_andnot_ps(Taken, _mm256_and_ps(gzx, gxy));              // z, x, y
+        Taken = _mm256_or_ps(Taken, m3);
+        m4 = _mm256_andnot_ps(Taken, _mm256_and_ps(gyx, gxz));              // y, x, z
+        Taken = _mm256_or_ps(Taken, m4);
+        m5 = _mm256_andnot_ps(Taken, _mm256_and_ps(gyz, gzx));              // y, z, x
+        Taken = _mm256_or_ps(Taken, m5);
+        m6 = _mm256_andnot_ps(Taken, _mm256_and_ps(gzy, gyx));              // z, y, x
+        Taken = _mm256_or_ps(Taken, m6);
+
+        // Position of each axis in the walk
+        XFirst  = _mm256_or_ps(m1, m2); XSecond = _mm256_or_ps(m3, m4);
+        YFirst  = _mm256_or_ps(m4, m5); YSecond = _mm256_or_ps(m1, m6);
+        ZFirst  = _mm256_or_ps(m3, m6); ZSecond = _mm256_or_ps(m2, m5);
+
+        A = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(XFirst), X1),
+                                            _mm256_and_si256(_mm256_castps_si256(YFirst), Y1)),
+                                            _mm256_and_si256(_mm256_castps_si256(ZFirst), Z1));
+
+        B = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(_mm256_castps_si256(XSecond), X1),
+                                            _mm256_and_si256(_mm256_castps_si256(YSecond), Y1)),
+                                            _mm256_and_si256(_mm256_castps_si256(ZSecond), Z1));
+
+        v1 = _mm256_add_epi32(v0, A);
+        v2 = _mm256_add_epi32(v1, B);
+        v3 = _mm256_add_epi32(_mm256_add_epi32(v0, X1), _mm256_add_epi32(Y1, Z1));
+
+        for (OutChan=0; OutChan < TotalOut; OutChan++) {
+
+            __m256 c0, c1, c2, c3, d1, d2, d3, dx, dy, dz, Out;
+
+            c0 = _mm256_i32gather_ps(LutTable, v0, 4);
+            c1 = _mm256_i32gather_ps(LutTable, v1, 4);
+            c2 = _mm256_i32gather_ps(LutTable, v2, 4);
+            c3 = _mm256_i32gather_ps(LutTable, v3, 4);
+
+            d1 = _mm256_sub_ps(c1, c0);
+            d2 = _mm256_sub_ps(c2, c1);
+            d3 = _mm256_sub_ps(c3, c2);
+
+            dx = _mm256_and_ps(Taken, _mm256_blendv_ps(_mm256_blendv_ps(d3, d2, XSecond), d1, XFirst));
+            dy = _mm256_and_ps(Taken, _mm256_blendv_ps(_mm256_blendv_ps(d3, d2, YSecond), d1, YFirst));
+            dz = _mm256_and_ps(Taken, _mm256_blendv_ps(_mm256_blendv_ps(d3, d2, ZSecond), d1, ZFirst));
+
+            Out = _mm256_add_ps(c0,  _mm256_mul_ps(dx, rx));
+            Out = _mm256_add_ps(Out, _mm256_mul_ps(dy, ry));
+            Out = _mm256_add_ps(Out, _mm256_mul_ps(dz, rz));
+
+            _mm256_storeu_ps(Tmp, Out);
+            for (j=0; j < AVX2_LANES; j++)
+                Output[(i + j) * TotalOut + OutChan] = Tmp[j];
+
+            v0 = _mm256_add_epi32(v0, Next);
+            v1 = _mm256_add_epi32(v1, Next);
+            v2 = _mm256_add_epi32(v2, Next);
+            v3 = _mm256_add_epi32(v3, Next);
+        }
+    }
+
+    // Remaining pixels
+    for (; i < nPixels; i++)
+        TetrahedralInterpFloat(Input + 3 * i, Output + i * TotalOut, p);
+}
+
+
+// 16 bits gathers read the table as 32 bits, so the last node would read two bytes past the end on
+// the last channel. Those few pixels go through the scalar code.
+static CMS_TARGET_AVX2 CMS_NO_SANITIZE
+void TetrahedralInterp16BatchAVX2(const cmsUInt16Number Input[],
+                                  cmsUInt16Number Output[],
+                                  cmsUInt32Number nPixels,
+                                  const cmsInterpParams* p)
+{
+    const int* LutTable = (const int*) p ->Table;
+    cmsUInt32Number TotalOut = p ->nOutputs;
+    cmsUInt32Number i, j, OutChan;
+    cmsS15Fixed16Number Tmp[AVX2_LANES];
+
+    const __m256i DomX  = _mm256_set1_epi32((int) p ->Domain[0]);
+    const __m256i DomY  = _mm256_set1_epi32((int) p ->Domain[1]);
+    const __m256i DomZ  = _mm256_set1_epi32((int) p ->Domain[2]);
+    const __m256i OptaX = _mm256_set1_epi32((int) p ->opta[2]);
+    const __m256i OptaY = _mm256_set1_epi32((int) p ->opta[1]);
+    const __m256i OptaZ = _mm256_set1_epi32((int) p ->opta[0]);
+    const __m256i LastNode = _mm256_set1_epi32((int) (p ->opta[2] * p ->Domain[0] + p ->opta[1] * p ->Domain[1] + p ->opta[0] * p ->Domain[2]));
+    const __m256i Ones  = _mm256_set1_epi32(1);
+    const __m256i Word  = _mm256_set1_epi32(0xFFFF);
+    const __m256i Half  = _mm256_set1_epi32(0x7FFF);
+    const __m256i Round = _mm256_set1_epi32(0x8001);
+
+    for (i=0; i + AVX2_LANES <= nPixels; i += AVX2_LANES) {
+
+        const cmsUInt16Number* In = Input + 3 * i;
+        __m256i vx, vy, vz, fx, fy, fz, t, m;
+        __m256i r1, r2, r3, o1, o2, o3, X1, Y1, Z1;
+        __m256i v0, v1, v2, v3;
+
+        vx = _mm256_setr_epi32(In[0], In[3], In[6], In[9],  In[12], In[15], In[18], In[21]);
+        vy = _mm256_setr_epi32(In[1], In[4], In[7], In[10], In[13], In[16], In[19], In[22]);
+        vz = _mm256_setr_epi32(In[2], In[5], In[8], In[11], In[14], In[17], In[20], In[23]);
+
+        // _cmsToFixedDomain(). Division by 0xFFFF is exact for the range of values here
+        fx = _mm256_mullo_epi32(vx, DomX);
+        t  = _mm256_add_epi32(fx, Half);
+        fx = _mm256_add_epi32(fx, _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), Ones), 16));
+
+        fy = _mm256_mullo_epi32(vy, DomY);
+        t  = _mm256_add_epi32(fy, Half);
+        fy = _mm256_add_epi32(fy, _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), Ones), 16));
+
+        fz = _mm256_mullo_epi32(vz, DomZ);
+        t  = _mm256_add_epi32(fz, Half);
+        fz = _mm256_add_epi32(fz, _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), Ones), 16));
+
+        // Step to next node, zero if at the upper edge
+        X1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(vx, Word), OptaX);
+        Y1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(vy, Word), OptaY);
+        Z1 = _mm256_andnot_si256(_mm256_cmpeq_epi32(vz, Word), OptaZ);
+
+        v0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(fx, 16), OptaX),
+                                               _mm256_mullo_epi32(_mm256_srli_epi32(fy, 16), OptaY)),
+                                               _mm256_mullo_epi32(_mm256_srli_epi32(fz, 16), OptaZ));
+
+        // Sort the rests in decreasing order, carrying along the node steps
+        r1 = _mm256_and_si256(fx, Word); o1 = X1;
+        r2 = _mm256_and_si256(fy, Word); o2 = Y1;
+        r3 = _mm256_and_si256(fz, Word); o3 = Z1;
+
+#define SWAP_IF_GREATER(ra, oa, rb, ob) \
+        m  = _mm256_cmpgt_epi32(rb, ra); \
+        t  = _mm256_blendv_epi8(ra, rb, m); rb = _mm256_blendv_epi8(rb, ra, m); ra = t; \
+        t  = _mm256_blendv_epi8(oa, ob, m); ob = _mm256_blendv_epi8(ob, oa, m); oa = t;
+
+        SWAP_IF_GREATER(r1, o1, r2, o2);
+        SWAP_IF_GREATER(r2, o2, r3, o3);
+        SWAP_IF_GREATER(r1, o1, r2, o2);
+
+#undef SWAP_IF_GREATER
+
+        v1 = _mm256_add_epi32(v0, o1);
+        v2 = _mm256_add_epi32(v1, o2);
+        v3 = _mm256_add_epi32(v2, o3);
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(v3, LastNode)) != 0) {
+
+            for (j=0; j < AVX2_LANES; j++)
+                TetrahedralInterp16(Input + 3 * (i + j), Output + (i + j) * TotalOut, p);
+            continue;
+        }
+
+        for (OutChan=0; OutChan < TotalOut; OutChan++) {
+
+            __m256i c0, c1, c2, c3, Rest, Out;
+
+            c0 = _mm256_and_si256(_mm256_i32gather_epi32(LutTable, v0, 2), Word);
+            c1 = _mm256_and_si256(_mm256_i32gather_epi32(LutTable, v1, 2), Word);
+            c2 = _mm256_and_si256(_mm256_i32gather_epi32(LutTable, v2, 2), Word);
+            c3 = _mm256_and_si256(_mm256_i32gather_epi32(LutTable, v3, 2), Word);
+
+            c3 = _mm256_sub_epi32(c3, c2);
+            c2 = _mm256_sub_epi32(c2, c1);
+            c1 = _mm256_sub_epi32(c1, c0);
+
+            Rest = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(c1, r1), _mm256_mullo_epi32(c2, r2)),
+                                    _mm256_add_epi32(_mm256_mullo_epi32(c3, r3), Round));
+
+            Out = _mm256_add_epi32(c0, _mm256_srai_epi32(_mm256_add_epi32(Rest, _mm256_srai_epi32(Rest, 16)), 16));
+
+            _mm256_storeu_si256((__m256i*) Tmp, Out);
+            for (j=0; j < AVX2_LANES; j++)
+                Output[(i + j) * TotalOut + OutChan] = (cmsUInt16Number) Tmp[j];
+
+            v0 = _mm256_add_epi32(v0, Ones);
+            v1 = _mm256_add_epi32(v1, Ones);
+            v2 = _mm256_add_epi32(v2, Ones);
+            v3 = _mm256_add_epi32(v3, Ones);
+        }
+    }
+
+    // Remaining pixels
+    for (; i < nPixels; i++)
+        TetrahedralInterp16(Input + 3 * i, Output + i * TotalOut, p);
+}
+
+
+// SSE2 has no gathers nor 32 bits multiplication, those are emulated
+cmsINLINE CMS_TARGET_SSE2 __m128i MulLo32SSE2(__m128i a, __m128i b)
+{
+    __m128i Even = _mm_mul_epu32(a, b);
+    __m128i Odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(Even, _MM_SHUFFLE(0, 0, 2, 0)), 
+                              _mm_shuffle_epi32(Odd,  _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+cmsINLINE CMS_TARGET_SSE2 __m128 GatherSSE2(const cmsFloat32Number* Table, __m128i Index)
+{
+    int k[SSE2_LANES];
+
+    _mm_storeu_si128((__m128i*) k, Index);
+    return _mm_setr_ps(Table[k[0]], Table[k[1]], Table[k[2]], Table[k[3]]);
+}
+
+cmsINLINE CMS_TARGET_SSE2 __m128 SelectSSE2(__m128 Mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(Mask, a), _mm_andnot_ps(Mask, b));
+}
+
+static CMS_TARGET_SSE2
+void TetrahedralInterpFloatBatchSSE2(const cmsFloat32Number Input[],
+                                     cmsFloat32Number Output[],
+                                     cmsUInt32Number nPixels,
+                                     const cmsInterpParams* p)
+{
+    const cmsFloat32Number* LutTable = (const cmsFloat32Number*) p ->Table;
+    cmsUInt32Number TotalOut = p ->nOutputs;
+    cmsUInt32Number i, j, OutChan;
+    cmsFloat32Number Tmp[SSE2_LANES];
+
+    const __m128  One   = _mm_set1_ps(1.0F);
+    const __m128  Tiny  = _mm_set1_ps(1.0e-9F);
+    const __m128  DomX  = _mm_set1_ps((cmsFloat32Number) p ->Domain[0]);
+    const __m128  DomY  = _mm_set1_ps((cmsFloat32Number) p ->Domain[1]);
+    const __m128  DomZ  = _mm_set1_ps((cmsFloat32Number) p ->Domain[2]);
+    const __m128i OptaX = _mm_set1_epi32((int) p ->opta[2]);
+    const __m128i OptaY = _mm_set1_epi32((int) p ->opta[1]);
+    const __m128i OptaZ = _mm_set1_epi32((int) p ->opta[0]);
+    const __m128i Next  = _mm_set1_epi32(1);
+
+    for (i=0; i + SSE2_LANES <= nPixels; i += SSE2_LANES) {
+
+        const cmsFloat32Number* In = Input + 3 * i;
+        __m128  vx, vy, vz, px, py, pz, rx, ry, rz;
+        __m128  gxy, gyz, gxz, gzx, gyx, gzy;
+        __m128  m1, m2, m3, m4, m5, m6, Taken;
+        __m128  XFirst, XSecond, YFirst, YSecond, ZFirst, ZSecond;
+        __m128i x0, y0, z0, X1, Y1, Z1;
+        __m128i v0, v1, v2, v3, A, B;
+
+        vx = _mm_setr_ps(In[0], In[3], In[6], In[9]);
+        vy = _mm_setr_ps(In[1], In[4], In[7], In[10]);
+        vz = _mm_setr_ps(In[2], In[5], In[8], In[11]);
+
+        // fclamp(). min() returns the second operand on NaN, the mask takes care of them afterwards
+        vx = _mm_andnot_ps(_mm_cmpnge_ps(vx, Tiny), _mm_min_ps(vx, One));
+        vy = _mm_andnot_ps(_mm_cmpnge_ps(vy, Tiny), _mm_min_ps(vy, One));
+        vz = _mm_andnot_ps(_mm_cmpnge_ps(vz, Tiny), _mm_min_ps(vz, One));
+
+        px = _mm_mul_ps(vx, DomX);
+        py = _mm_mul_ps(vy, DomY);
+        pz = _mm_mul_ps(vz, DomZ);
+
+        // Values are positive, so truncation is floor
+        x0 = _mm_cvttps_epi32(px); rx = _mm_sub_ps(px, _mm_cvtepi32_ps(x0));
+        y0 = _mm_cvttps_epi32(py); ry = _mm_sub_ps(py, _mm_cvtepi32_ps(y0));
+        z0 = _mm_cvttps_epi32(pz); rz = _mm_sub_ps(pz, _mm_cvtepi32_ps(z0));
+
+        // Step to next node, zero if at the upper edge
+        X1 = _mm_andnot_si128(_mm_castps_si128(_mm_cmpge_ps(vx, One)), OptaX);
+        Y1 = _mm_andnot_si128(_mm_castps_si128(_mm_cmpge_ps(vy, One)), OptaY);
+        Z1 = _mm_andnot_si128(_mm_castps_si128(_mm_cmpge_ps(vz, One)), OptaZ);
+
+        v0 = _mm_add_epi32(_mm_add_epi32(MulLo32SSE2(x0, OptaX), MulLo32SSE2(y0, OptaY)), MulLo32SSE2(z0, OptaZ));
+
+        // The six tetrahedra, in the order they are checked by the scalar code
+        gxy = _mm_cmpge_ps(rx, ry);
+        gyz = _mm_cmpge_ps(ry, rz);
+        gxz = _mm_cmpge_ps(rx, rz);
+        gzx = _mm_cmpge_ps(rz, rx);
+        gyx = _mm_cmpge_ps(ry, rx);
+        gzy = _mm_cmpge_ps(rz, ry);
+
+        m1 = _mm_and_ps(gxy, gyz);                                      // x, y, z
+        Taken = m1;
+        m2 = _mm_andnot_ps(Taken, _mm_and_ps(gxz, gzy));                // x, z, y
+        Taken = _mm_or_ps(Taken, m2);
+        m3 = _mm_andnot_ps(Taken, _mm_and_ps(gzx, gxy));                // z, x, y
+        Taken = _mm_or_ps(Taken, m3);
+        m4 = _mm_andnot_ps(Taken, _mm_and_ps(gyx, gxz));                // y, x, z
+        Taken = _mm_or_ps(Taken, m4);
+        m5 = _mm_andnot_ps(Taken, _mm_and_ps(gyz, gzx));                // y, z, x
+        Taken = _mm_or_ps(Taken, m5);
+        m6 = _mm_andnot_ps(Taken, _mm_and_ps(gzy, gyx));                // z, y, x
+        Taken = _mm_or_ps(Taken, m6);
+
+        // Position of each axis in the walk
+        XFirst  = _mm_or_ps(m1, m2); XSecond = _mm_or_ps(m3, m4);
+        YFirst  = _mm_or_ps(m4, m5); YSecond = _mm_or_ps(m1, m6);
+        ZFirst  = _mm_or_ps(m3, m6); ZSecond = _mm_or_ps(m2, m5);
+
+        A = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_castps_si128(XFirst), X1),
+                                      _mm_and_si128(_mm_castps_si128(YFirst), Y1)),
+                                      _mm_and_si128(_mm_castps_si128(ZFirst), Z1));
+
+        B = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_castps_si128(XSecond), X1),
+                                      _mm_and_si128(_mm_castps_si128(YSecond), Y1)),
+                                      _mm_and_si128(_mm_castps_si128(ZSecond), Z1));
+
+        v1 = _mm_add_epi32(v0, A);
+        v2 = _mm_add_epi32(v1, B);
+        v3 = _mm_add_epi32(_mm_add_epi32(v0, X1), _mm_add_epi32(Y1, Z1));
+
+        for (OutChan=0; OutChan < TotalOut; OutChan++) {
+
+            __m128 c0, c1, c2, c3, d1, d2, d3, dx, dy, dz, Out;
+
+            c0 = GatherSSE2(LutTable, v0);
+            c1 = GatherSSE2(LutTable, v1);
+            c2 = GatherSSE2(LutTable, v2);
+            c3 = GatherSSE2(LutTable, v3);
+
+            d1 = _mm_sub_ps(c1, c0);
+            d2 = _mm_sub_ps(c2, c1);
+            d3 = _mm_sub_ps(c3, c2);
+
+            dx = _mm_and_ps(Taken, SelectSSE2(XFirst, d1, SelectSSE2(XSecond, d2, d3)));
+            dy = _mm_and_ps(Taken, SelectSSE2(YFirst, d1, SelectSSE2(YSecond, d2, d3)));
+            dz = _mm_and_ps(Taken, SelectSSE2(ZFirst, d1, SelectSSE2(ZSecond, d2, d3)));
+
+            Out = _mm_add_ps(c0,  _mm_mul_ps(dx, rx));
+            Out = _mm_add_ps(Out, _mm_mul_ps(dy, ry));
+            Out = _mm_add_ps(Out, _mm_mul_ps(dz, rz));
+
+            _mm_storeu_ps(Tmp, Out);
+            for (j=0; j < SSE2_LANES; j++)
+                Output[(i + j) * TotalOut + OutChan] = Tmp[j];
+
+            v0 = _mm_add_epi32(v0, Next);
+            v1 = _mm_add_epi32(v1, Next);
+            v2 = _mm_add_epi32(v2, Next);
+            v3 = _mm_add_epi32(v3, Next);
+        }
+    }
+
+    // Remaining pixels
+    for (; i < nPixels; i++)
+        TetrahedralInterpFloat(Input + 3 * i, Output + i * TotalOut, p);
+}
+
+
+// 1D linear interpolation on eight values at once. Each gather reads two consecutive table entries as a
+// 32 bits word. The last value (0xFFFF) is taken as the end of the last cell instead of the start of
+// a cell past the table, so nothing is read beyond the end. Arithmetic wraps as in LinearInterp.
+static CMS_TARGET_AVX2 CMS_NO_SANITIZE
+void LinLerp1DBatchAVX2(const cmsUInt16Number Input[],
+                        cmsUInt16Number Output[],
+                        cmsUInt32Number nPixels,
+                        const cmsInterpParams* p)
+{
+    const int* LutTable = (const int*) p ->Table;
+    const __m256i Dom   = _mm256_set1_epi32((int) p ->Domain[0]);
+    const __m256i Last  = _mm256_set1_epi32((int) p ->Domain[0] - 1);
+    const __m256i Ones  = _mm256_set1_epi32(1);
+    const __m256i Word  = _mm256_set1_epi32(0xFFFF);
+    const __m256i Half  = _mm256_set1_epi32(0x7FFF);
+    const __m256i Round = _mm256_set1_epi32(0x8000);
+    const __m256i Full  = _mm256_set1_epi32(0x10000);
+    cmsUInt32Number i = 0;
+
+    // Single node tables have no cell to interpolate
+    if (p ->Domain[0] > 0) {
+
+        for (; i + AVX2_LANES <= nPixels; i += AVX2_LANES) {
+
+            __m256i v, f, t, m, cell, rest, y, y0, y1;
+
+            v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (Input + i)));
+
+            // _cmsToFixedDomain(). Division by 0xFFFF is exact up to the biggest tables allowed
+            f = _mm256_mullo_epi32(v, Dom);
+            t = _mm256_add_epi32(f, Half);
+            f = _mm256_add_epi32(f, _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(t, _mm256_srli_epi32(t, 16)), Ones), 16));
+
+            m    = _mm256_cmpeq_epi32(v, Word);
+            cell = _mm256_blendv_epi8(_mm256_srli_epi32(f, 16), Last, m);
+            rest = _mm256_blendv_epi8(_mm256_and_si256(f, Word), Full, m);
+
+            y  = _mm256_i32gather_epi32(LutTable, cell, 2);
+            y0 = _mm256_and_si256(y, Word);
+            y1 = _mm256_srli_epi32(y, 16);
+
+            y = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y1, y0), rest), Round);
+            y = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(y, 16), y0), Word);
+
+            _mm_storeu_si128((__m128i*) (Output + i), _mm_packus_epi32(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1)));
+        }
+    }
+
+    // Remaining values
+    for (; i < nPixels; i++)
+        LinLerp1D(Input + i, Output + i, p);
+}
+
+#endif
+
+
 #define DENS(i,j,k) (LutTable[(i)+(j)+(k)+OutChan])
 static CMS_NO_SANITIZE
 void Eval4Inputs(CMSREGISTER const cmsUInt16Number Input[],
@@ -1519,3 +2132,133 @@ cmsInterpFunction DefaultInterpolatorsFactory(cmsUInt32Number nInputChannels, cm
 
     return Interpolation;
 }
+
+
+// The default factory for batch kernels. Only 1D linear and 3D tetrahedral have them, everything
+// else gets NULL and therefore the generic one-pixel-at-time batch.
+static
+cmsInterpBatchFunction DefaultBatchInterpolatorsFactory(cmsUInt32Number nInputChannels, cmsUInt32Number nOutputChannels, cmsUInt32Number dwFlags)
+{
+    cmsInterpBatchFunction Interpolation;
+    cmsBool  IsFloat     = (dwFlags & CMS_LERP_FLAGS_FLOAT);
+    cmsBool  IsTrilinear = (dwFlags & CMS_LERP_FLAGS_TRILINEAR);
+#ifdef CMS_SIMD_X86
+    cmsUInt32Number CPU  = _cmsGetCPUFeatures();
+#endif
+
+    memset(&Interpolation, 0, sizeof(Interpolation));
+
+    // Tone curves
+    if (nInputChannels == 1 && nOutputChannels == 1 && !IsFloat) {
+
+#ifdef CMS_SIMD_X86
+        if (CPU & cmsCPU_AVX2)
+            Interpolation.Lerp16 = LinLerp1DBatchAVX2;
+        else
+#endif
+            Interpolation.Lerp16 = LinLerp1DBatch;
+
+        return Interpolation;
+    }
+
+    if (nInputChannels != 3 || IsTrilinear || nOutputChannels >= MAX_STAGE_CHANNELS)
+        return Interpolation;
+
+    if (IsFloat) {
+
+#ifdef CMS_SIMD_X86
+        if (CPU & cmsCPU_AVX2)
+            Interpolation.LerpFloat = TetrahedralInterpFloatBatchAVX2;
+        else
+        if (CPU & cmsCPU_SSE2)
+            Interpolation.LerpFloat = TetrahedralInterpFloatBatchSSE2;
+        else
+#endif
+            Interpolation.LerpFloat = TetrahedralInterpFloatBatch;
+    }
+    else {
+
+#ifdef CMS_SIMD_X86
+        if (CPU & cmsCPU_AVX2)
+            Interpolation.Lerp16 = TetrahedralInterp16BatchAVX2;
+        else
+#endif
+            Interpolation.Lerp16 = TetrahedralInterp16Batch;
+    }
+
+    return Interpolation;
+}
+
+// Names of the built-in routines, for cmsGetTransformInfo(). Plug-in routines are just "plugin"
+typedef struct {
+
+    _cmsInterpFn16    Lerp16;
+    _cmsInterpFnFloat LerpFloat;
+    const char*       Name;
+
+} InterpolatorName;
+
+static const InterpolatorName InterpolatorNames[] = {
+
+    { LinLerp1D,           LinLerp1Dfloat,           "LinLerp1D" },
+    { Eval1Input,          Eval1InputFloat,          "Eval1Input" },
+    { BilinearInterp16,    BilinearInterpFloat,      "BilinearInterp" },
+    { TrilinearInterp16,   TrilinearInterpFloat,     "TrilinearInterp" },
+    { TetrahedralInterp16, TetrahedralInterpFloat,   "TetrahedralInterp" },
+    { Eval4Inputs,         Eval4InputsFloat,         "Eval4Inputs" },
+    { Eval5Inputs,         Eval5InputsFloat,         "Eval5Inputs" },
+    { Eval6Inputs,         Eval6InputsFloat,         "Eval6Inputs" },
+    { Eval7Inputs,         Eval7InputsFloat,         "Eval7Inputs" },
+    { Eval8Inputs,         Eval8InputsFloat,         "Eval8Inputs" }
+};
+
+typedef struct {
+
+    _cmsInterpFn16Batch    Lerp16;
+    _cmsInterpFnFloatBatch LerpFloat;
+    const char*            Name;
+
+} BatchInterpolatorName;
+
+static const BatchInterpolatorName BatchInterpolatorNames[] = {
+
+    { Eval16Batch,               EvalFloatBatch,               "OneByOne" },
+    { LinLerp1DBatch,            NULL,                         "LinLerp1DBatch" },
+    { TetrahedralInterp16Batch,  TetrahedralInterpFloatBatch,  "TetrahedralInterpBatch" },
+#ifdef CMS_SIMD_X86
+    { LinLerp1DBatchAVX2,        NULL,                         "LinLerp1DBatchAVX2" },
+    { TetrahedralInterp16BatchAVX2, TetrahedralInterpFloatBatchAVX2, "TetrahedralInterpBatchAVX2" },
+    { NULL,                      TetrahedralInterpFloatBatchSSE2, "TetrahedralInterpBatchSSE2" },
+#endif
+};
+
+#define INTERPOLATOR_NAMES          (sizeof(InterpolatorNames) / sizeof(InterpolatorName))
+#define BATCH_INTERPOLATOR_NAMES    (sizeof(BatchInterpolatorNames) / sizeof(BatchInterpolatorName))
+
+// Returns the name of the routine in use, either the one-pixel or the batch one
+const char* _cmsGetInterpolationName(const cmsInterpParams* p, cmsBool Batch)
+{
+    cmsBool IsFloat = (p ->dwFlags & CMS_LERP_FLAGS_FLOAT);
+    cmsUInt32Number i;
+
+    if (Batch) {
+
+        for (i=0; i < BATCH_INTERPOLATOR_NAMES; i++) {
+
+            if (IsFloat ? p ->InterpolationBatch.LerpFloat == BatchInterpolatorNames[i].LerpFloat
+                        : p ->InterpolationBatch.Lerp16 == BatchInterpolatorNames[i].Lerp16)
+                return BatchInterpolatorNames[i].Name;
+        }
+    }
+    else {
+
+        for (i=0; i < INTERPOLATOR_NAMES; i++) {
+
+            if (IsFloat ? p ->Interpolation.LerpFloat == InterpolatorNames[i].LerpFloat
+                        : p ->Interpolation.Lerp16 == InterpolatorNames[i].Lerp16)
+                return InterpolatorNames[i].Name;
+        }
+    }
+
+    return "plugin";
+}
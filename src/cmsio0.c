@@ -26,6 +26,14 @@
 
 #include "lcms2_internal.h"
 
+#ifndef CMS_IS_WINDOWS_
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 // Generic I/O, tag dictionary management, profile struct
 
 // IOhandlers are abstractions used by littleCMS to read from whatever file, stream,
@@ -150,7 +158,8 @@ cmsUInt32Number MemoryRead(struct _cms_io_handler* iohandler, void *Buffer, cmsU
     cmsUInt8Number* Ptr;
     cmsUInt32Number len = size * count;
 
-    if (ResData -> Pointer + len > ResData -> Size){
+    // Pointer never goes past Size, so the remaining bytes cannot wrap, while Pointer + len could
+    if ((size != 0 && len / size != count) || len > ResData -> Size - ResData -> Pointer) {
 
         len = (ResData -> Size - ResData -> Pointer);
         cmsSignalError(iohandler ->ContextID, cmsERROR_READ, "Read from memory error. Got %d bytes, block should be of %d bytes", len, count * size);
@@ -308,6 +317,106 @@ Error:
     return NULL;
 }
 
+// Mapped files ------------------------------------------------------------
+
+// A read-only memory block mapped from a file. Only pages of the tags actually read are brought into
+// memory, and nothing is copied but the tag contents. Windows gets a regular file iohandler instead.
+
+#ifndef CMS_IS_WINDOWS_
+
+static
+cmsBool MappedWrite(struct _cms_io_handler* iohandler, cmsUInt32Number size, const void *Ptr)
+{
+    cmsSignalError(iohandler ->ContextID, cmsERROR_WRITE, "Cannot write on a mapped file");
+    return FALSE;
+
+    cmsUNUSED_PARAMETER(size);
+    cmsUNUSED_PARAMETER(Ptr);
+}
+
+static
+cmsBool  MappedClose(struct _cms_io_handler* iohandler)
+{
+    FILEMEM* ResData = (FILEMEM*) iohandler ->stream;
+    cmsBool rc = munmap(ResData ->Block, ResData ->Size) == 0;
+
+    _cmsFree(iohandler ->ContextID, ResData);
+    _cmsFree(iohandler ->ContextID, iohandler);
+
+    return rc;
+}
+
+cmsIOHANDLER* CMSEXPORT cmsOpenIOhandlerFromMappedFile(cmsContext ContextID, const char* FileName)
+{
+    cmsIOHANDLER* iohandler;
+    FILEMEM* fm;
+    struct stat st;
+    void* Block;
+    int fd;
+
+    _cmsAssert(FileName != NULL);
+
+    fd = open(FileName, O_RDONLY);
+    if (fd < 0) {
+        cmsSignalError(ContextID, cmsERROR_FILE, "File '%s' not found", FileName);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || (cmsUInt64Number) st.st_size > 0xFFFFFFFFU) {
+        close(fd);
+        cmsSignalError(ContextID, cmsERROR_FILE, "Cannot get size of file '%s'", FileName);
+        return NULL;
+    }
+
+    Block = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);      // The mapping keeps its own reference
+
+    if (Block == MAP_FAILED) {
+        cmsSignalError(ContextID, cmsERROR_FILE, "Cannot map file '%s'", FileName);
+        return NULL;
+    }
+
+    iohandler = (cmsIOHANDLER*) _cmsMallocZero(ContextID, sizeof(cmsIOHANDLER));
+    fm = (FILEMEM*) _cmsMallocZero(ContextID, sizeof(FILEMEM));
+
+    if (iohandler == NULL || fm == NULL) {
+        if (iohandler) _cmsFree(ContextID, iohandler);
+        if (fm) _cmsFree(ContextID, fm);
+        munmap(Block, (size_t) st.st_size);
+        return NULL;
+    }
+
+    fm ->Block   = (cmsUInt8Number*) Block;
+    fm ->Size    = (cmsUInt32Number) st.st_size;
+    fm ->Pointer = 0;
+    fm ->FreeBlockOnClose = FALSE;
+
+    iohandler ->ContextID = ContextID;
+    iohandler ->stream  = (void*) fm;
+    iohandler ->UsedSpace = 0;
+    iohandler ->ReportedSize = fm ->Size;
+
+    strncpy(iohandler -> PhysicalFile, FileName, sizeof(iohandler -> PhysicalFile)-1);
+    iohandler -> PhysicalFile[sizeof(iohandler -> PhysicalFile)-1] = 0;
+
+    iohandler ->Read    = MemoryRead;
+    iohandler ->Seek    = MemorySeek;
+    iohandler ->Close   = MappedClose;
+    iohandler ->Tell    = MemoryTell;
+    iohandler ->Write   = MappedWrite;
+
+    return iohandler;
+}
+
+#else
+
+cmsIOHANDLER* CMSEXPORT cmsOpenIOhandlerFromMappedFile(cmsContext ContextID, const char* FileName)
+{
+    return cmsOpenIOhandlerFromFile(ContextID, FileName, "r");
+}
+
+#endif
+
 // File-based stream -------------------------------------------------------
 
 // Read count elements of size bytes each. Return number of elements read
@@ -863,6 +972,7 @@ void CMSEXPORT cmsSetHeaderRenderingIntent(cmsHPROFILE hProfile, cmsUInt32Number
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> RenderingIntent = RenderingIntent;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsUInt32Number CMSEXPORT cmsGetHeaderFlags(cmsHPROFILE hProfile)
@@ -875,6 +985,7 @@ void CMSEXPORT cmsSetHeaderFlags(cmsHPROFILE hProfile, cmsUInt32Number Flags)
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> flags = (cmsUInt32Number) Flags;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsUInt32Number CMSEXPORT cmsGetHeaderManufacturer(cmsHPROFILE hProfile)
@@ -887,6 +998,7 @@ void CMSEXPORT cmsSetHeaderManufacturer(cmsHPROFILE hProfile, cmsUInt32Number ma
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> manufacturer = manufacturer;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsUInt32Number CMSEXPORT cmsGetHeaderCreator(cmsHPROFILE hProfile)
@@ -905,6 +1017,7 @@ void CMSEXPORT cmsSetHeaderModel(cmsHPROFILE hProfile, cmsUInt32Number model)
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> model = model;
+    Icc -> HasDigest = FALSE;
 }
 
 void CMSEXPORT cmsGetHeaderAttributes(cmsHPROFILE hProfile, cmsUInt64Number* Flags)
@@ -917,6 +1030,7 @@ void CMSEXPORT cmsSetHeaderAttributes(cmsHPROFILE hProfile, cmsUInt64Number Flag
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     memmove(&Icc -> attributes, &Flags, sizeof(cmsUInt64Number));
+    Icc -> HasDigest = FALSE;
 }
 
 void CMSEXPORT cmsGetHeaderProfileID(cmsHPROFILE hProfile, cmsUInt8Number* ProfileID)
@@ -929,6 +1043,7 @@ void CMSEXPORT cmsSetHeaderProfileID(cmsHPROFILE hProfile, cmsUInt8Number* Profi
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     memmove(&Icc -> ProfileID, ProfileID, 16);
+    Icc -> HasDigest = FALSE;
 }
 
 cmsBool  CMSEXPORT cmsGetHeaderCreationDateTime(cmsHPROFILE hProfile, struct tm *Dest)
@@ -948,6 +1063,7 @@ void CMSEXPORT cmsSetPCS(cmsHPROFILE hProfile, cmsColorSpaceSignature pcs)
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> PCS = pcs;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsColorSpaceSignature CMSEXPORT cmsGetColorSpace(cmsHPROFILE hProfile)
@@ -960,6 +1076,7 @@ void CMSEXPORT cmsSetColorSpace(cmsHPROFILE hProfile, cmsColorSpaceSignature sig
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> ColorSpace = sig;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsProfileClassSignature CMSEXPORT cmsGetDeviceClass(cmsHPROFILE hProfile)
@@ -972,6 +1089,7 @@ void CMSEXPORT cmsSetDeviceClass(cmsHPROFILE hProfile, cmsProfileClassSignature
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> DeviceClass = sig;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsUInt32Number CMSEXPORT cmsGetEncodedICCversion(cmsHPROFILE hProfile)
@@ -984,6 +1102,7 @@ void CMSEXPORT cmsSetEncodedICCversion(cmsHPROFILE hProfile, cmsUInt32Number Ver
 {
     _cmsICCPROFILE*  Icc = (_cmsICCPROFILE*) hProfile;
     Icc -> Version = Version;
+    Icc -> HasDigest = FALSE;
 }
 
 // Get an hexadecimal number with same digits as v
@@ -1014,6 +1133,7 @@ void  CMSEXPORT cmsSetProfileVersion(cmsHPROFILE hProfile, cmsFloat64Number Vers
     // 4.2 -> 0x4200000
 
     Icc -> Version = BaseToBase((cmsUInt32Number) floor(Version * 100.0 + 0.5), 10, 16) << 16;
+    Icc -> HasDigest = FALSE;
 }
 
 cmsFloat64Number CMSEXPORT cmsGetProfileVersion(cmsHPROFILE hProfile)
@@ -1311,11 +1431,13 @@ cmsBool SetLinks( _cmsICCPROFILE* Icc)
 
 // Low-level save to IOHANDLER. It returns the number of bytes used to
 // store the profile, or zero on error. io may be NULL and in this case
-// no data is written--only sizes are calculated
+// no data is written--only sizes are calculated. Offsets and handlers are
+// set on a copy, so the live profile is never touched and lock-free readers
+// may go on meanwhile. The mutex still serializes the use of its IOhandler.
 cmsUInt32Number CMSEXPORT cmsSaveProfileToIOhandler(cmsHPROFILE hProfile, cmsIOHANDLER* io)
 {
     _cmsICCPROFILE* Icc = (_cmsICCPROFILE*) hProfile;
-    _cmsICCPROFILE Keep;
+    _cmsICCPROFILE Work;
     cmsIOHANDLER* PrevIO = NULL;
     cmsUInt32Number UsedSpace;
     cmsContext ContextID;
@@ -1323,10 +1445,10 @@ cmsUInt32Number CMSEXPORT cmsSaveProfileToIOhandler(cmsHPROFILE hProfile, cmsIOH
     _cmsAssert(hProfile != NULL);
     
     if (!_cmsLockMutex(Icc->ContextID, Icc->UsrMutex)) return 0;
-    memmove(&Keep, Icc, sizeof(_cmsICCPROFILE));
+    memmove(&Work, Icc, sizeof(_cmsICCPROFILE));
 
     ContextID = cmsGetProfileContextID(hProfile);
-    PrevIO = Icc ->IOhandler = cmsOpenIOhandlerFromNULL(ContextID);
+    PrevIO = Work.IOhandler = cmsOpenIOhandlerFromNULL(ContextID);
     if (PrevIO == NULL) {
         _cmsUnlockMutex(Icc->ContextID, Icc->UsrMutex);
         return 0;
@@ -1334,8 +1456,8 @@ cmsUInt32Number CMSEXPORT cmsSaveProfileToIOhandler(cmsHPROFILE hProfile, cmsIOH
 
     // Pass #1 does compute offsets
 
-    if (!_cmsWriteHeader(Icc, 0)) goto Error;
-    if (!SaveTags(Icc, &Keep)) goto Error;
+    if (!_cmsWriteHeader(&Work, 0)) goto Error;
+    if (!SaveTags(&Work, Icc)) goto Error;
 
     UsedSpace = PrevIO ->UsedSpace;
 
@@ -1343,13 +1465,12 @@ cmsUInt32Number CMSEXPORT cmsSaveProfileToIOhandler(cmsHPROFILE hProfile, cmsIOH
 
     if (io != NULL) {
 
-        Icc ->IOhandler = io;
-        if (!SetLinks(Icc)) goto Error;
-        if (!_cmsWriteHeader(Icc, UsedSpace)) goto Error;
-        if (!SaveTags(Icc, &Keep)) goto Error;
+        Work.IOhandler = io;
+        if (!SetLinks(&Work)) goto Error;
+        if (!_cmsWriteHeader(&Work, UsedSpace)) goto Error;
+        if (!SaveTags(&Work, Icc)) goto Error;
     }
 
-    memmove(Icc, &Keep, sizeof(_cmsICCPROFILE));
     if (!cmsCloseIOhandler(PrevIO)) 
         UsedSpace = 0; // As a error marker
 
@@ -1360,7 +1481,6 @@ cmsUInt32Number CMSEXPORT cmsSaveProfileToIOhandler(cmsHPROFILE hProfile, cmsIOH
 
 Error:
     cmsCloseIOhandler(PrevIO);
-    memmove(Icc, &Keep, sizeof(_cmsICCPROFILE));
     _cmsUnlockMutex(Icc->ContextID, Icc->UsrMutex);
 
     return 0;
@@ -1496,7 +1616,33 @@ cmsBool IsTypeSupported(cmsTagDescriptor* TagDescriptor, cmsTagTypeSignature Typ
 }
 
 
-// That's the main read function
+// Checks whether a tag already in memory can be returned for the given signature
+static
+cmsBool IsCachedTagUsable(_cmsICCPROFILE* Icc, int n, cmsTagSignature sig)
+{
+    cmsTagDescriptor*  TagDescriptor;
+    cmsTagTypeSignature BaseType;
+
+    if (Icc->TagTypeHandlers[n] == NULL) return FALSE;
+
+    // Sanity check
+    BaseType = Icc->TagTypeHandlers[n]->Signature;
+    if (BaseType == 0) return FALSE;
+
+    TagDescriptor = _cmsGetTagDescriptor(Icc->ContextID, sig);
+    if (TagDescriptor == NULL) return FALSE;
+
+    if (!IsTypeSupported(TagDescriptor, BaseType)) return FALSE;
+
+    if (Icc ->TagSaveAsRaw[n]) return FALSE;  // We don't support read raw tags as cooked
+
+    return TRUE;
+}
+
+// That's the main read function. Tags are decoded once, under the profile mutex, and then published
+// atomically. From this point on, readers get the decoded object without locking at all, so several
+// threads may share a profile with no contention. Decoded tags are owned by the profile and should be
+// taken as read-only; the profile should not be modified while other threads are reading from it.
 void* CMSEXPORT cmsReadTag(cmsHPROFILE hProfile, cmsTagSignature sig)
 {
     _cmsICCPROFILE* Icc = (_cmsICCPROFILE*) hProfile;
@@ -1507,29 +1653,28 @@ void* CMSEXPORT cmsReadTag(cmsHPROFILE hProfile, cmsTagSignature sig)
     cmsTagTypeSignature BaseType;
     cmsUInt32Number Offset, TagSize;
     cmsUInt32Number ElemCount;
+    void* Ptr;
     int n;
 
+    // Lock-free path for tags already in memory
+    n = _cmsSearchTag(Icc, sig, TRUE);
+    if (n < 0) return NULL;               // Not found, return NULL
+
+    Ptr = _cmsAtomicLoadPtr(&Icc -> TagPtrs[n]);
+    if (Ptr != NULL)
+        return IsCachedTagUsable(Icc, n, sig) ? Ptr : NULL;
+
     if (!_cmsLockMutex(Icc->ContextID, Icc ->UsrMutex)) return NULL;
 
+    // Search again, someone else may have changed the directory meanwhile
     n = _cmsSearchTag(Icc, sig, TRUE);
     if (n < 0) goto Error;               // Not found, return NULL
 
 
-    // If the element is already in memory, return the pointer
+    // If the element has been read by another thread while waiting, return the pointer
     if (Icc -> TagPtrs[n]) {
 
-        if (Icc->TagTypeHandlers[n] == NULL) goto Error;
-
-        // Sanity check
-        BaseType = Icc->TagTypeHandlers[n]->Signature;
-        if (BaseType == 0) goto Error;
-
-        TagDescriptor = _cmsGetTagDescriptor(Icc->ContextID, sig);
-        if (TagDescriptor == NULL) goto Error;
-
-        if (!IsTypeSupported(TagDescriptor, BaseType)) goto Error;
-
-        if (Icc ->TagSaveAsRaw[n]) goto Error;  // We don't support read raw tags as cooked
+        if (!IsCachedTagUsable(Icc, n, sig)) goto Error;
 
         _cmsUnlockMutex(Icc->ContextID, Icc ->UsrMutex);
         return Icc -> TagPtrs[n];
@@ -1577,11 +1722,11 @@ void* CMSEXPORT cmsReadTag(cmsHPROFILE hProfile, cmsTagSignature sig)
 
     LocalTypeHandler.ContextID = Icc ->ContextID;
     LocalTypeHandler.ICCVersion = Icc ->Version;
-    Icc -> TagPtrs[n] = LocalTypeHandler.ReadPtr(&LocalTypeHandler, io, &ElemCount, TagSize);
+    Ptr = LocalTypeHandler.ReadPtr(&LocalTypeHandler, io, &ElemCount, TagSize);
 
     // The tag type is supported, but something wrong happened and we cannot read the tag.
     // let know the user about this (although it is just a warning)
-    if (Icc -> TagPtrs[n] == NULL) {
+    if (Ptr == NULL) {
 
         char String[5];
 
@@ -1596,16 +1741,19 @@ void* CMSEXPORT cmsReadTag(cmsHPROFILE hProfile, cmsTagSignature sig)
 
         char String[5];
 
+        LocalTypeHandler.FreePtr(&LocalTypeHandler, Ptr);
+
         _cmsTagSignature2String(String, sig);
         cmsSignalError(Icc ->ContextID, cmsERROR_CORRUPTION_DETECTED, "'%s' Inconsistent number of items: expected %d, got %d",
             String, TagDescriptor ->ElemCount, ElemCount);
         goto Error;
     }
 
+    // Publish the data. Type handler and contents are visible before the pointer.
+    _cmsAtomicStorePtr(&Icc -> TagPtrs[n], Ptr);
 
-    // Return the data
     _cmsUnlockMutex(Icc->ContextID, Icc ->UsrMutex);
-    return Icc -> TagPtrs[n];
+    return Ptr;
 
 
     // Return error and unlock tha data
@@ -1615,6 +1763,28 @@ Error:
 }
 
 
+// Decodes all known tags at once, so later reads never touch the IOhandler nor take the profile mutex.
+// Unknown and raw tags are left alone. Returns FALSE if any known tag cannot be read.
+cmsBool CMSEXPORT cmsProfilePreloadTags(cmsHPROFILE hProfile)
+{
+    _cmsICCPROFILE* Icc = (_cmsICCPROFILE*) hProfile;
+    cmsUInt32Number i;
+    cmsBool rc = TRUE;
+
+    for (i=0; i < Icc ->TagCount; i++) {
+
+        cmsTagSignature sig = Icc ->TagNames[i];
+
+        if (Icc ->TagSaveAsRaw[i]) continue;
+        if (_cmsGetTagDescriptor(Icc ->ContextID, sig) == NULL) continue;
+
+        if (cmsReadTag(hProfile, sig) == NULL) rc = FALSE;
+    }
+
+    return rc;
+}
+
+
 // Get true type of data
 cmsTagTypeSignature _cmsGetTagTrueType(cmsHPROFILE hProfile, cmsTagSignature sig)
 {
@@ -1646,6 +1816,7 @@ cmsBool CMSEXPORT cmsWriteTag(cmsHPROFILE hProfile, cmsTagSignature sig, const v
     char TypeString[5], SigString[5];
 
     if (!_cmsLockMutex(Icc->ContextID, Icc ->UsrMutex)) return FALSE;
+    Icc ->HasDigest = FALSE;
 
     // To delete tags.
     if (data == NULL) {
@@ -1881,6 +2052,7 @@ cmsBool CMSEXPORT cmsWriteRawTag(cmsHPROFILE hProfile, cmsTagSignature sig, cons
     int i;
 
     if (!_cmsLockMutex(Icc->ContextID, Icc ->UsrMutex)) return 0;
+    Icc ->HasDigest = FALSE;
 
     if (!_cmsNewTag(Icc, sig, &i)) {
         _cmsUnlockMutex(Icc->ContextID, Icc ->UsrMutex);
@@ -1912,6 +2084,7 @@ cmsBool CMSEXPORT cmsLinkTag(cmsHPROFILE hProfile, cmsTagSignature sig, cmsTagSi
     int i;
 
      if (!_cmsLockMutex(Icc->ContextID, Icc ->UsrMutex)) return FALSE;
+     Icc ->HasDigest = FALSE;
 
     if (!_cmsNewTag(Icc, sig, &i)) {
         _cmsUnlockMutex(Icc->ContextID, Icc ->UsrMutex);
@@ -50,6 +50,7 @@ cmsStage* CMSEXPORT _cmsStageAllocPlaceholder(cmsContext ContextID,
     ph ->InputChannels  = InputChannels;
     ph ->OutputChannels = OutputChannels;
     ph ->EvalPtr        = EvalPtr;
+    ph ->EvalBatchPtr   = NULL;
     ph ->DupElemPtr     = DupElemPtr;
     ph ->FreePtr        = FreePtr;
     ph ->Data           = Data;
@@ -57,6 +58,13 @@ cmsStage* CMSEXPORT _cmsStageAllocPlaceholder(cmsContext ContextID,
     return ph;
 }
 
+// Sets the optional batch evaluator of a stage. NULL restores pixel by pixel evaluation
+void CMSEXPORT _cmsStageSetEvalBatch(cmsStage* mpe, _cmsStageEvalBatchFn EvalBatchPtr)
+{
+    _cmsAssert(mpe != NULL);
+    mpe ->EvalBatchPtr = EvalBatchPtr;
+}
+
 
 static
 void EvaluateIdentity(const cmsFloat32Number In[],
@@ -66,16 +74,34 @@ void EvaluateIdentity(const cmsFloat32Number In[],
     memmove(Out, In, mpe ->InputChannels * sizeof(cmsFloat32Number));
 }
 
+static
+void EvaluateIdentityBatch(const cmsFloat32Number In[],
+                                 cmsFloat32Number Out[],
+                                 cmsUInt32Number nPixels,
+                                 cmsUInt32Number Stride,
+                           const cmsStage *mpe)
+{
+    cmsUInt32Number i;
+
+    for (i=0; i < mpe ->InputChannels; i++) {
+        memmove(Out + i * Stride, In + i * Stride, nPixels * sizeof(cmsFloat32Number));
+    }
+}
+
 
 cmsStage* CMSEXPORT cmsStageAllocIdentity(cmsContext ContextID, cmsUInt32Number nChannels)
 {
-    return _cmsStageAllocPlaceholder(ContextID,
+    cmsStage* mpe = _cmsStageAllocPlaceholder(ContextID,
                                    cmsSigIdentityElemType,
                                    nChannels, nChannels,
                                    EvaluateIdentity,
                                    NULL,
                                    NULL,
                                    NULL);
+    if (mpe == NULL) return NULL;
+
+    mpe ->EvalBatchPtr = EvaluateIdentityBatch;
+    return mpe;
  }
 
 // Conversion functions. From floating point to 16 bits
@@ -101,6 +127,46 @@ void From16ToFloat(const cmsUInt16Number In[], cmsFloat32Number Out[], cmsUInt32
 }
 
 
+// Batch evaluation works on blocks of planar floats. The scratch area is sized to hold the biggest stage
+// at least once, so MAX_STAGE_CHANNELS * pixels in block always fits
+#define BATCH_SCRATCH_SIZE  512
+
+// How many pixels of MaxChannels fit in the scratch area
+static
+cmsUInt32Number BatchBlockSize(cmsUInt32Number MaxChannels)
+{
+    _cmsAssert(MaxChannels <= MAX_STAGE_CHANNELS);
+
+    if (MaxChannels == 0) MaxChannels = 1;
+    return BATCH_SCRATCH_SIZE / MaxChannels;
+}
+
+// Evaluates a stage on a planar block, using the per-pixel evaluator if the stage has no batch evaluator
+static
+void EvalStageBatch(const cmsStage* mpe, const cmsFloat32Number In[], cmsFloat32Number Out[],
+                    cmsUInt32Number nPixels, cmsUInt32Number Stride)
+{
+    cmsFloat32Number PixIn[MAX_STAGE_CHANNELS], PixOut[MAX_STAGE_CHANNELS];
+    cmsUInt32Number i, c;
+
+    if (mpe ->EvalBatchPtr != NULL) {
+        mpe ->EvalBatchPtr(In, Out, nPixels, Stride, mpe);
+        return;
+    }
+
+    for (i=0; i < nPixels; i++) {
+
+        for (c=0; c < mpe ->InputChannels; c++)
+            PixIn[c] = In[c * Stride + i];
+
+        mpe ->EvalPtr(PixIn, PixOut, mpe);
+
+        for (c=0; c < mpe ->OutputChannels; c++)
+            Out[c * Stride + i] = PixOut[c];
+    }
+}
+
+
 // This function is quite useful to analyze the structure of a LUT and retrieve the MPE elements
 // that conform the LUT. It should be called with the LUT, the number of expected elements and
 // then a list of expected types followed with a list of cmsFloat64Number pointers to MPE elements. If
@@ -178,11 +244,53 @@ void EvaluateCurves(const cmsFloat32Number In[],
 
     if (Data ->TheCurves == NULL) return;
 
+    if (Data ->Approximate) {
+
+        for (i=0; i < Data ->nCurves; i++)
+            Out[i] = _cmsEvalToneCurveFloatApprox(Data ->TheCurves[i], In[i]);
+        return;
+    }
+
     for (i=0; i < Data ->nCurves; i++) {
         Out[i] = cmsEvalToneCurveFloat(Data ->TheCurves[i], In[i]);
     }
 }
 
+static
+void EvaluateCurvesBatch(const cmsFloat32Number In[],
+                         cmsFloat32Number Out[],
+                         cmsUInt32Number nPixels,
+                         cmsUInt32Number Stride,
+                         const cmsStage *mpe)
+{
+    _cmsStageToneCurvesData* Data;
+    const cmsToneCurve* Curve;
+    cmsUInt32Number i, j;
+
+    _cmsAssert(mpe != NULL);
+
+    Data = (_cmsStageToneCurvesData*) mpe ->Data;
+    if (Data == NULL) return;
+
+    if (Data ->TheCurves == NULL) return;
+
+    for (i=0; i < Data ->nCurves; i++) {
+
+        Curve = Data ->TheCurves[i];
+
+        if (Data ->Approximate) {
+
+            for (j=0; j < nPixels; j++)
+                Out[i * Stride + j] = _cmsEvalToneCurveFloatApprox(Curve, In[i * Stride + j]);
+            continue;
+        }
+
+        for (j=0; j < nPixels; j++) {
+            Out[i * Stride + j] = cmsEvalToneCurveFloat(Curve, In[i * Stride + j]);
+        }
+    }
+}
+
 static
 void CurveSetElemTypeFree(cmsStage* mpe)
 {
@@ -200,10 +308,26 @@ void CurveSetElemTypeFree(cmsStage* mpe)
                 cmsFreeToneCurve(Data ->TheCurves[i]);
         }
     }
-    _cmsFree(mpe ->ContextID, Data ->TheCurves);
     _cmsFree(mpe ->ContextID, Data);
 }
 
+// The curve set and the array of pointers to curves share the same block
+static
+_cmsStageToneCurvesData* AllocCurveSetData(cmsContext ContextID, cmsUInt32Number nCurves)
+{
+    _cmsStageToneCurvesData* Data;
+
+    if (nCurves > MAX_STAGE_CHANNELS) return NULL;
+
+    Data = (_cmsStageToneCurvesData*) _cmsMallocZero(ContextID, _cmsALIGNMEM(sizeof(_cmsStageToneCurvesData)) + nCurves * sizeof(cmsToneCurve*));
+    if (Data == NULL) return NULL;
+
+    Data ->nCurves   = nCurves;
+    Data ->TheCurves = (cmsToneCurve**) ((cmsUInt8Number*) Data + _cmsALIGNMEM(sizeof(_cmsStageToneCurvesData)));
+
+    return Data;
+}
+
 
 static
 void* CurveSetDup(cmsStage* mpe)
@@ -212,13 +336,10 @@ void* CurveSetDup(cmsStage* mpe)
     _cmsStageToneCurvesData* NewElem;
     cmsUInt32Number i;
 
-    NewElem = (_cmsStageToneCurvesData*) _cmsMallocZero(mpe ->ContextID, sizeof(_cmsStageToneCurvesData));
+    NewElem = AllocCurveSetData(mpe ->ContextID, Data ->nCurves);
     if (NewElem == NULL) return NULL;
 
-    NewElem ->nCurves   = Data ->nCurves;
-    NewElem ->TheCurves = (cmsToneCurve**) _cmsCalloc(mpe ->ContextID, NewElem ->nCurves, sizeof(cmsToneCurve*));
-
-    if (NewElem ->TheCurves == NULL) goto Error;
+    NewElem ->Approximate = Data ->Approximate;
 
     for (i=0; i < NewElem ->nCurves; i++) {
 
@@ -232,13 +353,10 @@ void* CurveSetDup(cmsStage* mpe)
 
 Error:
 
-    if (NewElem ->TheCurves != NULL) {
-        for (i=0; i < NewElem ->nCurves; i++) {
-            if (NewElem ->TheCurves[i])
-                cmsFreeToneCurve(NewElem ->TheCurves[i]);
-        }
+    for (i=0; i < NewElem ->nCurves; i++) {
+        if (NewElem ->TheCurves[i])
+            cmsFreeToneCurve(NewElem ->TheCurves[i]);
     }
-    _cmsFree(mpe ->ContextID, NewElem ->TheCurves);
     _cmsFree(mpe ->ContextID, NewElem);
     return NULL;
 }
@@ -256,7 +374,9 @@ cmsStage* CMSEXPORT cmsStageAllocToneCurves(cmsContext ContextID, cmsUInt32Numbe
                                      EvaluateCurves, CurveSetDup, CurveSetElemTypeFree, NULL );
     if (NewMPE == NULL) return NULL;
 
-    NewElem = (_cmsStageToneCurvesData*) _cmsMallocZero(ContextID, sizeof(_cmsStageToneCurvesData));
+    NewMPE ->EvalBatchPtr = EvaluateCurvesBatch;
+
+    NewElem = AllocCurveSetData(ContextID, nChannels);
     if (NewElem == NULL) {
         cmsStageFree(NewMPE);
         return NULL;
@@ -264,13 +384,6 @@ cmsStage* CMSEXPORT cmsStageAllocToneCurves(cmsContext ContextID, cmsUInt32Numbe
 
     NewMPE ->Data  = (void*) NewElem;
 
-    NewElem ->nCurves   = nChannels;
-    NewElem ->TheCurves = (cmsToneCurve**) _cmsCalloc(ContextID, nChannels, sizeof(cmsToneCurve*));
-    if (NewElem ->TheCurves == NULL) {
-        cmsStageFree(NewMPE);
-        return NULL;
-    }
-
     for (i=0; i < nChannels; i++) {
 
         if (Curves == NULL) {
@@ -335,6 +448,38 @@ void EvaluateMatrix(const cmsFloat32Number In[],
     // Output in 0..1.0 domain
 }
 
+// Same, on a planar block. Operations are kept in the same order for identical results.
+static
+void EvaluateMatrixBatch(const cmsFloat32Number In[],
+                         cmsFloat32Number Out[],
+                         cmsUInt32Number nPixels,
+                         cmsUInt32Number Stride,
+                         const cmsStage *mpe)
+{
+    cmsUInt32Number i, j, k;
+    _cmsStageMatrixData* Data = (_cmsStageMatrixData*) mpe ->Data;
+    const cmsFloat64Number* Row;
+    cmsFloat64Number Tmp;
+
+    for (i=0; i < mpe ->OutputChannels; i++) {
+
+        Row = Data->Double + i*mpe->InputChannels;
+
+        for (k=0; k < nPixels; k++) {
+
+            Tmp = 0;
+            for (j=0; j < mpe->InputChannels; j++) {
+                Tmp += In[j * Stride + k] * Row[j];
+            }
+
+            if (Data ->Offset != NULL)
+                Tmp += Data->Offset[i];
+
+            Out[i * Stride + k] = (cmsFloat32Number) Tmp;
+        }
+    }
+}
+
 
 // Duplicate a yet-existing matrix element
 static
@@ -395,6 +540,8 @@ cmsStage*  CMSEXPORT cmsStageAllocMatrix(cmsContext ContextID, cmsUInt32Number R
                                      EvaluateMatrix, MatrixElemDup, MatrixElemTypeFree, NULL );
     if (NewMPE == NULL) return NULL;
 
+    NewMPE ->EvalBatchPtr = EvaluateMatrixBatch;
+
 
     NewElem = (_cmsStageMatrixData*) _cmsMallocZero(ContextID, sizeof(_cmsStageMatrixData));
     if (NewElem == NULL) return NULL;
@@ -462,6 +609,67 @@ void EvaluateCLUTfloatIn16(const cmsFloat32Number In[], cmsFloat32Number Out[],
 }
 
 
+// Batch counterparts. The interpolators do work on chunky pixels, so the planar block is
+// reshuffled in small runs that fit in the stack.
+static
+void EvaluateCLUTfloatBatch(const cmsFloat32Number In[], cmsFloat32Number Out[],
+                            cmsUInt32Number nPixels, cmsUInt32Number Stride, const cmsStage *mpe)
+{
+    _cmsStageCLutData* Data = (_cmsStageCLutData*) mpe ->Data;
+    cmsFloat32Number InRun[BATCH_SCRATCH_SIZE], OutRun[BATCH_SCRATCH_SIZE];
+    cmsUInt32Number nIn  = mpe ->InputChannels;
+    cmsUInt32Number nOut = mpe ->OutputChannels;
+    cmsUInt32Number Block, Start, n, i, c;
+
+    Block = BatchBlockSize(nIn > nOut ? nIn : nOut);
+
+    for (Start = 0; Start < nPixels; Start += n) {
+
+        n = nPixels - Start;
+        if (n > Block) n = Block;
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nIn; c++)
+                InRun[i * nIn + c] = In[c * Stride + Start + i];
+
+        Data -> Params ->InterpolationBatch.LerpFloat(InRun, OutRun, n, Data->Params);
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nOut; c++)
+                Out[c * Stride + Start + i] = OutRun[i * nOut + c];
+    }
+}
+
+static
+void EvaluateCLUTfloatIn16Batch(const cmsFloat32Number In[], cmsFloat32Number Out[],
+                                cmsUInt32Number nPixels, cmsUInt32Number Stride, const cmsStage *mpe)
+{
+    _cmsStageCLutData* Data = (_cmsStageCLutData*) mpe ->Data;
+    cmsUInt16Number InRun[BATCH_SCRATCH_SIZE], OutRun[BATCH_SCRATCH_SIZE];
+    cmsUInt32Number nIn  = mpe ->InputChannels;
+    cmsUInt32Number nOut = mpe ->OutputChannels;
+    cmsUInt32Number Block, Start, n, i, c;
+
+    Block = BatchBlockSize(nIn > nOut ? nIn : nOut);
+
+    for (Start = 0; Start < nPixels; Start += n) {
+
+        n = nPixels - Start;
+        if (n > Block) n = Block;
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nIn; c++)
+                InRun[i * nIn + c] = _cmsQuickSaturateWord(In[c * Stride + Start + i] * 65535.0);
+
+        Data -> Params ->InterpolationBatch.Lerp16(InRun, OutRun, n, Data->Params);
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nOut; c++)
+                Out[c * Stride + Start + i] = (cmsFloat32Number) OutRun[i * nOut + c] / 65535.0F;
+    }
+}
+
+
 // Given an hypercube of b dimensions, with Dims[] number of nodes by dimension, calculate the total amount of nodes
 static
 cmsUInt32Number CubeSize(const cmsUInt32Number Dims[], cmsUInt32Number b)
@@ -569,6 +777,8 @@ cmsStage* CMSEXPORT cmsStageAllocCLut16bitGranular(cmsContext ContextID,
 
     if (NewMPE == NULL) return NULL;
 
+    NewMPE ->EvalBatchPtr = EvaluateCLUTfloatIn16Batch;
+
     NewElem = (_cmsStageCLutData*) _cmsMallocZero(ContextID, sizeof(_cmsStageCLutData));
     if (NewElem == NULL) {
         cmsStageFree(NewMPE);
@@ -659,6 +869,8 @@ cmsStage* CMSEXPORT cmsStageAllocCLutFloatGranular(cmsContext ContextID, const c
                                              EvaluateCLUTfloat, CLUTElemDup, CLutElemTypeFree, NULL);
     if (NewMPE == NULL) return NULL;
 
+    NewMPE ->EvalBatchPtr = EvaluateCLUTfloatBatch;
+
 
     NewElem = (_cmsStageCLutData*) _cmsMallocZero(ContextID, sizeof(_cmsStageCLutData));
     if (NewElem == NULL) {
@@ -745,42 +957,46 @@ cmsUInt16Number CMSEXPORT _cmsQuantizeVal(cmsFloat64Number i, cmsUInt32Number Ma
 }
 
 
-// This routine does a sweep on whole input space, and calls its callback
-// function on knots. returns TRUE if all ok, FALSE otherwise.
-cmsBool CMSEXPORT cmsStageSampleCLut16bit(cmsStage* mpe, cmsSAMPLER16 Sampler, void * Cargo, cmsUInt32Number dwFlags)
-{
-    int i, t, index, rest;
-    cmsUInt32Number nTotalPoints;
-    cmsUInt32Number nInputs, nOutputs;
-    cmsUInt32Number* nSamples;
-    cmsUInt16Number In[MAX_INPUT_DIMENSIONS+1], Out[MAX_STAGE_CHANNELS];
-    _cmsStageCLutData* clut;
+// Do not split the grid if each job would get less than this amount of nodes
+#define MIN_NODES_PER_JOB   1024
 
-    if (mpe == NULL) return FALSE;
+// A range of grid nodes to be sampled. Ranges never overlap, so each job writes on its own piece of the table
+typedef struct {
 
-    clut = (_cmsStageCLutData*) mpe->Data;
-
-    if (clut == NULL) return FALSE;
+    _cmsStageCLutData* clut;
+    cmsSAMPLER16      Sampler16;
+    cmsSAMPLERFLOAT   SamplerFloat;
+    cmsSAMPLER16_BATCH    Batch16;
+    cmsSAMPLERFLOAT_BATCH BatchFloat;
+    void*             Cargo;
+    cmsUInt32Number   dwFlags;
+    cmsUInt32Number   Start, End;
+    cmsBool           rc;
 
-    nSamples = clut->Params ->nSamples;
-    nInputs  = clut->Params ->nInputs;
-    nOutputs = clut->Params ->nOutputs;
+} _cmsSamplerJob;
 
-    if (nInputs <= 0) return FALSE;
-    if (nOutputs <= 0) return FALSE;
-    if (nInputs > MAX_INPUT_DIMENSIONS) return FALSE;
-    if (nOutputs >= MAX_STAGE_CHANNELS) return FALSE;
+static
+void SampleNodes16(void* Param)
+{
+    _cmsSamplerJob* j = (_cmsSamplerJob*) Param;
+    _cmsStageCLutData* clut = j ->clut;
+    cmsSAMPLER16 Sampler = j ->Sampler16;
+    const cmsUInt32Number* nSamples = clut->Params ->nSamples;
+    cmsUInt32Number nInputs  = clut->Params ->nInputs;
+    cmsUInt32Number nOutputs = clut->Params ->nOutputs;
+    cmsUInt16Number In[MAX_INPUT_DIMENSIONS+1], Out[MAX_STAGE_CHANNELS];
+    cmsUInt32Number i, index;
+    int t, rest;
 
     memset(In, 0, sizeof(In));
     memset(Out, 0, sizeof(Out));
 
-    nTotalPoints = CubeSize(nSamples, nInputs);
-    if (nTotalPoints == 0) return FALSE;
+    j ->rc = TRUE;
 
-    index = 0;
-    for (i = 0; i < (int) nTotalPoints; i++) {
+    index = j ->Start * nOutputs;
+    for (i = j ->Start; i < j ->End; i++) {
 
-        rest = i;
+        rest = (int) i;
         for (t = (int)nInputs - 1; t >= 0; --t) {
 
             cmsUInt32Number  Colorant = rest % nSamples[t];
@@ -795,10 +1011,12 @@ cmsBool CMSEXPORT cmsStageSampleCLut16bit(cmsStage* mpe, cmsSAMPLER16 Sampler, v
                 Out[t] = clut->Tab.T[index + t];
         }
 
-        if (!Sampler(In, Out, Cargo))
-            return FALSE;
+        if (!Sampler(In, Out, j ->Cargo)) {
+            j ->rc = FALSE;
+            return;
+        }
 
-        if (!(dwFlags & SAMPLER_INSPECT)) {
+        if (!(j ->dwFlags & SAMPLER_INSPECT)) {
 
             if (clut ->Tab.T != NULL) {
                 for (t=0; t < (int) nOutputs; t++)
@@ -808,36 +1026,27 @@ cmsBool CMSEXPORT cmsStageSampleCLut16bit(cmsStage* mpe, cmsSAMPLER16 Sampler, v
 
         index += nOutputs;
     }
-
-    return TRUE;
 }
 
-// Same as anterior, but for floating point
-cmsBool CMSEXPORT cmsStageSampleCLutFloat(cmsStage* mpe, cmsSAMPLERFLOAT Sampler, void * Cargo, cmsUInt32Number dwFlags)
-{
-    int i, t, index, rest;
-    cmsUInt32Number nTotalPoints;
-    cmsUInt32Number nInputs, nOutputs;
-    cmsUInt32Number* nSamples;
+static
+void SampleNodesFloat(void* Param)
+{
+    _cmsSamplerJob* j = (_cmsSamplerJob*) Param;
+    _cmsStageCLutData* clut = j ->clut;
+    cmsSAMPLERFLOAT Sampler = j ->SamplerFloat;
+    const cmsUInt32Number* nSamples = clut->Params ->nSamples;
+    cmsUInt32Number nInputs  = clut->Params ->nInputs;
+    cmsUInt32Number nOutputs = clut->Params ->nOutputs;
     cmsFloat32Number In[MAX_INPUT_DIMENSIONS+1], Out[MAX_STAGE_CHANNELS];
-    _cmsStageCLutData* clut = (_cmsStageCLutData*) mpe->Data;
-
-    nSamples = clut->Params ->nSamples;
-    nInputs  = clut->Params ->nInputs;
-    nOutputs = clut->Params ->nOutputs;
-
-    if (nInputs <= 0) return FALSE;
-    if (nOutputs <= 0) return FALSE;
-    if (nInputs  > MAX_INPUT_DIMENSIONS) return FALSE;
-    if (nOutputs >= MAX_STAGE_CHANNELS) return FALSE;
+    cmsUInt32Number i, index;
+    int t, rest;
 
-    nTotalPoints = CubeSize(nSamples, nInputs);
-    if (nTotalPoints == 0) return FALSE;
+    j ->rc = TRUE;
 
-    index = 0;
-    for (i = 0; i < (int)nTotalPoints; i++) {
+    index = j ->Start * nOutputs;
+    for (i = j ->Start; i < j ->End; i++) {
 
-        rest = i;
+        rest = (int) i;
         for (t = (int) nInputs-1; t >=0; --t) {
 
             cmsUInt32Number  Colorant = rest % nSamples[t];
@@ -852,10 +1061,12 @@ cmsBool CMSEXPORT cmsStageSampleCLutFloat(cmsStage* mpe, cmsSAMPLERFLOAT Sampler
                 Out[t] = clut->Tab.TFloat[index + t];
         }
 
-        if (!Sampler(In, Out, Cargo))
-            return FALSE;
+        if (!Sampler(In, Out, j ->Cargo)) {
+            j ->rc = FALSE;
+            return;
+        }
 
-        if (!(dwFlags & SAMPLER_INSPECT)) {
+        if (!(j ->dwFlags & SAMPLER_INSPECT)) {
 
             if (clut ->Tab.TFloat != NULL) {
                 for (t=0; t < (int) nOutputs; t++)
@@ -865,8 +1076,302 @@ cmsBool CMSEXPORT cmsStageSampleCLutFloat(cmsStage* mpe, cmsSAMPLERFLOAT Sampler
 
         index += nOutputs;
     }
+}
 
-    return TRUE;
+// Batch samplers get runs of up to this amount of consecutive nodes
+#define SAMPLER_BATCH_NODES 256
+
+// Grid coordinates of a node. Last dimension is the one that varies faster.
+static
+void NodeToCoordinates(cmsUInt32Number Node, const cmsUInt32Number nSamples[], cmsUInt32Number nInputs, cmsUInt32Number Coord[])
+{
+    int t;
+
+    for (t = (int) nInputs - 1; t >= 0; --t) {
+
+        Coord[t] = Node % nSamples[t];
+        Node /= nSamples[t];
+    }
+}
+
+// Moves to next node, as an odometer
+static
+void NextNode(const cmsUInt32Number nSamples[], cmsUInt32Number nInputs, cmsUInt32Number Coord[])
+{
+    int t;
+
+    for (t = (int) nInputs - 1; t >= 0; --t) {
+
+        if (++Coord[t] < nSamples[t]) return;
+        Coord[t] = 0;
+    }
+}
+
+static
+void SampleNodes16Batch(void* Param)
+{
+    _cmsSamplerJob* j = (_cmsSamplerJob*) Param;
+    _cmsStageCLutData* clut = j ->clut;
+    cmsContext ContextID = clut ->Params ->ContextID;
+    const cmsUInt32Number* nSamples = clut->Params ->nSamples;
+    cmsUInt32Number nInputs  = clut->Params ->nInputs;
+    cmsUInt32Number nOutputs = clut->Params ->nOutputs;
+    cmsUInt32Number Coord[MAX_INPUT_DIMENSIONS];
+    cmsUInt16Number *In, *Out, *Scratch = NULL;
+    cmsUInt32Number i, k, n;
+    int t;
+
+    j ->rc = FALSE;
+
+    In = (cmsUInt16Number*) _cmsCalloc(ContextID, SAMPLER_BATCH_NODES * nInputs, sizeof(cmsUInt16Number));
+    if (In == NULL) return;
+
+    // Results go straight to the table, unless we are just inspecting
+    if ((j ->dwFlags & SAMPLER_INSPECT) || clut ->Tab.T == NULL) {
+
+        Scratch = (cmsUInt16Number*) _cmsCalloc(ContextID, SAMPLER_BATCH_NODES * nOutputs, sizeof(cmsUInt16Number));
+        if (Scratch == NULL) {
+            _cmsFree(ContextID, In);
+            return;
+        }
+    }
+
+    j ->rc = TRUE;
+
+    NodeToCoordinates(j ->Start, nSamples, nInputs, Coord);
+
+    for (i = j ->Start; i < j ->End; i += n) {
+
+        n = j ->End - i;
+        if (n > SAMPLER_BATCH_NODES) n = SAMPLER_BATCH_NODES;
+
+        for (k=0; k < n; k++) {
+
+            for (t=0; t < (int) nInputs; t++)
+                In[k * nInputs + t] = _cmsQuantizeVal(Coord[t], nSamples[t]);
+
+            NextNode(nSamples, nInputs, Coord);
+        }
+
+        if (Scratch != NULL) {
+
+            Out = Scratch;
+            if (clut ->Tab.T != NULL)
+                memmove(Out, clut ->Tab.T + i * nOutputs, n * nOutputs * sizeof(cmsUInt16Number));
+        }
+        else
+            Out = clut ->Tab.T + i * nOutputs;
+
+        if (!j ->Batch16(In, Out, n, j ->Cargo)) {
+            j ->rc = FALSE;
+            break;
+        }
+    }
+
+    _cmsFree(ContextID, In);
+    if (Scratch) _cmsFree(ContextID, Scratch);
+}
+
+static
+void SampleNodesFloatBatch(void* Param)
+{
+    _cmsSamplerJob* j = (_cmsSamplerJob*) Param;
+    _cmsStageCLutData* clut = j ->clut;
+    cmsContext ContextID = clut ->Params ->ContextID;
+    const cmsUInt32Number* nSamples = clut->Params ->nSamples;
+    cmsUInt32Number nInputs  = clut->Params ->nInputs;
+    cmsUInt32Number nOutputs = clut->Params ->nOutputs;
+    cmsUInt32Number Coord[MAX_INPUT_DIMENSIONS];
+    cmsFloat32Number *In, *Out, *Scratch = NULL;
+    cmsUInt32Number i, k, n;
+    int t;
+
+    j ->rc = FALSE;
+
+    In = (cmsFloat32Number*) _cmsCalloc(ContextID, SAMPLER_BATCH_NODES * nInputs, sizeof(cmsFloat32Number));
+    if (In == NULL) return;
+
+    // Results go straight to the table, unless we are just inspecting
+    if ((j ->dwFlags & SAMPLER_INSPECT) || clut ->Tab.TFloat == NULL) {
+
+        Scratch = (cmsFloat32Number*) _cmsCalloc(ContextID, SAMPLER_BATCH_NODES * nOutputs, sizeof(cmsFloat32Number));
+        if (Scratch == NULL) {
+            _cmsFree(ContextID, In);
+            return;
+        }
+    }
+
+    j ->rc = TRUE;
+
+    NodeToCoordinates(j ->Start, nSamples, nInputs, Coord);
+
+    for (i = j ->Start; i < j ->End; i += n) {
+
+        n = j ->End - i;
+        if (n > SAMPLER_BATCH_NODES) n = SAMPLER_BATCH_NODES;
+
+        for (k=0; k < n; k++) {
+
+            for (t=0; t < (int) nInputs; t++)
+                In[k * nInputs + t] = (cmsFloat32Number) (_cmsQuantizeVal(Coord[t], nSamples[t]) / 65535.0);
+
+            NextNode(nSamples, nInputs, Coord);
+        }
+
+        if (Scratch != NULL) {
+
+            Out = Scratch;
+            if (clut ->Tab.TFloat != NULL)
+                memmove(Out, clut ->Tab.TFloat + i * nOutputs, n * nOutputs * sizeof(cmsFloat32Number));
+        }
+        else
+            Out = clut ->Tab.TFloat + i * nOutputs;
+
+        if (!j ->BatchFloat(In, Out, n, j ->Cargo)) {
+            j ->rc = FALSE;
+            break;
+        }
+    }
+
+    _cmsFree(ContextID, In);
+    if (Scratch) _cmsFree(ContextID, Scratch);
+}
+
+// Runs the sampling job on the whole grid. If the sampler is reentrant, the grid is split in ranges of
+// nodes that are sampled in parallel. Results are exactly the same as sampling serially. The order in which
+// the sampler is called is not defined in this case, and all ranges are always run to the end.
+static
+cmsBool SampleGrid(cmsStage* mpe, _cmsParallelJobFn Job, const _cmsSamplerJob* Template)
+{
+    _cmsStageCLutData* clut = Template ->clut;
+    cmsUInt32Number nTotalPoints, nJobs, Start, Size, i;
+    _cmsSamplerJob Whole;
+    _cmsSamplerJob* Jobs;
+    void** Cargos;
+    cmsBool rc;
+
+    if (clut ->Params ->nInputs <= 0) return FALSE;
+    if (clut ->Params ->nOutputs <= 0) return FALSE;
+    if (clut ->Params ->nInputs > MAX_INPUT_DIMENSIONS) return FALSE;
+    if (clut ->Params ->nOutputs >= MAX_STAGE_CHANNELS) return FALSE;
+
+    nTotalPoints = CubeSize(clut ->Params ->nSamples, clut ->Params ->nInputs);
+    if (nTotalPoints == 0) return FALSE;
+
+    Whole       = *Template;
+    Whole.Start = 0;
+    Whole.End   = nTotalPoints;
+    Whole.rc    = FALSE;
+
+    nJobs = 1;
+    if (Whole.dwFlags & SAMPLER_REENTRANT) {
+
+        nJobs = _cmsGetMaxWorkers(mpe ->ContextID);
+        if (nJobs > nTotalPoints / MIN_NODES_PER_JOB) nJobs = nTotalPoints / MIN_NODES_PER_JOB;
+    }
+
+    if (nJobs <= 1) {
+        Job(&Whole);
+        return Whole.rc;
+    }
+
+    Jobs   = (_cmsSamplerJob*) _cmsCalloc(mpe ->ContextID, nJobs, sizeof(_cmsSamplerJob));
+    Cargos = (void**) _cmsCalloc(mpe ->ContextID, nJobs, sizeof(void*));
+
+    if (Jobs == NULL || Cargos == NULL) {
+
+        if (Jobs) _cmsFree(mpe ->ContextID, Jobs);
+        if (Cargos) _cmsFree(mpe ->ContextID, Cargos);
+
+        Job(&Whole);
+        return Whole.rc;
+    }
+
+    Start = 0;
+    for (i=0; i < nJobs; i++) {
+
+        // Spread the remainder across first ranges
+        Size = nTotalPoints / nJobs + (i < nTotalPoints % nJobs ? 1 : 0);
+
+        Jobs[i] = Whole;
+        Jobs[i].Start = Start;
+        Jobs[i].End   = Start + Size;
+
+        Cargos[i] = &Jobs[i];
+        Start += Size;
+    }
+
+    _cmsRunParallelJobs(mpe ->ContextID, nJobs, Job, Cargos);
+
+    rc = TRUE;
+    for (i=0; i < nJobs; i++)
+        if (!Jobs[i].rc) rc = FALSE;
+
+    _cmsFree(mpe ->ContextID, Jobs);
+    _cmsFree(mpe ->ContextID, Cargos);
+    return rc;
+}
+
+
+// Gets the CLUT data of a stage, and fills the common part of the sampling job
+static
+_cmsStageCLutData* InitSamplerJob(_cmsSamplerJob* Job, cmsStage* mpe, void* Cargo, cmsUInt32Number dwFlags)
+{
+    memset(Job, 0, sizeof(_cmsSamplerJob));
+
+    if (mpe == NULL) return NULL;
+
+    Job ->clut    = (_cmsStageCLutData*) mpe->Data;
+    Job ->Cargo   = Cargo;
+    Job ->dwFlags = dwFlags;
+
+    return Job ->clut;
+}
+
+// This routine does a sweep on whole input space, and calls its callback
+// function on knots. returns TRUE if all ok, FALSE otherwise.
+cmsBool CMSEXPORT cmsStageSampleCLut16bit(cmsStage* mpe, cmsSAMPLER16 Sampler, void * Cargo, cmsUInt32Number dwFlags)
+{
+    _cmsSamplerJob Job;
+
+    if (InitSamplerJob(&Job, mpe, Cargo, dwFlags) == NULL) return FALSE;
+
+    Job.Sampler16 = Sampler;
+    return SampleGrid(mpe, SampleNodes16, &Job);
+}
+
+// Same as anterior, but for floating point
+cmsBool CMSEXPORT cmsStageSampleCLutFloat(cmsStage* mpe, cmsSAMPLERFLOAT Sampler, void * Cargo, cmsUInt32Number dwFlags)
+{
+    _cmsSamplerJob Job;
+
+    if (InitSamplerJob(&Job, mpe, Cargo, dwFlags) == NULL) return FALSE;
+
+    Job.SamplerFloat = Sampler;
+    return SampleGrid(mpe, SampleNodesFloat, &Job);
+}
+
+// Same sweep, but the sampler gets runs of consecutive nodes. This saves a call per node, and lets the
+// sampler use batch evaluation.
+cmsBool CMSEXPORT cmsStageSampleCLut16bitBatch(cmsStage* mpe, cmsSAMPLER16_BATCH Sampler, void * Cargo, cmsUInt32Number dwFlags)
+{
+    _cmsSamplerJob Job;
+
+    if (InitSamplerJob(&Job, mpe, Cargo, dwFlags) == NULL) return FALSE;
+
+    Job.Batch16 = Sampler;
+    return SampleGrid(mpe, SampleNodes16Batch, &Job);
+}
+
+// Batch sweep for floating point
+cmsBool CMSEXPORT cmsStageSampleCLutFloatBatch(cmsStage* mpe, cmsSAMPLERFLOAT_BATCH Sampler, void * Cargo, cmsUInt32Number dwFlags)
+{
+    _cmsSamplerJob Job;
+
+    if (InitSamplerJob(&Job, mpe, Cargo, dwFlags) == NULL) return FALSE;
+
+    Job.BatchFloat = Sampler;
+    return SampleGrid(mpe, SampleNodesFloatBatch, &Job);
 }
 
 
@@ -1255,6 +1760,7 @@ cmsStage* CMSEXPORT cmsStageDup(cmsStage* mpe)
     if (NewMPE == NULL) return NULL;
 
     NewMPE ->Implements = mpe ->Implements;
+    NewMPE ->EvalBatchPtr = mpe ->EvalBatchPtr;
 
     if (mpe ->DupElemPtr) {
 
@@ -1339,6 +1845,12 @@ void _LUTeval16(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Num
     FromFloatTo16(&Storage[Phase][0], Out, lut ->OutputChannels);
 }
 
+// Pipelines start evaluating stage by stage. Anything else has been set by an optimization
+cmsBool _cmsPipelineIsOptimized(const cmsPipeline* Lut)
+{
+    return Lut ->Eval16Fn != _LUTeval16;
+}
+
 
 
 // Does evaluate the LUT on cmsFloat32Number-basis.
@@ -1364,6 +1876,119 @@ void _LUTevalFloat(CMSREGISTER const cmsFloat32Number In[], CMSREGISTER cmsFloat
     memmove(Out, &Storage[Phase][0], lut ->OutputChannels * sizeof(cmsFloat32Number));
 }
 
+// Same for the floating point evaluator
+cmsBool _cmsPipelineIsFloatOptimized(const cmsPipeline* Lut)
+{
+    return Lut ->EvalFloatFn != _LUTevalFloat;
+}
+
+
+// Widest point of the pipeline, to size the blocks of batch evaluation
+static
+cmsUInt32Number PipelineMaxChannels(const cmsPipeline* lut)
+{
+    cmsStage *mpe;
+    cmsUInt32Number Max = lut ->InputChannels;
+
+    if (lut ->OutputChannels > Max) Max = lut ->OutputChannels;
+
+    for (mpe = lut ->Elements;
+         mpe != NULL;
+         mpe = mpe ->Next) {
+
+             if (mpe ->InputChannels > Max)  Max = mpe ->InputChannels;
+             if (mpe ->OutputChannels > Max) Max = mpe ->OutputChannels;
+    }
+
+    return Max;
+}
+
+// Batch counterpart of _LUTeval16. Pixels are converted to planar floats in blocks, and then each stage
+// is evaluated on the whole block before going to the next one. Results are identical to _LUTeval16.
+static
+void _LUTeval16Batch(const cmsUInt16Number In[], cmsUInt16Number Out[], cmsUInt32Number nPixels, const void* D)
+{
+    cmsPipeline* lut = (cmsPipeline*) D;
+    cmsStage *mpe;
+    cmsFloat32Number Storage[2][BATCH_SCRATCH_SIZE];
+    cmsUInt32Number nIn  = lut ->InputChannels;
+    cmsUInt32Number nOut = lut ->OutputChannels;
+    cmsUInt32Number Block, n, i, c;
+    int Phase, NextPhase;
+
+    Block = BatchBlockSize(PipelineMaxChannels(lut));
+
+    while (nPixels > 0) {
+
+        n = nPixels < Block ? nPixels : Block;
+
+        for (c=0; c < nIn; c++)
+            for (i=0; i < n; i++)
+                Storage[0][c * n + i] = (cmsFloat32Number) In[i * nIn + c] / 65535.0F;
+
+        Phase = 0;
+        for (mpe = lut ->Elements;
+             mpe != NULL;
+             mpe = mpe ->Next) {
+
+                 NextPhase = Phase ^ 1;
+                 EvalStageBatch(mpe, &Storage[Phase][0], &Storage[NextPhase][0], n, n);
+                 Phase = NextPhase;
+        }
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nOut; c++)
+                Out[i * nOut + c] = _cmsQuickSaturateWord(Storage[Phase][c * n + i] * 65535.0);
+
+        In  += n * nIn;
+        Out += n * nOut;
+        nPixels -= n;
+    }
+}
+
+
+// Batch counterpart of _LUTevalFloat
+static
+void _LUTevalFloatBatch(const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number nPixels, const void* D)
+{
+    cmsPipeline* lut = (cmsPipeline*) D;
+    cmsStage *mpe;
+    cmsFloat32Number Storage[2][BATCH_SCRATCH_SIZE];
+    cmsUInt32Number nIn  = lut ->InputChannels;
+    cmsUInt32Number nOut = lut ->OutputChannels;
+    cmsUInt32Number Block, n, i, c;
+    int Phase, NextPhase;
+
+    Block = BatchBlockSize(PipelineMaxChannels(lut));
+
+    while (nPixels > 0) {
+
+        n = nPixels < Block ? nPixels : Block;
+
+        for (c=0; c < nIn; c++)
+            for (i=0; i < n; i++)
+                Storage[0][c * n + i] = In[i * nIn + c];
+
+        Phase = 0;
+        for (mpe = lut ->Elements;
+             mpe != NULL;
+             mpe = mpe ->Next) {
+
+                 NextPhase = Phase ^ 1;
+                 EvalStageBatch(mpe, &Storage[Phase][0], &Storage[NextPhase][0], n, n);
+                 Phase = NextPhase;
+        }
+
+        for (i=0; i < n; i++)
+            for (c=0; c < nOut; c++)
+                Out[i * nOut + c] = Storage[Phase][c * n + i];
+
+        In  += n * nIn;
+        Out += n * nOut;
+        nPixels -= n;
+    }
+}
+
 
 // LUT Creation & Destruction
 cmsPipeline* CMSEXPORT cmsPipelineAlloc(cmsContext ContextID, cmsUInt32Number InputChannels, cmsUInt32Number OutputChannels)
@@ -1382,6 +2007,8 @@ cmsPipeline* CMSEXPORT cmsPipelineAlloc(cmsContext ContextID, cmsUInt32Number In
 
        NewLUT ->Eval16Fn    = _LUTeval16;
        NewLUT ->EvalFloatFn = _LUTevalFloat;
+       NewLUT ->Eval16BatchFn    = _LUTeval16Batch;
+       NewLUT ->EvalFloatBatchFn = _LUTevalFloatBatch;
        NewLUT ->DupDataFn   = NULL;
        NewLUT ->FreeDataFn  = NULL;
        NewLUT ->Data        = NewLUT;
@@ -1451,6 +2078,42 @@ void CMSEXPORT cmsPipelineEvalFloat(const cmsFloat32Number In[], cmsFloat32Numbe
 }
 
 
+// Evaluates a run of nPixels contiguous pixels on 16 bit-basis. Same results as calling cmsPipelineEval16 on each pixel.
+void CMSEXPORT cmsPipelineEval16Batch(const cmsUInt16Number In[], cmsUInt16Number Out[], cmsUInt32Number nPixels, const cmsPipeline* lut)
+{
+    cmsUInt32Number i;
+
+    _cmsAssert(lut != NULL);
+
+    if (lut ->Eval16BatchFn != NULL) {
+        lut ->Eval16BatchFn(In, Out, nPixels, lut->Data);
+        return;
+    }
+
+    for (i=0; i < nPixels; i++) {
+        lut ->Eval16Fn(In + i * lut ->InputChannels, Out + i * lut ->OutputChannels, lut->Data);
+    }
+}
+
+
+// Evaluates a run of nPixels contiguous pixels on cmsFloat32Number-basis.
+void CMSEXPORT cmsPipelineEvalFloatBatch(const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number nPixels, const cmsPipeline* lut)
+{
+    cmsUInt32Number i;
+
+    _cmsAssert(lut != NULL);
+
+    if (lut ->EvalFloatBatchFn != NULL) {
+        lut ->EvalFloatBatchFn(In, Out, nPixels, lut);
+        return;
+    }
+
+    for (i=0; i < nPixels; i++) {
+        lut ->EvalFloatFn(In + i * lut ->InputChannels, Out + i * lut ->OutputChannels, lut);
+    }
+}
+
+
 
 // Duplicates a LUT
 cmsPipeline* CMSEXPORT cmsPipelineDup(const cmsPipeline* lut)
@@ -1489,6 +2152,8 @@ cmsPipeline* CMSEXPORT cmsPipelineDup(const cmsPipeline* lut)
 
     NewLUT ->Eval16Fn    = lut ->Eval16Fn;
     NewLUT ->EvalFloatFn = lut ->EvalFloatFn;
+    NewLUT ->Eval16BatchFn    = lut ->Eval16BatchFn;
+    NewLUT ->EvalFloatBatchFn = lut ->EvalFloatBatchFn;
     NewLUT ->DupDataFn   = lut ->DupDataFn;
     NewLUT ->FreeDataFn  = lut ->FreeDataFn;
 
@@ -1661,6 +2326,97 @@ cmsUInt32Number CMSEXPORT cmsPipelineStageCount(const cmsPipeline* lut)
     return n;
 }
 
+// Describes a stage for cmsGetTransformInfo(). Sizes are those of the built-in types; other stages are just the header
+void _cmsGetStageInfo(const cmsStage* mpe, cmsStageInfo* Info)
+{
+    cmsUInt32Number i;
+
+    memset(Info, 0, sizeof(cmsStageInfo));
+
+    Info ->Type           = mpe ->Type;
+    Info ->Implements     = mpe ->Implements;
+    Info ->InputChannels  = mpe ->InputChannels;
+    Info ->OutputChannels = mpe ->OutputChannels;
+    Info ->MemorySize     = sizeof(cmsStage);
+
+    if (mpe ->Data == NULL) return;
+
+    switch (mpe ->Type) {
+
+    case cmsSigCurveSetElemType: {
+
+        _cmsStageToneCurvesData* Data = (_cmsStageToneCurvesData*) mpe ->Data;
+
+        Info ->MemorySize += sizeof(_cmsStageToneCurvesData) + Data ->nCurves * sizeof(cmsToneCurve*);
+
+        for (i=0; i < Data ->nCurves; i++) {
+
+            const cmsToneCurve* Curve = Data ->TheCurves[i];
+
+            if (Curve ->nEntries > Info ->Entries)
+                Info ->Entries = Curve ->nEntries;
+
+            Info ->MemorySize += _cmsToneCurveMemorySize(Curve);
+        }
+
+        if (Data ->nCurves > 0) {
+
+            strcpy(Info ->Interpolation,      _cmsGetInterpolationName(Data ->TheCurves[0] ->InterpParams, FALSE));
+            strcpy(Info ->BatchInterpolation, _cmsGetInterpolationName(Data ->TheCurves[0] ->InterpParams, TRUE));
+        }
+        }
+        break;
+
+    case cmsSigMatrixElemType: {
+
+        _cmsStageMatrixData* Data = (_cmsStageMatrixData*) mpe ->Data;
+
+        Info ->MemorySize += sizeof(_cmsStageMatrixData) + mpe ->InputChannels * mpe ->OutputChannels * sizeof(cmsFloat64Number);
+        if (Data ->Offset != NULL)
+            Info ->MemorySize += mpe ->OutputChannels * sizeof(cmsFloat64Number);
+        }
+        break;
+
+    case cmsSigCLutElemType: {
+
+        _cmsStageCLutData* Data = (_cmsStageCLutData*) mpe ->Data;
+
+        Info ->Entries     = Data ->nEntries;
+        Info ->MemorySize += sizeof(_cmsStageCLutData) +
+                             Data ->nEntries * (Data ->HasFloatValues ? sizeof(cmsFloat32Number) : sizeof(cmsUInt16Number));
+
+        if (Data ->Params != NULL) {
+
+            Info ->GridPoints  = Data ->Params ->nSamples[0];
+            Info ->MemorySize += sizeof(cmsInterpParams);
+
+            strcpy(Info ->Interpolation,      _cmsGetInterpolationName(Data ->Params, FALSE));
+            strcpy(Info ->BatchInterpolation, _cmsGetInterpolationName(Data ->Params, TRUE));
+        }
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Bytes held by the pipeline and its stages. Optimization data is not included
+cmsUInt32Number _cmsPipelineMemorySize(const cmsPipeline* Lut)
+{
+    cmsStageInfo Info;
+    cmsStage* mpe;
+    cmsUInt32Number Size = sizeof(cmsPipeline);
+
+    for (mpe = Lut ->Elements; mpe != NULL; mpe = mpe ->Next) {
+
+        _cmsGetStageInfo(mpe, &Info);
+        Size += Info.MemorySize;
+    }
+
+    return Size;
+}
+
 // This function may be used to set the optional evaluator and a block of private data. If private data is being used, an optional
 // duplicator and free functions should also be specified in order to duplicate the LUT construct. Use NULL to inhibit such functionality.
 void CMSEXPORT _cmsPipelineSetOptimizationParameters(cmsPipeline* Lut,
@@ -1671,11 +2427,27 @@ void CMSEXPORT _cmsPipelineSetOptimizationParameters(cmsPipeline* Lut,
 {
 
     Lut ->Eval16Fn = Eval16;
+    Lut ->Eval16BatchFn = NULL;
     Lut ->DupDataFn = DupPrivateDataFn;
     Lut ->FreeDataFn = FreePrivateDataFn;
     Lut ->Data = PrivateData;
 }
 
+// Sets the batch counterpart of the optimized evaluator. Private data is the same given to _cmsPipelineSetOptimizationParameters
+void CMSEXPORT _cmsPipelineSetOptimizationBatch(cmsPipeline* Lut, _cmsOPTeval16BatchFn Eval16Batch)
+{
+    _cmsAssert(Lut != NULL);
+    Lut ->Eval16BatchFn = Eval16Batch;
+}
+
+// Floating point evaluators are separated from the 16 bits ones, since float transforms do use the pipeline directly
+void _cmsPipelineSetOptimizationFloat(cmsPipeline* Lut, _cmsPipelineEvalFloatFn EvalFloat, _cmsPipelineEvalFloatBatchFn EvalFloatBatch)
+{
+    _cmsAssert(Lut != NULL);
+    Lut ->EvalFloatFn = EvalFloat;
+    Lut ->EvalFloatBatchFn = EvalFloatBatch;
+}
+
 
 // ----------------------------------------------------------- Reverse interpolation
 // Here's how it goes. The derivative Df(x) of the function f is the linear
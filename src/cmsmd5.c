@@ -258,6 +258,55 @@ void MD5finish(cmsProfileID* ProfileID,  cmsHANDLE Handle)
 // In the header, rendering intentent, attributes and ID should be set to zero
 // before computing MD5 checksum (per 6.1.13 in ICC spec)
 
+// Digest of the profile as it would be saved, used to identify profiles having no ID. Unlike cmsMD5computeID,
+// the profile is not touched, so several threads may ask for it. It is computed once and kept in the profile,
+// guarded by the profile mutex.
+cmsBool _cmsGetProfileDigest(cmsHPROFILE hProfile, cmsProfileID* Digest)
+{
+    _cmsICCPROFILE* Icc = (_cmsICCPROFILE*) hProfile;
+    cmsContext ContextID = Icc ->ContextID;
+    cmsUInt32Number BytesNeeded;
+    cmsUInt8Number* Mem;
+    cmsHANDLE MD5;
+    cmsBool Found;
+
+    if (!_cmsLockMutex(ContextID, Icc ->UsrMutex)) return FALSE;
+    Found = Icc ->HasDigest;
+    if (Found) *Digest = Icc ->Digest;
+    _cmsUnlockMutex(ContextID, Icc ->UsrMutex);
+
+    if (Found) return TRUE;
+
+    // Saving does take the mutex by itself
+    if (!cmsSaveProfileToMem(hProfile, NULL, &BytesNeeded)) return FALSE;
+
+    Mem = (cmsUInt8Number*) _cmsMalloc(ContextID, BytesNeeded);
+    if (Mem == NULL) return FALSE;
+
+    if (!cmsSaveProfileToMem(hProfile, Mem, &BytesNeeded)) {
+        _cmsFree(ContextID, Mem);
+        return FALSE;
+    }
+
+    MD5 = MD5alloc(ContextID);
+    if (MD5 == NULL) {
+        _cmsFree(ContextID, Mem);
+        return FALSE;
+    }
+
+    MD5add(MD5, Mem, BytesNeeded);
+    _cmsFree(ContextID, Mem);
+    MD5finish(Digest, MD5);
+
+    if (!_cmsLockMutex(ContextID, Icc ->UsrMutex)) return TRUE;
+    Icc ->Digest    = *Digest;
+    Icc ->HasDigest = TRUE;
+    _cmsUnlockMutex(ContextID, Icc ->UsrMutex);
+
+    return TRUE;
+}
+
+
 cmsBool CMSEXPORT cmsMD5computeID(cmsHPROFILE hProfile)
 {
     cmsContext   ContextID;
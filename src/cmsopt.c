@@ -26,6 +26,10 @@
 
 #include "lcms2_internal.h"
 
+#ifdef CMS_SIMD_X86
+#include <immintrin.h>
+#endif
+
 
 //----------------------------------------------------------------------------------
 
@@ -86,6 +90,7 @@ typedef struct {
     cmsUInt16Number Shaper2R[16385];    // 1.14 to 0..255
     cmsUInt16Number Shaper2G[16385];
     cmsUInt16Number Shaper2B[16385];
+    cmsUInt16Number Shaper2Pad;         // 32 bits gathers on the last entry of Shaper2B do read this one
 
 } MatShaper8Data;
 
@@ -321,6 +326,50 @@ void PrelinEval16(CMSREGISTER const cmsUInt16Number Input[],
 }
 
 
+// Batch counterpart of PrelinEval16. Curves are still applied pixel by pixel, but the CLUT, which is
+// where time goes, is evaluated on whole runs. Runs are short enough to live in the stack.
+#define PRELIN_BATCH_SIZE   64
+
+static
+void PrelinEval16Batch(const cmsUInt16Number Input[],
+                       cmsUInt16Number Output[],
+                       cmsUInt32Number nPixels,
+                       const void* D)
+{
+    Prelin16Data* p16 = (Prelin16Data*) D;
+    cmsUInt16Number  StageABC[PRELIN_BATCH_SIZE * MAX_INPUT_DIMENSIONS];
+    cmsUInt16Number  StageDEF[PRELIN_BATCH_SIZE * cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = p16 ->nInputs;
+    cmsUInt32Number nOut = p16 ->nOutputs;
+    cmsUInt32Number i, k, n;
+
+    while (nPixels > 0) {
+
+        n = nPixels < PRELIN_BATCH_SIZE ? nPixels : PRELIN_BATCH_SIZE;
+
+        for (k=0; k < n; k++) {
+            for (i=0; i < nIn; i++) {
+
+                p16 ->EvalCurveIn16[i](&Input[k*nIn + i], &StageABC[k*nIn + i], p16 ->ParamsCurveIn16[i]);
+            }
+        }
+
+        p16 ->CLUTparams ->InterpolationBatch.Lerp16(StageABC, StageDEF, n, p16 ->CLUTparams);
+
+        for (k=0; k < n; k++) {
+            for (i=0; i < nOut; i++) {
+
+                p16 ->EvalCurveOut16[i](&StageDEF[k*nOut + i], &Output[k*nOut + i], p16 ->ParamsCurveOut16[i]);
+            }
+        }
+
+        Input  += n * nIn;
+        Output += n * nOut;
+        nPixels -= n;
+    }
+}
+
+
 static
 void PrelinOpt16free(cmsContext ContextID, void* ptr)
 {
@@ -403,30 +452,41 @@ Prelin16Data* PrelinOpt16alloc(cmsContext ContextID,
 
 #define PRELINEARIZATION_POINTS 4096
 
+// Nodes evaluated by each call to the pipeline in the sampler
+#define SAMPLER_CHUNK_NODES 64
+
 // Sampler implemented by another LUT. This is a clean way to precalculate the devicelink 3D CLUT for
 // almost any transform. We use floating point precision and then convert from floating point to 16 bits.
+// Whole runs of nodes go through the pipeline at once, so stages can take profit of their batch evaluators.
 static
-cmsInt32Number XFormSampler16(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Number Out[], CMSREGISTER void* Cargo)
+cmsInt32Number XFormSampler16Batch(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Number Out[], cmsUInt32Number nNodes, CMSREGISTER void* Cargo)
 {
     cmsPipeline* Lut = (cmsPipeline*) Cargo;
-    cmsFloat32Number InFloat[cmsMAXCHANNELS], OutFloat[cmsMAXCHANNELS];
-    cmsUInt32Number i;
+    cmsFloat32Number InFloat[SAMPLER_CHUNK_NODES * cmsMAXCHANNELS], OutFloat[SAMPLER_CHUNK_NODES * cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = Lut ->InputChannels;
+    cmsUInt32Number nOut = Lut ->OutputChannels;
+    cmsUInt32Number i, n;
+
+    _cmsAssert(nIn < cmsMAXCHANNELS);
+    _cmsAssert(nOut < cmsMAXCHANNELS);
 
-    _cmsAssert(Lut -> InputChannels < cmsMAXCHANNELS);
-    _cmsAssert(Lut -> OutputChannels < cmsMAXCHANNELS);
+    while (nNodes > 0) {
 
-    // From 16 bit to floating point
-    for (i=0; i < Lut ->InputChannels; i++)
-        InFloat[i] = (cmsFloat32Number) (In[i] / 65535.0);
+        n = nNodes > SAMPLER_CHUNK_NODES ? SAMPLER_CHUNK_NODES : nNodes;
 
-    // Evaluate in floating point
-    cmsPipelineEvalFloat(InFloat, OutFloat, Lut);
+        for (i=0; i < n * nIn; i++)
+            InFloat[i] = (cmsFloat32Number) (In[i] / 65535.0);
 
-    // Back to 16 bits representation
-    for (i=0; i < Lut ->OutputChannels; i++)
-        Out[i] = _cmsQuickSaturateWord(OutFloat[i] * 65535.0);
+        cmsPipelineEvalFloatBatch(InFloat, OutFloat, n, Lut);
+
+        for (i=0; i < n * nOut; i++)
+            Out[i] = _cmsQuickSaturateWord(OutFloat[i] * 65535.0);
+
+        In     += n * nIn;
+        Out    += n * nOut;
+        nNodes -= n;
+    }
 
-    // Always succeed
     return TRUE;
 }
 
@@ -731,7 +791,7 @@ cmsBool OptimizeByResampling(cmsPipeline** Lut, cmsUInt32Number Intent, cmsUInt3
 
     // Now its time to do the sampling. We have to ignore pre/post linearization
     // The source LUT without pre/post curves is passed as parameter.
-    if (!cmsStageSampleCLut16bit(CLUT, XFormSampler16, (void*) Src, 0)) {
+    if (!cmsStageSampleCLut16bitBatch(CLUT, XFormSampler16Batch, (void*) Src, (*dwFlags & cmsFLAGS_PARALLEL) ? SAMPLER_REENTRANT : 0)) {
 Error:
         // Ops, something went wrong, Restore stages
         if (KeepPreLin != NULL) {
@@ -766,6 +826,7 @@ Error:
     if (DataSetIn == NULL && DataSetOut == NULL) {
 
         _cmsPipelineSetOptimizationParameters(Dest, (_cmsOPTeval16Fn) DataCLUT->Params->Interpolation.Lerp16, DataCLUT->Params, NULL, NULL);
+        _cmsPipelineSetOptimizationBatch(Dest, (_cmsOPTeval16BatchFn) DataCLUT->Params->InterpolationBatch.Lerp16);
     }
     else {
 
@@ -777,6 +838,7 @@ Error:
             DataSetOut);
 
         _cmsPipelineSetOptimizationParameters(Dest, PrelinEval16, (void*) p16, PrelinOpt16free, Prelin16dup);
+        _cmsPipelineSetOptimizationBatch(Dest, PrelinEval16Batch);
     }
 
 
@@ -843,8 +905,9 @@ void SlopeLimiting(cmsToneCurve* g)
 static
 Prelin8Data* PrelinOpt8alloc(cmsContext ContextID, const cmsInterpParams* p, cmsToneCurve* G[3])
 {
-    int i;
+    int i, j;
     cmsUInt16Number Input[3];
+    cmsUInt16Number Lin[3][256];
     cmsS15Fixed16Number v1, v2, v3;
     Prelin8Data* p8;
 
@@ -854,20 +917,21 @@ Prelin8Data* PrelinOpt8alloc(cmsContext ContextID, const cmsInterpParams* p, cms
     // Since this only works for 8 bit input, values comes always as x * 257,
     // we can safely take msb byte (x << 8 + x)
 
-    for (i=0; i < 256; i++) {
+    // Get 16-bit representation, all 256 values of each curve at once
+    for (j=0; j < 3; j++) {
 
-        if (G != NULL) {
+        for (i=0; i < 256; i++)
+            Lin[j][i] = FROM_8_TO_16(i);
 
-            // Get 16-bit representation
-            Input[0] = cmsEvalToneCurve16(G[0], FROM_8_TO_16(i));
-            Input[1] = cmsEvalToneCurve16(G[1], FROM_8_TO_16(i));
-            Input[2] = cmsEvalToneCurve16(G[2], FROM_8_TO_16(i));
-        }
-        else {
-            Input[0] = FROM_8_TO_16(i);
-            Input[1] = FROM_8_TO_16(i);
-            Input[2] = FROM_8_TO_16(i);
-        }
+        if (G != NULL)
+            cmsEvalToneCurve16Array(G[j], Lin[j], Lin[j], 256);
+    }
+
+    for (i=0; i < 256; i++) {
+
+        Input[0] = Lin[0][i];
+        Input[1] = Lin[1][i];
+        Input[2] = Lin[2][i];
 
 
         // Move to 0..1.0 in fixed domain
@@ -908,26 +972,19 @@ void* Prelin8dup(cmsContext ContextID, const void* ptr)
 
 // A optimized interpolation for 8-bit input.
 #define DENS(i,j,k) (LutTable[(i)+(j)+(k)+OutChan])
-static CMS_NO_SANITIZE
-void PrelinEval8(CMSREGISTER const cmsUInt16Number Input[],
-                  CMSREGISTER cmsUInt16Number Output[],
-                  CMSREGISTER const void* D)
+cmsINLINE CMS_NO_SANITIZE
+void PrelinEval8Bytes(cmsUInt8Number r, cmsUInt8Number g, cmsUInt8Number b,
+                      CMSREGISTER cmsUInt16Number Output[],
+                      const Prelin8Data* p8)
 {
-
-    cmsUInt8Number         r, g, b;
     cmsS15Fixed16Number    rx, ry, rz;
     cmsS15Fixed16Number    c0, c1, c2, c3, Rest;
     int                    OutChan;
     CMSREGISTER cmsS15Fixed16Number X0, X1, Y0, Y1, Z0, Z1;
-    Prelin8Data* p8 = (Prelin8Data*) D;
     CMSREGISTER const cmsInterpParams* p = p8 ->p;
     int                    TotalOut = (int) p -> nOutputs;
     const cmsUInt16Number* LutTable = (const cmsUInt16Number*) p->Table;
 
-    r = (cmsUInt8Number) (Input[0] >> 8);
-    g = (cmsUInt8Number) (Input[1] >> 8);
-    b = (cmsUInt8Number) (Input[2] >> 8);
-
     X0 = X1 = (cmsS15Fixed16Number) p8->X0[r];
     Y0 = Y1 = (cmsS15Fixed16Number) p8->Y0[g];
     Z0 = Z1 = (cmsS15Fixed16Number) p8->Z0[b];
@@ -999,6 +1056,16 @@ void PrelinEval8(CMSREGISTER const cmsUInt16Number Input[],
 
 #undef DENS
 
+static
+void PrelinEval8(CMSREGISTER const cmsUInt16Number Input[],
+                  CMSREGISTER cmsUInt16Number Output[],
+                  CMSREGISTER const void* D)
+{
+    PrelinEval8Bytes((cmsUInt8Number) (Input[0] >> 8),
+                     (cmsUInt8Number) (Input[1] >> 8),
+                     (cmsUInt8Number) (Input[2] >> 8), Output, (const Prelin8Data*) D);
+}
+
 
 // Curves that contain wide empty areas are not optimizeable
 static
@@ -1171,7 +1238,7 @@ cmsBool OptimizeByComputingLinearization(cmsPipeline** Lut, cmsUInt32Number Inte
         goto Error;
 
     // Resample the LUT
-    if (!cmsStageSampleCLut16bit(OptimizedCLUTmpe, XFormSampler16, (void*) LutPlusCurves, 0)) goto Error;
+    if (!cmsStageSampleCLut16bitBatch(OptimizedCLUTmpe, XFormSampler16Batch, (void*) LutPlusCurves, (*dwFlags & cmsFLAGS_PARALLEL) ? SAMPLER_REENTRANT : 0)) goto Error;
 
     // Free resources
     for (t = 0; t < OriginalLut ->InputChannels; t++) {
@@ -1205,6 +1272,7 @@ cmsBool OptimizeByComputingLinearization(cmsPipeline** Lut, cmsUInt32Number Inte
         if (p16 == NULL) return FALSE;
 
         _cmsPipelineSetOptimizationParameters(OptimizedLUT, PrelinEval16, (void*) p16, PrelinOpt16free, Prelin16dup);
+        _cmsPipelineSetOptimizationBatch(OptimizedLUT, PrelinEval16Batch);
 
     }
 
@@ -1315,15 +1383,18 @@ Curves16Data* CurvesAlloc(cmsContext ContextID, cmsUInt32Number nCurves, cmsUInt
 
             for (j=0; j < nElements; j++) {
 
-                c16 ->Curves[i][j] = cmsEvalToneCurve16(G[i], FROM_8_TO_16(j));
+                c16 ->Curves[i][j] = FROM_8_TO_16(j);
             }
         }
         else {
 
             for (j=0; j < nElements; j++) {
-                c16 ->Curves[i][j] = cmsEvalToneCurve16(G[i], (cmsUInt16Number) j);
+                c16 ->Curves[i][j] = (cmsUInt16Number) j;
             }
         }
+
+        // Curves are evaluated in place, on the whole table at once
+        cmsEvalToneCurve16Array(G[i], c16 ->Curves[i], c16 ->Curves[i], nElements);
     }
 
     return c16;
@@ -1520,20 +1591,12 @@ void* DupMatShaper(cmsContext ContextID, const void* Data)
 // A fast matrix-shaper evaluator for 8 bits. This is a bit ticky since I'm using 1.14 signed fixed point
 // to accomplish some performance. Actually it takes 256x3 16 bits tables and 16385 x 3 tables of 8 bits,
 // in total about 50K, and the performance boost is huge!
-static
-void MatShaperEval16(CMSREGISTER const cmsUInt16Number In[],
-                     CMSREGISTER cmsUInt16Number Out[],
-                     CMSREGISTER const void* D)
+cmsINLINE
+void MatShaperEval8(cmsUInt32Number ri, cmsUInt32Number gi, cmsUInt32Number bi,
+                    CMSREGISTER cmsUInt16Number Out[],
+                    const MatShaper8Data* p)
 {
-    MatShaper8Data* p = (MatShaper8Data*) D;
     cmsS1Fixed14Number l1, l2, l3, r, g, b;
-    cmsUInt32Number ri, gi, bi;
-
-    // In this case (and only in this case!) we can use this simplification since
-    // In[] is assured to come from a 8 bit number. (a << 8 | a)
-    ri = In[0] & 0xFFU;
-    gi = In[1] & 0xFFU;
-    bi = In[2] & 0xFFU;
 
     // Across first shaper, which also converts to 1.14 fixed point
     r = p->Shaper1R[ri];
@@ -1557,6 +1620,89 @@ void MatShaperEval16(CMSREGISTER const cmsUInt16Number In[],
 
 }
 
+static
+void MatShaperEval16(CMSREGISTER const cmsUInt16Number In[],
+                     CMSREGISTER cmsUInt16Number Out[],
+                     CMSREGISTER const void* D)
+{
+    // In this case (and only in this case!) we can use this simplification since
+    // In[] is assured to come from a 8 bit number. (a << 8 | a)
+    MatShaperEval8(In[0] & 0xFFU, In[1] & 0xFFU, In[2] & 0xFFU, Out, (const MatShaper8Data*) D);
+}
+
+#ifdef CMS_SIMD_X86
+
+// Same as MatShaperEval8, on eight pixels at once. Shapers are gathered and the matrix is evaluated on 32 bits lanes,
+// with same wrap-around as the scalar code, so results are identical.
+static CMS_TARGET_AVX2 CMS_NO_SANITIZE
+void MatShaperEval8x8AVX2(const cmsInt32Number Idx[3][8], cmsInt32Number Res[3][8], const MatShaper8Data* p)
+{
+    const __m256i Zero  = _mm256_setzero_si256();
+    const __m256i One   = _mm256_set1_epi32(16384);
+    const __m256i Low16 = _mm256_set1_epi32(0xFFFF);
+    const cmsUInt16Number* Shaper2[3];
+    __m256i r, g, b, l;
+    int i;
+
+    Shaper2[0] = p ->Shaper2R;
+    Shaper2[1] = p ->Shaper2G;
+    Shaper2[2] = p ->Shaper2B;
+
+    // Across first shaper
+    r = _mm256_i32gather_epi32((const int*) p ->Shaper1R, _mm256_loadu_si256((const __m256i*) Idx[0]), 4);
+    g = _mm256_i32gather_epi32((const int*) p ->Shaper1G, _mm256_loadu_si256((const __m256i*) Idx[1]), 4);
+    b = _mm256_i32gather_epi32((const int*) p ->Shaper1B, _mm256_loadu_si256((const __m256i*) Idx[2]), 4);
+
+    for (i=0; i < 3; i++) {
+
+        // Matrix in 1.14 fixed point
+        l = _mm256_mullo_epi32(_mm256_set1_epi32(p ->Mat[i][0]), r);
+        l = _mm256_add_epi32(l, _mm256_mullo_epi32(_mm256_set1_epi32(p ->Mat[i][1]), g));
+        l = _mm256_add_epi32(l, _mm256_mullo_epi32(_mm256_set1_epi32(p ->Mat[i][2]), b));
+        l = _mm256_add_epi32(l, _mm256_set1_epi32(p ->Off[i] + 0x2000));
+        l = _mm256_srai_epi32(l, 14);
+
+        // Clip to 0..1.0 and across second shaper
+        l = _mm256_min_epi32(_mm256_max_epi32(l, Zero), One);
+        l = _mm256_and_si256(_mm256_i32gather_epi32((const int*) Shaper2[i], l, 2), Low16);
+
+        _mm256_storeu_si256((__m256i*) Res[i], l);
+    }
+}
+
+// Batch evaluator, only set when the CPU has AVX2. This is the 16 bits batch entry of the pipeline, but as in
+// MatShaperEval16 the samples are 8 bit values, since only 8 bit input is optimized as a matrix-shaper. There is
+// no 16 bit input kernel: 256 entries shapers and a 1.14 matrix would lose precision, so such pipelines are
+// prelinearized and resampled instead, and go through PrelinEval16Batch and the SIMD CLUT interpolators.
+static
+void MatShaperEval16BatchAVX2(const cmsUInt16Number In[],
+                              cmsUInt16Number Out[],
+                              cmsUInt32Number nPixels,
+                              const void* D)
+{
+    const MatShaper8Data* p = (const MatShaper8Data*) D;
+    cmsInt32Number Idx[3][8], Res[3][8];
+    cmsUInt32Number i, j, c;
+
+    for (i=0; i + 8 <= nPixels; i += 8) {
+
+        for (j=0; j < 8; j++)
+            for (c=0; c < 3; c++)
+                Idx[c][j] = In[3 * (i + j) + c] & 0xFFU;
+
+        MatShaperEval8x8AVX2(Idx, Res, p);
+
+        for (j=0; j < 8; j++)
+            for (c=0; c < 3; c++)
+                Out[3 * (i + j) + c] = (cmsUInt16Number) Res[c][j];
+    }
+
+    for (; i < nPixels; i++)
+        MatShaperEval8(In[3*i] & 0xFFU, In[3*i+1] & 0xFFU, In[3*i+2] & 0xFFU, Out + 3*i, p);
+}
+
+#endif
+
 // This table converts from 8 bits to 1.14 after applying the curve
 static
 void FillFirstShaper(cmsS1Fixed14Number* Table, cmsToneCurve* Curve)
@@ -1622,6 +1768,7 @@ cmsBool SetMatShaper(cmsPipeline* Dest, cmsToneCurve* Curve1[3], cmsMAT3* Mat, c
     if (p == NULL) return FALSE;
 
     p -> ContextID = Dest -> ContextID;
+    p -> Shaper2Pad = 0;
 
     // Precompute tables
     FillFirstShaper(p ->Shaper1R, Curve1[0]);
@@ -1655,6 +1802,11 @@ cmsBool SetMatShaper(cmsPipeline* Dest, cmsToneCurve* Curve1[3], cmsMAT3* Mat, c
 
     // Fill function pointers
     _cmsPipelineSetOptimizationParameters(Dest, MatShaperEval16, (void*) p, FreeMatShaper, DupMatShaper);
+
+#ifdef CMS_SIMD_X86
+    if (_cmsGetCPUFeatures() & cmsCPU_AVX2)
+        _cmsPipelineSetOptimizationBatch(Dest, MatShaperEval16BatchAVX2);
+#endif
     return TRUE;
 }
 
@@ -1781,6 +1933,223 @@ Error:
 }
 
 
+// -------------------------------------------------------------------------------------------------------------------------------------
+// Floating point pipelines. Those are kept at full precision, so only exact rearrangements are done: consecutive
+// matrices are joined, and shaper-matrix-shaper chains get a dedicated evaluator. The only exception is
+// cmsFLAGS_APPROXIMATE_CURVES, which lets curves be evaluated from cached tables.
+
+// Joins any two consecutive matrices, offsets included. Result is M2 * M1 with offset M2 * Off1 + Off2
+static
+cmsBool JoinFloatMatrices(cmsPipeline* Lut)
+{
+    cmsStage** pt1;
+    cmsStage** pt2;
+    cmsStage*  chain;
+    cmsStage*  Joined;
+    cmsFloat64Number Mat[cmsMAXCHANNELS * cmsMAXCHANNELS], Off[cmsMAXCHANNELS];
+    cmsUInt32Number i, j, k, nIn, nMid, nOut;
+    cmsBool AnyOpt = FALSE, HasOffset, IsIdentity;
+
+    pt1 = &Lut->Elements;
+
+    while (*pt1 != NULL && (*pt1)->Next != NULL) {
+
+        pt2 = &((*pt1)->Next);
+
+        if ((*pt1)->Type != cmsSigMatrixElemType || (*pt2)->Type != cmsSigMatrixElemType) {
+            pt1 = pt2;
+            continue;
+        }
+
+        nIn  = (*pt1)->InputChannels;
+        nMid = (*pt1)->OutputChannels;
+        nOut = (*pt2)->OutputChannels;
+
+        if (nIn > cmsMAXCHANNELS || nOut > cmsMAXCHANNELS || nMid != (*pt2)->InputChannels) {
+            pt1 = pt2;
+            continue;
+        }
+
+        {
+            _cmsStageMatrixData* m1 = (_cmsStageMatrixData*) cmsStageData(*pt1);
+            _cmsStageMatrixData* m2 = (_cmsStageMatrixData*) cmsStageData(*pt2);
+
+            HasOffset  = FALSE;
+            IsIdentity = (nIn == nOut);
+
+            for (i=0; i < nOut; i++) {
+
+                for (j=0; j < nIn; j++) {
+
+                    cmsFloat64Number Tmp = 0;
+
+                    for (k=0; k < nMid; k++)
+                        Tmp += m2 ->Double[i * nMid + k] * m1 ->Double[k * nIn + j];
+
+                    Mat[i * nIn + j] = Tmp;
+                    if (!CloseEnoughFloat(Tmp, i == j ? 1.0 : 0.0)) IsIdentity = FALSE;
+                }
+
+                Off[i] = m2 ->Offset != NULL ? m2 ->Offset[i] : 0;
+
+                if (m1 ->Offset != NULL) {
+
+                    for (k=0; k < nMid; k++)
+                        Off[i] += m2 ->Double[i * nMid + k] * m1 ->Offset[k];
+                }
+
+                if (!CloseEnoughFloat(Off[i], 0)) HasOffset = TRUE;
+            }
+        }
+
+        Joined = NULL;
+        if (!IsIdentity || HasOffset) {
+
+            Joined = cmsStageAllocMatrix(Lut ->ContextID, nOut, nIn, Mat, HasOffset ? Off : NULL);
+            if (Joined == NULL) return AnyOpt;
+        }
+
+        // Get the next in chain after the matrices, and replace both
+        chain = (*pt2)->Next;
+
+        _RemoveElement(pt2);
+        _RemoveElement(pt1);
+
+        if (Joined != NULL) {
+
+            Joined ->Next = chain;
+            *pt1 = Joined;
+        }
+
+        AnyOpt = TRUE;
+    }
+
+    return AnyOpt;
+}
+
+// Returns the curves and the matrix if the pipeline is shaper-matrix-shaper on three channels
+static
+cmsBool GetMatShaperFloatStages(const cmsPipeline* Lut, _cmsStageToneCurvesData** Shaper1, _cmsStageMatrixData** Mat, _cmsStageToneCurvesData** Shaper2)
+{
+    cmsStage *mpe1, *mpe2, *mpe3;
+
+    if (Lut ->InputChannels != 3 || Lut ->OutputChannels != 3) return FALSE;
+
+    if (!cmsPipelineCheckAndRetreiveStages(Lut, 3,
+                cmsSigCurveSetElemType, cmsSigMatrixElemType, cmsSigCurveSetElemType, &mpe1, &mpe2, &mpe3)) return FALSE;
+
+    if (mpe2 ->InputChannels != 3 || mpe2 ->OutputChannels != 3) return FALSE;
+
+    *Shaper1 = (_cmsStageToneCurvesData*) cmsStageData(mpe1);
+    *Mat     = (_cmsStageMatrixData*) cmsStageData(mpe2);
+    *Shaper2 = (_cmsStageToneCurvesData*) cmsStageData(mpe3);
+
+    return *Shaper1 != NULL && (*Shaper1) ->TheCurves != NULL &&
+           *Shaper2 != NULL && (*Shaper2) ->TheCurves != NULL;
+}
+
+// One curve of a curve set, honoring the approximation flag of the set
+cmsINLINE
+cmsFloat32Number EvalShaperFloat(const _cmsStageToneCurvesData* Shaper, cmsUInt32Number i, cmsFloat32Number v)
+{
+    return Shaper ->Approximate ? _cmsEvalToneCurveFloatApprox(Shaper ->TheCurves[i], v) :
+                                  cmsEvalToneCurveFloat(Shaper ->TheCurves[i], v);
+}
+
+// Shaper-matrix-shaper, as the stages would do it
+cmsINLINE
+void MatShaperEvalFloat(const cmsFloat32Number In[], cmsFloat32Number Out[],
+                        const _cmsStageToneCurvesData* Shaper1, const _cmsStageMatrixData* Mat, const _cmsStageToneCurvesData* Shaper2)
+{
+    cmsFloat32Number v[3];
+    cmsFloat64Number Tmp;
+    cmsUInt32Number i;
+
+    for (i=0; i < 3; i++)
+        v[i] = EvalShaperFloat(Shaper1, i, In[i]);
+
+    for (i=0; i < 3; i++) {
+
+        Tmp = v[0] * Mat ->Double[i*3] + v[1] * Mat ->Double[i*3 + 1] + v[2] * Mat ->Double[i*3 + 2];
+
+        if (Mat ->Offset != NULL)
+            Tmp += Mat ->Offset[i];
+
+        Out[i] = EvalShaperFloat(Shaper2, i, (cmsFloat32Number) Tmp);
+    }
+}
+
+// Pipeline evaluators. Shape was checked when setting them, so stages are just followed
+static
+void MatShaperEvalFloatPipeline(const cmsFloat32Number In[], cmsFloat32Number Out[], const void* D)
+{
+    const cmsStage* mpe = ((const cmsPipeline*) D) ->Elements;
+
+    MatShaperEvalFloat(In, Out, (_cmsStageToneCurvesData*) mpe ->Data,
+                                (_cmsStageMatrixData*) mpe ->Next ->Data,
+                                (_cmsStageToneCurvesData*) mpe ->Next ->Next ->Data);
+}
+
+static
+void MatShaperEvalFloatPipelineBatch(const cmsFloat32Number In[], cmsFloat32Number Out[], cmsUInt32Number nPixels, const void* D)
+{
+    _cmsStageToneCurvesData *Shaper1, *Shaper2;
+    _cmsStageMatrixData* Mat;
+    cmsUInt32Number i;
+
+    GetMatShaperFloatStages((const cmsPipeline*) D, &Shaper1, &Mat, &Shaper2);
+
+    for (i=0; i < nPixels; i++)
+        MatShaperEvalFloat(In + 3 * i, Out + 3 * i, Shaper1, Mat, Shaper2);
+}
+
+// Lets every curve set in the pipeline use the cached float tables
+static
+cmsBool ApproximateFloatCurves(cmsPipeline* Lut)
+{
+    cmsStage* mpe;
+    cmsBool AnyOpt = FALSE;
+
+    for (mpe = cmsPipelineGetPtrToFirstStage(Lut); mpe != NULL; mpe = cmsStageNext(mpe)) {
+
+        if (cmsStageType(mpe) == cmsSigCurveSetElemType) {
+
+            ((_cmsStageToneCurvesData*) cmsStageData(mpe)) ->Approximate = TRUE;
+            AnyOpt = TRUE;
+        }
+    }
+
+    return AnyOpt;
+}
+
+static
+cmsBool OptimizeFloatPipeline(cmsPipeline** Lut, cmsUInt32Number Intent, cmsUInt32Number* InputFormat, cmsUInt32Number* OutputFormat, cmsUInt32Number* dwFlags)
+{
+    _cmsStageToneCurvesData *Shaper1, *Shaper2;
+    _cmsStageMatrixData* Mat;
+    cmsBool AnyOpt;
+
+    if (!_cmsFormatterIsFloat(*InputFormat) || !_cmsFormatterIsFloat(*OutputFormat)) return FALSE;
+
+    AnyOpt = JoinFloatMatrices(*Lut);
+
+    if (*dwFlags & cmsFLAGS_APPROXIMATE_CURVES) {
+
+        if (ApproximateFloatCurves(*Lut)) AnyOpt = TRUE;
+    }
+
+    if (GetMatShaperFloatStages(*Lut, &Shaper1, &Mat, &Shaper2)) {
+
+        _cmsPipelineSetOptimizationFloat(*Lut, MatShaperEvalFloatPipeline, MatShaperEvalFloatPipelineBatch);
+        AnyOpt = TRUE;
+    }
+
+    return AnyOpt;
+
+    cmsUNUSED_PARAMETER(Intent);
+}
+
+
 // -------------------------------------------------------------------------------------------------------------------------------------
 // Optimization plug-ins
 
@@ -1794,17 +2163,19 @@ typedef struct _cmsOptimizationCollection_st {
 } _cmsOptimizationCollection;
 
 
-// The built-in list. We currently implement 4 types of optimizations. Joining of curves, matrix-shaper, linearization and resampling
+// The built-in list. We currently implement 5 types of optimizations. Floating point, joining of curves, matrix-shaper,
+// linearization and resampling
 static _cmsOptimizationCollection DefaultOptimization[] = {
 
-    { OptimizeByJoiningCurves,            &DefaultOptimization[1] },
-    { OptimizeMatrixShaper,               &DefaultOptimization[2] },
-    { OptimizeByComputingLinearization,   &DefaultOptimization[3] },
+    { OptimizeFloatPipeline,              &DefaultOptimization[1] },
+    { OptimizeByJoiningCurves,            &DefaultOptimization[2] },
+    { OptimizeMatrixShaper,               &DefaultOptimization[3] },
+    { OptimizeByComputingLinearization,   &DefaultOptimization[4] },
     { OptimizeByResampling,               NULL }
 };
 
 // The linked list head
-_cmsOptimizationPluginChunkType _cmsOptimizationPluginChunk = { NULL };
+_cmsOptimizationPluginChunkType _cmsOptimizationPluginChunk = { NULL, 0 };
 
 
 // Duplicates the zone of memory used by the plug-in in the new context
@@ -1812,7 +2183,7 @@ static
 void DupPluginOptimizationList(struct _cmsContext_struct* ctx, 
                                const struct _cmsContext_struct* src)
 {
-   _cmsOptimizationPluginChunkType newHead = { NULL };
+   _cmsOptimizationPluginChunkType newHead = { NULL, 0 };
    _cmsOptimizationCollection*  entry;
    _cmsOptimizationCollection*  Anterior = NULL;
    _cmsOptimizationPluginChunkType* head = (_cmsOptimizationPluginChunkType*) src->chunks[OptimizationPlugin];
@@ -1841,6 +2212,8 @@ void DupPluginOptimizationList(struct _cmsContext_struct* ctx,
                 newHead.OptimizationCollection = newEntry;
     }
 
+  newHead.ExpectedPixels = head ->ExpectedPixels;
+
   ctx ->chunks[OptimizationPlugin] = _cmsSubAllocDup(ctx->MemPool, &newHead, sizeof(_cmsOptimizationPluginChunkType));
 }
 
@@ -1853,7 +2226,7 @@ void  _cmsAllocOptimizationPluginChunk(struct _cmsContext_struct* ctx,
        DupPluginOptimizationList(ctx, src);
     }
     else {
-        static _cmsOptimizationPluginChunkType OptimizationPluginChunkType = { NULL };
+        static _cmsOptimizationPluginChunkType OptimizationPluginChunkType = { NULL, 0 };
         ctx ->chunks[OptimizationPlugin] = _cmsSubAllocDup(ctx ->MemPool, &OptimizationPluginChunkType, sizeof(_cmsOptimizationPluginChunkType));
     }
 }
@@ -1891,6 +2264,57 @@ cmsBool  _cmsRegisterOptimizationPlugin(cmsContext ContextID, cmsPluginBase* Dat
     return TRUE;
 }
 
+// Sets the number of pixels transforms created on this context are expected to convert. Returns the previous value
+cmsUInt32Number CMSEXPORT cmsSetOptimizationBudget(cmsContext ContextID, cmsUInt32Number ExpectedPixels)
+{
+    _cmsOptimizationPluginChunkType* ctx = ( _cmsOptimizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, OptimizationPlugin);
+    cmsUInt32Number Old = ctx ->ExpectedPixels;
+
+    ctx ->ExpectedPixels = ExpectedPixels;
+    return Old;
+}
+
+cmsUInt32Number _cmsGetOptimizationBudget(cmsContext ContextID)
+{
+    _cmsOptimizationPluginChunkType* ctx = ( _cmsOptimizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, OptimizationPlugin);
+
+    return ctx ->ExpectedPixels;
+}
+
+// Resampling evaluates the whole pipeline once per grid node. When fewer pixels than nodes are expected, it is
+// cheaper to evaluate the pipeline on each pixel. When many more are expected, the extra nodes of the high
+// resolution grid are paid only once. Returns TRUE if resampling should be skipped. Float transforms are never
+// resampled, and explicit grid choices of the caller are kept.
+#define HIGHRES_BUDGET_FACTOR   16
+
+static
+cmsBool ApplyOptimizationBudget(cmsUInt32Number ExpectedPixels, const cmsPipeline* Lut,
+                                cmsUInt32Number InputFormat, cmsUInt32Number OutputFormat, cmsUInt32Number* dwFlags)
+{
+    cmsColorSpaceSignature ColorSpace;
+    cmsFloat64Number nInputs, Nodes, HighResNodes;
+
+    if (ExpectedPixels == 0) return FALSE;
+
+    if (_cmsFormatterIsFloat(InputFormat) || _cmsFormatterIsFloat(OutputFormat)) return FALSE;
+
+    if (*dwFlags & (cmsFLAGS_HIGHRESPRECALC|cmsFLAGS_LOWRESPRECALC|cmsFLAGS_GRIDPOINTS(0xFF))) return FALSE;
+
+    ColorSpace = _cmsICCcolorSpace((int) T_COLORSPACE(InputFormat));
+    if (ColorSpace == (cmsColorSpaceSignature) 0) return FALSE;
+
+    nInputs      = (cmsFloat64Number) cmsPipelineInputChannels(Lut);
+    Nodes        = pow((cmsFloat64Number) _cmsReasonableGridpointsByColorspace(ColorSpace, *dwFlags), nInputs);
+    HighResNodes = pow((cmsFloat64Number) _cmsReasonableGridpointsByColorspace(ColorSpace, *dwFlags | cmsFLAGS_HIGHRESPRECALC), nInputs);
+
+    if (ExpectedPixels < Nodes) return TRUE;
+
+    if (ExpectedPixels >= HighResNodes * HIGHRES_BUDGET_FACTOR)
+        *dwFlags |= cmsFLAGS_HIGHRESPRECALC;
+
+    return FALSE;
+}
+
 // The entry point for LUT optimization
 cmsBool _cmsOptimizePipeline(cmsContext ContextID,
                              cmsPipeline**    PtrLut,
@@ -1898,10 +2322,46 @@ cmsBool _cmsOptimizePipeline(cmsContext ContextID,
                              cmsUInt32Number* InputFormat,
                              cmsUInt32Number* OutputFormat,
                              cmsUInt32Number* dwFlags)
+{
+    return _cmsOptimizePipelineEx(ContextID, PtrLut, Intent, InputFormat, OutputFormat, dwFlags, NULL);
+}
+
+// Runs one optimization, timing it if statistics are requested
+static
+cmsBool RunOptimization(_cmsOPToptimizeFn OptimizePtr, cmsPipeline** PtrLut, cmsUInt32Number Intent,
+                        cmsUInt32Number* InputFormat, cmsUInt32Number* OutputFormat, cmsUInt32Number* dwFlags,
+                        cmsTransformStats* Stats)
+{
+    cmsFloat64Number Start;
+    cmsBool rc;
+
+    if (Stats == NULL)
+        return OptimizePtr(PtrLut, Intent, InputFormat, OutputFormat, dwFlags);
+
+    Start = _cmsGetTime();
+    rc = OptimizePtr(PtrLut, Intent, InputFormat, OutputFormat, dwFlags);
+
+    if (Stats ->nOptimizationSteps < cmsMAX_OPTIMIZATION_STEPS)
+        Stats ->StepTime[Stats ->nOptimizationSteps] = _cmsGetTime() - Start;
+
+    if (rc) Stats ->Optimization = (cmsInt32Number) Stats ->nOptimizationSteps;
+    Stats ->nOptimizationSteps++;
+
+    return rc;
+}
+
+cmsBool _cmsOptimizePipelineEx(cmsContext ContextID,
+                               cmsPipeline**    PtrLut,
+                               cmsUInt32Number  Intent,
+                               cmsUInt32Number* InputFormat,
+                               cmsUInt32Number* OutputFormat,
+                               cmsUInt32Number* dwFlags,
+                               cmsTransformStats* Stats)
 {
     _cmsOptimizationPluginChunkType* ctx = ( _cmsOptimizationPluginChunkType*) _cmsContextGetClientChunk(ContextID, OptimizationPlugin);
     _cmsOptimizationCollection* Opts;
     cmsBool AnySuccess = FALSE;
+    cmsBool SkipResampling;
 
     // A CLUT is being asked, so force this specific optimization
     if (*dwFlags & cmsFLAGS_FORCE_CLUT) {
@@ -1929,13 +2389,16 @@ cmsBool _cmsOptimizePipeline(cmsContext ContextID,
     if (*dwFlags & cmsFLAGS_NOOPTIMIZE)
         return FALSE;
 
+    // Pick the grid from the expected amount of pixels, if told
+    SkipResampling = ApplyOptimizationBudget(ctx ->ExpectedPixels, *PtrLut, *InputFormat, *OutputFormat, dwFlags);
+
     // Try plug-in optimizations 
     for (Opts = ctx->OptimizationCollection;
          Opts != NULL;
          Opts = Opts ->Next) {
 
             // If one schema succeeded, we are done
-            if (Opts ->OptimizePtr(PtrLut, Intent, InputFormat, OutputFormat, dwFlags)) {
+            if (RunOptimization(Opts ->OptimizePtr, PtrLut, Intent, InputFormat, OutputFormat, dwFlags, Stats)) {
 
                 return TRUE;    // Optimized!
             }
@@ -1946,7 +2409,10 @@ cmsBool _cmsOptimizePipeline(cmsContext ContextID,
          Opts != NULL;
          Opts = Opts ->Next) {
 
-            if (Opts ->OptimizePtr(PtrLut, Intent, InputFormat, OutputFormat, dwFlags)) {
+            if (SkipResampling && (Opts ->OptimizePtr == OptimizeByResampling ||
+                                   Opts ->OptimizePtr == OptimizeByComputingLinearization)) continue;
+
+            if (RunOptimization(Opts ->OptimizePtr, PtrLut, Intent, InputFormat, OutputFormat, dwFlags, Stats)) {
 
                 return TRUE;  
             }
@@ -1957,4 +2423,512 @@ cmsBool _cmsOptimizePipeline(cmsContext ContextID,
 }
 
 
+// Saved transforms ---------------------------------------------------------------------------------------------
+
+// Pipelines coming from resampling are a CLUT, optionally surrounded by curves. Returns the CLUT stage if
+// the pipeline has this shape, and pointers to the curves, if any.
+static
+cmsStage* GetSampledShape(const cmsPipeline* Lut, cmsToneCurve*** PreLin, cmsToneCurve*** PostLin)
+{
+    cmsStage* mpe = cmsPipelineGetPtrToFirstStage(Lut);
+    cmsStage* CLUT;
+
+    *PreLin = *PostLin = NULL;
+
+    if (mpe == NULL) return NULL;
+
+    if (cmsStageType(mpe) == cmsSigCurveSetElemType) {
+
+        *PreLin = _cmsStageGetPtrToCurveSet(mpe);
+        mpe = cmsStageNext(mpe);
+        if (mpe == NULL) return NULL;
+    }
+
+    if (cmsStageType(mpe) != cmsSigCLutElemType ||
+        ((_cmsStageCLutData*) mpe ->Data) ->HasFloatValues) return NULL;
+
+    CLUT = mpe;
+    mpe = cmsStageNext(mpe);
+
+    if (mpe != NULL) {
+
+        if (cmsStageType(mpe) != cmsSigCurveSetElemType || cmsStageNext(mpe) != NULL) return NULL;
+        *PostLin = _cmsStageGetPtrToCurveSet(mpe);
+    }
+
+    return CLUT;
+}
+
+// Tells which of the resampling optimizations is in use on the pipeline
+cmsUInt32Number _cmsGetPipelineOptimization(const cmsPipeline* Lut)
+{
+    cmsToneCurve** PreLin;
+    cmsToneCurve** PostLin;
+    cmsStage* CLUT = GetSampledShape(Lut, &PreLin, &PostLin);
+    _cmsStageCLutData* DataCLUT;
+
+    if (CLUT == NULL) return _cmsOPT_NONE;
+
+    DataCLUT = (_cmsStageCLutData*) CLUT ->Data;
+
+    if (PreLin == NULL && PostLin == NULL && Lut ->Data == (void*) DataCLUT ->Params &&
+        Lut ->Eval16Fn == (_cmsOPTeval16Fn) DataCLUT ->Params ->Interpolation.Lerp16) return _cmsOPT_CLUT16;
+
+    if (Lut ->Eval16Fn == PrelinEval16) return _cmsOPT_PRELIN16;
+
+    if (Lut ->Eval16Fn == PrelinEval8 && PreLin != NULL && PostLin == NULL) return _cmsOPT_PRELIN8;
+
+    return _cmsOPT_NONE;
+}
+
+// Sets the optimization of given kind from the stages. Tables are already sampled and white-fixed
+cmsBool _cmsRestorePipelineOptimization(cmsPipeline* Lut, cmsUInt32Number Kind)
+{
+    cmsToneCurve** PreLin;
+    cmsToneCurve** PostLin;
+    cmsStage* CLUT = GetSampledShape(Lut, &PreLin, &PostLin);
+    _cmsStageCLutData* DataCLUT;
+
+    if (CLUT == NULL) return FALSE;
+
+    DataCLUT = (_cmsStageCLutData*) CLUT ->Data;
+
+    switch (Kind) {
+
+    case _cmsOPT_CLUT16:
+        if (PreLin != NULL || PostLin != NULL) return FALSE;
+
+        _cmsPipelineSetOptimizationParameters(Lut, (_cmsOPTeval16Fn) DataCLUT->Params->Interpolation.Lerp16, DataCLUT->Params, NULL, NULL);
+        _cmsPipelineSetOptimizationBatch(Lut, (_cmsOPTeval16BatchFn) DataCLUT->Params->InterpolationBatch.Lerp16);
+        return TRUE;
+
+    case _cmsOPT_PRELIN16: {
+
+        Prelin16Data* p16 = PrelinOpt16alloc(Lut ->ContextID, DataCLUT ->Params,
+                                             Lut ->InputChannels, PreLin, Lut ->OutputChannels, PostLin);
+        if (p16 == NULL) return FALSE;
+
+        _cmsPipelineSetOptimizationParameters(Lut, PrelinEval16, (void*) p16, PrelinOpt16free, Prelin16dup);
+        _cmsPipelineSetOptimizationBatch(Lut, PrelinEval16Batch);
+        return TRUE;
+        }
+
+    case _cmsOPT_PRELIN8: {
+
+        Prelin8Data* p8;
+
+        if (PreLin == NULL || PostLin != NULL || Lut ->InputChannels != 3) return FALSE;
+
+        p8 = PrelinOpt8alloc(Lut ->ContextID, DataCLUT ->Params, PreLin);
+        if (p8 == NULL) return FALSE;
+
+        _cmsPipelineSetOptimizationParameters(Lut, PrelinEval8, (void*) p8, Prelin8free, Prelin8dup);
+        return TRUE;
+        }
+
+    default:
+        return FALSE;
+    }
+}
+
+// Tells which evaluators are set on the pipeline, as cmsEVAL_* codes. Returns the bytes held by the optimization data
+cmsUInt32Number _cmsGetPipelineEvaluators(const cmsPipeline* Lut, cmsUInt32Number* Eval16, cmsUInt32Number* EvalFloat)
+{
+    cmsUInt32Number Size = 0;
+
+    if (!_cmsPipelineIsOptimized(Lut)) {
+
+        *Eval16 = cmsEVAL_PIPELINE;
+    }
+    else
+    if (Lut ->Eval16Fn == FastIdentity16) {
+
+        *Eval16 = cmsEVAL_IDENTITY;
+    }
+    else
+    if (Lut ->Eval16Fn == FastEvaluateCurves8 || Lut ->Eval16Fn == FastEvaluateCurves16) {
+
+        Curves16Data* c16 = (Curves16Data*) Lut ->Data;
+
+        *Eval16 = Lut ->Eval16Fn == FastEvaluateCurves8 ? cmsEVAL_CURVES8 : cmsEVAL_CURVES16;
+        Size = sizeof(Curves16Data) + c16 ->nCurves * (sizeof(cmsUInt16Number*) + c16 ->nElements * sizeof(cmsUInt16Number));
+    }
+    else
+    if (Lut ->Eval16Fn == MatShaperEval16) {
+
+        *Eval16 = cmsEVAL_MATSHAPER8;
+        Size = sizeof(MatShaper8Data);
+    }
+    else
+    if (Lut ->Eval16Fn == PrelinEval8) {
+
+        *Eval16 = cmsEVAL_PRELIN8;
+        Size = sizeof(Prelin8Data);
+    }
+    else
+    if (Lut ->Eval16Fn == PrelinEval16) {
+
+        Prelin16Data* p16 = (Prelin16Data*) Lut ->Data;
+
+        *Eval16 = cmsEVAL_PRELIN16;
+        Size = sizeof(Prelin16Data) + p16 ->nOutputs * (sizeof(_cmsInterpFn16) + sizeof(cmsInterpParams*));
+    }
+    else
+    if (_cmsGetPipelineOptimization(Lut) == _cmsOPT_CLUT16) {
+
+        *Eval16 = cmsEVAL_CLUT;
+    }
+    else
+        *Eval16 = cmsEVAL_PLUGIN;
+
+    if (!_cmsPipelineIsFloatOptimized(Lut))
+        *EvalFloat = cmsEVAL_PIPELINE;
+    else
+        *EvalFloat = Lut ->EvalFloatFn == MatShaperEvalFloatPipeline ? cmsEVAL_MATSHAPER_FLOAT : cmsEVAL_PLUGIN;
+
+    return Size;
+}
+
+
+
+
+
+
+// Fused transforms ---------------------------------------------------------------------------------------------
+
+// For the most common 8-bit chunky formats, the formatters are simple enough to be folded into the transform
+// worker, so no indirect call is needed per pixel. Only the byte position of each channel is needed. Extra
+// channels are skipped, exactly as the formatters do.
+typedef struct {
+
+    cmsUInt32Number Type;
+    cmsUInt32Number nChannels;
+    cmsUInt32Number BytesPerPixel;
+    cmsUInt32Number Offset[4];
+
+} FusedLayout;
+
+static const FusedLayout FusedLayouts[] = {
+
+    { TYPE_RGB_8,  3, 3, { 0, 1, 2, 0 } },
+    { TYPE_BGR_8,  3, 3, { 2, 1, 0, 0 } },
+    { TYPE_RGBA_8, 3, 4, { 0, 1, 2, 0 } },
+    { TYPE_ARGB_8, 3, 4, { 1, 2, 3, 0 } },
+    { TYPE_BGRA_8, 3, 4, { 2, 1, 0, 0 } },
+    { TYPE_ABGR_8, 3, 4, { 3, 2, 1, 0 } },
+    { TYPE_CMYK_8, 4, 4, { 0, 1, 2, 3 } }
+};
+
+#define FUSED_LAYOUTS   (sizeof(FusedLayouts) / sizeof(FusedLayout))
+
+// Pixels per run in the generic fused worker
+#define FUSED_BATCH_SIZE 256
+
+static
+const FusedLayout* GetFusedLayout(cmsUInt32Number Type)
+{
+    cmsUInt32Number i;
 
+    // The optimized bit only tells 8-bit tables are in use, it does not change the layout
+    Type &= ~OPTIMIZED_SH(1);
+
+    for (i=0; i < FUSED_LAYOUTS; i++) {
+
+        if (FusedLayouts[i].Type == Type)
+            return &FusedLayouts[i];
+    }
+
+    return NULL;
+}
+
+// 8-bit matrix-shaper. Output tables hold the 8 bit result times 257
+static
+void FusedMatShaper8XFORM(struct _cmstransform_struct *CMMcargo,
+                          const void* InputBuffer,
+                          void* OutputBuffer,
+                          cmsUInt32Number PixelsPerLine,
+                          cmsUInt32Number LineCount,
+                          const cmsStride* Stride)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) CMMcargo;
+    const MatShaper8Data* Data = (const MatShaper8Data*) p ->Lut ->Data;
+    const FusedLayout* In  = GetFusedLayout(p ->InputFormat);
+    const FusedLayout* Out = GetFusedLayout(p ->OutputFormat);
+    const cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wOut[3];
+    cmsUInt32Number i, j;
+#ifdef CMS_SIMD_X86
+    cmsBool UseAVX2 = (p ->Lut ->Eval16BatchFn == MatShaperEval16BatchAVX2);
+    cmsInt32Number Idx[3][8], Res[3][8];
+    cmsUInt32Number k, c;
+#endif
+
+    _cmsHandleExtraChannels(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+
+    for (i=0; i < LineCount; i++) {
+
+        accum  = (const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn;
+        output = (cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut;
+        j = 0;
+
+#ifdef CMS_SIMD_X86
+        if (UseAVX2) {
+
+            for (; j + 8 <= PixelsPerLine; j += 8) {
+
+                for (k=0; k < 8; k++, accum += In ->BytesPerPixel)
+                    for (c=0; c < 3; c++)
+                        Idx[c][k] = accum[In ->Offset[c]];
+
+                MatShaperEval8x8AVX2(Idx, Res, Data);
+
+                for (k=0; k < 8; k++, output += Out ->BytesPerPixel)
+                    for (c=0; c < 3; c++)
+                        output[Out ->Offset[c]] = (cmsUInt8Number) (Res[c][k] & 0xFF);
+            }
+        }
+#endif
+
+        for (; j < PixelsPerLine; j++) {
+
+            MatShaperEval8(accum[In ->Offset[0]], accum[In ->Offset[1]], accum[In ->Offset[2]], wOut, Data);
+
+            output[Out ->Offset[0]] = (cmsUInt8Number) (wOut[0] & 0xFFU);
+            output[Out ->Offset[1]] = (cmsUInt8Number) (wOut[1] & 0xFFU);
+            output[Out ->Offset[2]] = (cmsUInt8Number) (wOut[2] & 0xFFU);
+
+            accum  += In ->BytesPerPixel;
+            output += Out ->BytesPerPixel;
+        }
+    }
+}
+
+// 8-bit prelinearization plus tetrahedral
+static
+void FusedPrelin8XFORM(struct _cmstransform_struct *CMMcargo,
+                       const void* InputBuffer,
+                       void* OutputBuffer,
+                       cmsUInt32Number PixelsPerLine,
+                       cmsUInt32Number LineCount,
+                       const cmsStride* Stride)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) CMMcargo;
+    const Prelin8Data* Data = (const Prelin8Data*) p ->Lut ->Data;
+    const FusedLayout* In  = GetFusedLayout(p ->InputFormat);
+    const FusedLayout* Out = GetFusedLayout(p ->OutputFormat);
+    const cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wOut[cmsMAXCHANNELS];
+    cmsUInt32Number i, j, c;
+
+    _cmsHandleExtraChannels(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+
+    for (i=0; i < LineCount; i++) {
+
+        accum  = (const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn;
+        output = (cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut;
+
+        for (j=0; j < PixelsPerLine; j++) {
+
+            PrelinEval8Bytes(accum[In ->Offset[0]], accum[In ->Offset[1]], accum[In ->Offset[2]], wOut, Data);
+
+            for (c=0; c < Out ->nChannels; c++)
+                output[Out ->Offset[c]] = FROM_16_TO_8(wOut[c]);
+
+            accum  += In ->BytesPerPixel;
+            output += Out ->BytesPerPixel;
+        }
+    }
+}
+
+// Any other pipeline having a batch evaluator. Pixels are unpacked in runs and evaluated in batch.
+static
+void FusedEval8XFORM(struct _cmstransform_struct *CMMcargo,
+                     const void* InputBuffer,
+                     void* OutputBuffer,
+                     cmsUInt32Number PixelsPerLine,
+                     cmsUInt32Number LineCount,
+                     const cmsStride* Stride)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) CMMcargo;
+    const FusedLayout* In  = GetFusedLayout(p ->InputFormat);
+    const FusedLayout* Out = GetFusedLayout(p ->OutputFormat);
+    const cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wIn[FUSED_BATCH_SIZE * 4], wOut[FUSED_BATCH_SIZE * 4];
+    cmsUInt16Number* w;
+    cmsUInt32Number i, j, k, c, n;
+    cmsUInt32Number nIn = In ->nChannels, nOut = Out ->nChannels;
+    cmsUInt32Number InOff[4], OutOff[4];
+
+    // Keep the layout in locals, byte stores would otherwise force to reload it each time
+    memmove(InOff, In ->Offset, sizeof(InOff));
+    memmove(OutOff, Out ->Offset, sizeof(OutOff));
+
+    _cmsHandleExtraChannels(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+
+    for (i=0; i < LineCount; i++) {
+
+        accum  = (const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn;
+        output = (cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut;
+
+        for (j=0; j < PixelsPerLine; j += n) {
+
+            n = PixelsPerLine - j;
+            if (n > FUSED_BATCH_SIZE) n = FUSED_BATCH_SIZE;
+
+            for (k=0, w = wIn; k < n; k++, w += nIn) {
+
+                for (c=0; c < nIn; c++)
+                    w[c] = FROM_8_TO_16(accum[InOff[c]]);
+
+                accum += In ->BytesPerPixel;
+            }
+
+            p ->Lut ->Eval16BatchFn(wIn, wOut, n, p ->Lut ->Data);
+
+            for (k=0, w = wOut; k < n; k++, w += nOut) {
+
+                for (c=0; c < nOut; c++)
+                    output[OutOff[c]] = FROM_16_TO_8(w[c]);
+
+                output += Out ->BytesPerPixel;
+            }
+        }
+    }
+}
+
+
+// Floating point matrix-shaper, without the formatters. Sizes are in floats here.
+static const FusedLayout FusedFloatLayouts[] = {
+
+    { TYPE_RGB_FLT,  3, 3, { 0, 1, 2, 0 } },
+    { TYPE_BGR_FLT,  3, 3, { 2, 1, 0, 0 } },
+    { TYPE_RGBA_FLT, 3, 4, { 0, 1, 2, 0 } },
+    { TYPE_ARGB_FLT, 3, 4, { 1, 2, 3, 0 } },
+    { TYPE_BGRA_FLT, 3, 4, { 2, 1, 0, 0 } },
+    { TYPE_ABGR_FLT, 3, 4, { 3, 2, 1, 0 } }
+};
+
+#define FUSED_FLOAT_LAYOUTS   (sizeof(FusedFloatLayouts) / sizeof(FusedLayout))
+
+static
+const FusedLayout* GetFusedFloatLayout(cmsUInt32Number Type)
+{
+    cmsUInt32Number i;
+
+    for (i=0; i < FUSED_FLOAT_LAYOUTS; i++) {
+
+        if (FusedFloatLayouts[i].Type == Type)
+            return &FusedFloatLayouts[i];
+    }
+
+    return NULL;
+}
+
+static
+void FusedMatShaperFloatXFORM(struct _cmstransform_struct *CMMcargo,
+                              const void* InputBuffer,
+                              void* OutputBuffer,
+                              cmsUInt32Number PixelsPerLine,
+                              cmsUInt32Number LineCount,
+                              const cmsStride* Stride)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) CMMcargo;
+    const FusedLayout* In  = GetFusedFloatLayout(p ->InputFormat);
+    const FusedLayout* Out = GetFusedFloatLayout(p ->OutputFormat);
+    const cmsFloat32Number* accum;
+    cmsFloat32Number* output;
+    _cmsStageToneCurvesData *Shaper1, *Shaper2;
+    _cmsStageMatrixData* Mat;
+    cmsFloat32Number v[3], w[3];
+    cmsUInt32Number i, j, c;
+
+    _cmsHandleExtraChannels(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+
+    GetMatShaperFloatStages(p ->Lut, &Shaper1, &Mat, &Shaper2);
+
+    // cmsChangeBuffersFormat may have set a layout not handled here. Go across the formatters then.
+    if (In == NULL || Out == NULL) {
+
+        cmsFloat32Number fIn[cmsMAXCHANNELS], fOut[cmsMAXCHANNELS];
+        const cmsUInt8Number* pIn;
+        cmsUInt8Number* pOut;
+
+        memset(fIn, 0, sizeof(fIn));
+
+        for (i=0; i < LineCount; i++) {
+
+            pIn  = (const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn;
+            pOut = (cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut;
+
+            for (j=0; j < PixelsPerLine; j++) {
+
+                pIn = p ->FromInputFloat(p, fIn, (cmsUInt8Number*) pIn, Stride ->BytesPerPlaneIn);
+                cmsPipelineEvalFloat(fIn, fOut, p ->Lut);
+                pOut = p ->ToOutputFloat(p, fOut, pOut, Stride ->BytesPerPlaneOut);
+            }
+        }
+        return;
+    }
+
+    for (i=0; i < LineCount; i++) {
+
+        accum  = (const cmsFloat32Number*) ((const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn);
+        output = (cmsFloat32Number*) ((cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut);
+
+        for (j=0; j < PixelsPerLine; j++) {
+
+            for (c=0; c < 3; c++)
+                v[c] = accum[In ->Offset[c]];
+
+            MatShaperEvalFloat(v, w, Shaper1, Mat, Shaper2);
+
+            for (c=0; c < 3; c++)
+                output[Out ->Offset[c]] = w[c];
+
+            accum  += In ->BytesPerPixel;
+            output += Out ->BytesPerPixel;
+        }
+    }
+}
+
+// Returns a fused worker for the given pipeline and formats, or NULL if none applies. Cached transforms
+// are kept unless the evaluator is so fast that the cache doesn't pay.
+_cmsTransform2Fn _cmsGetFusedXFORM(const cmsPipeline* Lut, cmsUInt32Number InputFormat, cmsUInt32Number OutputFormat, cmsUInt32Number dwFlags)
+{
+    const FusedLayout* In  = GetFusedLayout(InputFormat);
+    const FusedLayout* Out = GetFusedLayout(OutputFormat);
+
+    if (Lut == NULL) return NULL;
+
+    if (_cmsFormatterIsFloat(InputFormat) && _cmsFormatterIsFloat(OutputFormat)) {
+
+        _cmsStageToneCurvesData *Shaper1, *Shaper2;
+        _cmsStageMatrixData* Mat;
+
+        if (GetFusedFloatLayout(InputFormat) == NULL || GetFusedFloatLayout(OutputFormat) == NULL) return NULL;
+
+        return GetMatShaperFloatStages(Lut, &Shaper1, &Mat, &Shaper2) ? FusedMatShaperFloatXFORM : NULL;
+    }
+
+    if (In == NULL || Out == NULL) return NULL;
+
+    if (Lut ->InputChannels  != In ->nChannels ||
+        Lut ->OutputChannels != Out ->nChannels) return NULL;
+
+    if (Lut ->Eval16Fn == MatShaperEval16)
+        return T_OPTIMIZED(OutputFormat) ? FusedMatShaper8XFORM : NULL;
+
+    if (Lut ->Eval16Fn == PrelinEval8)
+        return FusedPrelin8XFORM;
+
+    if (T_OPTIMIZED(OutputFormat)) return NULL;
+
+    // Pixel by pixel evaluators are faster through the formatters
+    if ((dwFlags & cmsFLAGS_NOCACHE) && Lut ->Eval16BatchFn != NULL)
+        return FusedEval8XFORM;
+
+    return NULL;
+}
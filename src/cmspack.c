@@ -26,6 +26,10 @@
 
 #include "lcms2_internal.h"
 
+#ifdef CMS_SIMD_X86
+#include <immintrin.h>
+#endif
+
 // This module handles all formats supported by lcms. There are two flavors, 16 bits and
 // floating point. Floating point is supported only in a subset, those formats holding
 // cmsFloat32Number (4 bytes per component) and double (marked as 0 bytes per component
@@ -3278,9 +3282,936 @@ cmsFormatter _cmsGetStockOutputFormatter(cmsUInt32Number dwInput, cmsUInt32Numbe
 }
 
 
+// Line formatters ------------------------------------------------------------------------------------------------------
+
+// Those work on a whole run of pixels at once. Swaps, extra channels and the swap-first rotation do only change the
+// place where each value lives inside the pixel, so this is computed once per call and the inner loops are same for
+// all layouts. The built-in line formatters do exactly what the one-pixel formatters do for the same type.
+
+typedef struct {
+
+    cmsUInt32Number nChan;                  // Values per pixel
+    cmsUInt32Number nSamples;               // Samples per chunky pixel, extra channels included
+    cmsUInt32Number Pos[cmsMAXCHANNELS];    // Sample (chunky) or plane (planar) holding each value
+    cmsBool         Flat;                   // Values in order and no extra channels. The run is a plain array
+
+} _cmsLineLayout;
+
+static
+void CheckFlatLayout(_cmsLineLayout* l, cmsUInt32Number Extra)
+{
+    cmsUInt32Number i;
+
+    l ->Flat = (Extra == 0);
+    for (i=0; i < l ->nChan; i++)
+        if (l ->Pos[i] != i) l ->Flat = FALSE;
+}
+
+// Chunky pixels. Unrollers and packers do the rotation in a different order, but the 4 bytes packer with
+// swap and swap first, which works as the unroller does.
+static
+void ChunkyLayout(cmsUInt32Number Type, cmsFormatterDirection Dir, _cmsLineLayout* l)
+{
+    cmsUInt32Number nChan     = T_CHANNELS(Type);
+    cmsUInt32Number Extra     = T_EXTRA(Type);
+    cmsUInt32Number DoSwap    = T_DOSWAP(Type);
+    cmsUInt32Number SwapFirst = T_SWAPFIRST(Type);
+    cmsUInt32Number start     = (DoSwap ^ SwapFirst) ? Extra : 0;
+    cmsBool Rotate = (Extra == 0 && SwapFirst);
+    cmsBool AsUnroller = (Dir == cmsFormatterInput) ||
+                         (T_BYTES(Type) == 1 && !T_FLOAT(Type) && !T_FLAVOR(Type) && nChan == 4 && Rotate && DoSwap);
+    cmsUInt32Number i, k;
+
+    l ->nChan    = nChan;
+    l ->nSamples = nChan + Extra;
+
+    for (i=0; i < nChan; i++) {
+
+        if (AsUnroller) {
+            k = Rotate ? (i + 1) % nChan : i;
+            l ->Pos[i] = start + (DoSwap ? nChan - k - 1 : k);
+        }
+        else {
+            k = DoSwap ? nChan - i - 1 : i;
+            l ->Pos[i] = start + (Rotate ? (k + 1) % nChan : k);
+        }
+    }
+
+    CheckFlatLayout(l, Extra);
+}
+
+// Planar pixels. Words formatters do ignore swap first when skipping extra planes.
+static
+void PlanarLayout(cmsUInt32Number Type, _cmsLineLayout* l)
+{
+    cmsUInt32Number nChan     = T_CHANNELS(Type);
+    cmsUInt32Number Extra     = T_EXTRA(Type);
+    cmsUInt32Number DoSwap    = T_DOSWAP(Type);
+    cmsUInt32Number SwapFirst = T_BYTES(Type) == 1 ? T_SWAPFIRST(Type) : 0;
+    cmsUInt32Number start     = (DoSwap ^ SwapFirst) ? Extra : 0;
+    cmsUInt32Number i;
+
+    l ->nChan    = nChan;
+    l ->nSamples = 1;
+
+    for (i=0; i < nChan; i++)
+        l ->Pos[i] = start + (DoSwap ? nChan - i - 1 : i);
+
+    CheckFlatLayout(l, Extra);
+}
+
+
+#ifdef CMS_SIMD_X86
+
+// SSE2 kernels. Those return the amount of samples (or pixels, on planar) done, and the caller finishes the tail.
+// Four channel pixels are moved around by shuffling words, so the swaps of CMYK and alike come at no cost.
+
+#define SHUFFLE_4(v, imm)    _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, imm), imm)
+
+// Shuffle code of a four channels chunky layout: lane i of each pixel gets lane Pos[i]. -1 if not supported
+static
+int ShuffleCode(const _cmsLineLayout* l, cmsFormatterDirection Dir)
+{
+    cmsUInt32Number i, Src[4];
+
+    if (l ->Flat) return 0xE4;
+    if (l ->nChan != 4 || l ->nSamples != 4) return -1;
+
+    // Packers place value i on lane Pos[i], so the shuffle is the inverse
+    for (i=0; i < 4; i++) {
+        if (Dir == cmsFormatterInput)
+            Src[i] = l ->Pos[i];
+        else
+            Src[l ->Pos[i]] = i;
+    }
+
+    return (int) (Src[0] | (Src[1] << 2) | (Src[2] << 4) | (Src[3] << 6));
+}
+
+static CMS_TARGET_SSE2
+__m128i Shuffle4(__m128i v, int Code)
+{
+    switch (Code) {
+
+    case 0x39: return SHUFFLE_4(v, 0x39);   // Swap first
+    case 0x93: return SHUFFLE_4(v, 0x93);
+    case 0x1B: return SHUFFLE_4(v, 0x1B);   // Swap
+    case 0xC6: return SHUFFLE_4(v, 0xC6);   // Both
+    case 0x6C: return SHUFFLE_4(v, 0x6C);
+    default:   return v;
+    }
+}
+
+static
+cmsBool IsSupportedShuffle(int Code)
+{
+    return Code == 0xE4 || Code == 0x39 || Code == 0x93 || Code == 0x1B || Code == 0xC6 || Code == 0x6C;
+}
+
+// x * 257, same as FROM_8_TO_16
+static CMS_TARGET_SSE2
+void Widen8(__m128i v, __m128i* lo, __m128i* hi)
+{
+    *lo = _mm_unpacklo_epi8(v, v);
+    *hi = _mm_unpackhi_epi8(v, v);
+}
+
+// (x * 65281 + 8388608) >> 24, same as FROM_16_TO_8. The high word of the product has all we need.
+static CMS_TARGET_SSE2
+__m128i Narrow16(__m128i lo, __m128i hi)
+{
+    const __m128i k = _mm_set1_epi16((short) 65281);
+    const __m128i r = _mm_set1_epi16(128);
+
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(lo, k), r), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(hi, k), r), 8);
+
+    return _mm_packus_epi16(lo, hi);
+}
+
+static CMS_TARGET_SSE2
+__m128i SwapEndian16(__m128i v)
+{
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+static CMS_TARGET_SSE2
+cmsUInt32Number UnrollBytesSSE2(const cmsUInt8Number* In, cmsUInt16Number* Out, cmsUInt32Number nSamples, int Code, cmsBool Reverse)
+{
+    const __m128i Mask = Reverse ? _mm_set1_epi16(-1) : _mm_setzero_si128();
+    __m128i lo, hi;
+    cmsUInt32Number i;
+
+    for (i=0; i + 16 <= nSamples; i += 16) {
+
+        Widen8(_mm_loadu_si128((const __m128i*) (In + i)), &lo, &hi);
+
+        _mm_storeu_si128((__m128i*) (Out + i),     _mm_xor_si128(Shuffle4(lo, Code), Mask));
+        _mm_storeu_si128((__m128i*) (Out + i + 8), _mm_xor_si128(Shuffle4(hi, Code), Mask));
+    }
+
+    return i;
+}
+
+static CMS_TARGET_SSE2
+cmsUInt32Number PackBytesSSE2(const cmsUInt16Number* In, cmsUInt8Number* Out, cmsUInt32Number nSamples, int Code, cmsBool Reverse)
+{
+    const __m128i Mask = Reverse ? _mm_set1_epi8(-1) : _mm_setzero_si128();
+    cmsUInt32Number i;
+
+    for (i=0; i + 16 <= nSamples; i += 16) {
+
+        __m128i lo = Shuffle4(_mm_loadu_si128((const __m128i*) (In + i)), Code);
+        __m128i hi = Shuffle4(_mm_loadu_si128((const __m128i*) (In + i + 8)), Code);
+
+        _mm_storeu_si128((__m128i*) (Out + i), _mm_xor_si128(Narrow16(lo, hi), Mask));
+    }
+
+    return i;
+}
+
+// Swapping endianness and reversing do commute, so same kernel works on both directions
+static CMS_TARGET_SSE2
+cmsUInt32Number MoveWordsSSE2(const cmsUInt16Number* In, cmsUInt16Number* Out, cmsUInt32Number nSamples, int Code, cmsBool SwapEndian, cmsBool Reverse)
+{
+    const __m128i Mask = Reverse ? _mm_set1_epi16(-1) : _mm_setzero_si128();
+    cmsUInt32Number i;
+
+    for (i=0; i + 8 <= nSamples; i += 8) {
+
+        __m128i v = Shuffle4(_mm_loadu_si128((const __m128i*) (In + i)), Code);
+
+        if (SwapEndian) v = SwapEndian16(v);
+        _mm_storeu_si128((__m128i*) (Out + i), _mm_xor_si128(v, Mask));
+    }
+
+    return i;
+}
+
+// Four planes to chunky and back. p0..p3 hold eight samples of each plane, c0..c3 two pixels each.
+static CMS_TARGET_SSE2
+void Interleave4(__m128i p0, __m128i p1, __m128i p2, __m128i p3, __m128i c[4])
+{
+    __m128i lo01 = _mm_unpacklo_epi16(p0, p1), hi01 = _mm_unpackhi_epi16(p0, p1);
+    __m128i lo23 = _mm_unpacklo_epi16(p2, p3), hi23 = _mm_unpackhi_epi16(p2, p3);
+
+    c[0] = _mm_unpacklo_epi32(lo01, lo23);
+    c[1] = _mm_unpackhi_epi32(lo01, lo23);
+    c[2] = _mm_unpacklo_epi32(hi01, hi23);
+    c[3] = _mm_unpackhi_epi32(hi01, hi23);
+}
+
+static CMS_TARGET_SSE2
+void Deinterleave4(__m128i c0, __m128i c1, __m128i c2, __m128i c3, __m128i p[4])
+{
+    __m128i t0 = _mm_unpacklo_epi16(c0, c1), t1 = _mm_unpackhi_epi16(c0, c1);
+    __m128i t2 = _mm_unpacklo_epi16(c2, c3), t3 = _mm_unpackhi_epi16(c2, c3);
+    __m128i u0 = _mm_unpacklo_epi16(t0, t1), u1 = _mm_unpackhi_epi16(t0, t1);
+    __m128i u2 = _mm_unpacklo_epi16(t2, t3), u3 = _mm_unpackhi_epi16(t2, t3);
+
+    p[0] = _mm_unpacklo_epi64(u0, u2);
+    p[1] = _mm_unpackhi_epi64(u0, u2);
+    p[2] = _mm_unpacklo_epi64(u1, u3);
+    p[3] = _mm_unpackhi_epi64(u1, u3);
+}
+
+// Planar, four channels. Bytes is 1 or 2, on words the endianness and reversing is done by the caller mask
+static CMS_TARGET_SSE2
+cmsUInt32Number UnrollPlanar4SSE2(cmsUInt8Number* const Planes[4], cmsUInt16Number* Out, cmsUInt32Number nPixels,
+                                  cmsUInt32Number Bytes, cmsBool SwapEndian, cmsBool Reverse)
+{
+    const __m128i Mask = Reverse ? _mm_set1_epi16(-1) : _mm_setzero_si128();
+    __m128i p[4], c[4];
+    cmsUInt32Number i, k;
+
+    for (i=0; i + 8 <= nPixels; i += 8) {
+
+        for (k=0; k < 4; k++) {
+
+            if (Bytes == 1) {
+                __m128i v = _mm_loadl_epi64((const __m128i*) (Planes[k] + i));
+                p[k] = _mm_unpacklo_epi8(v, v);
+            }
+            else {
+                p[k] = _mm_loadu_si128((const __m128i*) (Planes[k] + 2 * i));
+                if (SwapEndian) p[k] = SwapEndian16(p[k]);
+            }
+        }
+
+        Interleave4(p[0], p[1], p[2], p[3], c);
+
+        for (k=0; k < 4; k++)
+            _mm_storeu_si128((__m128i*) (Out + 4 * i + 8 * k), _mm_xor_si128(c[k], Mask));
+    }
+
+    return i;
+}
+
+static CMS_TARGET_SSE2
+cmsUInt32Number PackPlanar4SSE2(const cmsUInt16Number* In, cmsUInt8Number* const Planes[4], cmsUInt32Number nPixels,
+                                cmsUInt32Number Bytes, cmsBool SwapEndian, cmsBool Reverse)
+{
+    const __m128i Mask = Reverse ? _mm_set1_epi16(-1) : _mm_setzero_si128();
+    __m128i p[4];
+    cmsUInt32Number i, k;
+
+    for (i=0; i + 8 <= nPixels; i += 8) {
+
+        Deinterleave4(_mm_loadu_si128((const __m128i*) (In + 4 * i)),
+                      _mm_loadu_si128((const __m128i*) (In + 4 * i + 8)),
+                      _mm_loadu_si128((const __m128i*) (In + 4 * i + 16)),
+                      _mm_loadu_si128((const __m128i*) (In + 4 * i + 24)), p);
+
+        for (k=0; k < 4; k++) {
+
+            if (Bytes == 1) {
+                // Reversing is done after reducing to 8 bits, on the low byte
+                __m128i v = _mm_xor_si128(Narrow16(p[k], p[k]), Mask);
+                _mm_storel_epi64((__m128i*) (Planes[k] + i), v);
+            }
+            else {
+                __m128i v = SwapEndian ? SwapEndian16(p[k]) : p[k];
+                _mm_storeu_si128((__m128i*) (Planes[k] + 2 * i), _mm_xor_si128(v, Mask));
+            }
+        }
+    }
+
+    return i;
+}
+
+#ifndef CMS_NO_HALF_SUPPORT
+
+// Half to float conversion is exact, so the F16C instruction gives the same as the tables. Not so on the other
+// direction, where tables do truncate and handle overflow in their own way.
+static CMS_TARGET_F16C
+cmsUInt32Number UnrollHalfF16C(const cmsUInt16Number* In, cmsFloat32Number* Out, cmsUInt32Number nSamples,
+                               cmsFloat32Number Maximum, cmsBool Reverse)
+{
+    const __m256 Max = _mm256_set1_ps(Maximum);
+    const __m256 One = _mm256_set1_ps(1.0F);
+    cmsUInt32Number i;
+
+    for (i=0; i + 8 <= nSamples; i += 8) {
+
+        __m256 v = _mm256_div_ps(_mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (In + i))), Max);
+
+        if (Reverse) v = _mm256_sub_ps(One, v);
+        _mm256_storeu_ps(Out + i, v);
+    }
+
+    return i;
+}
+
+#endif
+
+#endif
+
+// Planes of a planar buffer, in the order of the values
+static
+void GetPlanes(cmsUInt8Number* Buffer, const _cmsLineLayout* l, cmsUInt32Number Stride, cmsUInt8Number* Planes[])
+{
+    cmsUInt32Number c;
+
+    for (c=0; c < l ->nChan; c++)
+        Planes[c] = Buffer + l ->Pos[c] * Stride;
+}
+
+static
+cmsUInt8Number* UnrollChunkyBytesLine(_cmsTRANSFORM* info,
+                                      cmsUInt16Number Values[],
+                                      cmsUInt8Number* accum,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->InputFormat);
+    cmsUInt32Number i = 0, c, nSamples;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->InputFormat, cmsFormatterInput, &l);
+    nSamples = nPixels * l.nChan;
+
+#ifdef CMS_SIMD_X86
+    if (_cmsGetCPUFeatures() & cmsCPU_SSE2) {
+
+        int Code = ShuffleCode(&l, cmsFormatterInput);
+        if (IsSupportedShuffle(Code))
+            i = UnrollBytesSSE2(accum, Values, nSamples, Code, Reverse);
+    }
+#endif
+
+    if (l.Flat) {
+
+        for (; i < nSamples; i++) {
+            cmsUInt16Number v = FROM_8_TO_16(accum[i]);
+            Values[i] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+
+        return accum + nSamples;
+    }
+
+    for (i /= l.nChan, Values += i * l.nChan, accum += i * l.nSamples; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsUInt16Number v = FROM_8_TO_16(accum[l.Pos[c]]);
+            *Values++ = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+
+        accum += l.nSamples;
+    }
+
+    return accum;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* UnrollChunkyWordsLine(_cmsTRANSFORM* info,
+                                      cmsUInt16Number Values[],
+                                      cmsUInt8Number* accum,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse    = T_FLAVOR(info ->InputFormat);
+    cmsUInt32Number SwapEndian = T_ENDIAN16(info ->InputFormat);
+    cmsUInt16Number* In = (cmsUInt16Number*) accum;
+    cmsUInt32Number i = 0, c, nSamples;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->InputFormat, cmsFormatterInput, &l);
+    nSamples = nPixels * l.nChan;
+
+#ifdef CMS_SIMD_X86
+    if (_cmsGetCPUFeatures() & cmsCPU_SSE2) {
+
+        int Code = ShuffleCode(&l, cmsFormatterInput);
+        if (IsSupportedShuffle(Code))
+            i = MoveWordsSSE2(In, Values, nSamples, Code, SwapEndian, Reverse);
+    }
+#endif
+
+    if (l.Flat) {
+
+        for (; i < nSamples; i++) {
+            cmsUInt16Number v = SwapEndian ? CHANGE_ENDIAN(In[i]) : In[i];
+            Values[i] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+
+        return (cmsUInt8Number*) (In + nSamples);
+    }
+
+    for (i /= l.nChan, Values += i * l.nChan, In += i * l.nSamples; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsUInt16Number v = SwapEndian ? CHANGE_ENDIAN(In[l.Pos[c]]) : In[l.Pos[c]];
+            *Values++ = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+
+        In += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) In;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* UnrollPlanarBytesLine(_cmsTRANSFORM* info,
+                                      cmsUInt16Number Values[],
+                                      cmsUInt8Number* accum,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->InputFormat);
+    cmsUInt8Number* Planes[cmsMAXCHANNELS];
+    cmsUInt32Number i = 0, c;
+    _cmsLineLayout l;
+
+    PlanarLayout(info ->InputFormat, &l);
+    GetPlanes(accum, &l, Stride, Planes);
+
+#ifdef CMS_SIMD_X86
+    if (l.nChan == 4 && (_cmsGetCPUFeatures() & cmsCPU_SSE2))
+        i = UnrollPlanar4SSE2(Planes, Values, nPixels, 1, FALSE, Reverse);
+#endif
+
+    for (c=0; c < l.nChan; c++) {
+
+        cmsUInt32Number j;
+
+        for (j=i; j < nPixels; j++) {
+            cmsUInt16Number v = FROM_8_TO_16(Planes[c][j]);
+            Values[j * l.nChan + c] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+    }
+
+    return accum + nPixels;
+}
+
+static
+cmsUInt8Number* UnrollPlanarWordsLine(_cmsTRANSFORM* info,
+                                      cmsUInt16Number Values[],
+                                      cmsUInt8Number* accum,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse    = T_FLAVOR(info ->InputFormat);
+    cmsUInt32Number SwapEndian = T_ENDIAN16(info ->InputFormat);
+    cmsUInt8Number* Planes[cmsMAXCHANNELS];
+    cmsUInt32Number i = 0, c;
+    _cmsLineLayout l;
+
+    PlanarLayout(info ->InputFormat, &l);
+    GetPlanes(accum, &l, Stride, Planes);
+
+#ifdef CMS_SIMD_X86
+    if (l.nChan == 4 && (_cmsGetCPUFeatures() & cmsCPU_SSE2))
+        i = UnrollPlanar4SSE2(Planes, Values, nPixels, 2, SwapEndian, Reverse);
+#endif
+
+    for (c=0; c < l.nChan; c++) {
+
+        const cmsUInt16Number* In = (const cmsUInt16Number*) Planes[c];
+        cmsUInt32Number j;
+
+        for (j=i; j < nPixels; j++) {
+            cmsUInt16Number v = SwapEndian ? CHANGE_ENDIAN(In[j]) : In[j];
+            Values[j * l.nChan + c] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+    }
+
+    return accum + nPixels * sizeof(cmsUInt16Number);
+}
+
+static
+cmsUInt8Number* PackChunkyBytesLine(_cmsTRANSFORM* info,
+                                    cmsUInt16Number Values[],
+                                    cmsUInt8Number* output,
+                                    cmsUInt32Number nPixels,
+                                    cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->OutputFormat);
+    cmsUInt32Number i = 0, c, nSamples;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->OutputFormat, cmsFormatterOutput, &l);
+    nSamples = nPixels * l.nChan;
+
+#ifdef CMS_SIMD_X86
+    if (_cmsGetCPUFeatures() & cmsCPU_SSE2) {
+
+        int Code = ShuffleCode(&l, cmsFormatterOutput);
+        if (IsSupportedShuffle(Code))
+            i = PackBytesSSE2(Values, output, nSamples, Code, Reverse);
+    }
+#endif
+
+    if (l.Flat) {
+
+        for (; i < nSamples; i++) {
+            cmsUInt8Number v = FROM_16_TO_8(Values[i]);
+            output[i] = Reverse ? REVERSE_FLAVOR_8(v) : v;
+        }
+
+        return output + nSamples;
+    }
+
+    for (i /= l.nChan, Values += i * l.nChan, output += i * l.nSamples; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsUInt8Number v = FROM_16_TO_8(*Values++);
+            output[l.Pos[c]] = Reverse ? REVERSE_FLAVOR_8(v) : v;
+        }
+
+        output += l.nSamples;
+    }
+
+    return output;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* PackChunkyWordsLine(_cmsTRANSFORM* info,
+                                    cmsUInt16Number Values[],
+                                    cmsUInt8Number* output,
+                                    cmsUInt32Number nPixels,
+                                    cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse    = T_FLAVOR(info ->OutputFormat);
+    cmsUInt32Number SwapEndian = T_ENDIAN16(info ->OutputFormat);
+    cmsUInt16Number* Out = (cmsUInt16Number*) output;
+    cmsUInt32Number i = 0, c, nSamples;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->OutputFormat, cmsFormatterOutput, &l);
+    nSamples = nPixels * l.nChan;
+
+#ifdef CMS_SIMD_X86
+    if (_cmsGetCPUFeatures() & cmsCPU_SSE2) {
+
+        int Code = ShuffleCode(&l, cmsFormatterOutput);
+        if (IsSupportedShuffle(Code))
+            i = MoveWordsSSE2(Values, Out, nSamples, Code, SwapEndian, Reverse);
+    }
+#endif
+
+    if (l.Flat) {
+
+        for (; i < nSamples; i++) {
+            cmsUInt16Number v = SwapEndian ? CHANGE_ENDIAN(Values[i]) : Values[i];
+            Out[i] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+
+        return (cmsUInt8Number*) (Out + nSamples);
+    }
+
+    for (i /= l.nChan, Values += i * l.nChan, Out += i * l.nSamples; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsUInt16Number v = SwapEndian ? CHANGE_ENDIAN(*Values) : *Values;
+            Out[l.Pos[c]] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+            Values++;
+        }
+
+        Out += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) Out;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* PackPlanarBytesLine(_cmsTRANSFORM* info,
+                                    cmsUInt16Number Values[],
+                                    cmsUInt8Number* output,
+                                    cmsUInt32Number nPixels,
+                                    cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->OutputFormat);
+    cmsUInt8Number* Planes[cmsMAXCHANNELS];
+    cmsUInt32Number i = 0, c;
+    _cmsLineLayout l;
+
+    PlanarLayout(info ->OutputFormat, &l);
+    GetPlanes(output, &l, Stride, Planes);
+
+#ifdef CMS_SIMD_X86
+    if (l.nChan == 4 && (_cmsGetCPUFeatures() & cmsCPU_SSE2))
+        i = PackPlanar4SSE2(Values, Planes, nPixels, 1, FALSE, Reverse);
+#endif
+
+    for (c=0; c < l.nChan; c++) {
+
+        cmsUInt32Number j;
+
+        for (j=i; j < nPixels; j++) {
+            cmsUInt8Number v = FROM_16_TO_8(Values[j * l.nChan + c]);
+            Planes[c][j] = Reverse ? REVERSE_FLAVOR_8(v) : v;
+        }
+    }
+
+    return output + nPixels;
+}
+
+static
+cmsUInt8Number* PackPlanarWordsLine(_cmsTRANSFORM* info,
+                                    cmsUInt16Number Values[],
+                                    cmsUInt8Number* output,
+                                    cmsUInt32Number nPixels,
+                                    cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse    = T_FLAVOR(info ->OutputFormat);
+    cmsUInt32Number SwapEndian = T_ENDIAN16(info ->OutputFormat);
+    cmsUInt8Number* Planes[cmsMAXCHANNELS];
+    cmsUInt32Number i = 0, c;
+    _cmsLineLayout l;
+
+    PlanarLayout(info ->OutputFormat, &l);
+    GetPlanes(output, &l, Stride, Planes);
+
+#ifdef CMS_SIMD_X86
+    if (l.nChan == 4 && (_cmsGetCPUFeatures() & cmsCPU_SSE2))
+        i = PackPlanar4SSE2(Values, Planes, nPixels, 2, SwapEndian, Reverse);
+#endif
+
+    for (c=0; c < l.nChan; c++) {
+
+        cmsUInt16Number* Out = (cmsUInt16Number*) Planes[c];
+        cmsUInt32Number j;
+
+        for (j=i; j < nPixels; j++) {
+            cmsUInt16Number v = Values[j * l.nChan + c];
+            if (SwapEndian) v = CHANGE_ENDIAN(v);
+            Out[j] = Reverse ? REVERSE_FLAVOR_16(v) : v;
+        }
+    }
+
+    return output + nPixels * sizeof(cmsUInt16Number);
+}
+
+// Floating point, chunky only
+
+static
+cmsUInt8Number* UnrollFloatsToFloatLine(_cmsTRANSFORM* info,
+                                        cmsFloat32Number Values[],
+                                        cmsUInt8Number* accum,
+                                        cmsUInt32Number nPixels,
+                                        cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->InputFormat);
+    cmsFloat32Number maximum = IsInkSpace(info ->InputFormat) ? 100.0F : 1.0F;
+    cmsFloat32Number* In = (cmsFloat32Number*) accum;
+    cmsUInt32Number i, c;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->InputFormat, cmsFormatterInput, &l);
+
+    for (i=0; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsFloat32Number v = In[l.Pos[c]] / maximum;
+            *Values++ = Reverse ? 1 - v : v;
+        }
+
+        In += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) In;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* PackFloatsFromFloatLine(_cmsTRANSFORM* info,
+                                        cmsFloat32Number Values[],
+                                        cmsUInt8Number* output,
+                                        cmsUInt32Number nPixels,
+                                        cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->OutputFormat);
+    cmsFloat64Number maximum = IsInkSpace(info ->OutputFormat) ? 100.0 : 1.0;
+    cmsFloat32Number* Out = (cmsFloat32Number*) output;
+    cmsUInt32Number i, c;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->OutputFormat, cmsFormatterOutput, &l);
+
+    for (i=0; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+
+            cmsFloat64Number v = *Values++ * maximum;
+            Out[l.Pos[c]] = (cmsFloat32Number) (Reverse ? maximum - v : v);
+        }
+
+        Out += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) Out;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+#ifndef CMS_NO_HALF_SUPPORT
+
+static
+cmsUInt8Number* UnrollHalfToFloatLine(_cmsTRANSFORM* info,
+                                      cmsFloat32Number Values[],
+                                      cmsUInt8Number* accum,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->InputFormat);
+    cmsFloat32Number maximum = IsInkSpace(info ->InputFormat) ? 100.0F : 1.0F;
+    cmsUInt16Number* In = (cmsUInt16Number*) accum;
+    cmsUInt32Number i = 0, c, nSamples;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->InputFormat, cmsFormatterInput, &l);
+    nSamples = nPixels * l.nChan;
+
+    if (l.Flat) {
+
+#ifdef CMS_SIMD_X86
+        if (_cmsGetCPUFeatures() & cmsCPU_F16C)
+            i = UnrollHalfF16C(In, Values, nSamples, maximum, Reverse);
+#endif
+        for (; i < nSamples; i++) {
+            cmsFloat32Number v = _cmsHalf2Float(In[i]) / maximum;
+            Values[i] = Reverse ? 1 - v : v;
+        }
+
+        return (cmsUInt8Number*) (In + nSamples);
+    }
+
+    for (i=0; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+            cmsFloat32Number v = _cmsHalf2Float(In[l.Pos[c]]) / maximum;
+            *Values++ = Reverse ? 1 - v : v;
+        }
+
+        In += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) In;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+static
+cmsUInt8Number* PackHalfFromFloatLine(_cmsTRANSFORM* info,
+                                      cmsFloat32Number Values[],
+                                      cmsUInt8Number* output,
+                                      cmsUInt32Number nPixels,
+                                      cmsUInt32Number Stride)
+{
+    cmsUInt32Number Reverse = T_FLAVOR(info ->OutputFormat);
+    cmsFloat32Number maximum = IsInkSpace(info ->OutputFormat) ? 100.0F : 1.0F;
+    cmsUInt16Number* Out = (cmsUInt16Number*) output;
+    cmsUInt32Number i, c;
+    _cmsLineLayout l;
+
+    ChunkyLayout(info ->OutputFormat, cmsFormatterOutput, &l);
+
+    for (i=0; i < nPixels; i++) {
+
+        for (c=0; c < l.nChan; c++) {
+
+            cmsFloat32Number v = *Values++ * maximum;
+            Out[l.Pos[c]] = _cmsFloat2Half(Reverse ? maximum - v : v);
+        }
+
+        Out += l.nSamples;
+    }
+
+    return (cmsUInt8Number*) Out;
+
+    cmsUNUSED_PARAMETER(Stride);
+}
+
+#endif
+
+// Same matching rules as the one-pixel tables. A NULL function stops the search, those are types with a dedicated
+// one-pixel formatter doing some encoding work.
+
+typedef struct {
+    cmsUInt32Number    Type;
+    cmsUInt32Number    Mask;
+    cmsFormatter16Line Frm;
+
+} cmsLineFormatters16;
+
+typedef struct {
+    cmsUInt32Number       Type;
+    cmsUInt32Number       Mask;
+    cmsFormatterFloatLine Frm;
+
+} cmsLineFormattersFloat;
+
+static const cmsLineFormatters16 InputLineFormatters16[] = {
+
+    { TYPE_LabV2_8,                                                                 0,  NULL },
+    { TYPE_ALabV2_8,                                                                0,  NULL },
+    { TYPE_LabV2_16,                                                                0,  NULL },
+
+    { BYTES_SH(1)|PLANAR_SH(1), ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  UnrollPlanarBytesLine },
+    { BYTES_SH(1),              ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  UnrollChunkyBytesLine },
+    { BYTES_SH(2)|PLANAR_SH(1), ANYFLAVOR|ANYSWAP|ANYENDIAN|ANYEXTRA|ANYCHANNELS|ANYSPACE,     UnrollPlanarWordsLine },
+    { BYTES_SH(2),  ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYENDIAN|ANYEXTRA|ANYCHANNELS|ANYSPACE,    UnrollChunkyWordsLine },
+};
+
+static const cmsLineFormatters16 OutputLineFormatters16[] = {
+
+    { TYPE_LabV2_8,                                                                 0,  NULL },
+    { TYPE_ALabV2_8,                                                                0,  NULL },
+    { TYPE_LabV2_16,                                                                0,  NULL },
+
+    { BYTES_SH(1)|PLANAR_SH(1), ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  PackPlanarBytesLine },
+    { BYTES_SH(1),              ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  PackChunkyBytesLine },
+    { BYTES_SH(2)|PLANAR_SH(1), ANYFLAVOR|ANYENDIAN|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,     PackPlanarWordsLine },
+    { BYTES_SH(2),  ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYENDIAN|ANYEXTRA|ANYCHANNELS|ANYSPACE,    PackChunkyWordsLine },
+};
+
+static const cmsLineFormattersFloat InputLineFormattersFloat[] = {
+
+    { TYPE_Lab_FLT,                                                ANYPLANAR|ANYEXTRA,  NULL },
+    { TYPE_XYZ_FLT,                                                ANYPLANAR|ANYEXTRA,  NULL },
+
+    { FLOAT_SH(1)|BYTES_SH(4), ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,      UnrollFloatsToFloatLine },
+#ifndef CMS_NO_HALF_SUPPORT
+    { FLOAT_SH(1)|BYTES_SH(2), ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,      UnrollHalfToFloatLine },
+#endif
+};
+
+static const cmsLineFormattersFloat OutputLineFormattersFloat[] = {
+
+    { TYPE_Lab_FLT,                                                ANYPLANAR|ANYEXTRA,  NULL },
+    { TYPE_XYZ_FLT,                                                ANYPLANAR|ANYEXTRA,  NULL },
+
+    { FLOAT_SH(1)|BYTES_SH(4), ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  PackFloatsFromFloatLine },
+#ifndef CMS_NO_HALF_SUPPORT
+    { FLOAT_SH(1)|BYTES_SH(2), ANYFLAVOR|ANYSWAPFIRST|ANYSWAP|ANYEXTRA|ANYCHANNELS|ANYSPACE,  PackHalfFromFloatLine },
+#endif
+};
+
+// Bit fields set to one in the mask are not compared
+static
+cmsLineFormatter _cmsGetStockLineFormatter(cmsUInt32Number Type, cmsFormatterDirection Dir, cmsUInt32Number dwFlags)
+{
+    cmsUInt32Number i;
+    cmsLineFormatter fr;
+
+    fr.Line16 = NULL;
+
+    // Optimization is only a hint
+    if (Dir == cmsFormatterOutput)
+        Type &= ~OPTIMIZED_SH(1);
+
+    switch (dwFlags) {
+
+    case CMS_PACK_FLAGS_16BITS: {
+
+        const cmsLineFormatters16* Table = Dir == cmsFormatterInput ? InputLineFormatters16 : OutputLineFormatters16;
+        cmsUInt32Number n = Dir == cmsFormatterInput ? sizeof(InputLineFormatters16) / sizeof(cmsLineFormatters16) :
+                                                       sizeof(OutputLineFormatters16) / sizeof(cmsLineFormatters16);
+        for (i=0; i < n; i++) {
+
+            if ((Type & ~Table[i].Mask) == Table[i].Type) {
+                fr.Line16 = Table[i].Frm;
+                break;
+            }
+        }
+        }
+        break;
+
+    case CMS_PACK_FLAGS_FLOAT: {
+
+        const cmsLineFormattersFloat* Table = Dir == cmsFormatterInput ? InputLineFormattersFloat : OutputLineFormattersFloat;
+        cmsUInt32Number n = Dir == cmsFormatterInput ? sizeof(InputLineFormattersFloat) / sizeof(cmsLineFormattersFloat) :
+                                                       sizeof(OutputLineFormattersFloat) / sizeof(cmsLineFormattersFloat);
+        for (i=0; i < n; i++) {
+
+            if ((Type & ~Table[i].Mask) == Table[i].Type) {
+                fr.LineFloat = Table[i].Frm;
+                break;
+            }
+        }
+        }
+        break;
+
+    default:;
+    }
+
+    return fr;
+}
+
+
 typedef struct _cms_formatters_factory_list {
 
-    cmsFormatterFactory Factory;
+    cmsFormatterFactory     Factory;
+    cmsLineFormatterFactory LineFactory;
     struct _cms_formatters_factory_list *Next;
 
 } cmsFormattersFactoryList;
@@ -3360,7 +4291,8 @@ cmsBool  _cmsRegisterFormattersPlugin(cmsContext ContextID, cmsPluginBase* Data)
     fl = (cmsFormattersFactoryList*) _cmsPluginMalloc(ContextID, sizeof(cmsFormattersFactoryList));
     if (fl == NULL) return FALSE;
 
-    fl ->Factory    = Plugin ->FormattersFactory;
+    fl ->Factory     = Plugin ->FormattersFactory;
+    fl ->LineFactory = Plugin ->base.ExpectedVersion >= 2110 ? Plugin ->LineFormattersFactory : NULL;
 
     fl ->Next = ctx -> FactoryList;
     ctx ->FactoryList = fl;
@@ -3389,6 +4321,51 @@ cmsFormatter CMSEXPORT _cmsGetFormatter(cmsContext ContextID,
         return _cmsGetStockOutputFormatter(Type, dwFlags);
 }
 
+cmsLineFormatter CMSEXPORT _cmsGetLineFormatter(cmsContext ContextID,
+                                                cmsUInt32Number Type,
+                                                cmsFormatterDirection Dir,
+                                                cmsUInt32Number dwFlags)
+{
+    _cmsFormattersPluginChunkType* ctx = ( _cmsFormattersPluginChunkType*) _cmsContextGetClientChunk(ContextID, FormattersPlugin);
+    cmsFormattersFactoryList* f;
+    cmsLineFormatter fn;
+
+    fn.Line16 = NULL;
+
+    for (f =ctx->FactoryList; f != NULL; f = f ->Next) {
+
+        if (f ->LineFactory != NULL) {
+
+            fn = f ->LineFactory(Type, Dir, dwFlags);
+            if (fn.Line16 != NULL) return fn;
+        }
+
+        // A plug-in handling this type one pixel at time wins over the built-in line formatters
+        if (f ->Factory != NULL && f ->Factory(Type, Dir, dwFlags).Fmt16 != NULL) {
+
+            fn.Line16 = NULL;
+            return fn;
+        }
+    }
+
+    return _cmsGetStockLineFormatter(Type, Dir, dwFlags);
+}
+
+// TRUE if no plug-in in the context claims this type, so the built-in formatters are the ones in use
+cmsBool _cmsFormatterIsStock(cmsContext ContextID, cmsUInt32Number Type, cmsFormatterDirection Dir, cmsUInt32Number dwFlags)
+{
+    _cmsFormattersPluginChunkType* ctx = ( _cmsFormattersPluginChunkType*) _cmsContextGetClientChunk(ContextID, FormattersPlugin);
+    cmsFormattersFactoryList* f;
+
+    for (f =ctx->FactoryList; f != NULL; f = f ->Next) {
+
+        if (f ->LineFactory != NULL && f ->LineFactory(Type, Dir, dwFlags).Line16 != NULL) return FALSE;
+        if (f ->Factory != NULL && f ->Factory(Type, Dir, dwFlags).Fmt16 != NULL) return FALSE;
+    }
+
+    return TRUE;
+}
+
 
 // Return whatever given formatter refers to float values
 cmsBool  _cmsFormatterIsFloat(cmsUInt32Number Type)
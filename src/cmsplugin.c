@@ -134,22 +134,30 @@ cmsBool CMSEXPORT  _cmsReadUInt16Number(cmsIOHANDLER* io, cmsUInt16Number* n)
     return TRUE;
 }
 
+// Arrays are read in a single operation, and then adjusted in place. Big tables, as CLUTs, are read much faster this way
 cmsBool CMSEXPORT  _cmsReadUInt16Array(cmsIOHANDLER* io, cmsUInt32Number n, cmsUInt16Number* Array)
 {
     cmsUInt32Number i;
 
     _cmsAssert(io != NULL);
 
-    for (i=0; i < n; i++) {
+    if (Array == NULL) {
 
-        if (Array != NULL) {
-            if (!_cmsReadUInt16Number(io, Array + i)) return FALSE;
-        }
-        else {
+        for (i=0; i < n; i++) {
             if (!_cmsReadUInt16Number(io, NULL)) return FALSE;
         }
-
+        return TRUE;
     }
+
+    if (n == 0) return TRUE;
+    if (n > 0x7FFFFFFFU) return FALSE;
+
+    if (io -> Read(io, Array, sizeof(cmsUInt16Number), n) != n)
+        return FALSE;
+
+    for (i=0; i < n; i++)
+        Array[i] = _cmsAdjustEndianess16(Array[i]);
+
     return TRUE;
 }
 
@@ -611,6 +619,10 @@ cmsBool CMSEXPORT cmsPluginTHR(cmsContext id, void* Plug_in)
                     if (!_cmsRegisterMutexPlugin(id, Plugin)) return FALSE;
                     break;
 
+                case cmsPluginParallelizationSig:
+                    if (!_cmsRegisterParallelizationPlugin(id, Plugin)) return FALSE;
+                    break;
+
                 default:
                     cmsSignalError(id, cmsERROR_UNKNOWN_EXTENSION, "Unrecognized plugin type '%X'", Plugin -> Type);
                     return FALSE;
@@ -650,7 +662,10 @@ static struct _cmsContext_struct globalContext = {
         &_cmsMPETypePluginChunk,       //  MPEPlugin,
         &_cmsOptimizationPluginChunk,  //  OptimizationPlugin,
         &_cmsTransformPluginChunk,     //  TransformPlugin,
-        &_cmsMutexPluginChunk          //  MutexPlugin
+        &_cmsMutexPluginChunk,         //  MutexPlugin
+        &_cmsParallelizationPluginChunk, //  ParallelizationPlugin
+        &_cmsSharedTransformsChunk,    //  SharedTransformsContext
+        &_cmsTransformStatsChunk       //  TransformStatsContext
     },
     
     { NULL, NULL, NULL, NULL, NULL, NULL } // The default memory allocator is not used for context 0
@@ -661,25 +676,112 @@ static struct _cmsContext_struct globalContext = {
 static _cmsMutex _cmsContextPoolHeadMutex = CMS_MUTEX_INITIALIZER;
 static struct _cmsContext_struct* _cmsContextPoolHead = NULL;
 
+// Live contexts are also kept in an open addressing hash table, so lookups take no lock. The table is only
+// written with the pool mutex held, and slots are published atomically. Deleted entries leave a tombstone,
+// unless they end a probe chain. Once a context does not fit in the table, misses walk the list, with the lock.
+#define CONTEXT_HASH_SIZE   1024
+#define CONTEXT_TOMBSTONE   ((void*) &globalContext)
+
+static void* _cmsContextHash[CONTEXT_HASH_SIZE];
+static void* _cmsContextHashFull = NULL;
+
+static
+cmsUInt32Number ContextHash(const void* ContextID)
+{
+    cmsUInt32Number h = (cmsUInt32Number) ((size_t) ContextID >> 4);
+
+    return (h ^ (h >> 10) ^ (h >> 20)) & (CONTEXT_HASH_SIZE - 1);
+}
+
+// Must be called with the pool mutex held
+static
+void AddContextToHash(struct _cmsContext_struct* ctx)
+{
+    cmsUInt32Number i, n = ContextHash(ctx);
+
+    for (i=0; i < CONTEXT_HASH_SIZE; i++, n = (n + 1) & (CONTEXT_HASH_SIZE - 1)) {
+
+        void* Slot = _cmsAtomicLoadPtr(&_cmsContextHash[n]);
+
+        if (Slot == NULL || Slot == CONTEXT_TOMBSTONE) {
+            _cmsAtomicStorePtr(&_cmsContextHash[n], (void*) ctx);
+            return;
+        }
+    }
+
+    // Full, the context is on the list only
+    _cmsAtomicStorePtr(&_cmsContextHashFull, CONTEXT_TOMBSTONE);
+}
+
+// Must be called with the pool mutex held
+static
+void RemoveContextFromHash(struct _cmsContext_struct* ctx)
+{
+    cmsUInt32Number i, n = ContextHash(ctx);
+
+    for (i=0; i < CONTEXT_HASH_SIZE; i++, n = (n + 1) & (CONTEXT_HASH_SIZE - 1)) {
+
+        void* Slot = _cmsAtomicLoadPtr(&_cmsContextHash[n]);
+
+        if (Slot == NULL) return;
+        if (Slot == (void*) ctx) break;
+    }
+
+    if (i == CONTEXT_HASH_SIZE) return;
+
+    // If the next slot is empty, no chain goes through this one, nor through the tombstones just before
+    if (_cmsAtomicLoadPtr(&_cmsContextHash[(n + 1) & (CONTEXT_HASH_SIZE - 1)]) != NULL) {
+
+        _cmsAtomicStorePtr(&_cmsContextHash[n], CONTEXT_TOMBSTONE);
+        return;
+    }
+
+    do {
+        _cmsAtomicStorePtr(&_cmsContextHash[n], NULL);
+        n = (n - 1) & (CONTEXT_HASH_SIZE - 1);
+
+    } while (_cmsAtomicLoadPtr(&_cmsContextHash[n]) == CONTEXT_TOMBSTONE);
+}
+
 // Internal, get associated pointer, with guessing. Never returns NULL.
 struct _cmsContext_struct* _cmsGetContext(cmsContext ContextID)
 {
     struct _cmsContext_struct* id = (struct _cmsContext_struct*) ContextID;
     struct _cmsContext_struct* ctx;
+    cmsUInt32Number i, n;
 
 
     // On 0, use global settings
     if (id == NULL) 
         return &globalContext;
 
-    // Search
-    for (ctx = _cmsContextPoolHead;
-         ctx != NULL;
-         ctx = ctx ->Next) {
+    // Lock-free search in the table
+    n = ContextHash(id);
+    for (i=0; i < CONTEXT_HASH_SIZE; i++, n = (n + 1) & (CONTEXT_HASH_SIZE - 1)) {
 
-            // Found it?
-            if (id == ctx)
-                return ctx; // New-style context, 
+        void* Slot = _cmsAtomicLoadPtr(&_cmsContextHash[n]);
+
+        if (Slot == (void*) id) return id;
+        if (Slot == NULL) break;
+    }
+
+    // Not there, maybe the table was full
+    if (_cmsAtomicLoadPtr(&_cmsContextHashFull) != NULL) {
+
+        _cmsEnterCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
+
+        for (ctx = _cmsContextPoolHead;
+             ctx != NULL;
+             ctx = ctx ->Next) {
+
+                // Found it?
+                if (id == ctx)
+                    break; // New-style context, 
+        }
+
+        _cmsLeaveCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
+
+        if (ctx != NULL) return ctx;
     }
 
     return &globalContext;
@@ -723,6 +825,9 @@ void* _cmsContextGetClientChunk(cmsContext ContextID, _cmsMemoryClient mc)
 // identify which plug-in to unregister.
 void CMSEXPORT cmsUnregisterPluginsTHR(cmsContext ContextID)
 {
+    // Shared transforms may depend on plug-ins, so they go first
+    _cmsFlushSharedTransforms(ContextID);
+
     _cmsRegisterMemHandlerPlugin(ContextID, NULL);
     _cmsRegisterInterpPlugin(ContextID, NULL);
     _cmsRegisterTagTypePlugin(ContextID, NULL);
@@ -734,6 +839,7 @@ void CMSEXPORT cmsUnregisterPluginsTHR(cmsContext ContextID)
     _cmsRegisterOptimizationPlugin(ContextID, NULL);
     _cmsRegisterTransformPlugin(ContextID, NULL);    
     _cmsRegisterMutexPlugin(ContextID, NULL);
+    _cmsRegisterParallelizationPlugin(ContextID, NULL);
 }
 
 
@@ -812,6 +918,7 @@ cmsContext CMSEXPORT cmsCreateContext(void* Plugin, void* UserData)
     _cmsEnterCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
        ctx ->Next = _cmsContextPoolHead;
        _cmsContextPoolHead = ctx;
+       AddContextToHash(ctx);
     _cmsLeaveCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
 
     ctx ->chunks[UserPtr]     = UserData;
@@ -839,6 +946,9 @@ cmsContext CMSEXPORT cmsCreateContext(void* Plugin, void* UserData)
     _cmsAllocOptimizationPluginChunk(ctx, NULL);
     _cmsAllocTransformPluginChunk(ctx, NULL);
     _cmsAllocMutexPluginChunk(ctx, NULL);
+    _cmsAllocParallelizationPluginChunk(ctx, NULL);
+    _cmsAllocSharedTransformsChunk(ctx, NULL);
+    _cmsAllocTransformStatsChunk(ctx, NULL);
 
     // Setup the plug-ins
     if (!cmsPluginTHR(ctx, Plugin)) {
@@ -873,6 +983,7 @@ cmsContext CMSEXPORT cmsDupContext(cmsContext ContextID, void* NewUserData)
     _cmsEnterCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
        ctx ->Next = _cmsContextPoolHead;
        _cmsContextPoolHead = ctx;
+       AddContextToHash(ctx);
     _cmsLeaveCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
 
     ctx ->chunks[UserPtr]    = userData;
@@ -900,6 +1011,9 @@ cmsContext CMSEXPORT cmsDupContext(cmsContext ContextID, void* NewUserData)
     _cmsAllocOptimizationPluginChunk(ctx, src);
     _cmsAllocTransformPluginChunk(ctx, src);
     _cmsAllocMutexPluginChunk(ctx, src);
+    _cmsAllocParallelizationPluginChunk(ctx, src);
+    _cmsAllocSharedTransformsChunk(ctx, src);
+    _cmsAllocTransformStatsChunk(ctx, src);
 
     // Make sure no one failed
     for (i=Logger; i < MemoryClientMax; i++) {
@@ -952,6 +1066,9 @@ void CMSEXPORT cmsDeleteContext(cmsContext ContextID)
         // Get rid of plugins
         cmsUnregisterPluginsTHR(ContextID); 
 
+        _cmsFreeSharedTransformsChunk(ctx);
+        _cmsFreeTransformStatsChunk(ctx);
+
         // Since all memory is allocated in the private pool, all what we need to do is destroy the pool
         if (ctx -> MemPool != NULL)
               _cmsSubAllocDestroy(ctx ->MemPool);
@@ -959,6 +1076,7 @@ void CMSEXPORT cmsDeleteContext(cmsContext ContextID)
 
         // Maintain list
         _cmsEnterCriticalSectionPrimitive(&_cmsContextPoolHeadMutex);
+        RemoveContextFromHash(ctx);
         if (_cmsContextPoolHead == ctx) { 
 
             _cmsContextPoolHead = ctx->Next;
@@ -2368,17 +2368,18 @@ cmsStage* ReadCLUT(struct _cms_typehandler_struct* self, cmsIOHANDLER* io,
     // Precision can be 1 or 2 bytes
     if (Precision == 1) {
 
-        cmsUInt8Number  v;
+        // Read all bytes on the upper half of the table, and then expand them in place. Each
+        // entry is always read before being overwritten.
+        cmsUInt8Number* v = (cmsUInt8Number*) Data ->Tab.T + Data ->nEntries;
 
-        for (i=0; i < Data ->nEntries; i++) {
-
-            if (io ->Read(io, &v, sizeof(cmsUInt8Number), 1) != 1) {
-                cmsStageFree(CLUT);
-                return NULL;
-            }
-            Data ->Tab.T[i] = FROM_8_TO_16(v);
+        if (Data ->nEntries > 0 && io ->Read(io, v, sizeof(cmsUInt8Number), Data ->nEntries) != Data ->nEntries) {
+            cmsStageFree(CLUT);
+            return NULL;
         }
 
+        for (i=0; i < Data ->nEntries; i++)
+            Data ->Tab.T[i] = FROM_8_TO_16(v[i]);
+
     }
     else
         if (Precision == 2) {
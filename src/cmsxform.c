@@ -143,12 +143,223 @@ void _cmsAllocAlarmCodesChunk(struct _cmsContext_struct* ctx,
 
 // -----------------------------------------------------------------------
 
+// Transform statistics. Those are collected when the transform is created with cmsFLAGS_STATS, or when the context
+// has a callback. Creation times are taken once, runtime counters are updated at the end of each call under the
+// cache mutex. The context keeps the sums over its transforms with statistics.
+
+// The global statistics storage. No callback by default
+_cmsTransformStatsChunkType _cmsTransformStatsChunk = { CMS_MUTEX_INITIALIZER, NULL, NULL, { 0, 0, 0, { 0 }, -1, 0, 0, 0, 0, 0, 0, 0 } };
+
+// Allocates and inits the statistics container. The callback is inherited, the totals are not
+void _cmsAllocTransformStatsChunk(struct _cmsContext_struct* ctx,
+                                  const struct _cmsContext_struct* src)
+{
+    _cmsTransformStatsChunkType Chunk;
+    _cmsTransformStatsChunkType* ptr;
+
+    memset(&Chunk, 0, sizeof(Chunk));
+
+    if (src != NULL) {
+
+        _cmsTransformStatsChunkType* From = (_cmsTransformStatsChunkType*) src ->chunks[TransformStatsContext];
+
+        Chunk.Fn       = From ->Fn;
+        Chunk.UserData = From ->UserData;
+    }
+
+    Chunk.Totals.Optimization = -1;
+
+    ptr = (_cmsTransformStatsChunkType*) _cmsSubAllocDup(ctx ->MemPool, &Chunk, sizeof(_cmsTransformStatsChunkType));
+    if (ptr != NULL)
+        _cmsInitMutexPrimitive(&ptr ->Mutex);
+
+    ctx ->chunks[TransformStatsContext] = ptr;
+}
+
+void _cmsFreeTransformStatsChunk(struct _cmsContext_struct* ctx)
+{
+    _cmsTransformStatsChunkType* ptr = (_cmsTransformStatsChunkType*) ctx ->chunks[TransformStatsContext];
+
+    if (ptr != NULL)
+        _cmsDestroyMutexPrimitive(&ptr ->Mutex);
+}
+
+// Returns a zeroed statistics block if statistics are to be collected, NULL otherwise
+static
+cmsTransformStats* AllocTransformStats(cmsContext ContextID, cmsUInt32Number dwFlags)
+{
+    _cmsTransformStatsChunkType* ctx = (_cmsTransformStatsChunkType*) _cmsContextGetClientChunk(ContextID, TransformStatsContext);
+    cmsTransformStats* Stats;
+    cmsBool Enabled;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    Enabled = (dwFlags & cmsFLAGS_STATS) || ctx ->Fn != NULL;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    if (!Enabled) return NULL;
+
+    Stats = (cmsTransformStats*) _cmsMallocZero(ContextID, sizeof(cmsTransformStats));
+    if (Stats == NULL) return NULL;
+
+    Stats ->Optimization = -1;
+    return Stats;
+}
+
+// Adds runtime counters of one call
+static
+void AddRuntimeStats(_cmsTRANSFORM* p, cmsUInt32Number Calls, cmsFloat64Number Pixels, cmsFloat64Number Time,
+                     cmsFloat64Number CacheHits, cmsFloat64Number CacheMisses)
+{
+    if (p ->CacheMutex != NULL) _cmsLockMutex(p ->ContextID, p ->CacheMutex);
+
+    p ->Stats ->Calls         += Calls;
+    p ->Stats ->Pixels        += Pixels;
+    p ->Stats ->TransformTime += Time;
+    p ->Stats ->CacheHits     += CacheHits;
+    p ->Stats ->CacheMisses   += CacheMisses;
+
+    if (p ->CacheMutex != NULL) _cmsUnlockMutex(p ->ContextID, p ->CacheMutex);
+}
+
+// Cached workers count the pixels they had to evaluate
+static
+void AddCacheStats(_cmsTRANSFORM* p, cmsUInt32Number PixelsPerLine, cmsUInt32Number LineCount, cmsUInt32Number Misses)
+{
+    if (p ->Stats != NULL)
+        AddRuntimeStats(p, 0, 0, 0, (cmsFloat64Number) PixelsPerLine * LineCount - Misses, Misses);
+}
+
+static
+void CopyTransformStats(_cmsTRANSFORM* p, cmsTransformStats* Stats)
+{
+    if (p ->CacheMutex != NULL) _cmsLockMutex(p ->ContextID, p ->CacheMutex);
+    *Stats = *p ->Stats;
+    if (p ->CacheMutex != NULL) _cmsUnlockMutex(p ->ContextID, p ->CacheMutex);
+}
+
+// Adds the transform to the context totals and calls the callback, if any
+static
+void NotifyTransformStats(_cmsTRANSFORM* p, cmsUInt32Number Event)
+{
+    _cmsTransformStatsChunkType* ctx = (_cmsTransformStatsChunkType*) _cmsContextGetClientChunk(p ->ContextID, TransformStatsContext);
+    cmsTransformStats Stats;
+    cmsTransformStatsFn Fn;
+    void* UserData;
+    cmsUInt32Number i;
+
+    CopyTransformStats(p, &Stats);
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+
+    if (Event == cmsSTATS_TRANSFORM_CREATED) {
+
+        ctx ->Totals.nTransforms++;
+        ctx ->Totals.LinkTime     += Stats.LinkTime;
+        ctx ->Totals.OptimizeTime += Stats.OptimizeTime;
+
+        for (i=0; i < Stats.nOptimizationSteps && i < cmsMAX_OPTIMIZATION_STEPS; i++)
+            ctx ->Totals.StepTime[i] += Stats.StepTime[i];
+
+        if (Stats.nOptimizationSteps > ctx ->Totals.nOptimizationSteps)
+            ctx ->Totals.nOptimizationSteps = Stats.nOptimizationSteps;
+    }
+    else {
+
+        ctx ->Totals.Calls         += Stats.Calls;
+        ctx ->Totals.Pixels        += Stats.Pixels;
+        ctx ->Totals.TransformTime += Stats.TransformTime;
+        ctx ->Totals.CacheHits     += Stats.CacheHits;
+        ctx ->Totals.CacheMisses   += Stats.CacheMisses;
+    }
+
+    Fn       = ctx ->Fn;
+    UserData = ctx ->UserData;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    if (Fn != NULL)
+        Fn(p ->ContextID, (cmsHTRANSFORM) p, Event, &Stats, UserData);
+}
+
+// Called once the transform is complete
+static
+void AnnounceTransform(_cmsTRANSFORM* p)
+{
+    if (p ->Stats == NULL) return;
+
+    p ->StatsAnnounced = TRUE;
+    NotifyTransformStats(p, cmsSTATS_TRANSFORM_CREATED);
+}
+
+// Grid points of the first CLUT in the pipeline, if any
+static
+cmsUInt32Number FirstCLUTGridPoints(const cmsPipeline* Lut)
+{
+    cmsStage* mpe;
+
+    for (mpe = cmsPipelineGetPtrToFirstStage(Lut); mpe != NULL; mpe = cmsStageNext(mpe)) {
+
+        if (cmsStageType(mpe) == cmsSigCLutElemType)
+            return ((_cmsStageCLutData*) cmsStageData(mpe)) ->Params ->nSamples[0];
+    }
+
+    return 0;
+}
+
+cmsBool CMSEXPORT cmsGetTransformStats(cmsHTRANSFORM hTransform, cmsTransformStats* Stats)
+{
+    _cmsTRANSFORM* xform = (_cmsTRANSFORM*) hTransform;
+
+    _cmsAssert(Stats != NULL);
+
+    if (xform == NULL || xform ->Stats == NULL) return FALSE;
+
+    CopyTransformStats(xform, Stats);
+    return TRUE;
+}
+
+// A callback turns statistics on for transforms created from now on. NULL removes it
+void CMSEXPORT cmsSetTransformStatsCallback(cmsContext ContextID, cmsTransformStatsFn Fn, void* UserData)
+{
+    _cmsTransformStatsChunkType* ctx = (_cmsTransformStatsChunkType*) _cmsContextGetClientChunk(ContextID, TransformStatsContext);
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    ctx ->Fn       = Fn;
+    ctx ->UserData = UserData;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+}
+
+void CMSEXPORT cmsGetContextTransformStats(cmsContext ContextID, cmsTransformStats* Stats)
+{
+    _cmsTransformStatsChunkType* ctx = (_cmsTransformStatsChunkType*) _cmsContextGetClientChunk(ContextID, TransformStatsContext);
+
+    _cmsAssert(Stats != NULL);
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    *Stats = ctx ->Totals;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+}
+
+// -----------------------------------------------------------------------
+
 // Get rid of transform resources
-void CMSEXPORT cmsDeleteTransform(cmsHTRANSFORM hTransform)
+static
+void FreeTransform(_cmsTRANSFORM* p)
 {
-    _cmsTRANSFORM* p = (_cmsTRANSFORM*) hTransform;
+    cmsUInt32Number i;
 
-    _cmsAssert(p != NULL);
+    for (i=0; i < MAX_TRANSFORM_WORKSPACES; i++) {
+
+        if (p ->Workspaces[i] != NULL)
+            _cmsFree(p ->ContextID, p ->Workspaces[i]);
+    }
+
+    if (p ->Stats) {
+
+        if (p ->StatsAnnounced)
+            NotifyTransformStats(p, cmsSTATS_TRANSFORM_DELETED);
+
+        _cmsFree(p ->ContextID, p ->Stats);
+    }
 
     if (p -> GamutCheck)
         cmsPipelineFree(p -> GamutCheck);
@@ -168,9 +379,233 @@ void CMSEXPORT cmsDeleteTransform(cmsHTRANSFORM hTransform)
     if (p ->UserData)
         p ->FreeUserData(p ->ContextID, p ->UserData);
 
+    if (p ->CacheMutex)
+        _cmsDestroyMutex(p ->ContextID, p ->CacheMutex);
+
+    if (p ->SharedKey)
+        _cmsFree(p ->ContextID, p ->SharedKey);
+
     _cmsFree(p ->ContextID, (void *) p);
 }
 
+// -----------------------------------------------------------------------
+
+// Shared transforms. When a limit is set on a context, transforms created with same profiles, intents, black point
+// compensation, adaptation states, flags and formats are returned from a cache, as the same handle with one
+// more reference. Profiles are compared by their ID, which is computed as MD5 when the header has none. The
+// cache keeps at most MaxEntries transforms, dropping the least recently used. A dropped transform that is still
+// open lives until its last handle is deleted.
+
+// The global shared transforms storage. Disabled by default
+_cmsSharedTransformsChunkType _cmsSharedTransformsChunk = { CMS_MUTEX_INITIALIZER, 0, 0, 0, 0, 0, NULL };
+
+// Allocates and inits the shared transforms container. Only the limit is inherited, not the transforms
+void _cmsAllocSharedTransformsChunk(struct _cmsContext_struct* ctx,
+                                    const struct _cmsContext_struct* src)
+{
+    _cmsSharedTransformsChunkType Chunk;
+    _cmsSharedTransformsChunkType* ptr;
+
+    memset(&Chunk, 0, sizeof(Chunk));
+
+    if (src != NULL) {
+
+        Chunk.MaxEntries = ((_cmsSharedTransformsChunkType*) src ->chunks[SharedTransformsContext]) ->MaxEntries;
+    }
+
+    ptr = (_cmsSharedTransformsChunkType*) _cmsSubAllocDup(ctx ->MemPool, &Chunk, sizeof(_cmsSharedTransformsChunkType));
+    if (ptr != NULL)
+        _cmsInitMutexPrimitive(&ptr ->Mutex);
+
+    ctx ->chunks[SharedTransformsContext] = ptr;
+}
+
+// Releases the container. Transforms should be already flushed
+void _cmsFreeSharedTransformsChunk(struct _cmsContext_struct* ctx)
+{
+    _cmsSharedTransformsChunkType* ptr = (_cmsSharedTransformsChunkType*) ctx ->chunks[SharedTransformsContext];
+
+    if (ptr != NULL)
+        _cmsDestroyMutexPrimitive(&ptr ->Mutex);
+}
+
+// Keeps the first Max entries on the list. Dropped transforms that are not open are returned as a list to be freed
+// once the lock is released. Must be called with the lock held.
+static
+_cmsTRANSFORM* TrimSharedTransforms(_cmsSharedTransformsChunkType* ctx, cmsUInt32Number Max)
+{
+    _cmsTRANSFORM** Link = &ctx ->Head;
+    _cmsTRANSFORM* Idle = NULL;
+    _cmsTRANSFORM* p;
+    _cmsTRANSFORM* Next;
+    cmsUInt32Number n = 0;
+
+    while (*Link != NULL && n < Max) {
+        Link = &(*Link) ->SharedNext;
+        n++;
+    }
+
+    p = *Link;
+    *Link = NULL;
+
+    for (; p != NULL; p = Next) {
+
+        Next = p ->SharedNext;
+
+        p ->Listed = FALSE;
+        p ->SharedNext = NULL;
+        ctx ->nEntries--;
+        ctx ->Evictions++;
+
+        if (p ->RefCount == 0) {
+            p ->SharedNext = Idle;
+            Idle = p;
+        }
+    }
+
+    return Idle;
+}
+
+static
+void FreeTransformList(_cmsTRANSFORM* p)
+{
+    _cmsTRANSFORM* Next;
+
+    for (; p != NULL; p = Next) {
+
+        Next = p ->SharedNext;
+        FreeTransform(p);
+    }
+}
+
+// Deletes all transforms on the list that are not in use, keeping the limit
+void _cmsFlushSharedTransforms(cmsContext ContextID)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(ContextID, SharedTransformsContext);
+    _cmsTRANSFORM* Idle;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    Idle = TrimSharedTransforms(ctx, 0);
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    FreeTransformList(Idle);
+}
+
+// Sets the maximum number of shared transforms kept on the context. Zero disables sharing and flushes the
+// cache. Returns the previous limit.
+cmsUInt32Number CMSEXPORT cmsSetSharedTransformLimit(cmsContext ContextID, cmsUInt32Number MaxEntries)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(ContextID, SharedTransformsContext);
+    _cmsTRANSFORM* Idle;
+    cmsUInt32Number Prev;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    Prev = ctx ->MaxEntries;
+    ctx ->MaxEntries = MaxEntries;
+    Idle = TrimSharedTransforms(ctx, MaxEntries);
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    FreeTransformList(Idle);
+    return Prev;
+}
+
+// Grabs a snapshot of the counters
+void CMSEXPORT cmsGetSharedTransformStats(cmsContext ContextID, cmsSharedTransformStats* Stats)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(ContextID, SharedTransformsContext);
+
+    _cmsAssert(Stats != NULL);
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    Stats ->Entries    = ctx ->nEntries;
+    Stats ->MaxEntries = ctx ->MaxEntries;
+    Stats ->Hits       = ctx ->Hits;
+    Stats ->Misses     = ctx ->Misses;
+    Stats ->Evictions  = ctx ->Evictions;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+}
+
+// Drops one reference. Returns TRUE if the transform is to be freed
+static
+cmsBool ReleaseSharedTransform(_cmsTRANSFORM* p)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(p ->ContextID, SharedTransformsContext);
+    cmsBool Destroy;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    if (p ->RefCount > 0) p ->RefCount--;
+    Destroy = (p ->RefCount == 0 && !p ->Listed);
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    return Destroy;
+}
+
+// Takes an open shared transform out of the list, so it is not returned by later requests. Used before the
+// transform gets different from what its key says. Handles already given keep working as usual.
+static
+void UnlistSharedTransform(_cmsTRANSFORM* p)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(p ->ContextID, SharedTransformsContext);
+    _cmsTRANSFORM** Link;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+
+    if (p ->Listed) {
+
+        for (Link = &ctx ->Head; *Link != NULL; Link = &(*Link) ->SharedNext) {
+
+            if (*Link == p) {
+                *Link = p ->SharedNext;
+                break;
+            }
+        }
+
+        p ->Listed = FALSE;
+        p ->SharedNext = NULL;
+        ctx ->nEntries--;
+    }
+
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+}
+
+// Get rid of transform resources. Shared transforms are kept until the last handle goes away
+void CMSEXPORT cmsDeleteTransform(cmsHTRANSFORM hTransform)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) hTransform;
+
+    _cmsAssert(p != NULL);
+
+    if (p ->SharedKey != NULL) {
+
+        if (!ReleaseSharedTransform(p)) return;
+    }
+
+    FreeTransform(p);
+}
+
+// All entry points go here, so calls are timed when statistics are on
+static
+void RunTransform(_cmsTRANSFORM* p,
+                  const void* InputBuffer,
+                  void* OutputBuffer,
+                  cmsUInt32Number PixelsPerLine,
+                  cmsUInt32Number LineCount,
+                  const cmsStride* Stride)
+{
+    cmsFloat64Number Start;
+
+    if (p ->Stats == NULL) {
+
+        p ->xform(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
+    Start = _cmsGetTime();
+    p ->xform(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, Stride);
+
+    AddRuntimeStats(p, 1, (cmsFloat64Number) PixelsPerLine * LineCount, _cmsGetTime() - Start, 0, 0);
+}
+
 // Apply transform.
 void CMSEXPORT cmsDoTransform(cmsHTRANSFORM  Transform,
                               const void* InputBuffer,
@@ -186,7 +621,7 @@ void CMSEXPORT cmsDoTransform(cmsHTRANSFORM  Transform,
     stride.BytesPerPlaneIn = Size;
     stride.BytesPerPlaneOut = Size;
            
-    p -> xform(p, InputBuffer, OutputBuffer, Size, 1, &stride);
+    RunTransform(p, InputBuffer, OutputBuffer, Size, 1, &stride);
 }
 
 
@@ -205,7 +640,7 @@ void CMSEXPORT cmsDoTransformStride(cmsHTRANSFORM  Transform,
     stride.BytesPerPlaneIn = Stride;
     stride.BytesPerPlaneOut = Stride;
 
-    p -> xform(p, InputBuffer, OutputBuffer, Size, 1, &stride);
+    RunTransform(p, InputBuffer, OutputBuffer, Size, 1, &stride);
 }
 
 // This is the "fast" function for plugins
@@ -228,13 +663,142 @@ void CMSEXPORT cmsDoTransformLineStride(cmsHTRANSFORM  Transform,
     stride.BytesPerPlaneIn = BytesPerPlaneIn;
     stride.BytesPerPlaneOut = BytesPerPlaneOut;
 
-    p->xform(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, &stride);
+    RunTransform(p, InputBuffer, OutputBuffer, PixelsPerLine, LineCount, &stride);
 }
 
 
 
 // Transform routines ----------------------------------------------------------------------------------------------------------
 
+// Batch evaluation. Pixels are unpacked in runs, the whole run is evaluated by the pipeline at once and then packed.
+// This is only possible when the formatters do handle exactly the channels of the pipeline, since pixels are stored
+// contiguously. Some unrollers do write a few values past the channel count (i.e, gray to 3 channels), so there is
+// room for that at the end of the run.
+#define XFORM_BATCH_SIZE    1024
+
+static
+cmsBool CanEvalInBatch(const _cmsTRANSFORM* p, cmsUInt32Number PixelsPerLine)
+{
+    if (PixelsPerLine < 2) return FALSE;
+
+    return T_CHANNELS(p ->InputFormat)  == p ->Lut ->InputChannels &&
+           T_CHANNELS(p ->OutputFormat) == p ->Lut ->OutputChannels;
+}
+
+static
+cmsUInt32Number XFormBatchBlockSize(const cmsPipeline* Lut)
+{
+    cmsUInt32Number MaxChannels = Lut ->InputChannels > Lut ->OutputChannels ? Lut ->InputChannels : Lut ->OutputChannels;
+
+    if (MaxChannels == 0) MaxChannels = 1;
+    return XFORM_BATCH_SIZE / MaxChannels;
+}
+
+static
+void FloatBatchXFORM(_cmsTRANSFORM* p,
+                     const void* in,
+                     void* out,
+                     cmsUInt32Number PixelsPerLine,
+                     cmsUInt32Number LineCount,
+                     const cmsStride* Stride)
+{
+    cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsFloat32Number fIn[XFORM_BATCH_SIZE + cmsMAXCHANNELS], fOut[XFORM_BATCH_SIZE + cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = p ->Lut ->InputChannels;
+    cmsUInt32Number nOut = p ->Lut ->OutputChannels;
+    cmsUInt32Number i, j, k, n, Block, strideIn, strideOut;
+
+    Block = XFormBatchBlockSize(p ->Lut);
+
+    strideIn = 0;
+    strideOut = 0;
+
+    for (i = 0; i < LineCount; i++) {
+
+        accum = (cmsUInt8Number*)in + strideIn;
+        output = (cmsUInt8Number*)out + strideOut;
+
+        for (j = 0; j < PixelsPerLine; j += n) {
+
+            n = PixelsPerLine - j;
+            if (n > Block) n = Block;
+
+            if (p->FromInputFloatLine != NULL)
+                accum = p->FromInputFloatLine(p, fIn, accum, n, Stride->BytesPerPlaneIn);
+            else
+                for (k = 0; k < n; k++)
+                    accum = p->FromInputFloat(p, fIn + k * nIn, accum, Stride->BytesPerPlaneIn);
+
+            cmsPipelineEvalFloatBatch(fIn, fOut, n, p->Lut);
+
+            if (p->ToOutputFloatLine != NULL)
+                output = p->ToOutputFloatLine(p, fOut, output, n, Stride->BytesPerPlaneOut);
+            else
+                for (k = 0; k < n; k++)
+                    output = p->ToOutputFloat(p, fOut + k * nOut, output, Stride->BytesPerPlaneOut);
+        }
+
+        strideIn += Stride->BytesPerLineIn;
+        strideOut += Stride->BytesPerLineOut;
+    }
+}
+
+static
+void PrecalculatedBatchXFORM(_cmsTRANSFORM* p,
+                             const void* in,
+                             void* out,
+                             cmsUInt32Number PixelsPerLine,
+                             cmsUInt32Number LineCount,
+                             const cmsStride* Stride)
+{
+    cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wIn[XFORM_BATCH_SIZE + cmsMAXCHANNELS], wOut[XFORM_BATCH_SIZE + cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = p ->Lut ->InputChannels;
+    cmsUInt32Number nOut = p ->Lut ->OutputChannels;
+    cmsUInt32Number i, j, k, n, Block, strideIn, strideOut;
+
+    Block = XFormBatchBlockSize(p ->Lut);
+
+    strideIn = 0;
+    strideOut = 0;
+
+    for (i = 0; i < LineCount; i++) {
+
+        accum = (cmsUInt8Number*)in + strideIn;
+        output = (cmsUInt8Number*)out + strideOut;
+
+        for (j = 0; j < PixelsPerLine; j += n) {
+
+            n = PixelsPerLine - j;
+            if (n > Block) n = Block;
+
+            if (p->FromInputLine != NULL)
+                accum = p->FromInputLine(p, wIn, accum, n, Stride->BytesPerPlaneIn);
+            else
+                for (k = 0; k < n; k++)
+                    accum = p->FromInput(p, wIn + k * nIn, accum, Stride->BytesPerPlaneIn);
+
+            if (p->Lut->Eval16BatchFn != NULL)
+                p->Lut->Eval16BatchFn(wIn, wOut, n, p->Lut->Data);
+            else
+                for (k = 0; k < n; k++)
+                    p->Lut->Eval16Fn(wIn + k * nIn, wOut + k * nOut, p->Lut->Data);
+
+            if (p->ToOutputLine != NULL)
+                output = p->ToOutputLine(p, wOut, output, n, Stride->BytesPerPlaneOut);
+            else
+                for (k = 0; k < n; k++)
+                    output = p->ToOutput(p, wOut + k * nOut, output, Stride->BytesPerPlaneOut);
+        }
+
+        strideIn += Stride->BytesPerLineIn;
+        strideOut += Stride->BytesPerLineOut;
+    }
+}
+
+
 // Float xform converts floats. Since there are no performance issues, one routine does all job, including gamut check.
 // Note that because extended range, we can use a -1.0 value for out of gamut in this case.
 static
@@ -253,6 +817,11 @@ void FloatXFORM(_cmsTRANSFORM* p,
 
     _cmsHandleExtraChannels(p, in, out, PixelsPerLine, LineCount, Stride);
 
+    if (p->GamutCheck == NULL && CanEvalInBatch(p, PixelsPerLine)) {
+        FloatBatchXFORM(p, in, out, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
     strideIn = 0;
     strideOut = 0;
     memset(fIn, 0, sizeof(fIn));
@@ -395,6 +964,13 @@ void PrecalculatedXFORM(_cmsTRANSFORM* p,
 
     _cmsHandleExtraChannels(p, in, out, PixelsPerLine, LineCount, Stride);
 
+    // Pipelines knowing how to evaluate whole runs, or formatters working on whole lines, are better served that way
+    if ((p->Lut->Eval16BatchFn != NULL || (p->FromInputLine != NULL && p->ToOutputLine != NULL)) &&
+        CanEvalInBatch(p, PixelsPerLine)) {
+        PrecalculatedBatchXFORM(p, in, out, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
     strideIn = 0;
     strideOut = 0;
     memset(wIn, 0, sizeof(wIn));
@@ -481,6 +1057,171 @@ void PrecalculatedXFORMGamutCheck(_cmsTRANSFORM* p,
 }
 
 
+// Hashed color cache. When the transform has a cache size set, each call uses a direct-mapped table of
+// that many entries, indexed by a hash of the input words. It helps on images with a limited palette, where
+// colors repeat but not necessarily on consecutive pixels. Each call takes its own table from the transform
+// workspaces, so concurrent calls don't interfere. Entries hold the input words along with the result, so a
+// table stays good for later calls and is only cleared when it is new or the cache has been resized.
+// Returns FALSE if there is no memory for the table.
+static
+cmsUInt32Number HashColor(const cmsUInt16Number wIn[], cmsUInt32Number nChannels, cmsUInt32Number Bits)
+{
+    cmsUInt32Number i, h = 0;
+
+    for (i=0; i < nChannels; i++)
+        h = (h ^ wIn[i]) * 0x9E3779B1U;
+
+    return h >> (32 - Bits);
+}
+
+// Defined with the workspaces below
+static
+void* GetWorkspace(_cmsTRANSFORM* p, cmsUInt32Number Size, cmsUInt32Number Tag, cmsBool* Fresh);
+
+static
+cmsBool HashCachedXFORM(_cmsTRANSFORM* p,
+                        const void* in,
+                        void* out,
+                        cmsUInt32Number PixelsPerLine,
+                        cmsUInt32Number LineCount,
+                        const cmsStride* Stride)
+{
+    cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wIn[cmsMAXCHANNELS], wOut[cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = p ->Lut ->InputChannels;
+    cmsUInt32Number nOut = p ->Lut ->OutputChannels;
+    cmsUInt32Number nEntry = nIn + nOut;
+    cmsUInt32Number Bits = 0, Hits = 0, Misses = 0;
+    cmsUInt32Number i, j, h, strideIn, strideOut;
+    cmsUInt16Number* Table;
+    cmsUInt16Number* Entry;
+    cmsUInt8Number* Valid;
+    cmsBool Fresh;
+
+    while ((1U << Bits) < p ->CacheSize) Bits++;
+
+    Table = (cmsUInt16Number*) GetWorkspace(p, p ->CacheSize * (nEntry * (cmsUInt32Number) sizeof(cmsUInt16Number) + 1),
+                                            p ->CacheEpoch, &Fresh);
+    if (Table == NULL) return FALSE;
+
+    Valid = (cmsUInt8Number*) (Table + p ->CacheSize * nEntry);
+    if (Fresh) memset(Valid, 0, p ->CacheSize);
+
+    memset(wIn, 0, sizeof(wIn));
+    memset(wOut, 0, sizeof(wOut));
+
+    strideIn = 0;
+    strideOut = 0;
+
+    for (i = 0; i < LineCount; i++) {
+
+        accum = (cmsUInt8Number*)in + strideIn;
+        output = (cmsUInt8Number*)out + strideOut;
+
+        for (j = 0; j < PixelsPerLine; j++) {
+
+            accum = p->FromInput(p, wIn, accum, Stride->BytesPerPlaneIn);
+
+            h = Bits == 0 ? 0 : HashColor(wIn, nIn, Bits);
+            Entry = Table + h * nEntry;
+
+            if (Valid[h] && memcmp(wIn, Entry, nIn * sizeof(cmsUInt16Number)) == 0) {
+
+                memcpy(wOut, Entry + nIn, nOut * sizeof(cmsUInt16Number));
+                Hits++;
+            }
+            else {
+                p->Lut->Eval16Fn(wIn, wOut, p->Lut->Data);
+
+                memcpy(Entry, wIn, nIn * sizeof(cmsUInt16Number));
+                memcpy(Entry + nIn, wOut, nOut * sizeof(cmsUInt16Number));
+                Valid[h] = 1;
+                Misses++;
+            }
+
+            output = p->ToOutput(p, wOut, output, Stride->BytesPerPlaneOut);
+        }
+
+        strideIn += Stride->BytesPerLineIn;
+        strideOut += Stride->BytesPerLineOut;
+    }
+
+    _cmsReleaseTransformWorkspace(p, Table);
+
+    // Statistics are shared by all calls
+    if (p ->CacheMutex != NULL) _cmsLockMutex(p ->ContextID, p ->CacheMutex);
+    p ->CacheHits   += Hits;
+    p ->CacheMisses += Misses;
+    if (p ->CacheMutex != NULL) _cmsUnlockMutex(p ->ContextID, p ->CacheMutex);
+
+    AddCacheStats(p, PixelsPerLine, LineCount, Misses);
+    return TRUE;
+}
+
+// Same as below, but pixels are unpacked and packed by whole runs. The one-pixel cache is checked on the run.
+static
+void CachedBatchXFORM(_cmsTRANSFORM* p,
+                      const void* in,
+                      void* out,
+                      cmsUInt32Number PixelsPerLine,
+                      cmsUInt32Number LineCount,
+                      const cmsStride* Stride)
+{
+    cmsUInt8Number* accum;
+    cmsUInt8Number* output;
+    cmsUInt16Number wIn[XFORM_BATCH_SIZE + cmsMAXCHANNELS], wOut[XFORM_BATCH_SIZE + cmsMAXCHANNELS];
+    cmsUInt16Number CacheIn[cmsMAXCHANNELS], CacheOut[cmsMAXCHANNELS];
+    cmsUInt32Number nIn  = p ->Lut ->InputChannels;
+    cmsUInt32Number nOut = p ->Lut ->OutputChannels;
+    cmsUInt32Number i, j, k, n, Block, strideIn, strideOut, Misses = 0;
+
+    Block = XFormBatchBlockSize(p ->Lut);
+
+    // Get copy of zero cache
+    memcpy(CacheIn, p->Cache.CacheIn, sizeof(CacheIn));
+    memcpy(CacheOut, p->Cache.CacheOut, sizeof(CacheOut));
+
+    strideIn = 0;
+    strideOut = 0;
+
+    for (i = 0; i < LineCount; i++) {
+
+        accum = (cmsUInt8Number*)in + strideIn;
+        output = (cmsUInt8Number*)out + strideOut;
+
+        for (j = 0; j < PixelsPerLine; j += n) {
+
+            n = PixelsPerLine - j;
+            if (n > Block) n = Block;
+
+            accum = p->FromInputLine(p, wIn, accum, n, Stride->BytesPerPlaneIn);
+
+            for (k = 0; k < n; k++) {
+
+                cmsUInt16Number* pIn  = wIn + k * nIn;
+                cmsUInt16Number* pOut = wOut + k * nOut;
+
+                if (memcmp(pIn, CacheIn, nIn * sizeof(cmsUInt16Number)) != 0) {
+
+                    p->Lut->Eval16Fn(pIn, CacheOut, p->Lut->Data);
+                    memcpy(CacheIn, pIn, nIn * sizeof(cmsUInt16Number));
+                    Misses++;
+                }
+
+                memcpy(pOut, CacheOut, nOut * sizeof(cmsUInt16Number));
+            }
+
+            output = p->ToOutputLine(p, wOut, output, n, Stride->BytesPerPlaneOut);
+        }
+
+        strideIn += Stride->BytesPerLineIn;
+        strideOut += Stride->BytesPerLineOut;
+    }
+
+    AddCacheStats(p, PixelsPerLine, LineCount, Misses);
+}
+
 // No gamut check, Cache, 16 bits,
 static
 void CachedXFORM(_cmsTRANSFORM* p,
@@ -494,10 +1235,21 @@ void CachedXFORM(_cmsTRANSFORM* p,
     cmsUInt8Number* output;
     cmsUInt16Number wIn[cmsMAXCHANNELS], wOut[cmsMAXCHANNELS];
     _cmsCACHE Cache;
-    cmsUInt32Number i, j, strideIn, strideOut;
+    cmsUInt32Number i, j, strideIn, strideOut, Misses = 0;
 
     _cmsHandleExtraChannels(p, in, out, PixelsPerLine, LineCount, Stride);
 
+    // A hashed cache is only worth on more than one pixel
+    if (p->CacheSize > 0 && (PixelsPerLine > 1 || LineCount > 1)) {
+
+        if (HashCachedXFORM(p, in, out, PixelsPerLine, LineCount, Stride)) return;
+    }
+
+    if (p->FromInputLine != NULL && p->ToOutputLine != NULL && CanEvalInBatch(p, PixelsPerLine)) {
+        CachedBatchXFORM(p, in, out, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
     // Empty buffers for quick memcmp
     memset(wIn, 0, sizeof(wIn));
     memset(wOut, 0, sizeof(wOut));
@@ -526,6 +1278,7 @@ void CachedXFORM(_cmsTRANSFORM* p,
 
                 memcpy(Cache.CacheIn, wIn, sizeof(Cache.CacheIn));
                 memcpy(Cache.CacheOut, wOut, sizeof(Cache.CacheOut));
+                Misses++;
             }
 
             output = p->ToOutput(p, wOut, output, Stride->BytesPerPlaneOut);
@@ -534,6 +1287,8 @@ void CachedXFORM(_cmsTRANSFORM* p,
         strideIn += Stride->BytesPerLineIn;
         strideOut += Stride->BytesPerLineOut;
     }
+
+    AddCacheStats(p, PixelsPerLine, LineCount, Misses);
 }
 
 // All those nice features together
@@ -549,7 +1304,7 @@ void CachedXFORMGamutCheck(_cmsTRANSFORM* p,
     cmsUInt8Number* output;
     cmsUInt16Number wIn[cmsMAXCHANNELS], wOut[cmsMAXCHANNELS];
     _cmsCACHE Cache;
-    cmsUInt32Number i, j, strideIn, strideOut;
+    cmsUInt32Number i, j, strideIn, strideOut, Misses = 0;
 
     _cmsHandleExtraChannels(p, in, out, PixelsPerLine, LineCount, Stride);
 
@@ -581,6 +1336,7 @@ void CachedXFORMGamutCheck(_cmsTRANSFORM* p,
 
                 memcpy(Cache.CacheIn, wIn, sizeof(Cache.CacheIn));
                 memcpy(Cache.CacheOut, wOut, sizeof(Cache.CacheOut));
+                Misses++;
             }
 
             output = p->ToOutput(p, wOut, output, Stride->BytesPerPlaneOut);
@@ -589,6 +1345,138 @@ void CachedXFORMGamutCheck(_cmsTRANSFORM* p,
         strideIn += Stride->BytesPerLineIn;
         strideOut += Stride->BytesPerLineOut;
     }
+
+    AddCacheStats(p, PixelsPerLine, LineCount, Misses);
+}
+
+// Parallel execution ----------------------------------------------------------------------------------------------------
+
+// Do not split the work if each job would get less than this amount of pixels
+#define MIN_PIXELS_PER_JOB  16384
+
+// A band of the image, either a set of lines or a piece of a single line
+typedef struct {
+
+    _cmsTRANSFORM*  p;
+    const void*     InputBuffer;
+    void*           OutputBuffer;
+    cmsUInt32Number PixelsPerLine;
+    cmsUInt32Number LineCount;
+    cmsStride       Stride;
+
+} _cmsBand;
+
+static
+void BandJob(void* Cargo)
+{
+    _cmsBand* b = (_cmsBand*) Cargo;
+
+    b ->p ->Worker(b ->p, b ->InputBuffer, b ->OutputBuffer, b ->PixelsPerLine, b ->LineCount, &b ->Stride);
+}
+
+// Distance in bytes between two consecutive pixels. On planar formats, this is the size of one sample
+static
+cmsUInt32Number PixelSpacing(cmsUInt32Number Format)
+{
+    cmsUInt32Number BytesPerSample = T_BYTES(Format);
+
+    if (BytesPerSample == 0)
+        BytesPerSample = sizeof(cmsFloat64Number);
+
+    if (T_PLANAR(Format)) return BytesPerSample;
+
+    return BytesPerSample * (T_CHANNELS(Format) + T_EXTRA(Format));
+}
+
+// Splits the buffer in bands and runs the worker on each one. Pixels are independent, so results are the same
+// as running the worker on the whole buffer. Bands are made of lines if there are enough, otherwise the single 
+// line is split in pieces.
+static
+void ParallelXFORM(_cmsTRANSFORM* p,
+                   const void* in,
+                   void* out,
+                   cmsUInt32Number PixelsPerLine,
+                   cmsUInt32Number LineCount,
+                   const cmsStride* Stride)
+{
+    cmsUInt32Number nJobs, nUnits, Start, Size, i;
+    cmsUInt32Number InputSpacing, OutputSpacing;
+    cmsFloat64Number TotalPixels;
+    cmsBool SplitLines;
+    _cmsBand* Bands;
+    void** Cargo;
+
+    SplitLines    = LineCount > 1;
+    nUnits        = SplitLines ? LineCount : PixelsPerLine;
+    InputSpacing  = PixelSpacing(p ->InputFormat);
+    OutputSpacing = PixelSpacing(p ->OutputFormat);
+
+    TotalPixels = (cmsFloat64Number) PixelsPerLine * (cmsFloat64Number) LineCount;
+
+    nJobs = _cmsGetMaxWorkers(p ->ContextID);
+    if (nJobs > nUnits) nJobs = nUnits;
+    if (nJobs > TotalPixels / MIN_PIXELS_PER_JOB) nJobs = (cmsUInt32Number) (TotalPixels / MIN_PIXELS_PER_JOB);
+
+    // Formats with no pixel size (i.e. zero formats on a change-formatter transform) cannot be split
+    if (!SplitLines && (InputSpacing == 0 || OutputSpacing == 0)) nJobs = 1;
+
+    if (nJobs <= 1) {
+        p ->Worker(p, in, out, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
+    Bands = (_cmsBand*) _cmsGetTransformWorkspace(p, nJobs * (cmsUInt32Number) (sizeof(_cmsBand) + sizeof(void*)));
+
+    if (Bands == NULL) {
+
+        p ->Worker(p, in, out, PixelsPerLine, LineCount, Stride);
+        return;
+    }
+
+    Cargo = (void**) (Bands + nJobs);
+
+    Start = 0;
+    for (i=0; i < nJobs; i++) {
+
+        // Spread the remainder across first bands
+        Size = nUnits / nJobs + (i < nUnits % nJobs ? 1 : 0);
+
+        Bands[i].p      = p;
+        Bands[i].Stride = *Stride;
+
+        if (SplitLines) {
+
+            Bands[i].InputBuffer   = (const cmsUInt8Number*) in + (size_t) Start * Stride ->BytesPerLineIn;
+            Bands[i].OutputBuffer  = (cmsUInt8Number*) out + (size_t) Start * Stride ->BytesPerLineOut;
+            Bands[i].PixelsPerLine = PixelsPerLine;
+            Bands[i].LineCount     = Size;
+        }
+        else {
+
+            Bands[i].InputBuffer   = (const cmsUInt8Number*) in + (size_t) Start * InputSpacing;
+            Bands[i].OutputBuffer  = (cmsUInt8Number*) out + (size_t) Start * OutputSpacing;
+            Bands[i].PixelsPerLine = Size;
+            Bands[i].LineCount     = 1;
+        }
+
+        Cargo[i] = &Bands[i];
+        Start += Size;
+    }
+
+    _cmsRunParallelJobs(p ->ContextID, nJobs, BandJob, Cargo);
+
+    _cmsReleaseTransformWorkspace(p, Bands);
+}
+
+// If requested, put the scheduler in front of the worker
+static
+void SetupParallelXFORM(_cmsTRANSFORM* p, cmsUInt32Number dwFlags)
+{
+    if ((dwFlags & cmsFLAGS_PARALLEL) && p ->xform != NULL) {
+
+        p ->Worker = p ->xform;
+        p ->xform  = ParallelXFORM;
+    }
 }
 
 // Transform plug-ins ----------------------------------------------------------------------------------------------------
@@ -742,6 +1630,83 @@ void * CMSEXPORT _cmsGetTransformUserData(struct _cmstransform_struct *CMMcargo)
     return CMMcargo ->UserData;
 }
 
+// Workspaces. A block is taken from the idle slots, or allocated if there is none or it is too small. The block
+// size is kept in a header, which is as large as the malloc alignment so the user area keeps it. The header also
+// holds the tag of the last user, so internal users can tell whatever they left in the block is still there.
+#define WORKSPACE_HEADER    16
+
+static
+void* GetWorkspace(_cmsTRANSFORM* p, cmsUInt32Number Size, cmsUInt32Number Tag, cmsBool* Fresh)
+{
+    cmsUInt8Number* Block = NULL;
+    cmsUInt32Number* Header;
+    cmsUInt32Number i;
+
+    for (i=0; i < MAX_TRANSFORM_WORKSPACES && Block == NULL; i++) {
+
+        void* Slot = _cmsAtomicLoadPtr(&p ->Workspaces[i]);
+
+        if (Slot != NULL && _cmsAtomicCompareExchangePtr(&p ->Workspaces[i], Slot, NULL))
+            Block = (cmsUInt8Number*) Slot;
+    }
+
+    // Blocks only grow, so after a while all of them fit
+    if (Block != NULL && *(cmsUInt32Number*) Block < Size) {
+
+        _cmsFree(p ->ContextID, Block);
+        Block = NULL;
+    }
+
+    if (Block == NULL) {
+
+        if (Size > 0xFFFFFFFFU - WORKSPACE_HEADER) return NULL;
+
+        Block = (cmsUInt8Number*) _cmsMalloc(p ->ContextID, Size + WORKSPACE_HEADER);
+        if (Block == NULL) return NULL;
+
+        Header = (cmsUInt32Number*) Block;
+        Header[0] = Size;
+        Header[1] = 0;
+        if (Fresh) *Fresh = TRUE;
+    }
+    else {
+
+        Header = (cmsUInt32Number*) Block;
+        if (Fresh) *Fresh = (Header[1] != Tag);
+    }
+
+    Header[1] = Tag;
+    return Block + WORKSPACE_HEADER;
+}
+
+// Plug-ins get untagged blocks
+void* CMSEXPORT _cmsGetTransformWorkspace(struct _cmstransform_struct *CMMcargo, cmsUInt32Number Size)
+{
+    _cmsAssert(CMMcargo != NULL);
+
+    return GetWorkspace(CMMcargo, Size, 0, NULL);
+}
+
+void CMSEXPORT _cmsReleaseTransformWorkspace(struct _cmstransform_struct *CMMcargo, void* Workspace)
+{
+    cmsUInt8Number* Block;
+    cmsUInt32Number i;
+
+    _cmsAssert(CMMcargo != NULL);
+
+    if (Workspace == NULL) return;
+
+    Block = (cmsUInt8Number*) Workspace - WORKSPACE_HEADER;
+
+    for (i=0; i < MAX_TRANSFORM_WORKSPACES; i++) {
+
+        if (_cmsAtomicCompareExchangePtr(&CMMcargo ->Workspaces[i], NULL, Block)) return;
+    }
+
+    // All slots in use, more threads than we keep blocks for
+    _cmsFree(CMMcargo ->ContextID, Block);
+}
+
 // returns the current formatters
 void CMSEXPORT _cmsGetTransformFormatters16(struct _cmstransform_struct *CMMcargo, cmsFormatter16* FromInput, cmsFormatter16* ToOutput)
 {
@@ -757,6 +1722,21 @@ void CMSEXPORT _cmsGetTransformFormattersFloat(struct _cmstransform_struct *CMMc
      if (ToOutput)  *ToOutput  = CMMcargo ->ToOutputFloat;
 }
 
+// returns the current line formatters. Any of those may be NULL, then the one-pixel formatters are to be used
+void CMSEXPORT _cmsGetTransformLineFormatters16(struct _cmstransform_struct *CMMcargo, cmsFormatter16Line* FromInput, cmsFormatter16Line* ToOutput)
+{
+     _cmsAssert(CMMcargo != NULL);
+     if (FromInput) *FromInput = CMMcargo ->FromInputLine;
+     if (ToOutput)  *ToOutput  = CMMcargo ->ToOutputLine;
+}
+
+void CMSEXPORT _cmsGetTransformLineFormattersFloat(struct _cmstransform_struct *CMMcargo, cmsFormatterFloatLine* FromInput, cmsFormatterFloatLine* ToOutput)
+{
+     _cmsAssert(CMMcargo != NULL);
+     if (FromInput) *FromInput = CMMcargo ->FromInputFloatLine;
+     if (ToOutput)  *ToOutput  = CMMcargo ->ToOutputFloatLine;
+}
+
 
 // Allocate transform struct and set it to defaults. Ask the optimization plug-in about if those formats are proper
 // for separated transforms. If this is the case,
@@ -776,6 +1756,12 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
 
        // Store the proposed pipeline
        p->Lut = lut;
+       p->ContextID = ContextID;
+
+       // Statistics, if requested. Not getting them is not an error
+       p->Stats = AllocTransformStats(ContextID, *dwFlags);
+       if (p->Stats != NULL)
+              p->CacheMutex = _cmsCreateMutex(ContextID);
 
        // Let's see if any plug-in want to do the transform by itself
        if (p->Lut != NULL) {
@@ -804,19 +1790,36 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
                             p->ToOutput = _cmsGetFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_16BITS).Fmt16;
                             p->FromInputFloat = _cmsGetFormatter(ContextID, *InputFormat, cmsFormatterInput, CMS_PACK_FLAGS_FLOAT).FmtFloat;
                             p->ToOutputFloat = _cmsGetFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_FLOAT).FmtFloat;
+                            p->FromInputLine = _cmsGetLineFormatter(ContextID, *InputFormat, cmsFormatterInput, CMS_PACK_FLAGS_16BITS).Line16;
+                            p->ToOutputLine = _cmsGetLineFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_16BITS).Line16;
+                            p->FromInputFloatLine = _cmsGetLineFormatter(ContextID, *InputFormat, cmsFormatterInput, CMS_PACK_FLAGS_FLOAT).LineFloat;
+                            p->ToOutputFloatLine = _cmsGetLineFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_FLOAT).LineFloat;
 
                             // Save the day? (Ignore the warning)
                             if (Plugin->OldXform) {
                                    p->OldXform = (_cmsTransformFn)(void*) p->xform;
                                    p->xform = _cmsTransform2toTransformAdaptor;
                             }
-                             
+
+                            SetupParallelXFORM(p, *dwFlags);
                             return p;
                      }
               }
 
-              // Not suitable for the transform plug-in, let's check  the pipeline plug-in
-              _cmsOptimizePipeline(ContextID, &p->Lut, Intent, InputFormat, OutputFormat, dwFlags);
+              // Not suitable for the transform plug-in, let's check  the pipeline plug-in. Pipelines
+              // of loaded transforms may come already optimized
+              if (!_cmsPipelineIsOptimized(p->Lut)) {
+
+                  cmsFloat64Number Start = p->Stats != NULL ? _cmsGetTime() : 0;
+
+                  _cmsOptimizePipelineEx(ContextID, &p->Lut, Intent, InputFormat, OutputFormat, dwFlags, p->Stats);
+
+                  if (p->Stats != NULL)
+                      p->Stats->OptimizeTime = _cmsGetTime() - Start;
+              }
+
+              if (p->Stats != NULL)
+                  p->Stats->GridPoints = FirstCLUTGridPoints(p->Lut);
        }
 
     // Check whatever this is a true floating point transform
@@ -834,6 +1837,10 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
             return NULL;
         }
 
+        // Those are optional
+        p ->FromInputFloatLine = _cmsGetLineFormatter(ContextID, *InputFormat,  cmsFormatterInput, CMS_PACK_FLAGS_FLOAT).LineFloat;
+        p ->ToOutputFloatLine  = _cmsGetLineFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_FLOAT).LineFloat;
+
         if (*dwFlags & cmsFLAGS_NULLTRANSFORM) {
 
             p ->xform = NullFloatXFORM;
@@ -841,6 +1848,16 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
         else {
             // Float transforms don't use cache, always are non-NULL
             p ->xform = FloatXFORM;
+
+            // Matrix-shapers may skip the formatters, unless a plug-in overrides them
+            if (!(*dwFlags & cmsFLAGS_GAMUTCHECK) &&
+                _cmsFormatterIsStock(ContextID, *InputFormat,  cmsFormatterInput,  CMS_PACK_FLAGS_FLOAT) &&
+                _cmsFormatterIsStock(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_FLOAT)) {
+
+                _cmsTransform2Fn Fused = _cmsGetFusedXFORM(p ->Lut, *InputFormat, *OutputFormat, *dwFlags);
+                if (Fused != NULL)
+                    p ->xform = Fused;
+            }
         }
 
     }
@@ -864,6 +1881,9 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
                 return NULL;
             }
 
+            p ->FromInputLine = _cmsGetLineFormatter(ContextID, *InputFormat,  cmsFormatterInput, CMS_PACK_FLAGS_16BITS).Line16;
+            p ->ToOutputLine  = _cmsGetLineFormatter(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_16BITS).Line16;
+
             BytesPerPixelInput = T_BYTES(p ->InputFormat);
             if (BytesPerPixelInput == 0 || BytesPerPixelInput >= 2)
                    *dwFlags |= cmsFLAGS_CAN_CHANGE_FORMATTER;
@@ -890,6 +1910,16 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
                     p ->xform = CachedXFORM;  // No gamut check, cache
 
             }
+
+            // Common 8-bit formats may skip the formatters altogether, unless a plug-in overrides them
+            if (!(*dwFlags & cmsFLAGS_GAMUTCHECK) &&
+                _cmsFormatterIsStock(ContextID, *InputFormat,  cmsFormatterInput,  CMS_PACK_FLAGS_16BITS) &&
+                _cmsFormatterIsStock(ContextID, *OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_16BITS)) {
+
+                _cmsTransform2Fn Fused = _cmsGetFusedXFORM(p ->Lut, *InputFormat, *OutputFormat, *dwFlags);
+                if (Fused != NULL)
+                    p ->xform = Fused;
+            }
         }
     }
 
@@ -898,6 +1928,8 @@ _cmsTRANSFORM* AllocEmptyTransform(cmsContext ContextID, cmsPipeline* lut,
     p ->dwOriginalFlags = *dwFlags;
     p ->ContextID       = ContextID;
     p ->UserData        = NULL;
+
+    SetupParallelXFORM(p, *dwFlags);
     return p;
 }
 
@@ -1006,7 +2038,8 @@ void SetWhitePoint(cmsCIEXYZ* wtPt, const cmsCIEXYZ* src)
 }
 
 // New to lcms 2.0 -- have all parameters available.
-cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
+static
+cmsHTRANSFORM CreateExtendedTransform(cmsContext ContextID,
                                                    cmsUInt32Number nProfiles, cmsHPROFILE hProfiles[],
                                                    cmsBool  BPC[],
                                                    cmsUInt32Number Intents[],
@@ -1021,6 +2054,7 @@ cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
     cmsColorSpaceSignature EntryColorSpace;
     cmsColorSpaceSignature ExitColorSpace;
     cmsPipeline* Lut;
+    cmsFloat64Number LinkTime;
     cmsUInt32Number LastIntent = Intents[nProfiles-1];
 
     // If it is a fake transform
@@ -1056,7 +2090,9 @@ cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
     }
 
     // Create a pipeline with all transformations
+    LinkTime = _cmsGetTime();
     Lut = _cmsLinkProfiles(ContextID, nProfiles, Intents, hProfiles, BPC, AdaptationStates, dwFlags);
+    LinkTime = _cmsGetTime() - LinkTime;
     if (Lut == NULL) {
         cmsSignalError(ContextID, cmsERROR_NOT_SUITABLE, "Couldn't link the profiles");
         return NULL;
@@ -1077,6 +2113,9 @@ cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
         return NULL;
     }
 
+    if (xform ->Stats != NULL)
+        xform ->Stats ->LinkTime = LinkTime;
+
     // Keep values
     xform ->EntryColorSpace = EntryColorSpace;
     xform ->ExitColorSpace  = ExitColorSpace;
@@ -1093,7 +2132,8 @@ cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
                                                         BPC, Intents,
                                                         AdaptationStates,
                                                         nGamutPCSposition,
-                                                        hGamutProfile);
+                                                        hGamutProfile,
+                                                        dwFlags);
 
 
     // Try to read input and output colorant table
@@ -1143,51 +2183,267 @@ cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
 
     }
 
+    AnnounceTransform(xform);
     return (cmsHTRANSFORM) xform;
 }
 
-// Multiprofile transforms: Gamut check is not available here, as it is unclear from which profile the gamut comes.
-cmsHTRANSFORM CMSEXPORT cmsCreateMultiprofileTransformTHR(cmsContext ContextID,
-                                                       cmsHPROFILE hProfiles[],
-                                                       cmsUInt32Number nProfiles,
-                                                       cmsUInt32Number InputFormat,
-                                                       cmsUInt32Number OutputFormat,
-                                                       cmsUInt32Number Intent,
-                                                       cmsUInt32Number dwFlags)
+// Shared transforms key. A fixed part followed by one entry for each profile, plus one for the gamut profile
+typedef struct {
+
+    cmsProfileID     ID;
+    cmsUInt32Number  Intent;
+    cmsUInt32Number  BPC;
+    cmsFloat64Number AdaptationState;
+    cmsUInt32Number  HeaderIntent;
+    cmsUInt64Number  Attributes;
+
+} _cmsSharedProfileKey;
+
+typedef struct {
+
+    cmsUInt32Number  nProfiles;
+    cmsUInt32Number  nGamutPCSposition;
+    cmsUInt32Number  InputFormat;
+    cmsUInt32Number  OutputFormat;
+    cmsUInt32Number  dwFlags;
+    cmsUInt32Number  OptimizationBudget;
+    cmsUInt16Number  AlarmCodes[cmsMAXCHANNELS];
+
+} _cmsSharedTransformKey;
+
+// Gets the profile ID, or a digest of the contents if the header has none
+static
+cmsBool GetSharedProfileID(cmsHPROFILE hProfile, cmsProfileID* ID)
 {
     cmsUInt32Number i;
-    cmsBool BPC[256];
-    cmsUInt32Number Intents[256];
-    cmsFloat64Number AdaptationStates[256];
 
-    if (nProfiles <= 0 || nProfiles > 255) {
-         cmsSignalError(ContextID, cmsERROR_RANGE, "Wrong number of profiles. 1..255 expected, %d found.", nProfiles);
-        return NULL;
-    }
+    cmsGetHeaderProfileID(hProfile, ID ->ID8);
 
-    for (i=0; i < nProfiles; i++) {
-        BPC[i] = dwFlags & cmsFLAGS_BLACKPOINTCOMPENSATION ? TRUE : FALSE;
-        Intents[i] = Intent;
-        AdaptationStates[i] = cmsSetAdaptationStateTHR(ContextID, -1);
-    }
+    for (i=0; i < 16; i++)
+        if (ID ->ID8[i] != 0) return TRUE;
 
+    return _cmsGetProfileDigest(hProfile, ID);
+}
 
-    return cmsCreateExtendedTransform(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates, NULL, 0, InputFormat, OutputFormat, dwFlags);
+static
+void FillSharedProfileKey(_cmsSharedProfileKey* Key, cmsHPROFILE hProfile)
+{
+    Key ->HeaderIntent = cmsGetHeaderRenderingIntent(hProfile);
+    cmsGetHeaderAttributes(hProfile, &Key ->Attributes);
 }
 
+// Builds the lookup key. Returns NULL if any profile cannot be identified
+static
+void* BuildSharedKey(cmsContext ContextID,
+                     cmsUInt32Number nProfiles, cmsHPROFILE hProfiles[],
+                     cmsBool  BPC[],
+                     cmsUInt32Number Intents[],
+                     cmsFloat64Number AdaptationStates[],
+                     cmsHPROFILE hGamutProfile,
+                     cmsUInt32Number nGamutPCSposition,
+                     cmsUInt32Number InputFormat,
+                     cmsUInt32Number OutputFormat,
+                     cmsUInt32Number dwFlags,
+                     cmsUInt32Number* KeySize)
+{
+    _cmsSharedTransformKey* Key;
+    _cmsSharedProfileKey* Profiles;
+    cmsUInt32Number i, Size;
 
+    Size = sizeof(_cmsSharedTransformKey) + (nProfiles + 1) * sizeof(_cmsSharedProfileKey);
 
-cmsHTRANSFORM CMSEXPORT cmsCreateMultiprofileTransform(cmsHPROFILE hProfiles[],
-                                                  cmsUInt32Number nProfiles,
-                                                  cmsUInt32Number InputFormat,
-                                                  cmsUInt32Number OutputFormat,
-                                                  cmsUInt32Number Intent,
-                                                  cmsUInt32Number dwFlags)
-{
+    // Zeroed, so padding does not get into the comparison
+    Key = (_cmsSharedTransformKey*) _cmsMallocZero(ContextID, Size);
+    if (Key == NULL) return NULL;
 
-    if (nProfiles <= 0 || nProfiles > 255) {
-         cmsSignalError(NULL, cmsERROR_RANGE, "Wrong number of profiles. 1..255 expected, %d found.", nProfiles);
-         return NULL;
+    Profiles = (_cmsSharedProfileKey*) (Key + 1);
+
+    Key ->nProfiles    = nProfiles;
+    Key ->InputFormat  = InputFormat;
+    Key ->OutputFormat = OutputFormat;
+    Key ->dwFlags      = dwFlags;
+    Key ->OptimizationBudget = _cmsGetOptimizationBudget(ContextID);
+
+    for (i=0; i < nProfiles; i++) {
+
+        if (hProfiles[i] == NULL || !GetSharedProfileID(hProfiles[i], &Profiles[i].ID)) goto Error;
+
+        FillSharedProfileKey(&Profiles[i], hProfiles[i]);
+        Profiles[i].Intent = Intents[i];
+        Profiles[i].BPC    = BPC[i] ? 1 : 0;
+        Profiles[i].AdaptationState = AdaptationStates[i];
+    }
+
+    // Gamut check depends on the gamut profile and the alarm codes at creation time
+    if ((dwFlags & cmsFLAGS_GAMUTCHECK) && hGamutProfile != NULL) {
+
+        if (!GetSharedProfileID(hGamutProfile, &Profiles[nProfiles].ID)) goto Error;
+
+        FillSharedProfileKey(&Profiles[nProfiles], hGamutProfile);
+        Key ->nGamutPCSposition = nGamutPCSposition;
+        cmsGetAlarmCodesTHR(ContextID, Key ->AlarmCodes);
+    }
+
+    *KeySize = Size;
+    return (void*) Key;
+
+Error:
+    _cmsFree(ContextID, Key);
+    return NULL;
+}
+
+static
+cmsUInt32Number HashSharedKey(const void* Key, cmsUInt32Number Size)
+{
+    const cmsUInt8Number* ptr = (const cmsUInt8Number*) Key;
+    cmsUInt32Number i, h = 2166136261U;
+
+    for (i=0; i < Size; i++)
+        h = (h ^ ptr[i]) * 16777619U;
+
+    return h;
+}
+
+// Looks for a transform with same key and moves it to the front. Must be called with the lock held
+static
+_cmsTRANSFORM* FindSharedTransform(_cmsSharedTransformsChunkType* ctx, cmsContext ContextID,
+                                   const void* Key, cmsUInt32Number KeySize, cmsUInt32Number Hash)
+{
+    _cmsTRANSFORM** Link;
+    _cmsTRANSFORM* p;
+
+    for (Link = &ctx ->Head; *Link != NULL; Link = &(*Link) ->SharedNext) {
+
+        p = *Link;
+
+        if (p ->SharedHash == Hash && p ->SharedKeySize == KeySize && p ->ContextID == ContextID &&
+            memcmp(p ->SharedKey, Key, KeySize) == 0) {
+
+            *Link = p ->SharedNext;
+            p ->SharedNext = ctx ->Head;
+            ctx ->Head = p;
+            return p;
+        }
+    }
+
+    return NULL;
+}
+
+cmsHTRANSFORM CMSEXPORT cmsCreateExtendedTransform(cmsContext ContextID,
+                                                   cmsUInt32Number nProfiles, cmsHPROFILE hProfiles[],
+                                                   cmsBool  BPC[],
+                                                   cmsUInt32Number Intents[],
+                                                   cmsFloat64Number AdaptationStates[],
+                                                   cmsHPROFILE hGamutProfile,
+                                                   cmsUInt32Number nGamutPCSposition,
+                                                   cmsUInt32Number InputFormat,
+                                                   cmsUInt32Number OutputFormat,
+                                                   cmsUInt32Number dwFlags)
+{
+    _cmsSharedTransformsChunkType* ctx = (_cmsSharedTransformsChunkType*) _cmsContextGetClientChunk(ContextID, SharedTransformsContext);
+    _cmsTRANSFORM* xform;
+    _cmsTRANSFORM* Idle;
+    void* Key;
+    cmsUInt32Number KeySize, Hash;
+
+    // Sharing is disabled by default. Fake transforms are not worth sharing
+    if (ctx ->MaxEntries == 0 || (dwFlags & cmsFLAGS_NULLTRANSFORM) || nProfiles == 0 || nProfiles > 255)
+        return CreateExtendedTransform(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates,
+                                       hGamutProfile, nGamutPCSposition, InputFormat, OutputFormat, dwFlags);
+
+    Key = BuildSharedKey(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates,
+                         hGamutProfile, nGamutPCSposition, InputFormat, OutputFormat, dwFlags, &KeySize);
+
+    if (Key == NULL)
+        return CreateExtendedTransform(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates,
+                                       hGamutProfile, nGamutPCSposition, InputFormat, OutputFormat, dwFlags);
+
+    Hash = HashSharedKey(Key, KeySize);
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+    xform = FindSharedTransform(ctx, ContextID, Key, KeySize, Hash);
+    if (xform != NULL) {
+        xform ->RefCount++;
+        ctx ->Hits++;
+    }
+    else
+        ctx ->Misses++;
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    if (xform != NULL) {
+        _cmsFree(ContextID, Key);
+        return (cmsHTRANSFORM) xform;
+    }
+
+    // Not found, create a new one. The lock is not held, as this may take long
+    xform = (_cmsTRANSFORM*) CreateExtendedTransform(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates,
+                                                      hGamutProfile, nGamutPCSposition, InputFormat, OutputFormat, dwFlags);
+    if (xform == NULL) {
+        _cmsFree(ContextID, Key);
+        return NULL;
+    }
+
+    xform ->SharedKey     = Key;
+    xform ->SharedKeySize = KeySize;
+    xform ->SharedHash    = Hash;
+    xform ->RefCount      = 1;
+
+    _cmsEnterCriticalSectionPrimitive(&ctx ->Mutex);
+
+    xform ->Listed     = TRUE;
+    xform ->SharedNext = ctx ->Head;
+    ctx ->Head = xform;
+    ctx ->nEntries++;
+
+    Idle = TrimSharedTransforms(ctx, ctx ->MaxEntries);
+    _cmsLeaveCriticalSectionPrimitive(&ctx ->Mutex);
+
+    FreeTransformList(Idle);
+    return (cmsHTRANSFORM) xform;
+}
+
+// Multiprofile transforms: Gamut check is not available here, as it is unclear from which profile the gamut comes.
+cmsHTRANSFORM CMSEXPORT cmsCreateMultiprofileTransformTHR(cmsContext ContextID,
+                                                       cmsHPROFILE hProfiles[],
+                                                       cmsUInt32Number nProfiles,
+                                                       cmsUInt32Number InputFormat,
+                                                       cmsUInt32Number OutputFormat,
+                                                       cmsUInt32Number Intent,
+                                                       cmsUInt32Number dwFlags)
+{
+    cmsUInt32Number i;
+    cmsBool BPC[256];
+    cmsUInt32Number Intents[256];
+    cmsFloat64Number AdaptationStates[256];
+
+    if (nProfiles <= 0 || nProfiles > 255) {
+         cmsSignalError(ContextID, cmsERROR_RANGE, "Wrong number of profiles. 1..255 expected, %d found.", nProfiles);
+        return NULL;
+    }
+
+    for (i=0; i < nProfiles; i++) {
+        BPC[i] = dwFlags & cmsFLAGS_BLACKPOINTCOMPENSATION ? TRUE : FALSE;
+        Intents[i] = Intent;
+        AdaptationStates[i] = cmsSetAdaptationStateTHR(ContextID, -1);
+    }
+
+
+    return cmsCreateExtendedTransform(ContextID, nProfiles, hProfiles, BPC, Intents, AdaptationStates, NULL, 0, InputFormat, OutputFormat, dwFlags);
+}
+
+
+
+cmsHTRANSFORM CMSEXPORT cmsCreateMultiprofileTransform(cmsHPROFILE hProfiles[],
+                                                  cmsUInt32Number nProfiles,
+                                                  cmsUInt32Number InputFormat,
+                                                  cmsUInt32Number OutputFormat,
+                                                  cmsUInt32Number Intent,
+                                                  cmsUInt32Number dwFlags)
+{
+
+    if (nProfiles <= 0 || nProfiles > 255) {
+         cmsSignalError(NULL, cmsERROR_RANGE, "Wrong number of profiles. 1..255 expected, %d found.", nProfiles);
+         return NULL;
     }
 
     return cmsCreateMultiprofileTransformTHR(cmsGetProfileContextID(hProfiles[0]),
@@ -1331,9 +2587,774 @@ cmsBool CMSEXPORT cmsChangeBuffersFormat(cmsHTRANSFORM hTransform,
         return FALSE;
     }
 
+    // The shared key holds the formats at creation
+    if (xform ->SharedKey != NULL) UnlistSharedTransform(xform);
+
     xform ->InputFormat  = InputFormat;
     xform ->OutputFormat = OutputFormat;
     xform ->FromInput    = FromInput;
     xform ->ToOutput     = ToOutput;
+    xform ->FromInputLine = _cmsGetLineFormatter(xform->ContextID, InputFormat,  cmsFormatterInput, CMS_PACK_FLAGS_16BITS).Line16;
+    xform ->ToOutputLine  = _cmsGetLineFormatter(xform->ContextID, OutputFormat, cmsFormatterOutput, CMS_PACK_FLAGS_16BITS).Line16;
     return TRUE;
 }
+
+// Sets the number of entries of the hashed color cache. It is rounded up to a power of two, and zero
+// goes back to the 1-pixel cache. Only transforms using the 16 bits cache can take it. Resets statistics.
+#define MAX_TRANSFORM_CACHE_SIZE (1U << 20)
+
+cmsBool CMSEXPORT cmsSetTransformCacheSize(cmsHTRANSFORM hTransform, cmsUInt32Number nEntries)
+{
+    _cmsTRANSFORM* xform = (_cmsTRANSFORM*) hTransform;
+    cmsUInt32Number n;
+
+    if (xform == NULL) return FALSE;
+
+    if (xform ->xform != CachedXFORM && xform ->Worker != CachedXFORM) {
+
+        cmsSignalError(xform ->ContextID, cmsERROR_NOT_SUITABLE, "Transform does not use a color cache");
+        return FALSE;
+    }
+
+    if (nEntries > MAX_TRANSFORM_CACHE_SIZE) nEntries = MAX_TRANSFORM_CACHE_SIZE;
+
+    n = 0;
+    if (nEntries > 0) {
+
+        n = 1;
+        while (n < nEntries) n <<= 1;
+    }
+
+    if (n > 0 && xform ->CacheMutex == NULL) {
+
+        xform ->CacheMutex = _cmsCreateMutex(xform ->ContextID);
+        if (xform ->CacheMutex == NULL) return FALSE;
+    }
+
+    // Requests for a new transform should not get a resized cache
+    if (xform ->SharedKey != NULL) UnlistSharedTransform(xform);
+
+    // Tables left in workspaces are for the old size. Zero is the tag of untagged blocks
+    if (++xform ->CacheEpoch == 0) xform ->CacheEpoch = 1;
+
+    xform ->CacheSize   = n;
+    xform ->CacheHits   = 0;
+    xform ->CacheMisses = 0;
+    return TRUE;
+}
+
+// Returns hits and misses of the hashed cache since it was last sized. Either pointer may be NULL
+cmsBool CMSEXPORT cmsGetTransformCacheStats(cmsHTRANSFORM hTransform, cmsUInt32Number* Hits, cmsUInt32Number* Misses)
+{
+    _cmsTRANSFORM* xform = (_cmsTRANSFORM*) hTransform;
+
+    if (xform == NULL) return FALSE;
+
+    if (xform ->CacheMutex != NULL) _cmsLockMutex(xform ->ContextID, xform ->CacheMutex);
+    if (Hits)   *Hits   = xform ->CacheHits;
+    if (Misses) *Misses = xform ->CacheMisses;
+    if (xform ->CacheMutex != NULL) _cmsUnlockMutex(xform ->ContextID, xform ->CacheMutex);
+
+    return TRUE;
+}
+
+// Introspection -----------------------------------------------------------------------------------------------
+
+// Maps the worker to its cmsWORKER_* code. Anything not built-in comes from a plug-in
+static
+cmsUInt32Number GetWorkerKind(const _cmsTRANSFORM* p, _cmsTransform2Fn Worker)
+{
+    if (Worker == NullXFORM)                    return cmsWORKER_NULL;
+    if (Worker == NullFloatXFORM)               return cmsWORKER_NULL_FLOAT;
+    if (Worker == PrecalculatedXFORM)           return cmsWORKER_PRECALCULATED;
+    if (Worker == PrecalculatedXFORMGamutCheck) return cmsWORKER_PRECALCULATED_GAMUTCHECK;
+    if (Worker == CachedXFORM)                  return cmsWORKER_CACHED;
+    if (Worker == CachedXFORMGamutCheck)        return cmsWORKER_CACHED_GAMUTCHECK;
+    if (Worker == FloatXFORM)                   return cmsWORKER_FLOAT;
+
+    if (Worker == _cmsGetFusedXFORM(p ->Lut, p ->InputFormat, p ->OutputFormat, p ->dwOriginalFlags))
+        return cmsWORKER_FUSED;
+
+    return cmsWORKER_PLUGIN;
+}
+
+cmsBool CMSEXPORT cmsGetTransformInfo(cmsHTRANSFORM hTransform, cmsTransformInfo* Info)
+{
+    _cmsTRANSFORM* xform = (_cmsTRANSFORM*) hTransform;
+    cmsStage* mpe;
+    cmsUInt32Number n;
+
+    _cmsAssert(Info != NULL);
+
+    if (xform == NULL) return FALSE;
+
+    memset(Info, 0, sizeof(cmsTransformInfo));
+
+    Info ->Parallel  = xform ->xform == ParallelXFORM;
+    Info ->Worker    = GetWorkerKind(xform, Info ->Parallel ? xform ->Worker : xform ->xform);
+    Info ->CacheSize = xform ->CacheSize;
+
+    Info ->MemorySize = sizeof(_cmsTRANSFORM);
+    if (xform ->Stats != NULL)
+        Info ->MemorySize += sizeof(cmsTransformStats);
+
+    if (xform ->GamutCheck != NULL)
+        Info ->MemorySize += _cmsPipelineMemorySize(xform ->GamutCheck);
+
+    // Transform plug-ins may take the pipeline for themselves
+    if (xform ->Lut == NULL) return TRUE;
+
+    Info ->OptimizationSize = _cmsGetPipelineEvaluators(xform ->Lut, &Info ->Eval16, &Info ->EvalFloat);
+    Info ->MemorySize      += _cmsPipelineMemorySize(xform ->Lut) + Info ->OptimizationSize;
+
+    if (_cmsFormatterIsFloat(xform ->InputFormat) && _cmsFormatterIsFloat(xform ->OutputFormat))
+        Info ->Batch = xform ->Lut ->EvalFloatBatchFn != NULL;
+    else
+        Info ->Batch = xform ->Lut ->Eval16BatchFn != NULL;
+
+    Info ->InputChannels  = xform ->Lut ->InputChannels;
+    Info ->OutputChannels = xform ->Lut ->OutputChannels;
+
+    for (n=0, mpe = xform ->Lut ->Elements; mpe != NULL; mpe = mpe ->Next, n++) {
+
+        if (n < cmsMAX_STAGE_INFO)
+            _cmsGetStageInfo(mpe, &Info ->Stages[n]);
+    }
+
+    Info ->nStages = n;
+    return TRUE;
+}
+
+// Saved transforms -----------------------------------------------------------------------------------------------
+
+// A transform can be saved as a block of memory, holding the optimized pipeline and anything else needed to
+// rebuild it, so the expensive parts (mainly resampling) are not computed again on load. Tables are stored
+// as they are, big endian as in ICC, and formatters are taken from the formats on load. Transforms with gamut
+// check or a profile sequence, and stages other than curves, matrices, 16 bits CLUTs and few built-in
+// conversions, cannot be saved.
+
+#define XFORM_BLOB_MAGIC    0x6C637866      // 'lcxf'
+#define XFORM_BLOB_VERSION  1
+
+static
+cmsBool WriteFloat64(cmsIOHANDLER* io, cmsFloat64Number n)
+{
+    cmsUInt64Number Bits;
+
+    memmove(&Bits, &n, sizeof(Bits));
+    return _cmsWriteUInt64Number(io, &Bits);
+}
+
+static
+cmsBool ReadFloat64(cmsIOHANDLER* io, cmsFloat64Number* n)
+{
+    cmsUInt64Number Bits;
+
+    if (!_cmsReadUInt64Number(io, &Bits)) return FALSE;
+    memmove(n, &Bits, sizeof(Bits));
+    return TRUE;
+}
+
+// Floats go as raw bits, as segment domains may be out of the range accepted by _cmsReadFloat32Number
+static
+cmsBool WriteFloat32(cmsIOHANDLER* io, cmsFloat32Number n)
+{
+    cmsUInt32Number Bits;
+
+    memmove(&Bits, &n, sizeof(Bits));
+    return _cmsWriteUInt32Number(io, Bits);
+}
+
+static
+cmsBool ReadFloat32(cmsIOHANDLER* io, cmsFloat32Number* n)
+{
+    cmsUInt32Number Bits;
+
+    if (!_cmsReadUInt32Number(io, &Bits)) return FALSE;
+    memmove(n, &Bits, sizeof(Bits));
+    return TRUE;
+}
+
+static
+cmsBool WriteXYZ(cmsIOHANDLER* io, const cmsCIEXYZ* XYZ)
+{
+    return WriteFloat64(io, XYZ ->X) && WriteFloat64(io, XYZ ->Y) && WriteFloat64(io, XYZ ->Z);
+}
+
+static
+cmsBool ReadXYZ(cmsIOHANDLER* io, cmsCIEXYZ* XYZ)
+{
+    return ReadFloat64(io, &XYZ ->X) && ReadFloat64(io, &XYZ ->Y) && ReadFloat64(io, &XYZ ->Z);
+}
+
+// Curves keep their segments, if any, and the 16 bits table
+static
+cmsBool WriteCurve(cmsIOHANDLER* io, const cmsToneCurve* Curve)
+{
+    cmsUInt32Number i, j;
+
+    if (!_cmsWriteUInt32Number(io, Curve ->nSegments)) return FALSE;
+
+    for (i=0; i < Curve ->nSegments; i++) {
+
+        const cmsCurveSegment* Seg = Curve ->Segments + i;
+
+        if (!WriteFloat32(io, Seg ->x0)) return FALSE;
+        if (!WriteFloat32(io, Seg ->x1)) return FALSE;
+        if (!_cmsWriteUInt32Number(io, (cmsUInt32Number) Seg ->Type)) return FALSE;
+
+        for (j=0; j < 10; j++)
+            if (!WriteFloat64(io, Seg ->Params[j])) return FALSE;
+
+        if (!_cmsWriteUInt32Number(io, Seg ->nGridPoints)) return FALSE;
+
+        for (j=0; j < Seg ->nGridPoints; j++)
+            if (!WriteFloat32(io, Seg ->SampledPoints[j])) return FALSE;
+    }
+
+    if (!_cmsWriteUInt32Number(io, Curve ->nEntries)) return FALSE;
+    return _cmsWriteUInt16Array(io, Curve ->nEntries, Curve ->Table16);
+}
+
+static
+cmsToneCurve* ReadCurve(cmsContext ContextID, cmsIOHANDLER* io)
+{
+    cmsUInt32Number i, j, nSegments, nEntries, Type;
+    cmsCurveSegment* Segments = NULL;
+    cmsUInt16Number* Table = NULL;
+    cmsToneCurve* Curve = NULL;
+
+    if (!_cmsReadUInt32Number(io, &nSegments)) return NULL;
+    if (nSegments > 65530) return NULL;
+
+    if (nSegments > 0) {
+
+        Segments = (cmsCurveSegment*) _cmsCalloc(ContextID, nSegments, sizeof(cmsCurveSegment));
+        if (Segments == NULL) return NULL;
+
+        for (i=0; i < nSegments; i++) {
+
+            cmsCurveSegment* Seg = Segments + i;
+
+            if (!ReadFloat32(io, &Seg ->x0)) goto Error;
+            if (!ReadFloat32(io, &Seg ->x1)) goto Error;
+            if (!_cmsReadUInt32Number(io, &Type)) goto Error;
+            Seg ->Type = (cmsInt32Number) Type;
+
+            for (j=0; j < 10; j++)
+                if (!ReadFloat64(io, &Seg ->Params[j])) goto Error;
+
+            if (!_cmsReadUInt32Number(io, &Seg ->nGridPoints)) goto Error;
+            if (Seg ->nGridPoints > 65530) goto Error;
+
+            if (Seg ->nGridPoints > 0) {
+
+                Seg ->SampledPoints = (cmsFloat32Number*) _cmsCalloc(ContextID, Seg ->nGridPoints, sizeof(cmsFloat32Number));
+                if (Seg ->SampledPoints == NULL) goto Error;
+
+                for (j=0; j < Seg ->nGridPoints; j++)
+                    if (!ReadFloat32(io, &Seg ->SampledPoints[j])) goto Error;
+            }
+        }
+    }
+
+    if (!_cmsReadUInt32Number(io, &nEntries)) goto Error;
+    if (nEntries == 0 || nEntries > 65530) goto Error;
+
+    Table = (cmsUInt16Number*) _cmsCalloc(ContextID, nEntries, sizeof(cmsUInt16Number));
+    if (Table == NULL) goto Error;
+
+    if (!_cmsReadUInt16Array(io, nEntries, Table)) goto Error;
+
+    if (nSegments == 0) {
+
+        Curve = cmsBuildTabulatedToneCurve16(ContextID, nEntries, Table);
+    }
+    else {
+
+        // Table is computed again from the segments, so it has to be restored as it was
+        Curve = cmsBuildSegmentedToneCurve(ContextID, nSegments, Segments);
+        if (Curve != NULL) {
+
+            if (Curve ->nEntries != nEntries) {
+                cmsFreeToneCurve(Curve);
+                Curve = NULL;
+            }
+            else
+                memmove(Curve ->Table16, Table, nEntries * sizeof(cmsUInt16Number));
+        }
+    }
+
+Error:
+    if (Segments != NULL) {
+
+        for (i=0; i < nSegments; i++)
+            if (Segments[i].SampledPoints) _cmsFree(ContextID, Segments[i].SampledPoints);
+        _cmsFree(ContextID, Segments);
+    }
+
+    if (Table != NULL) _cmsFree(ContextID, Table);
+    return Curve;
+}
+
+static
+cmsBool WriteStage(cmsIOHANDLER* io, const cmsStage* mpe)
+{
+    cmsUInt32Number i, n;
+
+    if (!_cmsWriteUInt32Number(io, (cmsUInt32Number) mpe ->Type)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, (cmsUInt32Number) mpe ->Implements)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, mpe ->InputChannels)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, mpe ->OutputChannels)) return FALSE;
+
+    switch (mpe ->Type) {
+
+    case cmsSigCurveSetElemType: {
+
+        _cmsStageToneCurvesData* Data = (_cmsStageToneCurvesData*) mpe ->Data;
+
+        for (i=0; i < Data ->nCurves; i++)
+            if (!WriteCurve(io, Data ->TheCurves[i])) return FALSE;
+        }
+        break;
+
+    case cmsSigMatrixElemType: {
+
+        _cmsStageMatrixData* Data = (_cmsStageMatrixData*) mpe ->Data;
+
+        n = mpe ->InputChannels * mpe ->OutputChannels;
+        for (i=0; i < n; i++)
+            if (!WriteFloat64(io, Data ->Double[i])) return FALSE;
+
+        if (!_cmsWriteUInt32Number(io, Data ->Offset != NULL)) return FALSE;
+
+        if (Data ->Offset != NULL) {
+
+            for (i=0; i < mpe ->OutputChannels; i++)
+                if (!WriteFloat64(io, Data ->Offset[i])) return FALSE;
+        }
+        }
+        break;
+
+    case cmsSigCLutElemType: {
+
+        _cmsStageCLutData* Data = (_cmsStageCLutData*) mpe ->Data;
+
+        if (Data ->HasFloatValues) return FALSE;
+
+        for (i=0; i < mpe ->InputChannels; i++)
+            if (!_cmsWriteUInt32Number(io, Data ->Params ->nSamples[i])) return FALSE;
+
+        if (!_cmsWriteUInt32Number(io, Data ->nEntries)) return FALSE;
+        if (!_cmsWriteUInt16Array(io, Data ->nEntries, Data ->Tab.T)) return FALSE;
+        }
+        break;
+
+    // No data on those
+    case cmsSigIdentityElemType:
+    case cmsSigLab2XYZElemType:
+    case cmsSigXYZ2LabElemType:
+    case cmsSigClipNegativesElemType:
+        break;
+
+    default:
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+cmsStage* ReadStage(cmsContext ContextID, cmsIOHANDLER* io)
+{
+    cmsUInt32Number Type, Implements, nIn, nOut, i, n;
+    cmsStage* mpe = NULL;
+
+    if (!_cmsReadUInt32Number(io, &Type)) return NULL;
+    if (!_cmsReadUInt32Number(io, &Implements)) return NULL;
+    if (!_cmsReadUInt32Number(io, &nIn)) return NULL;
+    if (!_cmsReadUInt32Number(io, &nOut)) return NULL;
+
+    if (nIn == 0 || nIn > MAX_STAGE_CHANNELS || nOut == 0 || nOut > MAX_STAGE_CHANNELS) return NULL;
+
+    switch ((cmsStageSignature) Type) {
+
+    case cmsSigCurveSetElemType: {
+
+        cmsToneCurve* Curves[MAX_STAGE_CHANNELS];
+
+        if (nIn != nOut) return NULL;
+
+        memset(Curves, 0, sizeof(Curves));
+        for (i=0; i < nIn; i++) {
+            Curves[i] = ReadCurve(ContextID, io);
+            if (Curves[i] == NULL) break;
+        }
+
+        if (i == nIn)
+            mpe = cmsStageAllocToneCurves(ContextID, nIn, Curves);
+
+        for (i=0; i < nIn; i++)
+            if (Curves[i] != NULL) cmsFreeToneCurve(Curves[i]);
+        }
+        break;
+
+    case cmsSigMatrixElemType: {
+
+        cmsFloat64Number* Matrix;
+        cmsFloat64Number Offset[MAX_STAGE_CHANNELS];
+        cmsUInt32Number HasOffset = 0;
+
+        n = nIn * nOut;
+        Matrix = (cmsFloat64Number*) _cmsCalloc(ContextID, n, sizeof(cmsFloat64Number));
+        if (Matrix == NULL) return NULL;
+
+        for (i=0; i < n; i++)
+            if (!ReadFloat64(io, &Matrix[i])) break;
+
+        if (i == n && _cmsReadUInt32Number(io, &HasOffset)) {
+
+            for (i=0; HasOffset && i < nOut; i++)
+                if (!ReadFloat64(io, &Offset[i])) break;
+
+            if (!HasOffset || i == nOut)
+                mpe = cmsStageAllocMatrix(ContextID, nOut, nIn, Matrix, HasOffset ? Offset : NULL);
+        }
+
+        _cmsFree(ContextID, Matrix);
+        }
+        break;
+
+    case cmsSigCLutElemType: {
+
+        cmsUInt32Number GridPoints[MAX_INPUT_DIMENSIONS];
+        _cmsStageCLutData* Data;
+
+        if (nIn > MAX_INPUT_DIMENSIONS) return NULL;
+
+        for (i=0; i < nIn; i++)
+            if (!_cmsReadUInt32Number(io, &GridPoints[i])) return NULL;
+
+        if (!_cmsReadUInt32Number(io, &n)) return NULL;
+
+        mpe = cmsStageAllocCLut16bitGranular(ContextID, GridPoints, nIn, nOut, NULL);
+        if (mpe == NULL) return NULL;
+
+        Data = (_cmsStageCLutData*) mpe ->Data;
+        if (Data ->nEntries != n || !_cmsReadUInt16Array(io, n, Data ->Tab.T)) {
+            cmsStageFree(mpe);
+            return NULL;
+        }
+        }
+        break;
+
+    case cmsSigIdentityElemType:
+        mpe = cmsStageAllocIdentity(ContextID, nIn);
+        break;
+
+    case cmsSigLab2XYZElemType:
+        mpe = _cmsStageAllocLab2XYZ(ContextID);
+        break;
+
+    case cmsSigXYZ2LabElemType:
+        mpe = _cmsStageAllocXYZ2Lab(ContextID);
+        break;
+
+    case cmsSigClipNegativesElemType:
+        mpe = _cmsStageClipNegatives(ContextID, nIn);
+        break;
+
+    default:
+        return NULL;
+    }
+
+    if (mpe == NULL) return NULL;
+
+    if (mpe ->InputChannels != nIn || mpe ->OutputChannels != nOut) {
+        cmsStageFree(mpe);
+        return NULL;
+    }
+
+    mpe ->Implements = (cmsStageSignature) Implements;
+    return mpe;
+}
+
+// Colorant tables. A zero marks a missing table
+static
+cmsBool WriteColorantList(cmsIOHANDLER* io, const cmsNAMEDCOLORLIST* List)
+{
+    cmsUInt32Number i;
+
+    if (List == NULL) return _cmsWriteUInt32Number(io, 0);
+
+    if (!_cmsWriteUInt32Number(io, 1)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, List ->nColors)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, List ->ColorantCount)) return FALSE;
+    if (!io ->Write(io, sizeof(List ->Prefix), List ->Prefix)) return FALSE;
+    if (!io ->Write(io, sizeof(List ->Suffix), List ->Suffix)) return FALSE;
+
+    for (i=0; i < List ->nColors; i++) {
+
+        if (!io ->Write(io, cmsMAX_PATH, List ->List[i].Name)) return FALSE;
+        if (!_cmsWriteUInt16Array(io, 3, List ->List[i].PCS)) return FALSE;
+        if (!_cmsWriteUInt16Array(io, List ->ColorantCount, List ->List[i].DeviceColorant)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+cmsBool ReadColorantList(cmsContext ContextID, cmsIOHANDLER* io, cmsNAMEDCOLORLIST** List)
+{
+    cmsUInt32Number i, Present, nColors, ColorantCount;
+    char Prefix[33], Suffix[33], Name[cmsMAX_PATH];
+    cmsUInt16Number PCS[3], Colorant[cmsMAXCHANNELS];
+
+    *List = NULL;
+
+    if (!_cmsReadUInt32Number(io, &Present)) return FALSE;
+    if (!Present) return TRUE;
+
+    if (!_cmsReadUInt32Number(io, &nColors)) return FALSE;
+    if (!_cmsReadUInt32Number(io, &ColorantCount)) return FALSE;
+    if (ColorantCount > cmsMAXCHANNELS) return FALSE;
+
+    if (io ->Read(io, Prefix, sizeof(Prefix), 1) != 1) return FALSE;
+    if (io ->Read(io, Suffix, sizeof(Suffix), 1) != 1) return FALSE;
+    Prefix[32] = Suffix[32] = 0;
+
+    *List = cmsAllocNamedColorList(ContextID, nColors, ColorantCount, Prefix, Suffix);
+    if (*List == NULL) return FALSE;
+
+    memset(Colorant, 0, sizeof(Colorant));
+    for (i=0; i < nColors; i++) {
+
+        if (io ->Read(io, Name, cmsMAX_PATH, 1) != 1) return FALSE;
+        Name[cmsMAX_PATH-1] = 0;
+
+        if (!_cmsReadUInt16Array(io, 3, PCS)) return FALSE;
+        if (!_cmsReadUInt16Array(io, ColorantCount, Colorant)) return FALSE;
+
+        if (!cmsAppendNamedColor(*List, Name, PCS, Colorant)) return FALSE;
+    }
+
+    return TRUE;
+}
+
+static
+cmsBool WriteTransform(cmsIOHANDLER* io, const _cmsTRANSFORM* p)
+{
+    cmsStage* mpe;
+
+    if (!_cmsWriteUInt32Number(io, XFORM_BLOB_MAGIC)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, XFORM_BLOB_VERSION)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, p ->InputFormat)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, p ->OutputFormat)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, p ->dwOriginalFlags)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, p ->RenderingIntent)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, (cmsUInt32Number) p ->EntryColorSpace)) return FALSE;
+    if (!_cmsWriteUInt32Number(io, (cmsUInt32Number) p ->ExitColorSpace)) return FALSE;
+    if (!WriteXYZ(io, &p ->EntryWhitePoint)) return FALSE;
+    if (!WriteXYZ(io, &p ->ExitWhitePoint)) return FALSE;
+
+    if (p ->Lut == NULL) {
+
+        if (!_cmsWriteUInt32Number(io, 0)) return FALSE;
+    }
+    else {
+
+        if (!_cmsWriteUInt32Number(io, 1)) return FALSE;
+        if (!_cmsWriteUInt32Number(io, p ->Lut ->InputChannels)) return FALSE;
+        if (!_cmsWriteUInt32Number(io, p ->Lut ->OutputChannels)) return FALSE;
+        if (!_cmsWriteUInt32Number(io, _cmsGetPipelineOptimization(p ->Lut))) return FALSE;
+        if (!_cmsWriteUInt32Number(io, cmsPipelineStageCount(p ->Lut))) return FALSE;
+
+        for (mpe = cmsPipelineGetPtrToFirstStage(p ->Lut); mpe != NULL; mpe = cmsStageNext(mpe)) {
+
+            if (!WriteStage(io, mpe)) return FALSE;
+        }
+    }
+
+    if (!WriteColorantList(io, p ->InputColorant)) return FALSE;
+    if (!WriteColorantList(io, p ->OutputColorant)) return FALSE;
+
+    return TRUE;
+}
+
+// Saves the transform to the IO handler. If io is NULL, just computes the space needed. Returns the
+// number of bytes, or zero on error
+cmsUInt32Number CMSEXPORT cmsSaveTransformToIOhandler(cmsHTRANSFORM hTransform, cmsIOHANDLER* io)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) hTransform;
+    cmsIOHANDLER* NullIO;
+    cmsUInt32Number UsedSpace;
+
+    _cmsAssert(hTransform != NULL);
+
+    if (p ->GamutCheck != NULL || p ->Sequence != NULL) {
+
+        cmsSignalError(p ->ContextID, cmsERROR_NOT_SUITABLE, "Transforms with gamut check or profile sequence cannot be saved");
+        return 0;
+    }
+
+    // Pass #1 computes the size, and checks all stages can be saved
+    NullIO = cmsOpenIOhandlerFromNULL(p ->ContextID);
+    if (NullIO == NULL) return 0;
+
+    if (!WriteTransform(NullIO, p)) {
+
+        cmsCloseIOhandler(NullIO);
+        cmsSignalError(p ->ContextID, cmsERROR_NOT_SUITABLE, "Transform pipeline cannot be saved");
+        return 0;
+    }
+
+    UsedSpace = NullIO ->UsedSpace;
+    if (!cmsCloseIOhandler(NullIO)) return 0;
+
+    // Pass #2 does the real write
+    if (io != NULL) {
+
+        if (!WriteTransform(io, p)) return 0;
+    }
+
+    return UsedSpace;
+}
+
+// Saves the transform to memory. If MemPtr is NULL, BytesNeeded gets the size
+cmsBool CMSEXPORT cmsSaveTransformToMem(cmsHTRANSFORM hTransform, void* MemPtr, cmsUInt32Number* BytesNeeded)
+{
+    _cmsTRANSFORM* p = (_cmsTRANSFORM*) hTransform;
+    cmsIOHANDLER* io;
+    cmsBool rc;
+
+    _cmsAssert(BytesNeeded != NULL);
+
+    if (MemPtr == NULL) {
+
+        *BytesNeeded = cmsSaveTransformToIOhandler(hTransform, NULL);
+        return (*BytesNeeded == 0) ? FALSE : TRUE;
+    }
+
+    io = cmsOpenIOhandlerFromMem(p ->ContextID, MemPtr, *BytesNeeded, "w");
+    if (io == NULL) return FALSE;
+
+    rc = (cmsSaveTransformToIOhandler(hTransform, io) != 0);
+    rc &= cmsCloseIOhandler(io);
+
+    return rc;
+}
+
+// Rebuilds a transform saved by cmsSaveTransformToIOhandler. Formats and flags are the ones at save time
+cmsHTRANSFORM CMSEXPORT cmsLoadTransformFromIOhandler(cmsContext ContextID, cmsIOHANDLER* io)
+{
+    cmsUInt32Number Magic, Version, InputFormat, OutputFormat, dwFlags, Intent, EntryColorSpace, ExitColorSpace;
+    cmsUInt32Number HasLut, nIn, nOut, OptKind, nStages, i;
+    cmsCIEXYZ EntryWhitePoint, ExitWhitePoint;
+    cmsPipeline* Lut = NULL;
+    cmsStage* mpe;
+    _cmsTRANSFORM* xform;
+
+    if (!_cmsReadUInt32Number(io, &Magic) || Magic != XFORM_BLOB_MAGIC) {
+        cmsSignalError(ContextID, cmsERROR_BAD_SIGNATURE, "Not a saved transform");
+        return NULL;
+    }
+
+    if (!_cmsReadUInt32Number(io, &Version) || Version != XFORM_BLOB_VERSION) {
+        cmsSignalError(ContextID, cmsERROR_UNKNOWN_EXTENSION, "Unsupported saved transform version");
+        return NULL;
+    }
+
+    if (!_cmsReadUInt32Number(io, &InputFormat)) goto Error;
+    if (!_cmsReadUInt32Number(io, &OutputFormat)) goto Error;
+    if (!_cmsReadUInt32Number(io, &dwFlags)) goto Error;
+    if (!_cmsReadUInt32Number(io, &Intent)) goto Error;
+    if (!_cmsReadUInt32Number(io, &EntryColorSpace)) goto Error;
+    if (!_cmsReadUInt32Number(io, &ExitColorSpace)) goto Error;
+    if (!ReadXYZ(io, &EntryWhitePoint)) goto Error;
+    if (!ReadXYZ(io, &ExitWhitePoint)) goto Error;
+    if (!_cmsReadUInt32Number(io, &HasLut)) goto Error;
+
+    // The header is not trusted. Gamut check transforms are never saved, and only null transforms go without
+    // pipeline. Whatever formatters may be changed is found again on allocation
+    if (dwFlags & cmsFLAGS_GAMUTCHECK) goto Error;
+    if (!HasLut && !(dwFlags & cmsFLAGS_NULLTRANSFORM)) goto Error;
+    dwFlags &= ~cmsFLAGS_CAN_CHANGE_FORMATTER;
+
+    if (HasLut) {
+
+        if (!_cmsReadUInt32Number(io, &nIn)) goto Error;
+        if (!_cmsReadUInt32Number(io, &nOut)) goto Error;
+        if (!_cmsReadUInt32Number(io, &OptKind)) goto Error;
+        if (!_cmsReadUInt32Number(io, &nStages)) goto Error;
+
+        // Formatters should agree with the pipeline, unless there are none
+        if (InputFormat != 0 && T_CHANNELS(InputFormat) != nIn) goto Error;
+        if (OutputFormat != 0 && T_CHANNELS(OutputFormat) != nOut) goto Error;
+
+        Lut = cmsPipelineAlloc(ContextID, nIn, nOut);
+        if (Lut == NULL) goto Error;
+
+        for (i=0; i < nStages; i++) {
+
+            mpe = ReadStage(ContextID, io);
+            if (mpe == NULL) goto Error;
+
+            if (!cmsPipelineInsertStage(Lut, cmsAT_END, mpe)) goto Error;
+        }
+
+        if (cmsPipelineInputChannels(Lut) != nIn || cmsPipelineOutputChannels(Lut) != nOut) goto Error;
+
+        // Resampled pipelines get the optimization back, the others are optimized again as usual
+        if (OptKind != _cmsOPT_NONE) {
+
+            if (!_cmsRestorePipelineOptimization(Lut, OptKind)) goto Error;
+        }
+    }
+
+    // From now on, the Lut belongs to the transform
+    xform = AllocEmptyTransform(ContextID, Lut, Intent, &InputFormat, &OutputFormat, &dwFlags);
+    if (xform == NULL) return NULL;
+
+    xform ->EntryColorSpace = (cmsColorSpaceSignature) EntryColorSpace;
+    xform ->ExitColorSpace  = (cmsColorSpaceSignature) ExitColorSpace;
+    xform ->RenderingIntent = Intent;
+    xform ->EntryWhitePoint = EntryWhitePoint;
+    xform ->ExitWhitePoint  = ExitWhitePoint;
+
+    if (!ReadColorantList(ContextID, io, &xform ->InputColorant) ||
+        !ReadColorantList(ContextID, io, &xform ->OutputColorant)) {
+
+        cmsDeleteTransform((cmsHTRANSFORM) xform);
+        cmsSignalError(ContextID, cmsERROR_CORRUPTION_DETECTED, "Corrupted saved transform");
+        return NULL;
+    }
+
+    // Init the cache seed, as on creation
+    if (xform ->Lut != NULL && !(dwFlags & (cmsFLAGS_NOCACHE|cmsFLAGS_NULLTRANSFORM))) {
+
+        memset(&xform ->Cache.CacheIn, 0, sizeof(xform ->Cache.CacheIn));
+        xform ->Lut ->Eval16Fn(xform ->Cache.CacheIn, xform->Cache.CacheOut, xform -> Lut->Data);
+    }
+
+    AnnounceTransform(xform);
+    return (cmsHTRANSFORM) xform;
+
+Error:
+    if (Lut != NULL) cmsPipelineFree(Lut);
+    cmsSignalError(ContextID, cmsERROR_CORRUPTION_DETECTED, "Corrupted saved transform");
+    return NULL;
+}
+
+cmsHTRANSFORM CMSEXPORT cmsLoadTransformFromMem(cmsContext ContextID, const void* MemPtr, cmsUInt32Number dwSize)
+{
+    cmsIOHANDLER* io;
+    cmsHTRANSFORM xform;
+
+    io = cmsOpenIOhandlerFromMem(ContextID, (void*) MemPtr, dwSize, "r");
+    if (io == NULL) return NULL;
+
+    xform = cmsLoadTransformFromIOhandler(ContextID, io);
+    cmsCloseIOhandler(io);
+
+    return xform;
+}
@@ -393,6 +393,99 @@ cmsINLINE int _cmsLeaveCriticalSectionPrimitive(_cmsMutex *m)
 }
 #endif
 
+// Atomic pointers --------------------------------------------------------------------
+
+// Objects that are built once and then shared by several threads are published with release semantics, and
+// fetched with acquire semantics. This way, a reader that sees the pointer sees the contents as well, and no
+// lock is needed once the object is there. Without threads or without compiler support, plain accesses are used.
+#if !defined(CMS_NO_PTHREADS) && (defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 7)))))
+
+cmsINLINE void* _cmsAtomicLoadPtr(void** p)
+{
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+cmsINLINE void _cmsAtomicStorePtr(void** p, void* v)
+{
+    __atomic_store_n(p, v, __ATOMIC_RELEASE);
+}
+
+// Stores Desired only if the pointer still holds Expected. Returns TRUE if the store took place
+cmsINLINE cmsBool _cmsAtomicCompareExchangePtr(void** p, void* Expected, void* Desired)
+{
+    return __atomic_compare_exchange_n(p, &Expected, Desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ? TRUE : FALSE;
+}
+
+#elif !defined(CMS_NO_PTHREADS) && defined(CMS_IS_WINDOWS_)
+
+cmsINLINE void* _cmsAtomicLoadPtr(void** p)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile*) p, NULL, NULL);
+}
+
+cmsINLINE void _cmsAtomicStorePtr(void** p, void* v)
+{
+    InterlockedExchangePointer((PVOID volatile*) p, v);
+}
+
+cmsINLINE cmsBool _cmsAtomicCompareExchangePtr(void** p, void* Expected, void* Desired)
+{
+    return InterlockedCompareExchangePointer((PVOID volatile*) p, Desired, Expected) == Expected;
+}
+
+#else
+
+cmsINLINE void* _cmsAtomicLoadPtr(void** p)
+{
+    return *p;
+}
+
+cmsINLINE void _cmsAtomicStorePtr(void** p, void* v)
+{
+    *p = v;
+}
+
+cmsINLINE cmsBool _cmsAtomicCompareExchangePtr(void** p, void* Expected, void* Desired)
+{
+    if (*p != Expected) return FALSE;
+    *p = Desired;
+    return TRUE;
+}
+
+#endif
+
+// CPU features -----------------------------------------------------------------------
+
+// Some time-critical kernels have SIMD versions that are selected at runtime, depending on what the CPU 
+// supports. Only the x86 family is covered, other architectures use the plain C code, which is written to
+// be friendly with compiler autovectorization. Define CMS_NO_SIMD to get rid of all of them.
+#if !defined(CMS_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#   if defined(__clang__) || (defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9))))
+#       define CMS_SIMD_X86     1
+#       define CMS_TARGET_SSE2  __attribute__((target("sse2")))
+#       define CMS_TARGET_AVX2  __attribute__((target("avx2")))
+#       define CMS_TARGET_F16C  __attribute__((target("avx,f16c")))
+#   elif defined(_MSC_VER) && (_MSC_VER >= 1700)
+#       define CMS_SIMD_X86     1
+#       define CMS_TARGET_SSE2
+#       define CMS_TARGET_AVX2
+#       define CMS_TARGET_F16C
+#   endif
+#endif
+
+#define cmsCPU_SSE2     0x0001
+#define cmsCPU_AVX2     0x0002
+#define cmsCPU_F16C     0x0004
+
+// Returns the SIMD extensions available on this CPU and operating system
+CMSCHECKPOINT cmsUInt32Number CMSEXPORT _cmsGetCPUFeatures(void);
+
+// Testbed only. Hides CPU features not in the mask, so all code paths can be checked. Returns old mask
+CMSCHECKPOINT cmsUInt32Number CMSEXPORT _cmsSetCPUFeaturesMask(cmsUInt32Number Mask);
+
+// Seconds from an arbitrary origin, for timing only
+cmsFloat64Number _cmsGetTime(void);
+
 // Plug-In registration ---------------------------------------------------------------
 
 // Specialized function for plug-in memory management. No pairing free() since whole pool is freed at once.
@@ -431,6 +524,9 @@ cmsBool  _cmsRegisterTransformPlugin(cmsContext ContextID, cmsPluginBase* Plugin
 // Mutex
 cmsBool _cmsRegisterMutexPlugin(cmsContext ContextID, cmsPluginBase* Plugin);
 
+// Parallelization
+cmsBool _cmsRegisterParallelizationPlugin(cmsContext ContextID, cmsPluginBase* Plugin);
+
 // ---------------------------------------------------------------------------------------------------------
 
 // Suballocators. 
@@ -478,6 +574,9 @@ typedef enum {
     OptimizationPlugin,
     TransformPlugin,
     MutexPlugin,
+    ParallelizationPlugin,
+    SharedTransformsContext,
+    TransformStatsContext,
 
     // Last in list
     MemoryClientMax
@@ -512,8 +611,8 @@ struct _cmsContext_struct {
     _cmsMemPluginChunkType DefaultMemoryManager;  // The allocators used for creating the context itself. Cannot be overridden
 };
 
-// Returns a pointer to a valid context structure, including the global one if id is zero. 
-// Verifies the magic number.
+// Returns a pointer to a valid context structure, including the global one if id is zero or unknown.
+// Takes no lock, see cmsplugin.c
 struct _cmsContext_struct* _cmsGetContext(cmsContext ContextID);
 
 // Returns the block assigned to the specific zone. 
@@ -671,6 +770,7 @@ void _cmsAllocIntentsPluginChunk(struct _cmsContext_struct* ctx,
 typedef struct {
 
     struct _cmsOptimizationCollection_st* OptimizationCollection;
+    cmsUInt32Number ExpectedPixels;     // Optimization budget, 0 if none
 
 } _cmsOptimizationPluginChunkType;
 
@@ -713,6 +813,61 @@ extern  _cmsMutexPluginChunkType _cmsMutexPluginChunk;
 void _cmsAllocMutexPluginChunk(struct _cmsContext_struct* ctx, 
                                         const struct _cmsContext_struct* src);
 
+// Container for parallelization plug-in
+typedef struct {
+
+    cmsUInt32Number   MaxWorkers;
+    _cmsParallelRunFn RunJobs;
+
+} _cmsParallelizationPluginChunkType;
+
+// The global Context0 storage for parallelization plug-in
+extern  _cmsParallelizationPluginChunkType _cmsParallelizationPluginChunk;
+
+// Allocate and init parallelization container.
+void _cmsAllocParallelizationPluginChunk(struct _cmsContext_struct* ctx, 
+                                        const struct _cmsContext_struct* src);
+
+// Container for shared transforms. The list is kept in most recently used order
+typedef struct {
+
+    _cmsMutex        Mutex;
+    cmsUInt32Number  MaxEntries;
+    cmsUInt32Number  nEntries;
+    cmsUInt32Number  Hits, Misses, Evictions;
+    struct _cmstransform_struct* Head;
+
+} _cmsSharedTransformsChunkType;
+
+// The global Context0 storage for shared transforms
+extern  _cmsSharedTransformsChunkType _cmsSharedTransformsChunk;
+
+// Allocate and init shared transforms container.
+void _cmsAllocSharedTransformsChunk(struct _cmsContext_struct* ctx, 
+                                        const struct _cmsContext_struct* src);
+
+// Deletes all idle shared transforms, and releases the container
+void _cmsFlushSharedTransforms(cmsContext ContextID);
+void _cmsFreeSharedTransformsChunk(struct _cmsContext_struct* ctx);
+
+// Transform statistics callback and totals of the context
+typedef struct {
+
+    _cmsMutex           Mutex;
+    cmsTransformStatsFn Fn;
+    void*               UserData;
+    cmsTransformStats   Totals;
+
+} _cmsTransformStatsChunkType;
+
+// The global Context0 storage for transform statistics
+extern  _cmsTransformStatsChunkType _cmsTransformStatsChunk;
+
+// Allocate and free transform statistics container.
+void _cmsAllocTransformStatsChunk(struct _cmsContext_struct* ctx,
+                                  const struct _cmsContext_struct* src);
+void _cmsFreeTransformStatsChunk(struct _cmsContext_struct* ctx);
+
 // ----------------------------------------------------------------------------------
 // MLU internal representation
 typedef struct {
@@ -796,6 +951,10 @@ typedef struct _cms_iccprofile_struct {
 
     cmsProfileID             ProfileID;
 
+    // Digest of the contents, computed once for profiles without ID. Any change clears it
+    cmsProfileID             Digest;
+    cmsBool                  HasDigest;
+
     // Dictionary
     cmsUInt32Number          TagCount;
     cmsTagSignature          TagNames[MAX_TABLE_TAG];
@@ -817,6 +976,7 @@ typedef struct _cms_iccprofile_struct {
 
 // IO helpers for profiles
 cmsBool              _cmsReadHeader(_cmsICCPROFILE* Icc);
+cmsBool              _cmsGetProfileDigest(cmsHPROFILE hProfile, cmsProfileID* Digest);
 cmsBool              _cmsWriteHeader(_cmsICCPROFILE* Icc, cmsUInt32Number UsedSpace);
 int                  _cmsSearchTag(_cmsICCPROFILE* Icc, cmsTagSignature sig, cmsBool lFollowLinks);
 
@@ -833,8 +993,10 @@ void                 _cmsTagSignature2String(char String[5], cmsTagSignature sig
 
 CMSCHECKPOINT cmsInterpParams* CMSEXPORT _cmsComputeInterpParams(cmsContext ContextID, cmsUInt32Number nSamples, cmsUInt32Number InputChan, cmsUInt32Number OutputChan, const void* Table, cmsUInt32Number dwFlags);
 cmsInterpParams*                         _cmsComputeInterpParamsEx(cmsContext ContextID, const cmsUInt32Number nSamples[], cmsUInt32Number InputChan, cmsUInt32Number OutputChan, const void* Table, cmsUInt32Number dwFlags);
+cmsBool                                  _cmsInitInterpParams(cmsContext ContextID, cmsInterpParams* p, const cmsUInt32Number nSamples[], cmsUInt32Number InputChan, cmsUInt32Number OutputChan, const void* Table, cmsUInt32Number dwFlags);
 CMSCHECKPOINT void             CMSEXPORT _cmsFreeInterpParams(cmsInterpParams* p);
 cmsBool                                  _cmsSetInterpolationRoutine(cmsContext ContextID, cmsInterpParams* p);
+const char*                              _cmsGetInterpolationName(const cmsInterpParams* p, cmsBool Batch);
 
 // Curves ----------------------------------------------------------------------------------------------------------------
 
@@ -855,8 +1017,17 @@ struct _cms_curve_struct {
     // 16 bit Table-based representation follows
     cmsUInt32Number    nEntries;      // Number of table elements
     cmsUInt16Number*   Table16;       // The table itself.
+
+    // Float table for approximate evaluation of segmented curves. Built on first use, see _cmsEvalToneCurveFloatApprox
+    void*              FloatTable;
 };
 
+// Curve evaluation allowed to use a cached table, see cmsgamma.c for the error bounds
+CMSCHECKPOINT cmsFloat32Number CMSEXPORT _cmsEvalToneCurveFloatApprox(const cmsToneCurve* Curve, cmsFloat32Number v);
+
+// Bytes held by the curve
+cmsUInt32Number _cmsToneCurveMemorySize(const cmsToneCurve* Curve);
+
 
 //  Pipelines & Stages ---------------------------------------------------------------------------------------------
 
@@ -872,6 +1043,7 @@ struct _cmsStage_struct {
     cmsUInt32Number     OutputChannels; // Output channels -- for optimization purposes
 
     _cmsStageEvalFn     EvalPtr;        // Points to fn that evaluates the stage (always in floating point)
+    _cmsStageEvalBatchFn EvalBatchPtr;  // Optional, evaluates a planar run of pixels. NULL means pixel by pixel
     _cmsStageDupElemFn  DupElemPtr;     // Points to a fn that duplicates the *data* of the stage
     _cmsStageFreeElemFn FreePtr;        // Points to a fn that sets the *data* of the stage free
 
@@ -909,6 +1081,12 @@ typedef void (* _cmsPipelineEvalFloatFn)(const cmsFloat32Number In[],
                                          cmsFloat32Number Out[],
                                          const void* Data);
 
+// Same, on a chunky run of pixels
+typedef void (* _cmsPipelineEvalFloatBatchFn)(const cmsFloat32Number In[],
+                                              cmsFloat32Number Out[],
+                                              cmsUInt32Number nPixels,
+                                              const void* Data);
+
 struct _cmsPipeline_struct {
 
     cmsStage* Elements;                                // Points to elements chain
@@ -919,6 +1097,8 @@ struct _cmsPipeline_struct {
 
    _cmsOPTeval16Fn         Eval16Fn;
    _cmsPipelineEvalFloatFn EvalFloatFn;
+   _cmsOPTeval16BatchFn    Eval16BatchFn;       // NULL means Eval16Fn pixel by pixel
+   _cmsPipelineEvalFloatBatchFn EvalFloatBatchFn;  // NULL means EvalFloatFn pixel by pixel
    _cmsFreeUserDataFn      FreeDataFn;
    _cmsDupUserDataFn       DupDataFn;
 
@@ -927,6 +1107,9 @@ struct _cmsPipeline_struct {
     cmsBool  SaveAs8Bits;            // Implementation-specific: save as 8 bits if possible
 };
 
+// Sets the floating point evaluators, which get the pipeline itself as data. Batch may be NULL
+void _cmsPipelineSetOptimizationFloat(cmsPipeline* Lut, _cmsPipelineEvalFloatFn EvalFloat, _cmsPipelineEvalFloatBatchFn EvalFloatBatch);
+
 // LUT reading & creation -------------------------------------------------------------------------------------------
 
 // Read tags using low-level function, provide necessary glue code to adapt versions, etc. All those return a brand new copy
@@ -975,6 +1158,40 @@ cmsBool          _cmsOptimizePipeline(cmsContext ContextID,
                                       cmsUInt32Number* OutputFormat,
                                       cmsUInt32Number* dwFlags );
 
+// Same, recording the time taken by each step and which one succeeded. Stats may be NULL
+cmsBool          _cmsOptimizePipelineEx(cmsContext ContextID,
+                                        cmsPipeline**    Lut,
+                                        cmsUInt32Number  Intent,
+                                        cmsUInt32Number* InputFormat,
+                                        cmsUInt32Number* OutputFormat,
+                                        cmsUInt32Number* dwFlags,
+                                        cmsTransformStats* Stats);
+
+// The budget set by cmsSetOptimizationBudget(), as it changes the optimized pipeline
+cmsUInt32Number  _cmsGetOptimizationBudget(cmsContext ContextID);
+
+_cmsTransform2Fn _cmsGetFusedXFORM(const cmsPipeline* Lut,
+                                   cmsUInt32Number InputFormat,
+                                   cmsUInt32Number OutputFormat,
+                                   cmsUInt32Number dwFlags);
+
+// Resampled pipelines can get their optimization back from the stages, without sampling again.
+// Used by saved transforms. Zero means none of those.
+#define _cmsOPT_NONE      0
+#define _cmsOPT_CLUT16    1
+#define _cmsOPT_PRELIN16  2
+#define _cmsOPT_PRELIN8   3
+
+cmsUInt32Number  _cmsGetPipelineOptimization(const cmsPipeline* Lut);
+cmsBool          _cmsRestorePipelineOptimization(cmsPipeline* Lut, cmsUInt32Number Kind);
+cmsBool          _cmsPipelineIsOptimized(const cmsPipeline* Lut);
+cmsBool          _cmsPipelineIsFloatOptimized(const cmsPipeline* Lut);
+
+// Introspection, see cmsGetTransformInfo()
+void             _cmsGetStageInfo(const cmsStage* mpe, cmsStageInfo* Info);
+cmsUInt32Number  _cmsPipelineMemorySize(const cmsPipeline* Lut);
+cmsUInt32Number  _cmsGetPipelineEvaluators(const cmsPipeline* Lut, cmsUInt32Number* Eval16, cmsUInt32Number* EvalFloat);
+
 
 // Hi level LUT building ----------------------------------------------------------------------------------------------
 
@@ -984,7 +1201,8 @@ cmsPipeline*     _cmsCreateGamutCheckPipeline(cmsContext ContextID,
                                               cmsUInt32Number Intents[],
                                               cmsFloat64Number AdaptationStates[],
                                               cmsUInt32Number nGamutPCSposition,
-                                              cmsHPROFILE hGamut);
+                                              cmsHPROFILE hGamut,
+                                              cmsUInt32Number dwFlags);
 
 
 // Formatters ------------------------------------------------------------------------------------------------------------
@@ -993,12 +1211,19 @@ cmsPipeline*     _cmsCreateGamutCheckPipeline(cmsContext ContextID,
 
 cmsBool         _cmsFormatterIsFloat(cmsUInt32Number Type);
 cmsBool         _cmsFormatterIs8bit(cmsUInt32Number Type);
+cmsBool         _cmsFormatterIsStock(cmsContext ContextID, cmsUInt32Number Type, cmsFormatterDirection Dir, cmsUInt32Number dwFlags);
 
 CMSCHECKPOINT cmsFormatter CMSEXPORT _cmsGetFormatter(cmsContext ContextID,
                                                       cmsUInt32Number Type,          // Specific type, i.e. TYPE_RGB_8
                                                       cmsFormatterDirection Dir,
                                                       cmsUInt32Number dwFlags);
 
+// Returns NULL if there is no line formatter for this type
+CMSCHECKPOINT cmsLineFormatter CMSEXPORT _cmsGetLineFormatter(cmsContext ContextID,
+                                                              cmsUInt32Number Type,
+                                                              cmsFormatterDirection Dir,
+                                                              cmsUInt32Number dwFlags);
+
 
 #ifndef CMS_NO_HALF_SUPPORT 
 
@@ -1023,6 +1248,9 @@ typedef struct {
 
 
 // Transformation
+// Number of idle scratch blocks a transform keeps. More threads at once than this just allocate
+#define MAX_TRANSFORM_WORKSPACES    64
+
 typedef struct _cmstransform_struct {
 
     cmsUInt32Number InputFormat, OutputFormat; // Keep formats for further reference
@@ -1037,9 +1265,34 @@ typedef struct _cmstransform_struct {
     cmsFormatterFloat FromInputFloat;
     cmsFormatterFloat ToOutputFloat;
 
+    // Same, on whole runs of pixels. May be NULL, then above ones are used
+    cmsFormatter16Line FromInputLine;
+    cmsFormatter16Line ToOutputLine;
+
+    cmsFormatterFloatLine FromInputFloatLine;
+    cmsFormatterFloatLine ToOutputFloatLine;
+
     // 1-pixel cache seed for zero as input (16 bits, read only)
     _cmsCACHE Cache;
 
+    // Entries of the hashed cache (16 bits only). Zero means 1-pixel cache. Tables are kept in workspaces
+    // tagged with CacheEpoch, which changes on each resize
+    cmsUInt32Number CacheSize;
+    cmsUInt32Number CacheEpoch;
+
+    // Hashed cache statistics, modulo 2^32. Updated under CacheMutex at the end of each call
+    cmsUInt32Number CacheHits, CacheMisses;
+    void* CacheMutex;
+
+    // Shared transforms: lookup key, number of open handles and link to next on the context list.
+    // SharedKey is NULL on transforms that are not shared
+    void* SharedKey;
+    cmsUInt32Number SharedKeySize;
+    cmsUInt32Number SharedHash;
+    cmsUInt32Number RefCount;
+    cmsBool Listed;
+    struct _cmstransform_struct* SharedNext;
+
     // A Pipeline holding the full (optimized) transform
     cmsPipeline* Lut;
 
@@ -1077,6 +1330,16 @@ typedef struct _cmstransform_struct {
     // A way to provide backwards compatibility with full xform plugins
     _cmsTransformFn OldXform;
 
+    // When running in parallel, xform points to the scheduler and this is the code doing the actual work
+    _cmsTransform2Fn Worker;
+
+    // Idle scratch blocks, see _cmsGetTransformWorkspace(). Slots are taken and given back atomically
+    void* Workspaces[MAX_TRANSFORM_WORKSPACES];
+
+    // Statistics, NULL if not collected. Runtime counters are updated under CacheMutex
+    cmsTransformStats* Stats;
+    cmsBool StatsAnnounced;
+
 } _cmsTRANSFORM;
 
 // Copies extra channels from input to output if the original flags in the transform structure
@@ -0,0 +1,643 @@
+//---------------------------------------------------------------------------------
+//
+//  Little Color Management System
+//  Copyright (c) 1998-2020 Marti Maria Saguer
+//
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the Software
+// is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+//---------------------------------------------------------------------------------
+//
+
+// Performance benchmark. Each case is run on several pixel formats. Transform creation and transform
+// application are timed separately; after some warm-up runs, the given number of runs is timed and the
+// median and 95th percentile are reported, on wall clock and on CPU time. Input images are filled with
+// a fixed pseudo-random sequence, so runs on different builds do see exactly the same pixels.
+
+#ifdef _MSC_VER
+#    define _CRT_SECURE_NO_WARNINGS 1
+#endif
+
+#include "lcms2_internal.h"
+
+#include <time.h>
+
+// Defaults
+#define DEFAULT_WIDTH      1024
+#define DEFAULT_HEIGHT     1024
+#define DEFAULT_WARMUP     2
+#define DEFAULT_RUNS       11
+#define MAX_RUNS           1000
+
+// Profiles whose name starts by '@' are built on the fly, the others are read from the profile directory
+typedef struct {
+
+    const char*     Name;
+    const char*     Title;
+    const char*     Input;
+    const char*     Output;
+    cmsUInt32Number Intent;
+
+} BenchCase;
+
+static const BenchCase Cases[] = {
+
+    { "clut",    "CLUT profiles",                          "test5.icc", "test3.icc", INTENT_PERCEPTUAL },
+    { "matrix",  "Matrix-shaper profiles",                 "test5.icc", "@adobe",    INTENT_PERCEPTUAL },
+    { "same",    "Same matrix-shaper profiles",            "@adobe",    "@adobe",    INTENT_PERCEPTUAL },
+    { "abscol",  "Matrix-shaper profiles (AbsCol)",        "test5.icc", "@adobe",    INTENT_ABSOLUTE_COLORIMETRIC },
+    { "curves",  "Curves",                                 "@curves",   "@curves",   INTENT_PERCEPTUAL },
+    { "cmyk",    "CMYK profiles",                          "test1.icc", "test2.icc", INTENT_PERCEPTUAL },
+    { "gray",    "Gray to gray",                           "@gray30",   "@gray22",   INTENT_RELATIVE_COLORIMETRIC },
+    { "samegray","Same gray to gray",                      "@gray22",   "@gray22",   INTENT_PERCEPTUAL }
+};
+
+#define NCASES  (sizeof(Cases) / sizeof(BenchCase))
+
+// Sample encodings
+typedef struct {
+
+    const char*     Name;
+    cmsUInt32Number Bytes;
+    cmsBool         IsFloat;
+
+} BenchDepth;
+
+static const BenchDepth Depths[] = {
+
+    { "8",     1, FALSE },
+    { "16",    2, FALSE },
+#ifndef CMS_NO_HALF_SUPPORT
+    { "half",  2, TRUE },
+#endif
+    { "float", 4, TRUE }
+};
+
+#define NDEPTHS  (sizeof(Depths) / sizeof(BenchDepth))
+
+// Pixel layouts
+typedef struct {
+
+    const char*     Name;
+    cmsUInt32Number Planar;
+    cmsUInt32Number Extra;
+
+} BenchLayout;
+
+static const BenchLayout Layouts[] = {
+
+    { "chunky", 0, 0 },
+    { "planar", 1, 0 },
+    { "alpha",  0, 1 }
+};
+
+#define NLAYOUTS  (sizeof(Layouts) / sizeof(BenchLayout))
+
+// Options
+static cmsUInt32Number Width  = DEFAULT_WIDTH;
+static cmsUInt32Number Height = DEFAULT_HEIGHT;
+static cmsUInt32Number Warmup = DEFAULT_WARMUP;
+static cmsUInt32Number Runs   = DEFAULT_RUNS;
+static cmsUInt32Number Flags  = 0;
+static cmsUInt32Number Budget = 0;
+static cmsBool     ImageBudget = FALSE;
+static const char* ProfileDir = ".";
+static const char* CaseList   = NULL;
+static const char* DepthList  = NULL;
+static const char* LayoutList = NULL;
+static const char* JSONFile   = NULL;
+static cmsBool     JSONOnly   = FALSE;
+
+// Percentiles of a set of runs, in seconds
+typedef struct {
+
+    cmsFloat64Number Median;
+    cmsFloat64Number P95;
+
+} Percentiles;
+
+// Results of one case on one format
+typedef struct {
+
+    const BenchCase*   Case;
+    const BenchDepth*  Depth;
+    const BenchLayout* Layout;
+    cmsUInt32Number    InputFormat, OutputFormat;
+    cmsTransformInfo   Info;
+
+    Percentiles        Create;
+    Percentiles        Wall;
+    Percentiles        CPU;
+
+} BenchResult;
+
+static BenchResult* Results  = NULL;
+static cmsUInt32Number nResults = 0;
+
+
+// Utilities -------------------------------------------------------------------------------------------------------
+
+static
+void Die(const char* Reason)
+{
+    fprintf(stderr, "benchcms: %s\n", Reason);
+    exit(1);
+}
+
+static
+void* AllocOrDie(size_t size)
+{
+    void* ptr = calloc(1, size);
+
+    if (ptr == NULL) Die("Out of memory");
+    return ptr;
+}
+
+// Comma separated list. NULL list means all items
+static
+cmsBool InList(const char* List, const char* Item)
+{
+    size_t len = strlen(Item);
+    const char* p = List;
+
+    if (List == NULL) return TRUE;
+
+    while (*p) {
+
+        if (strncmp(p, Item, len) == 0 && (p[len] == ',' || p[len] == 0))
+            return TRUE;
+
+        p = strchr(p, ',');
+        if (p == NULL) break;
+        p++;
+    }
+
+    return FALSE;
+}
+
+static
+int CompareTimes(const void* a, const void* b)
+{
+    cmsFloat64Number x = *(const cmsFloat64Number*) a;
+    cmsFloat64Number y = *(const cmsFloat64Number*) b;
+
+    return (x > y) - (x < y);
+}
+
+// Nearest rank percentiles. The array gets sorted
+static
+Percentiles ComputePercentiles(cmsFloat64Number Times[], cmsUInt32Number n)
+{
+    Percentiles p;
+    cmsUInt32Number Rank95 = (95 * n + 99) / 100;
+
+    qsort(Times, n, sizeof(cmsFloat64Number), CompareTimes);
+
+    p.Median = (n & 1) ? Times[n / 2] : (Times[n / 2 - 1] + Times[n / 2]) / 2;
+    p.P95    = Times[Rank95 > 0 ? Rank95 - 1 : 0];
+
+    return p;
+}
+
+static
+cmsFloat64Number CPUTime(void)
+{
+    return (cmsFloat64Number) clock() / CLOCKS_PER_SEC;
+}
+
+// A fixed sequence, same on all platforms
+static
+cmsUInt16Number NextRandom(cmsUInt32Number* Seed)
+{
+    *Seed = *Seed * 1103515245U + 12345U;
+    return (cmsUInt16Number) (*Seed >> 16);
+}
+
+
+// Profiles --------------------------------------------------------------------------------------------------------
+
+static
+cmsHPROFILE CreateAdobeRGB(void)
+{
+    cmsCIExyYTRIPLE Primaries = { { 0.64, 0.33, 1 }, { 0.21, 0.71, 1 }, { 0.15, 0.06, 1 } };
+    cmsToneCurve* Curve[3];
+    cmsCIExyY D65;
+    cmsHPROFILE h;
+
+    cmsWhitePointFromTemp(&D65, 6504);
+    Curve[0] = Curve[1] = Curve[2] = cmsBuildGamma(NULL, 2.19921875);
+
+    h = cmsCreateRGBProfile(&D65, &Primaries, Curve);
+    cmsFreeToneCurve(Curve[0]);
+    return h;
+}
+
+static
+cmsHPROFILE CreateCurves(void)
+{
+    cmsToneCurve* Transfer[3];
+    cmsHPROFILE h;
+
+    Transfer[0] = Transfer[1] = Transfer[2] = cmsBuildGamma(NULL, 1.1);
+    h = cmsCreateLinearizationDeviceLink(cmsSigRgbData, Transfer);
+
+    cmsFreeToneCurve(Transfer[0]);
+    return h;
+}
+
+static
+cmsHPROFILE CreateGray(cmsFloat64Number Gamma)
+{
+    cmsToneCurve* Curve = cmsBuildGamma(NULL, Gamma);
+    cmsHPROFILE h = cmsCreateGrayProfile(cmsD50_xyY(), Curve);
+
+    cmsFreeToneCurve(Curve);
+    return h;
+}
+
+static
+cmsHPROFILE OpenBenchProfile(const char* Name)
+{
+    char FileName[1024];
+
+    if (strcmp(Name, "@adobe") == 0)  return CreateAdobeRGB();
+    if (strcmp(Name, "@curves") == 0) return CreateCurves();
+    if (strcmp(Name, "@gray22") == 0) return CreateGray(2.2);
+    if (strcmp(Name, "@gray30") == 0) return CreateGray(3.0);
+
+    if (strlen(ProfileDir) + strlen(Name) + 2 > sizeof(FileName)) return NULL;
+
+    strcpy(FileName, ProfileDir);
+    strcat(FileName, "/");
+    strcat(FileName, Name);
+    return cmsOpenProfileFromFile(FileName, "r");
+}
+
+// Formats follow the profiles, device links do have the output space as PCS
+static
+cmsUInt32Number BuildFormat(cmsHPROFILE hProfile, cmsBool IsOutput, const BenchDepth* Depth, const BenchLayout* Layout)
+{
+    cmsUInt32Number Format;
+
+    if (IsOutput && cmsGetDeviceClass(hProfile) == cmsSigLinkClass)
+        Format = cmsFormatterForPCSOfProfile(hProfile, Depth ->Bytes, Depth ->IsFloat);
+    else
+        Format = cmsFormatterForColorspaceOfProfile(hProfile, Depth ->Bytes, Depth ->IsFloat);
+
+    return Format | PLANAR_SH(Layout ->Planar) | EXTRA_SH(Layout ->Extra);
+}
+
+static
+cmsUInt32Number BytesPerPixel(cmsUInt32Number Format)
+{
+    cmsUInt32Number Bytes = T_BYTES(Format);
+
+    if (Bytes == 0) Bytes = sizeof(cmsFloat64Number);
+    return Bytes * (T_CHANNELS(Format) + T_EXTRA(Format));
+}
+
+// Applies the transform on the whole image, planar or chunky
+static
+void DoImage(cmsHTRANSFORM xform, const void* In, void* Out, cmsUInt32Number InputFormat, cmsUInt32Number OutputFormat)
+{
+    cmsUInt32Number InPixel  = BytesPerPixel(InputFormat);
+    cmsUInt32Number OutPixel = BytesPerPixel(OutputFormat);
+
+    if (T_PLANAR(InputFormat))
+        cmsDoTransformLineStride(xform, In, Out, Width, Height,
+                                 Width * (InPixel / (T_CHANNELS(InputFormat) + T_EXTRA(InputFormat))),
+                                 Width * (OutPixel / (T_CHANNELS(OutputFormat) + T_EXTRA(OutputFormat))),
+                                 Width * Height * (InPixel / (T_CHANNELS(InputFormat) + T_EXTRA(InputFormat))),
+                                 Width * Height * (OutPixel / (T_CHANNELS(OutputFormat) + T_EXTRA(OutputFormat))));
+    else
+        cmsDoTransformLineStride(xform, In, Out, Width, Height, Width * InPixel, Width * OutPixel, 0, 0);
+}
+
+// Fills the input image by converting a fixed 16 bits sequence to the format. The null transform
+// does only use formatters, so it works for any encoding and layout
+static
+cmsBool FillImage(cmsHPROFILE hProfile, cmsUInt32Number Format, void* Image)
+{
+    cmsUInt32Number RefFormat = (Format & ~(FLOAT_SH(1)|BYTES_SH(7))) | BYTES_SH(2);
+    cmsUInt32Number nSamples = Width * Height * (T_CHANNELS(Format) + T_EXTRA(Format));
+    cmsUInt16Number* Ref = (cmsUInt16Number*) AllocOrDie(nSamples * sizeof(cmsUInt16Number));
+    cmsUInt32Number Seed = 1, i;
+    cmsHTRANSFORM xform;
+
+    for (i=0; i < nSamples; i++)
+        Ref[i] = NextRandom(&Seed);
+
+    xform = cmsCreateTransform(hProfile, RefFormat, hProfile, Format, INTENT_PERCEPTUAL, cmsFLAGS_NULLTRANSFORM);
+    if (xform == NULL) {
+        free(Ref);
+        return FALSE;
+    }
+
+    DoImage(xform, Ref, Image, RefFormat, Format);
+
+    cmsDeleteTransform(xform);
+    free(Ref);
+    return TRUE;
+}
+
+
+// Running --------------------------------------------------------------------------------------------------------
+
+static
+cmsBool RunBenchmark(const BenchCase* Case, const BenchDepth* Depth, const BenchLayout* Layout,
+                     cmsHPROFILE hIn, cmsHPROFILE hOut, BenchResult* r)
+{
+    cmsFloat64Number Create[MAX_RUNS], Wall[MAX_RUNS], CPU[MAX_RUNS];
+    cmsHTRANSFORM xform;
+    void *In, *Out;
+    cmsUInt32Number i;
+
+    memset(r, 0, sizeof(BenchResult));
+
+    r ->Case   = Case;
+    r ->Depth  = Depth;
+    r ->Layout = Layout;
+    r ->InputFormat  = BuildFormat(hIn,  FALSE, Depth, Layout);
+    r ->OutputFormat = BuildFormat(hOut, TRUE,  Depth, Layout);
+
+    // Creation, profiles are linked and the pipeline is optimized each time
+    for (i=0; i < Warmup + Runs; i++) {
+
+        cmsFloat64Number Start = _cmsGetTime();
+
+        xform = cmsCreateTransform(hIn, r ->InputFormat, hOut, r ->OutputFormat, Case ->Intent, Flags);
+        if (xform == NULL) return FALSE;
+
+        if (i >= Warmup)
+            Create[i - Warmup] = _cmsGetTime() - Start;
+
+        cmsDeleteTransform(xform);
+    }
+
+    In  = AllocOrDie((size_t) Width * Height * BytesPerPixel(r ->InputFormat));
+    Out = AllocOrDie((size_t) Width * Height * BytesPerPixel(r ->OutputFormat));
+
+    if (!FillImage(hIn, r ->InputFormat, In)) {
+        free(In); free(Out);
+        return FALSE;
+    }
+
+    xform = cmsCreateTransform(hIn, r ->InputFormat, hOut, r ->OutputFormat, Case ->Intent, Flags);
+    cmsGetTransformInfo(xform, &r ->Info);
+
+    for (i=0; i < Warmup + Runs; i++) {
+
+        cmsFloat64Number StartWall = _cmsGetTime();
+        cmsFloat64Number StartCPU  = CPUTime();
+
+        DoImage(xform, In, Out, r ->InputFormat, r ->OutputFormat);
+
+        if (i >= Warmup) {
+            Wall[i - Warmup] = _cmsGetTime() - StartWall;
+            CPU[i - Warmup]  = CPUTime() - StartCPU;
+        }
+    }
+
+    cmsDeleteTransform(xform);
+    free(In);
+    free(Out);
+
+    r ->Create = ComputePercentiles(Create, Runs);
+    r ->Wall   = ComputePercentiles(Wall, Runs);
+    r ->CPU    = ComputePercentiles(CPU, Runs);
+    return TRUE;
+}
+
+static
+cmsFloat64Number MPixels(cmsFloat64Number Seconds)
+{
+    if (Seconds <= 0) return 0;
+    return (cmsFloat64Number) Width * Height / (Seconds * 1E6);
+}
+
+static
+void PrintResult(const BenchResult* r)
+{
+    char Title[64];
+
+    sprintf(Title, "%.40s, %s %s", r ->Case ->Title, r ->Depth ->Name, r ->Layout ->Name);
+
+    printf("%-56s create %8.3f ms   apply %8.3f ms (p95 %8.3f, cpu %8.3f)  %8.2f MPix/s\n", Title,
+           r ->Create.Median * 1E3, r ->Wall.Median * 1E3, r ->Wall.P95 * 1E3, r ->CPU.Median * 1E3,
+           MPixels(r ->Wall.Median));
+    fflush(stdout);
+}
+
+static
+void WriteJSON(FILE* f)
+{
+    cmsUInt32Number i;
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": %d,\n", cmsGetEncodedCMMversion());
+    fprintf(f, "  \"width\": %u,\n  \"height\": %u,\n", Width, Height);
+    fprintf(f, "  \"warmup\": %u,\n  \"runs\": %u,\n", Warmup, Runs);
+    fprintf(f, "  \"flags\": %u,\n", Flags);
+    fprintf(f, "  \"budget\": %u,\n", Budget);
+    fprintf(f, "  \"results\": [");
+
+    for (i=0; i < nResults; i++) {
+
+        const BenchResult* r = &Results[i];
+
+        fprintf(f, "%s\n    {\n", i > 0 ? "," : "");
+        fprintf(f, "      \"case\": \"%s\",\n", r ->Case ->Name);
+        fprintf(f, "      \"depth\": \"%s\",\n", r ->Depth ->Name);
+        fprintf(f, "      \"layout\": \"%s\",\n", r ->Layout ->Name);
+        fprintf(f, "      \"input_format\": %u,\n", r ->InputFormat);
+        fprintf(f, "      \"output_format\": %u,\n", r ->OutputFormat);
+        fprintf(f, "      \"worker\": %u,\n", r ->Info.Worker);
+        fprintf(f, "      \"eval16\": %u,\n", r ->Info.Eval16);
+        fprintf(f, "      \"eval_float\": %u,\n", r ->Info.EvalFloat);
+        fprintf(f, "      \"memory\": %u,\n", r ->Info.MemorySize);
+        fprintf(f, "      \"create_median\": %.9f,\n", r ->Create.Median);
+        fprintf(f, "      \"create_p95\": %.9f,\n", r ->Create.P95);
+        fprintf(f, "      \"wall_median\": %.9f,\n", r ->Wall.Median);
+        fprintf(f, "      \"wall_p95\": %.9f,\n", r ->Wall.P95);
+        fprintf(f, "      \"cpu_median\": %.9f,\n", r ->CPU.Median);
+        fprintf(f, "      \"cpu_p95\": %.9f,\n", r ->CPU.P95);
+        fprintf(f, "      \"mpixels_per_second\": %.3f\n", MPixels(r ->Wall.Median));
+        fprintf(f, "    }");
+    }
+
+    fprintf(f, "\n  ]\n}\n");
+}
+
+
+// Command line ---------------------------------------------------------------------------------------------------
+
+static
+void Help(void)
+{
+    cmsUInt32Number i;
+
+    fprintf(stderr, "usage: benchcms [flags]\n\n");
+    fprintf(stderr, "-s<W>x<H>  - Image size (default %ux%u)\n", DEFAULT_WIDTH, DEFAULT_HEIGHT);
+    fprintf(stderr, "-w<n>      - Warm-up runs, not timed (default %u)\n", DEFAULT_WARMUP);
+    fprintf(stderr, "-r<n>      - Timed runs (default %u, max %u)\n", DEFAULT_RUNS, MAX_RUNS);
+    fprintf(stderr, "-c<list>   - Cases, comma separated (default all):");
+    for (i=0; i < NCASES; i++) fprintf(stderr, " %s", Cases[i].Name);
+    fprintf(stderr, "\n-b<list>   - Sample encodings (default all):");
+    for (i=0; i < NDEPTHS; i++) fprintf(stderr, " %s", Depths[i].Name);
+    fprintf(stderr, "\n-l<list>   - Layouts (default all):");
+    for (i=0; i < NLAYOUTS; i++) fprintf(stderr, " %s", Layouts[i].Name);
+    fprintf(stderr, "\n-x<hex>    - Transform flags (default 0)\n");
+    fprintf(stderr, "-e<n>      - Optimization budget in pixels, or 'image' for the image size (default none)\n");
+    fprintf(stderr, "-d<dir>    - Directory of the test profiles (default .)\n");
+    fprintf(stderr, "-o<file>   - Write results as JSON to file\n");
+    fprintf(stderr, "-j         - Write results as JSON to stdout, instead of the table\n");
+    exit(0);
+}
+
+// Options may be given as "-r5" or "-r 5"
+static
+void HandleSwitches(int argc, char* argv[])
+{
+    int i;
+
+    for (i=1; i < argc; i++) {
+
+        const char* Arg = argv[i];
+        const char* Value;
+
+        if (Arg[0] != '-' || Arg[1] == 0 || (Arg[2] != 0 && strchr("jh", Arg[1]) != NULL)) Help();
+
+        if (strchr("jh", Arg[1]) != NULL)
+            Value = NULL;
+        else
+        if (Arg[2] != 0)
+            Value = Arg + 2;
+        else {
+            if (++i >= argc) Help();
+            Value = argv[i];
+        }
+
+        switch (Arg[1]) {
+
+        case 's':
+            if (sscanf(Value, "%ux%u", &Width, &Height) != 2 || Width == 0 || Height == 0) Help();
+            break;
+
+        case 'w': Warmup = (cmsUInt32Number) atoi(Value); break;
+        case 'r': Runs   = (cmsUInt32Number) atoi(Value); break;
+        case 'c': CaseList   = Value; break;
+        case 'b': DepthList  = Value; break;
+        case 'l': LayoutList = Value; break;
+        case 'd': ProfileDir = Value; break;
+        case 'o': JSONFile   = Value; break;
+        case 'x': Flags = (cmsUInt32Number) strtoul(Value, NULL, 16); break;
+        case 'j': JSONOnly = TRUE; break;
+
+        case 'e':
+            if (strcmp(Value, "image") == 0)
+                ImageBudget = TRUE;
+            else
+                Budget = (cmsUInt32Number) strtoul(Value, NULL, 10);
+            break;
+
+        default:
+            Help();
+        }
+    }
+
+    if (Runs == 0 || Runs > MAX_RUNS) Help();
+
+    if (ImageBudget) Budget = Width * Height;
+}
+
+int main(int argc, char* argv[])
+{
+    cmsUInt32Number i, j, k;
+
+    HandleSwitches(argc, argv);
+    cmsSetOptimizationBudget(NULL, Budget);
+
+    Results = (BenchResult*) AllocOrDie(NCASES * NDEPTHS * NLAYOUTS * sizeof(BenchResult));
+
+    if (!JSONOnly) {
+        printf("LittleCMS %2.2f benchmark, %ux%u pixels, %u warm-up and %u timed runs, medians shown\n",
+               cmsGetEncodedCMMversion() / 1000.0, Width, Height, Warmup, Runs);
+        if (Budget > 0) printf("Optimization budget of %u pixels\n", Budget);
+        printf("\n");
+        fflush(stdout);
+    }
+
+    for (i=0; i < NCASES; i++) {
+
+        cmsHPROFILE hIn, hOut;
+
+        if (!InList(CaseList, Cases[i].Name)) continue;
+
+        hIn  = OpenBenchProfile(Cases[i].Input);
+        hOut = OpenBenchProfile(Cases[i].Output);
+
+        if (hIn == NULL || hOut == NULL) {
+
+            fprintf(stderr, "benchcms: %s skipped, cannot open profiles (see -d)\n", Cases[i].Name);
+            if (hIn)  cmsCloseProfile(hIn);
+            if (hOut) cmsCloseProfile(hOut);
+            continue;
+        }
+
+        for (j=0; j < NDEPTHS; j++) {
+
+            if (!InList(DepthList, Depths[j].Name)) continue;
+
+            for (k=0; k < NLAYOUTS; k++) {
+
+                if (!InList(LayoutList, Layouts[k].Name)) continue;
+
+                if (!RunBenchmark(&Cases[i], &Depths[j], &Layouts[k], hIn, hOut, &Results[nResults])) {
+
+                    fprintf(stderr, "benchcms: %s on %s %s skipped, format not supported\n", Cases[i].Name, Depths[j].Name, Layouts[k].Name);
+                    continue;
+                }
+
+                if (!JSONOnly)
+                    PrintResult(&Results[nResults]);
+
+                nResults++;
+            }
+        }
+
+        if (!JSONOnly) printf("\n");
+
+        cmsCloseProfile(hIn);
+        cmsCloseProfile(hOut);
+    }
+
+    if (JSONOnly)
+        WriteJSON(stdout);
+
+    if (JSONFile != NULL) {
+
+        FILE* f = fopen(JSONFile, "wt");
+
+        if (f == NULL) Die("Cannot write JSON file");
+        WriteJSON(f);
+        fclose(f);
+    }
+
+    free(Results);
+    return 0;
+}
@@ -61,18 +61,25 @@ void Say(const char* str);
 // Plug-in tests
 cmsInt32Number CheckSimpleContext(void);
 cmsInt32Number CheckAllocContext(void);
+cmsInt32Number CheckContextLookup(void);
 cmsInt32Number CheckAlarmColorsContext(void);
 cmsInt32Number CheckAdaptationStateContext(void);
+cmsInt32Number CheckSharedTransformsContext(void);
+cmsInt32Number CheckSharedTransformsReadTags(void);
 cmsInt32Number CheckInterp1DPlugin(void);
 cmsInt32Number CheckInterp3DPlugin(void);
 cmsInt32Number CheckParametricCurvePlugin(void);
 cmsInt32Number CheckFormattersPlugin(void);
+cmsInt32Number CheckLineFormattersPluginVersion(void);
 cmsInt32Number CheckTagTypePlugin(void);
 cmsInt32Number CheckMPEPlugin(void);
 cmsInt32Number CheckOptimizationPlugin(void);
 cmsInt32Number CheckIntentPlugin(void);
 cmsInt32Number CheckTransformPlugin(void);
+cmsInt32Number CheckTransformWorkspaces(void);
 cmsInt32Number CheckMutexPlugin(void);
+cmsInt32Number CheckParallelizationPlugin(void);
+cmsInt32Number CheckParallelSampling(void);
 
 
 // Zoo
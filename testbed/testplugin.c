@@ -136,6 +136,69 @@ cmsInt32Number CheckSimpleContext(void)
 }
 
 
+// Lookup of many live contexts, more than fit in the lookup table, with deletions in between
+#define LOOKUP_CONTEXTS 1500
+
+cmsInt32Number CheckContextLookup(void)
+{
+    static int Data[LOOKUP_CONTEXTS];
+    cmsContext* c;
+    cmsInt32Number i, rc = 1;
+
+    c = (cmsContext*) malloc(LOOKUP_CONTEXTS * sizeof(cmsContext));
+    if (c == NULL) return 0;
+
+    for (i=0; i < LOOKUP_CONTEXTS; i++) {
+
+        c[i] = cmsCreateContext(NULL, &Data[i]);
+        if (c[i] == NULL) Die("Unable to create context");
+        DebugMemDontCheckThis(c[i]);
+    }
+
+    for (i=0; i < LOOKUP_CONTEXTS; i++) {
+
+        if (cmsGetContextUserData(c[i]) != &Data[i]) {
+            Fail("Context %d not found", i); rc = 0; break;
+        }
+    }
+
+    // Every other one goes, and some come back
+    for (i=1; i < LOOKUP_CONTEXTS; i += 2)
+        cmsDeleteContext(c[i]);
+
+    for (i=1; i < LOOKUP_CONTEXTS; i += 6) {
+
+        c[i] = cmsCreateContext(NULL, &Data[i]);
+        if (c[i] == NULL) Die("Unable to create context");
+        DebugMemDontCheckThis(c[i]);
+    }
+
+    for (i=0; i < LOOKUP_CONTEXTS; i++) {
+
+        if (!(i & 1) || (i % 6) == 1) {
+
+            if (cmsGetContextUserData(c[i]) != &Data[i]) {
+                Fail("Context %d not found after deletions", i); rc = 0; break;
+            }
+        }
+    }
+
+    for (i=0; i < LOOKUP_CONTEXTS; i++) {
+
+        if (!(i & 1) || (i % 6) == 1)
+            cmsDeleteContext(c[i]);
+    }
+
+    // Unknown ones revert to the global context
+    if (cmsGetContextUserData((cmsContext) &Data[0]) != NULL) {
+        Fail("Unknown context not reverted to global"); rc = 0;
+    }
+
+    free(c);
+    return rc;
+}
+
+
 
 
 // --------------------------------------------------------------------------------------------------
@@ -212,6 +275,240 @@ cmsInt32Number CheckAdaptationStateContext(void)
     return rc;
 }
 
+// Shared transforms are per context. Same requests get same handle, which lives until deleted as many times as created
+cmsInt32Number CheckSharedTransformsContext(void)
+{
+    cmsInt32Number rc = 1;
+    cmsContext c1, c2;
+    cmsHPROFILE hsRGB, hLab;
+    cmsHTRANSFORM x1, x2, x3, x4;
+    cmsSharedTransformStats Stats;
+    cmsUInt8Number rgb[3] = { 10, 200, 30 };
+    cmsUInt16Number Lab[3];
+
+    c1 = WatchDogContext(NULL);
+
+    cmsSetSharedTransformLimit(c1, 2);
+    c2 = DupContext(c1, NULL);
+
+    hsRGB = cmsCreate_sRGBProfileTHR(c1);
+    hLab  = cmsCreateLab4ProfileTHR(c1, NULL);
+
+    x1 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    x2 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    x3 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_ABSOLUTE_COLORIMETRIC, 0);
+
+    // Other context has its own cache
+    x4 = cmsCreateTransformTHR(c2, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+
+    if (x1 == NULL || x1 != x2 || x1 == x3 || x1 == x4) {
+        Fail("Shared transforms not properly returned"); rc = 0;
+    }
+
+    cmsGetSharedTransformStats(c1, &Stats);
+    if (Stats.Hits != 1 || Stats.Misses != 2 || Stats.Entries != 2 || Stats.MaxEntries != 2) {
+        Fail("Wrong shared transforms statistics"); rc = 0;
+    }
+
+    // Still usable after one delete
+    cmsDeleteTransform(x1);
+    cmsDoTransform(x2, rgb, Lab, 1);
+    cmsDeleteTransform(x2);
+    cmsDeleteTransform(x3);
+
+    // Idle transforms are kept
+    x1 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    cmsGetSharedTransformStats(c1, &Stats);
+    if (Stats.Hits != 2) {
+        Fail("Idle shared transform not reused"); rc = 0;
+    }
+
+    // An open transform survives a flush
+    cmsSetSharedTransformLimit(c1, 0);
+    cmsGetSharedTransformStats(c1, &Stats);
+    if (Stats.Entries != 0) {
+        Fail("Shared transforms not flushed"); rc = 0;
+    }
+
+    cmsDoTransform(x1, rgb, Lab, 1);
+    cmsDeleteTransform(x1);
+
+    // Not shared anymore
+    x1 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    x2 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    if (x1 == x2) {
+        Fail("Shared transform on disabled context"); rc = 0;
+    }
+    cmsDeleteTransform(x1);
+    cmsDeleteTransform(x2);
+
+    // Profiles without ID are told apart by contents, which are not modified. Changes are noticed
+    cmsSetSharedTransformLimit(c1, 4);
+    x1 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    cmsSetHeaderModel(hsRGB, 0x1234);
+    x2 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    x3 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    if (x1 == x2 || x2 != x3) {
+        Fail("Shared transform of a modified profile"); rc = 0;
+    }
+    {
+        cmsUInt8Number ID[16];
+        int i;
+
+        cmsGetHeaderProfileID(hsRGB, ID);
+        for (i=0; i < 16; i++)
+            if (ID[i] != 0) {
+                Fail("Profile ID written by shared transforms"); rc = 0; break;
+            }
+    }
+    cmsDeleteTransform(x1);
+    cmsDeleteTransform(x2);
+    cmsDeleteTransform(x3);
+
+    // Handles whose formats or cache size change are not returned anymore
+    x1 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_16, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    x2 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+
+    if (!cmsChangeBuffersFormat(x1, TYPE_BGR_16, TYPE_Lab_16) || !cmsSetTransformCacheSize(x2, 64)) {
+        Fail("Cannot change shared transform"); rc = 0;
+    }
+
+    x3 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_16, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    if (x3 == x1 || cmsGetTransformInputFormat(x3) != TYPE_RGB_16) {
+        Fail("Shared transform with changed formats returned"); rc = 0;
+    }
+    cmsDeleteTransform(x3);
+
+    x3 = cmsCreateTransformTHR(c1, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+    if (x3 == x2) {
+        Fail("Shared transform with resized cache returned"); rc = 0;
+    }
+    cmsDeleteTransform(x3);
+
+    // Still usable, and freed on delete
+    cmsDoTransform(x2, rgb, Lab, 1);
+    cmsDeleteTransform(x1);
+    cmsDeleteTransform(x2);
+
+    // Idle transform on c2 goes away with the context
+    cmsDeleteTransform(x4);
+
+    cmsCloseProfile(hsRGB);
+    cmsCloseProfile(hLab);
+
+    cmsDeleteContext(c1);
+    cmsDeleteContext(c2);
+
+    return rc;
+}
+
+// Tags in memory are read with no lock, while shared transforms save the profile to get its digest. Saving
+// should not touch the live profile. Meant to be run under a thread sanitizer as well.
+typedef struct {
+
+    cmsHPROFILE hsRGB, hLab;
+    void* RedColorant;
+    cmsBool IsReader;
+    cmsBool Ok;
+
+} SharedReadCargo;
+
+static
+void SharedReadJob(void* Cargo)
+{
+    SharedReadCargo* c = (SharedReadCargo*) Cargo;
+    cmsContext ContextID = cmsGetProfileContextID(c ->hsRGB);
+    cmsHTRANSFORM xform;
+    cmsUInt32Number i, BytesNeeded;
+
+    for (i=0; i < 200; i++) {
+
+        if (c ->IsReader) {
+
+            if (cmsReadTag(c ->hsRGB, cmsSigRedColorantTag) != c ->RedColorant ||
+                cmsReadTag(c ->hsRGB, cmsSigMediaWhitePointTag) == NULL) c ->Ok = FALSE;
+        }
+        else {
+
+            xform = cmsCreateTransformTHR(ContextID, c ->hsRGB, TYPE_RGB_8, c ->hLab, TYPE_Lab_16, INTENT_RELATIVE_COLORIMETRIC, 0);
+            if (xform == NULL) c ->Ok = FALSE;
+            else cmsDeleteTransform(xform);
+
+            if (!cmsSaveProfileToMem(c ->hsRGB, NULL, &BytesNeeded)) c ->Ok = FALSE;
+        }
+    }
+}
+
+// The debug memory handler keeps its totals without locking, so threads go with plain malloc
+static
+void* PlainMalloc(cmsContext ContextID, cmsUInt32Number size)
+{
+    return malloc(size);
+
+    cmsUNUSED_PARAMETER(ContextID);
+}
+
+static
+void PlainFree(cmsContext ContextID, void* Ptr)
+{
+    free(Ptr);
+
+    cmsUNUSED_PARAMETER(ContextID);
+}
+
+static
+void* PlainRealloc(cmsContext ContextID, void* Ptr, cmsUInt32Number NewSize)
+{
+    return realloc(Ptr, NewSize);
+
+    cmsUNUSED_PARAMETER(ContextID);
+}
+
+static cmsPluginMemHandler PlainMemHandler = {{ cmsPluginMagicNumber, 2060, cmsPluginMemHandlerSig, NULL },
+                                               PlainMalloc, PlainFree, PlainRealloc, NULL, NULL, NULL };
+
+cmsInt32Number CheckSharedTransformsReadTags(void)
+{
+    SharedReadCargo Cargo[8];
+    void* Jobs[8];
+    cmsContext ctx;
+    cmsHPROFILE hsRGB, hLab;
+    cmsInt32Number rc = 1;
+    cmsUInt32Number i;
+
+    ctx = cmsCreateContext(&PlainMemHandler, NULL);
+    DebugMemDontCheckThis(ctx);
+    cmsSetSharedTransformLimit(ctx, 4);
+
+    hsRGB = cmsCreate_sRGBProfileTHR(ctx);
+    hLab  = cmsCreateLab4ProfileTHR(ctx, NULL);
+
+    for (i=0; i < 8; i++) {
+
+        Cargo[i].hsRGB = hsRGB;
+        Cargo[i].hLab  = hLab;
+        Cargo[i].RedColorant = cmsReadTag(hsRGB, cmsSigRedColorantTag);
+        Cargo[i].IsReader = (i & 1);
+        Cargo[i].Ok = TRUE;
+        Jobs[i] = &Cargo[i];
+    }
+
+    _cmsRunParallelJobs(ctx, 8, SharedReadJob, Jobs);
+
+    for (i=0; i < 8; i++) {
+
+        if (!Cargo[i].Ok) {
+            Fail("Tag read or transform failed while saving the profile"); rc = 0; break;
+        }
+    }
+
+    cmsCloseProfile(hsRGB);
+    cmsCloseProfile(hLab);
+    cmsDeleteContext(ctx);
+
+    return rc;
+}
+
 // --------------------------------------------------------------------------------------------------
 // Interpolation plugin check: A fake 1D and 3D interpolation will be used to test the functionality. 
 // --------------------------------------------------------------------------------------------------
@@ -755,6 +1052,62 @@ cmsInt32Number CheckFormattersPlugin(void)
     return 1;
 }
 
+
+// Plug-ins built against older headers have no line formatter field, whatever follows must be ignored
+static int LineFactoryCalls = 0;
+
+static
+cmsLineFormatter my_LineFormatterFactory(cmsUInt32Number Type,
+                                         cmsFormatterDirection Dir,
+                                         cmsUInt32Number dwFlags)
+{
+    cmsLineFormatter Result = { NULL };
+
+    LineFactoryCalls++;
+    return Result;
+
+    cmsUNUSED_PARAMETER(Type);
+    cmsUNUSED_PARAMETER(Dir);
+    cmsUNUSED_PARAMETER(dwFlags);
+}
+
+static
+cmsPluginFormatters FormattersPluginOld = { {cmsPluginMagicNumber,
+                                2100,
+                                cmsPluginFormattersSig,
+                                NULL},
+                                my_FormatterFactory,
+                                my_LineFormatterFactory };
+
+static
+cmsPluginFormatters FormattersPluginLine = { {cmsPluginMagicNumber,
+                                2110,
+                                cmsPluginFormattersSig,
+                                NULL},
+                                my_FormatterFactory,
+                                my_LineFormatterFactory };
+
+cmsInt32Number CheckLineFormattersPluginVersion(void)
+{
+    cmsContext ctx = WatchDogContext(NULL);
+    cmsContext cpy;
+    int rc;
+
+    cmsPluginTHR(ctx, &FormattersPluginOld);
+    _cmsGetLineFormatter(ctx, TYPE_RGB_16, cmsFormatterInput, CMS_PACK_FLAGS_16BITS);
+    rc = (LineFactoryCalls == 0);
+
+    cpy = DupContext(ctx, NULL);
+    cmsPluginTHR(cpy, &FormattersPluginLine);
+    _cmsGetLineFormatter(cpy, TYPE_RGB_16, cmsFormatterInput, CMS_PACK_FLAGS_16BITS);
+    if (LineFactoryCalls != 1) rc = 0;
+
+    cmsDeleteContext(ctx);
+    cmsDeleteContext(cpy);
+
+    return rc;
+}
+
 // --------------------------------------------------------------------------------------------------
 // TagTypePlugin plugin check
 // --------------------------------------------------------------------------------------------------
@@ -1381,6 +1734,143 @@ cmsInt32Number CheckTransformPlugin(void)
 }
 
 
+// A transform that inverts gray 8 bits, one line at a time through a scratch buffer
+static
+void InvertWithWorkspace(struct _cmstransform_struct *CMMcargo,
+                         const void* InputBuffer,
+                         void* OutputBuffer,
+                         cmsUInt32Number PixelsPerLine,
+                         cmsUInt32Number LineCount,
+                         const cmsStride* Stride)
+{
+    cmsUInt8Number* Line = (cmsUInt8Number*) _cmsGetTransformWorkspace(CMMcargo, PixelsPerLine);
+    cmsUInt32Number i, j;
+
+    if (Line == NULL) return;
+
+    for (i=0; i < LineCount; i++) {
+
+        const cmsUInt8Number* In = (const cmsUInt8Number*) InputBuffer + (size_t) i * Stride ->BytesPerLineIn;
+        cmsUInt8Number* Out = (cmsUInt8Number*) OutputBuffer + (size_t) i * Stride ->BytesPerLineOut;
+
+        for (j=0; j < PixelsPerLine; j++)
+            Line[j] = (cmsUInt8Number) (255 - In[j]);
+
+        memcpy(Out, Line, PixelsPerLine);
+    }
+
+    _cmsReleaseTransformWorkspace(CMMcargo, Line);
+}
+
+static
+cmsBool WorkspaceTransformFactory(_cmsTransform2Fn* xformPtr,
+                                  void** UserData,
+                                  _cmsFreeUserDataFn* FreePrivateDataFn,
+                                  cmsPipeline** Lut,
+                                  cmsUInt32Number* InputFormat,
+                                  cmsUInt32Number* OutputFormat,
+                                  cmsUInt32Number* dwFlags)
+{
+    if (*InputFormat == TYPE_GRAY_8 && *OutputFormat == TYPE_GRAY_8) {
+
+        *xformPtr = InvertWithWorkspace;
+        return TRUE;
+    }
+
+    return FALSE;
+
+    cmsUNUSED_PARAMETER(UserData);
+    cmsUNUSED_PARAMETER(FreePrivateDataFn);
+    cmsUNUSED_PARAMETER(Lut);
+    cmsUNUSED_PARAMETER(dwFlags);
+}
+
+static cmsPluginTransform WorkspaceTransformPluginSample = {
+
+     { cmsPluginMagicNumber, 2100, cmsPluginTransformSig, NULL},
+
+     { (_cmsTransformFactory) WorkspaceTransformFactory }
+};
+
+static cmsPluginParallelization BuiltinThreadsPluginSample = {
+
+     { cmsPluginMagicNumber, 2100, cmsPluginParallelizationSig, NULL},
+
+     8, NULL
+};
+
+#define WS_WIDTH   512
+#define WS_HEIGHT  512
+
+cmsInt32Number CheckTransformWorkspaces(void)
+{
+    cmsContext ctx = WatchDogContext(NULL);
+    cmsHTRANSFORM xform;
+    cmsToneCurve* Linear;
+    cmsHPROFILE h;
+    cmsUInt8Number *In, *Out;
+    void *a, *b, *c;
+    cmsUInt32Number i, n;
+    cmsInt32Number rc = 1;
+
+    cmsPluginTHR(ctx, &WorkspaceTransformPluginSample);
+    cmsPluginTHR(ctx, &BuiltinThreadsPluginSample);
+
+    Linear = cmsBuildGamma(ctx, 1.0);
+    h = cmsCreateLinearizationDeviceLinkTHR(ctx, cmsSigGrayData, &Linear);
+    cmsFreeToneCurve(Linear);
+
+    xform = cmsCreateTransformTHR(ctx, h, TYPE_GRAY_8, h, TYPE_GRAY_8, INTENT_PERCEPTUAL, cmsFLAGS_PARALLEL);
+    cmsCloseProfile(h);
+
+    // Idle blocks are reused, if large enough
+    a = _cmsGetTransformWorkspace((struct _cmstransform_struct*) xform, 100);
+    b = _cmsGetTransformWorkspace((struct _cmstransform_struct*) xform, 100);
+    if (a == NULL || b == NULL || a == b) {
+        Fail("Workspaces not private"); rc = 0;
+    }
+    memset(a, 1, 100);
+    memset(b, 2, 100);
+    _cmsReleaseTransformWorkspace((struct _cmstransform_struct*) xform, a);
+    _cmsReleaseTransformWorkspace((struct _cmstransform_struct*) xform, b);
+
+    c = _cmsGetTransformWorkspace((struct _cmstransform_struct*) xform, 50);
+    if (c != a && c != b) {
+        Fail("Workspace not reused"); rc = 0;
+    }
+    _cmsReleaseTransformWorkspace((struct _cmstransform_struct*) xform, c);
+
+    // Whole lines and single lines split across threads
+    In  = (cmsUInt8Number*) malloc(WS_WIDTH * WS_HEIGHT);
+    Out = (cmsUInt8Number*) malloc(WS_WIDTH * WS_HEIGHT);
+
+    for (i=0; i < WS_WIDTH * WS_HEIGHT; i++)
+        In[i] = (cmsUInt8Number) (i ^ (i >> 9));
+
+    for (n=0; n < 2; n++) {
+
+        memset(Out, 0, WS_WIDTH * WS_HEIGHT);
+
+        if (n == 0)
+            cmsDoTransformLineStride(xform, In, Out, WS_WIDTH, WS_HEIGHT, WS_WIDTH, WS_WIDTH, 0, 0);
+        else
+            cmsDoTransform(xform, In, Out, WS_WIDTH * WS_HEIGHT);
+
+        for (i=0; i < WS_WIDTH * WS_HEIGHT; i++) {
+
+            if (Out[i] != 255 - In[i]) {
+                Fail("Wrong value at %u", i); rc = 0; break;
+            }
+        }
+    }
+
+    free(In);
+    free(Out);
+    cmsDeleteTransform(xform);
+    cmsDeleteContext(ctx);
+    return rc;
+}
+
 // --------------------------------------------------------------------------------------------------
 // Check the mutex plug-in
 // --------------------------------------------------------------------------------------------------
@@ -1474,3 +1964,271 @@ cmsInt32Number CheckMutexPlugin(void)
 
     return 1;
 }
+
+
+// --------------------------------------------------------------------------------------------------
+// Parallelization plug-in
+// --------------------------------------------------------------------------------------------------
+
+static cmsUInt32Number JobsRun = 0;
+
+// Host-supplied "thread pool". Runs the jobs backwards, to make sure the order doesn't matter
+static
+cmsBool MyRunJobs(cmsContext ContextID, cmsUInt32Number nJobs, _cmsParallelJobFn Job, void* Cargo[])
+{
+    cmsUInt32Number i;
+
+    for (i=nJobs; i > 0; i--) {
+
+        Job(Cargo[i-1]);
+        JobsRun++;
+    }
+
+    return TRUE;
+
+    cmsUNUSED_PARAMETER(ContextID);
+}
+
+static cmsPluginParallelization ParallelizationPluginSample = {
+
+     { cmsPluginMagicNumber, 2100, cmsPluginParallelizationSig, NULL}, 
+
+     4, MyRunJobs                     
+};
+
+// Same as above, but uses the built-in threads 
+static cmsPluginParallelization ParallelizationPluginSample2 = {
+
+     { cmsPluginMagicNumber, 2100, cmsPluginParallelizationSig, NULL}, 
+
+     4, NULL                     
+};
+
+
+#define PAR_WIDTH   256
+#define PAR_HEIGHT  256
+
+// Serial and parallel transforms should return the same, bit by bit
+static
+cmsInt32Number CompareParallelTransform(cmsContext ctx, cmsHPROFILE hIn, cmsUInt32Number InputFormat, 
+                                                        cmsHPROFILE hOut, cmsUInt32Number OutputFormat)
+{
+    cmsHTRANSFORM xSerial, xParallel;
+    cmsUInt32Number BytesIn  = T_BYTES(InputFormat) * T_CHANNELS(InputFormat);
+    cmsUInt32Number BytesOut = T_BYTES(OutputFormat) * T_CHANNELS(OutputFormat);
+    cmsUInt8Number *In, *Out1, *Out2;
+    cmsUInt32Number i;
+    cmsInt32Number rc;
+
+    xSerial   = cmsCreateTransformTHR(ctx, hIn, InputFormat, hOut, OutputFormat, INTENT_PERCEPTUAL, 0);
+    xParallel = cmsCreateTransformTHR(ctx, hIn, InputFormat, hOut, OutputFormat, INTENT_PERCEPTUAL, cmsFLAGS_PARALLEL);
+
+    In   = (cmsUInt8Number*) malloc(PAR_WIDTH * PAR_HEIGHT * BytesIn);
+    Out1 = (cmsUInt8Number*) malloc(PAR_WIDTH * PAR_HEIGHT * BytesOut);
+    Out2 = (cmsUInt8Number*) malloc(PAR_WIDTH * PAR_HEIGHT * BytesOut);
+
+    for (i=0; i < PAR_WIDTH * PAR_HEIGHT * BytesIn; i++)
+        In[i] = (cmsUInt8Number) ((i * 7) ^ (i >> 8));
+
+    // Float input needs to be in range
+    if (T_FLOAT(InputFormat)) {
+
+        cmsFloat32Number* fIn = (cmsFloat32Number*) In;
+
+        for (i=0; i < PAR_WIDTH * PAR_HEIGHT * T_CHANNELS(InputFormat); i++)
+            fIn[i] = (cmsFloat32Number) ((i * 7) % 255) / 255.0F;
+    }
+
+    rc = 1;
+
+    // One single line, split by pixels
+    memset(Out1, 0, PAR_WIDTH * PAR_HEIGHT * BytesOut);
+    memset(Out2, 0xFF, PAR_WIDTH * PAR_HEIGHT * BytesOut);
+
+    cmsDoTransform(xSerial,   In, Out1, PAR_WIDTH * PAR_HEIGHT);
+    cmsDoTransform(xParallel, In, Out2, PAR_WIDTH * PAR_HEIGHT);
+
+    if (memcmp(Out1, Out2, PAR_WIDTH * PAR_HEIGHT * BytesOut) != 0) rc = 0;
+
+    // Several lines, split by lines
+    memset(Out2, 0xFF, PAR_WIDTH * PAR_HEIGHT * BytesOut);
+
+    cmsDoTransformLineStride(xParallel, In, Out2, PAR_WIDTH, PAR_HEIGHT, PAR_WIDTH * BytesIn, PAR_WIDTH * BytesOut, 0, 0);
+
+    if (memcmp(Out1, Out2, PAR_WIDTH * PAR_HEIGHT * BytesOut) != 0) rc = 0;
+
+    free(In); free(Out1); free(Out2);
+    cmsDeleteTransform(xSerial);
+    cmsDeleteTransform(xParallel);
+
+    return rc;
+}
+
+static
+cmsInt32Number CompareParallelTransforms(cmsContext ctx)
+{
+    cmsHPROFILE hsRGB = cmsCreate_sRGBProfileTHR(ctx);
+    cmsHPROFILE hLab  = cmsCreateLab4ProfileTHR(ctx, NULL);
+    cmsInt32Number rc = 1;
+
+    if (!CompareParallelTransform(ctx, hsRGB, TYPE_RGB_8, hLab, TYPE_Lab_16)) rc = 0;
+    if (!CompareParallelTransform(ctx, hsRGB, TYPE_RGB_16, hsRGB, TYPE_RGB_8)) rc = 0;
+    if (!CompareParallelTransform(ctx, hsRGB, TYPE_RGB_FLT, hLab, TYPE_Lab_FLT)) rc = 0;
+
+    cmsCloseProfile(hsRGB);
+    cmsCloseProfile(hLab);
+
+    return rc;
+}
+
+cmsInt32Number CheckParallelizationPlugin(void)
+{
+    cmsContext ctx = WatchDogContext(NULL);
+    cmsContext cpy;
+    cmsInt32Number rc = 1;
+
+    cmsPluginTHR(ctx, &ParallelizationPluginSample);
+
+    cpy = DupContext(ctx, NULL);
+
+    JobsRun = 0;
+    if (!CompareParallelTransforms(cpy)) {
+        Fail("Parallel transform differs from serial one");
+        rc = 0;
+    }
+
+    // 3 transforms, each one run twice on 4 bands. The first one is resampled on 4 jobs as well
+    if (JobsRun != 3 * 2 * 4 + 4) {
+        Fail("Host pool not used (%d jobs)", JobsRun);
+        rc = 0;
+    }
+
+    cmsDeleteContext(cpy);
+
+    // Now using the built-in threads
+    cmsPluginTHR(ctx, &ParallelizationPluginSample2);
+
+    JobsRun = 0;
+    if (!CompareParallelTransforms(ctx)) {
+        Fail("Threaded transform differs from serial one");
+        rc = 0;
+    }
+
+    if (JobsRun != 0) rc = 0;
+
+    cmsDeleteContext(ctx);
+    return rc;
+}
+
+
+// A reentrant sampler. Just a function of the input
+static
+cmsInt32Number ReentrantSampler(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Number Out[], CMSREGISTER void* Cargo)
+{
+    Out[0] = (cmsUInt16Number) (In[0] ^ In[1]);
+    Out[1] = (cmsUInt16Number) (In[1] + In[2]);
+    Out[2] = (cmsUInt16Number) (In[2] / 3 + In[0] / 2);
+
+    return TRUE;
+
+    cmsUNUSED_PARAMETER(Cargo);
+}
+
+static
+cmsInt32Number FailingSampler(CMSREGISTER const cmsUInt16Number In[], CMSREGISTER cmsUInt16Number Out[], CMSREGISTER void* Cargo)
+{
+    ReentrantSampler(In, Out, Cargo);
+    return !(In[0] == 0xFFFF && In[1] == 0xFFFF);
+}
+
+static
+cmsInt32Number CompareParallelSampling(cmsContext ctx)
+{
+    cmsStage *Serial, *Parallel;
+    cmsInt32Number rc = 1;
+
+    Serial   = cmsStageAllocCLut16bit(ctx, 17, 3, 3, NULL);
+    Parallel = cmsStageAllocCLut16bit(ctx, 17, 3, 3, NULL);
+
+    if (!cmsStageSampleCLut16bit(Serial, ReentrantSampler, NULL, 0)) rc = 0;
+    if (!cmsStageSampleCLut16bit(Parallel, ReentrantSampler, NULL, SAMPLER_REENTRANT)) rc = 0;
+
+    if (memcmp(((_cmsStageCLutData*) cmsStageData(Serial)) ->Tab.T,
+               ((_cmsStageCLutData*) cmsStageData(Parallel)) ->Tab.T, 17 * 17 * 17 * 3 * sizeof(cmsUInt16Number)) != 0) {
+        Fail("Parallel sampling differs from serial one");
+        rc = 0;
+    }
+
+    // A failure on any node is reported
+    if (cmsStageSampleCLut16bit(Parallel, FailingSampler, NULL, SAMPLER_REENTRANT)) {
+        Fail("Sampler failure not reported");
+        rc = 0;
+    }
+
+    cmsStageFree(Serial);
+    cmsStageFree(Parallel);
+    return rc;
+}
+
+// Black-preserving intents sample a 4D grid, which is worth to be run in parallel
+static
+cmsInt32Number CompareParallelDeviceLink(cmsContext ctx)
+{
+    cmsHPROFILE hCMYK;
+    cmsHTRANSFORM xSerial, xParallel;
+    cmsUInt8Number In[256 * 4], Out1[256 * 4], Out2[256 * 4];
+    cmsUInt32Number i;
+    cmsInt32Number rc = 1;
+
+    hCMYK = cmsOpenProfileFromFileTHR(ctx, "test1.icc", "r");
+    if (hCMYK == NULL) return 0;
+
+    for (i=0; i < sizeof(In); i++)
+        In[i] = (cmsUInt8Number) ((i * 37) ^ (i >> 3));
+
+    xSerial   = cmsCreateTransformTHR(ctx, hCMYK, TYPE_CMYK_8, hCMYK, TYPE_CMYK_8, INTENT_PRESERVE_K_PLANE_PERCEPTUAL, cmsFLAGS_NOCACHE);
+    xParallel = cmsCreateTransformTHR(ctx, hCMYK, TYPE_CMYK_8, hCMYK, TYPE_CMYK_8, INTENT_PRESERVE_K_PLANE_PERCEPTUAL, cmsFLAGS_NOCACHE|cmsFLAGS_PARALLEL);
+
+    if (xSerial == NULL || xParallel == NULL) rc = 0;
+    else {
+
+        cmsDoTransform(xSerial,   In, Out1, 256);
+        cmsDoTransform(xParallel, In, Out2, 256);
+
+        if (memcmp(Out1, Out2, sizeof(Out1)) != 0) {
+            Fail("Device link built in parallel differs from serial one");
+            rc = 0;
+        }
+    }
+
+    if (xSerial) cmsDeleteTransform(xSerial);
+    if (xParallel) cmsDeleteTransform(xParallel);
+    cmsCloseProfile(hCMYK);
+    return rc;
+}
+
+cmsInt32Number CheckParallelSampling(void)
+{
+    cmsContext ctx = WatchDogContext(NULL);
+    cmsInt32Number rc = 1;
+
+    // Host pool, 4 workers
+    cmsPluginTHR(ctx, &ParallelizationPluginSample);
+
+    JobsRun = 0;
+    if (!CompareParallelSampling(ctx)) rc = 0;
+
+    if (JobsRun != 2 * 4) {
+        Fail("Host pool not used on sampling (%d jobs)", JobsRun);
+        rc = 0;
+    }
+
+    // Built-in threads
+    cmsPluginTHR(ctx, &ParallelizationPluginSample2);
+
+    if (!CompareParallelSampling(ctx)) rc = 0;
+    if (!CompareParallelDeviceLink(ctx)) rc = 0;
+
+    cmsDeleteContext(ctx);
+    return rc;
+}
@@ -25,6 +25,7 @@
 // This program does apply profiles to (some) JPEG files
 
 
+#include "lcms2_plugin.h"
 #include "utils.h"
 
 #include "jpeglib.h"
@@ -47,6 +48,7 @@ static int ProofingIntent          = INTENT_PERCEPTUAL;
 static int PrecalcMode             = 1;
 
 static int jpegQuality             = 75;
+static int Threads                 = 0;
 
 static cmsFloat64Number ObserverAdaptationState = 0;
 
@@ -839,12 +841,168 @@ void DoEmbedProfile(const char* ProfileFile)
 
 
 
+// Scanlines go through the transform in batches. With -j, each batch is decoded while the previous one is
+// transformed by several threads and the one before is encoded. Each round is a set of parallel jobs run by
+// lcms, so the decompressor and the compressor are only touched by one thread at a time.
+
+#define MAX_THREADS         64
+#define BATCH_ROWS          64
+#define MAX_BATCH_MEMORY    (64*1024*1024)
+
+typedef struct {
+
+    cmsHTRANSFORM hXForm;
+    JDIMENSION Width, Height;
+    JDIMENSION BatchRows;
+    size_t LineIn, LineOut;
+
+    JSAMPROW BufferIn[3];
+    JSAMPROW BufferOut[3];
+    JSAMPROW* RowsIn;               // Row pointers for libjpeg, read and write jobs run at the same time
+    JSAMPROW* RowsOut;
+
+} PIPELINE;
+
+typedef enum { READ_JOB, XFORM_JOB, WRITE_JOB } JOBKIND;
+
+typedef struct {
+
+    PIPELINE* p;
+    JOBKIND Kind;
+    int Slot;
+    JDIMENSION First, nRows;        // Rows of the batch
+    JDIMENSION Start, Count;        // Transform jobs take a chunk of those
+
+} PIPEJOB;
+
 static
-int DoTransform(cmsHTRANSFORM hXForm, int OutputColorSpace)
+void ReadRows(PIPELINE* p, JSAMPROW Buffer, JDIMENSION nRows)
+{
+    JDIMENSION i, n, Done = 0;
+
+    for (i=0; i < nRows; i++)
+        p ->RowsIn[i] = Buffer + i * p ->LineIn;
+
+    // libjpeg may return less rows than asked for, but none means there is nothing left
+    while (Done < nRows) {
+
+        n = jpeg_read_scanlines(&Decompressor, p ->RowsIn + Done, nRows - Done);
+        if (n == 0)
+            FatalError("Premature end of JPEG data at scanline %u", Decompressor.output_scanline);
+        Done += n;
+    }
+}
+
+static
+void WriteRows(PIPELINE* p, JSAMPROW Buffer, JDIMENSION nRows)
+{
+    JDIMENSION i, n, Done = 0;
+
+    for (i=0; i < nRows; i++)
+        p ->RowsOut[i] = Buffer + i * p ->LineOut;
+
+    while (Done < nRows) {
+
+        n = jpeg_write_scanlines(&Compressor, p ->RowsOut + Done, nRows - Done);
+        if (n == 0)
+            FatalError("Cannot write scanline %u", Compressor.next_scanline);
+        Done += n;
+    }
+}
+
+static
+void XformRows(PIPELINE* p, JSAMPROW In, JSAMPROW Out, JDIMENSION nRows)
+{
+    cmsDoTransformLineStride(p ->hXForm, In, Out, p ->Width, nRows,
+                             (cmsUInt32Number) p ->LineIn, (cmsUInt32Number) p ->LineOut,
+                             (cmsUInt32Number) (p ->LineIn * nRows), (cmsUInt32Number) (p ->LineOut * nRows));
+}
+
+static
+void PipelineJob(void* Cargo)
+{
+    PIPEJOB* Job = (PIPEJOB*) Cargo;
+    PIPELINE* p = Job ->p;
+    JSAMPROW In  = p ->BufferIn[Job ->Slot];
+    JSAMPROW Out = p ->BufferOut[Job ->Slot];
+
+    switch (Job ->Kind) {
+
+    case READ_JOB:
+        ReadRows(p, In, Job ->nRows);
+        break;
+
+    case XFORM_JOB:
+        if (Job ->Count > 0)
+            XformRows(p, In + Job ->Start * p ->LineIn, Out + Job ->Start * p ->LineOut, Job ->Count);
+        break;
+
+    case WRITE_JOB:
+        WriteRows(p, Out, Job ->nRows);
+        break;
+    }
+}
+
+static
+void AddJob(PIPEJOB* Jobs, void** Cargo, int* nJobs, PIPELINE* p, JOBKIND Kind,
+            JDIMENSION Batch, int Worker, int nWorkers)
 {
-    JSAMPROW ScanLineIn;
-    JSAMPROW ScanLineOut;
+    PIPEJOB* Job = &Jobs[*nJobs];
+    JDIMENSION Chunk;
+
+    Job ->p     = p;
+    Job ->Kind  = Kind;
+    Job ->Slot  = (int) (Batch % 3);
+    Job ->First = Batch * p ->BatchRows;
+    Job ->nRows = p ->Height - Job ->First < p ->BatchRows ? p ->Height - Job ->First : p ->BatchRows;
+
+    // Transform jobs split the batch in contiguous chunks
+    Chunk = (Job ->nRows + (JDIMENSION) nWorkers - 1) / (JDIMENSION) nWorkers;
+    Job ->Start = (JDIMENSION) Worker * Chunk;
+    if (Job ->Start > Job ->nRows) Job ->Start = Job ->nRows;
+    Job ->Count = Job ->nRows - Job ->Start < Chunk ? Job ->nRows - Job ->Start : Chunk;
+
+    Cargo[*nJobs] = Job;
+    (*nJobs)++;
+}
+
+static
+void PipelinedXform(PIPELINE* p)
+{
+    PIPEJOB  Jobs[MAX_THREADS + 2];
+    void*    Cargo[MAX_THREADS + 2];
+    JDIMENSION nBatches, Round;
+    int i, nJobs;
+
+    nBatches = (p ->Height + p ->BatchRows - 1) / p ->BatchRows;
+
+    // Batch n is read on round n, transformed on round n+1 and written on round n+2
+    for (Round = 0; Round < nBatches + 2; Round++) {
+
+        nJobs = 0;
+
+        if (Round < nBatches)
+            AddJob(Jobs, Cargo, &nJobs, p, READ_JOB, Round, 0, 1);
 
+        if (Round >= 1 && Round <= nBatches) {
+
+            for (i=0; i < Threads; i++)
+                AddJob(Jobs, Cargo, &nJobs, p, XFORM_JOB, Round - 1, i, Threads);
+        }
+
+        if (Round >= 2)
+            AddJob(Jobs, Cargo, &nJobs, p, WRITE_JOB, Round - 2, 0, 1);
+
+        _cmsRunParallelJobs(NULL, (cmsUInt32Number) nJobs, PipelineJob, Cargo);
+    }
+}
+
+static
+int DoTransform(cmsHTRANSFORM hXForm, int OutputColorSpace)
+{
+    PIPELINE p;
+    JDIMENSION nRows;
+    int i, nSlots;
 
        //Preserve resolution values from the original
        // (Thanks to Robert Bergs for finding out this bug)
@@ -864,21 +1022,57 @@ int DoTransform(cmsHTRANSFORM hXForm, int OutputColorSpace)
        if (EmbedProfile && cOutProf)
            DoEmbedProfile(cOutProf);
 
-       ScanLineIn  = (JSAMPROW) malloc(Decompressor.output_width * Decompressor.num_components);
-       ScanLineOut = (JSAMPROW) malloc(Compressor.image_width * Compressor.num_components);
+       memset(&p, 0, sizeof(p));
+
+       p.hXForm  = hXForm;
+       p.Width   = Decompressor.output_width;
+       p.Height  = Decompressor.output_height;
+       p.LineIn  = (size_t) Decompressor.output_width * Decompressor.num_components;
+       p.LineOut = (size_t) Compressor.image_width * Compressor.num_components;
+
+       // Several rows per thread keep the workers busy, as long as the memory is reasonable
+       p.BatchRows = Threads > 1 ? (JDIMENSION) (16 * Threads) : BATCH_ROWS;
+       while (p.BatchRows > 1 && p.BatchRows * (p.LineIn + p.LineOut) > MAX_BATCH_MEMORY)
+           p.BatchRows--;
+
+       nSlots = Threads > 1 ? 3 : 1;
+       for (i=0; i < nSlots; i++) {
+
+           p.BufferIn[i]  = (JSAMPROW) malloc(p.BatchRows * p.LineIn);
+           p.BufferOut[i] = (JSAMPROW) malloc(p.BatchRows * p.LineOut);
+           if (p.BufferIn[i] == NULL || p.BufferOut[i] == NULL)
+               FatalError("Out of memory on batch of %u rows", p.BatchRows);
+       }
+
+       p.RowsIn  = (JSAMPROW*) malloc(p.BatchRows * sizeof(JSAMPROW));
+       p.RowsOut = (JSAMPROW*) malloc(p.BatchRows * sizeof(JSAMPROW));
+       if (p.RowsIn == NULL || p.RowsOut == NULL)
+           FatalError("Out of memory on batch of %u rows", p.BatchRows);
+
+       if (Threads > 1) {
 
-       while (Decompressor.output_scanline <
-                            Decompressor.output_height) {
+           PipelinedXform(&p);
+       }
+       else {
 
-       jpeg_read_scanlines(&Decompressor, &ScanLineIn, 1);
+           while (Decompressor.output_scanline < p.Height) {
 
-       cmsDoTransform(hXForm, ScanLineIn, ScanLineOut, Decompressor.output_width);
+               nRows = p.Height - Decompressor.output_scanline;
+               if (nRows > p.BatchRows) nRows = p.BatchRows;
 
-       jpeg_write_scanlines(&Compressor, &ScanLineOut, 1);
+               ReadRows(&p, p.BufferIn[0], nRows);
+               XformRows(&p, p.BufferIn[0], p.BufferOut[0], nRows);
+               WriteRows(&p, p.BufferOut[0], nRows);
+           }
        }
 
-       free(ScanLineIn);
-       free(ScanLineOut);
+       for (i=0; i < nSlots; i++) {
+
+           free(p.BufferIn[i]);
+           free(p.BufferOut[i]);
+       }
+       free(p.RowsIn);
+       free(p.RowsOut);
 
        jpeg_finish_decompress(&Decompressor);
        jpeg_finish_compress(&Compressor);
@@ -888,6 +1082,37 @@ int DoTransform(cmsHTRANSFORM hXForm, int OutputColorSpace)
 
 
 
+// The transform of the last image, reused when the next one has the same layout and embedded profile.
+
+static struct {
+
+    cmsHTRANSFORM xform;
+    cmsUInt32Number wInput;
+    int OutputColorSpace;
+    cmsUInt8Number* Embedded;
+    cmsUInt32Number EmbeddedLen;
+
+} Cached;
+
+static
+cmsBool IsCached(cmsUInt32Number wInput, cmsUInt8Number* EmbedBuffer, cmsUInt32Number EmbedLen)
+{
+    if (Cached.xform == NULL || Cached.wInput != wInput) return FALSE;
+    if (Cached.EmbeddedLen != EmbedLen) return FALSE;
+
+    return EmbedLen == 0 || memcmp(Cached.Embedded, EmbedBuffer, EmbedLen) == 0;
+}
+
+static
+void FreeCached(void)
+{
+    if (Cached.xform) cmsDeleteTransform(Cached.xform);
+    if (Cached.Embedded) free(Cached.Embedded);
+
+    memset(&Cached, 0, sizeof(Cached));
+}
+
+
 // Transform one image
 
 static
@@ -898,9 +1123,32 @@ int TransformImage(char *cDefInpProf, char *cOutputProf)
        cmsUInt32Number wInput, wOutput;
        int OutputColorSpace;
        cmsUInt32Number dwFlags = 0;
-       cmsUInt32Number EmbedLen;
-       cmsUInt8Number* EmbedBuffer;
+       cmsUInt32Number EmbedLen = 0;
+       cmsUInt8Number* EmbedBuffer = NULL;
+
+
+       // Take input color space
+       wInput = GetInputPixelType();
+
+       if (!lIsDeviceLink && !IgnoreEmbedded && !read_icc_profile(&Decompressor, &EmbedBuffer, &EmbedLen)) {
+
+           EmbedBuffer = NULL;
+           EmbedLen = 0;
+       }
 
+       // Same kind of image as last time, no need to open profiles or to create the transform again
+       if (IsCached(wInput, EmbedBuffer, EmbedLen)) {
+
+           if (EmbedBuffer) free(EmbedBuffer);
+
+           jpeg_copy_critical_parameters(&Decompressor, &Compressor);
+           WriteOutputFields(Cached.OutputColorSpace);
+
+           DoTransform(Cached.xform, Cached.OutputColorSpace);
+
+           jcopy_markers_execute(&Decompressor, &Compressor);
+           return 1;
+       }
 
        cmsSetAdaptationState(ObserverAdaptationState);
 
@@ -924,9 +1172,6 @@ int TransformImage(char *cDefInpProf, char *cOutputProf)
             cmsSetAlarmCodes(Alarm);
        }
 
-       // Take input color space
-       wInput = GetInputPixelType();
-
         if (lIsDeviceLink) {
 
             hIn = cmsOpenProfileFromFile(cDefInpProf, "r");
@@ -935,7 +1180,7 @@ int TransformImage(char *cDefInpProf, char *cOutputProf)
        }
         else {
 
-        if (!IgnoreEmbedded && read_icc_profile(&Decompressor, &EmbedBuffer, &EmbedLen))
+        if (EmbedBuffer != NULL)
         {
               hIn = cmsOpenProfileFromMem(EmbedBuffer, EmbedLen);
 
@@ -948,8 +1193,6 @@ int TransformImage(char *cDefInpProf, char *cOutputProf)
 
                if (hIn != NULL && SaveEmbedded != NULL)
                           SaveMemoryBlock(EmbedBuffer, EmbedLen, SaveEmbedded);
-
-              free(EmbedBuffer);
         }
         else
         {
@@ -1012,16 +1255,23 @@ int TransformImage(char *cDefInpProf, char *cOutputProf)
        if (xform == NULL)
                  FatalError("Cannot transform by using the profiles");
 
-       DoTransform(xform, OutputColorSpace);
-
-
-       jcopy_markers_execute(&Decompressor, &Compressor);
-
-       cmsDeleteTransform(xform);
        cmsCloseProfile(hIn);
        cmsCloseProfile(hOut);
        if (hProof) cmsCloseProfile(hProof);
 
+       // Keep it for the next image
+       FreeCached();
+
+       Cached.xform            = xform;
+       Cached.wInput           = wInput;
+       Cached.OutputColorSpace = OutputColorSpace;
+       Cached.Embedded         = EmbedBuffer;
+       Cached.EmbeddedLen      = EmbedLen;
+
+       DoTransform(xform, OutputColorSpace);
+
+       jcopy_markers_execute(&Decompressor, &Compressor);
+
        return 1;
 }
 
@@ -1039,6 +1289,7 @@ void Help(int level)
      case 0:
 
      fprintf(stderr, "usage: jpgicc [flags] input.jpg output.jpg\n");
+     fprintf(stderr, "       jpgicc [flags] input1.jpg input2.jpg ... outdir\n");
 
      fprintf(stderr, "\nflags:\n\n");
      fprintf(stderr, "%cv - Verbose\n", SW);
@@ -1066,6 +1317,7 @@ void Help(int level)
 
      fprintf(stderr, "\n");
      fprintf(stderr, "%cq<0..100> - Output JPEG quality\n", SW);
+     fprintf(stderr, "%cj<n> - Use n threads, overlapping decoding, transform and encoding\n", SW);
 
      fprintf(stderr, "\n");
      fprintf(stderr, "%ch<0,1,2,3> - More help\n", SW);
@@ -1083,8 +1335,10 @@ void Help(int level)
                      "To recover sRGB from a CMYK separation:\n"
                      "\tjpgicc %ciprinter.icm incmyk.jpg outrgb.jpg\n"
                      "To convert from CIELab ITU/Fax JPEG to sRGB\n"
-                     "\tjpgicc in.jpg out.jpg\n\n",
-                     SW, SW, SW, SW, SW);
+                     "\tjpgicc in.jpg out.jpg\n"
+                     "To separate a whole set of images into a directory, using four threads:\n"
+                     "\tjpgicc %coprinter.icm %cj4 *.jpg outdir\n\n",
+                     SW, SW, SW, SW, SW, SW, SW);
      break;
 
      case 2:
@@ -1112,7 +1366,7 @@ void HandleSwitches(int argc, char *argv[])
 {
     int s;
 
-    while ((s=xgetopt(argc,argv,"bBnNvVGgh:H:i:I:o:O:P:p:t:T:c:C:Q:q:M:m:L:l:eEs:S:!:D:d:")) != EOF) {
+    while ((s=xgetopt(argc,argv,"bBnNvVGgh:H:i:I:o:O:P:p:t:T:c:C:Q:q:M:m:L:l:eEs:S:!:D:d:j:J:")) != EOF) {
 
         switch (s)
         {
@@ -1207,6 +1461,13 @@ void HandleSwitches(int argc, char *argv[])
             if (jpegQuality < 0)   jpegQuality = 0;
             break;
 
+        case 'j':
+        case 'J':
+            Threads = atoi(xoptarg);
+            if (Threads < 1 || Threads > MAX_THREADS)
+                FatalError("Threads must be 1..%d", MAX_THREADS);
+            break;
+
         case 'm':
         case 'M':
             ProofingIntent = atoi(xoptarg);
@@ -1234,28 +1495,65 @@ void HandleSwitches(int argc, char *argv[])
 }
 
 
+// Batch mode: output goes to a directory, with the same name as the input
+
+static
+void BuildOutputName(char* Name, const char* Dir, const char* Input)
+{
+    const char* Base = strrchr(Input, '/');
+    const char* Base2 = strrchr(Input, '\\');
+
+    if (Base2 > Base) Base = Base2;
+    Base = Base ? Base + 1 : Input;
+
+    if (strlen(Dir) + strlen(Base) + 2 > cmsMAX_PATH)
+        FatalError("File name too long '%s'", Input);
+
+    strcpy(Name, Dir);
+    strcat(Name, "/");
+    strcat(Name, Base);
+}
+
+
 int main(int argc, char* argv[])
 {
+    char OutName[cmsMAX_PATH];
+    const char* Output;
+    int i;
+
     InitUtils("jpgicc");
 
     HandleSwitches(argc, argv);
 
-    if ((argc - xoptind) != 2) {
+    if ((argc - xoptind) < 2) {
         Help(0);
     }
 
-    OpenInput(argv[xoptind]);
-    OpenOutput(argv[xoptind+1]);
+    // Images with the same layout and profile share the transform
+    for (i = xoptind; i < argc - 1; i++) {
 
-    TransformImage(cInpProf, cOutProf);
+        if ((argc - xoptind) == 2)
+            Output = argv[argc-1];
+        else {
 
+            BuildOutputName(OutName, argv[argc-1], argv[i]);
+            Output = OutName;
 
-    if (Verbose) { fprintf(stdout, "\n"); fflush(stdout); }
+            if (Verbose) { fprintf(stdout, "%s -> %s", argv[i], Output); fflush(stdout); }
+        }
 
-    Done();
+        OpenInput(argv[i]);
+        OpenOutput(Output);
+
+        TransformImage(cInpProf, cOutProf);
 
-    return 0;
-}
 
+        if (Verbose) { fprintf(stdout, "\n"); fflush(stdout); }
 
+        Done();
+    }
+
+    FreeCached();
 
+    return 0;
+}
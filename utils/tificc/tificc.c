@@ -43,6 +43,7 @@ static cmsBool StoreAsAlpha           = FALSE;
 static int Intent                  = INTENT_PERCEPTUAL;
 static int ProofingIntent          = INTENT_PERCEPTUAL;
 static int PrecalcMode             = 1;
+static int Threads                 = 0;
 static cmsFloat64Number InkLimit   = 400;
 
 static cmsFloat64Number ObserverAdaptationState  = 1.0;  // According ICC 4.3 this is the default
@@ -490,6 +491,240 @@ cleanup:
 }
 
 
+// Pipelined transforms
+
+// With -j, strips or tiles go in batches through three stages: a batch is decoded while the previous one is
+// transformed by several threads and the one before is written. Each round is a set of parallel jobs run by
+// lcms, so each TIFF file is only touched by one thread, and at most three batches are in memory.
+
+#define MAX_THREADS         64
+#define MAX_BATCH_MEMORY    (64*1024*1024)
+
+typedef struct {
+
+    TIFF* in;
+    TIFF* out;
+    cmsHTRANSFORM hXForm;
+    int nPlanesIn, nPlanesOut;      // Output may have a different number of channels
+    int Tiled;
+    ttile_t Count;                  // Strips or tiles per plane
+    tsize_t BufSizeIn, BufSizeOut;  // Per plane
+    size_t  UnitIn, UnitOut;        // All planes
+    uint32 Width, RowsPerStrip, Length;
+    int TilePixels;
+
+    unsigned char* BufferIn[3];
+    unsigned char* BufferOut[3];
+
+} PIPELINE;
+
+typedef enum { READ_JOB, XFORM_JOB, WRITE_JOB } JOBKIND;
+
+typedef struct {
+
+    PIPELINE* p;
+    JOBKIND Kind;
+    int Slot;
+    ttile_t First, nUnits;     // Units of the batch
+    int Worker, nWorkers;      // Transform jobs take one of each nWorkers units
+    int Failed;
+
+} PIPEJOB;
+
+static
+int UnitPixels(PIPELINE* p, ttile_t i)
+{
+    uint32 Rows;
+
+    if (p ->Tiled) return p ->TilePixels;
+
+    Rows = p ->Length - (uint32) i * p ->RowsPerStrip;
+    if (Rows > p ->RowsPerStrip) Rows = p ->RowsPerStrip;
+
+    return (int) (p ->Width * Rows);
+}
+
+static
+int ReadUnit(PIPELINE* p, ttile_t i, unsigned char* Buffer)
+{
+    int j;
+
+    for (j=0; j < p ->nPlanesIn; j++) {
+
+        unsigned char* Plane = Buffer + j * p ->BufSizeIn;
+        ttile_t n = i + j * p ->Count;
+
+        if ((p ->Tiled ? TIFFReadEncodedTile(p ->in, n, Plane, p ->BufSizeIn) :
+                         TIFFReadEncodedStrip(p ->in, n, Plane, p ->BufSizeIn)) < 0) return 0;
+    }
+
+    return 1;
+}
+
+static
+int WriteUnit(PIPELINE* p, ttile_t i, unsigned char* Buffer)
+{
+    int j;
+
+    for (j=0; j < p ->nPlanesOut; j++) {
+
+        unsigned char* Plane = Buffer + j * p ->BufSizeOut;
+        ttile_t n = i + j * p ->Count;
+
+        if ((p ->Tiled ? TIFFWriteEncodedTile(p ->out, n, Plane, p ->BufSizeOut) :
+                         TIFFWriteEncodedStrip(p ->out, n, Plane, p ->BufSizeOut)) < 0) return 0;
+    }
+
+    return 1;
+}
+
+static
+void PipelineJob(void* Cargo)
+{
+    PIPEJOB* Job = (PIPEJOB*) Cargo;
+    PIPELINE* p = Job ->p;
+    unsigned char* In  = p ->BufferIn[Job ->Slot];
+    unsigned char* Out = p ->BufferOut[Job ->Slot];
+    ttile_t k;
+
+    switch (Job ->Kind) {
+
+    case READ_JOB:
+        for (k=0; k < Job ->nUnits; k++)
+            if (!ReadUnit(p, Job ->First + k, In + k * p ->UnitIn)) { Job ->Failed = 1; return; }
+        break;
+
+    case XFORM_JOB:
+        // Planes are BufSizeIn/Out apart even on a short last strip
+        for (k = (ttile_t) Job ->Worker; k < Job ->nUnits; k += (ttile_t) Job ->nWorkers)
+            cmsDoTransformLineStride(p ->hXForm, In + k * p ->UnitIn, Out + k * p ->UnitOut,
+                                     (cmsUInt32Number) UnitPixels(p, Job ->First + k), 1,
+                                     (cmsUInt32Number) p ->UnitIn, (cmsUInt32Number) p ->UnitOut,
+                                     (cmsUInt32Number) p ->BufSizeIn, (cmsUInt32Number) p ->BufSizeOut);
+        break;
+
+    case WRITE_JOB:
+        for (k=0; k < Job ->nUnits; k++)
+            if (!WriteUnit(p, Job ->First + k, Out + k * p ->UnitOut)) { Job ->Failed = 1; return; }
+        break;
+    }
+}
+
+static
+void AddJob(PIPEJOB* Jobs, void** Cargo, int* nJobs, PIPELINE* p, JOBKIND Kind,
+            ttile_t Batch, ttile_t BatchSize, int Worker, int nWorkers)
+{
+    PIPEJOB* Job = &Jobs[*nJobs];
+
+    Job ->p        = p;
+    Job ->Kind     = Kind;
+    Job ->Slot     = (int) (Batch % 3);
+    Job ->First    = Batch * BatchSize;
+    Job ->nUnits   = p ->Count - Job ->First < BatchSize ? p ->Count - Job ->First : BatchSize;
+    Job ->Worker   = Worker;
+    Job ->nWorkers = nWorkers;
+    Job ->Failed   = 0;
+
+    Cargo[*nJobs] = Job;
+    (*nJobs)++;
+}
+
+static
+int PipelinedXform(cmsHTRANSFORM hXForm, TIFF* in, TIFF* out, int nPlanesIn, int nPlanesOut)
+{
+    PIPELINE p;
+    PIPEJOB  Jobs[MAX_THREADS + 2];
+    void*    Cargo[MAX_THREADS + 2];
+    ttile_t  BatchSize, nBatches, Round;
+    int i, nJobs, rc = 1;
+    uint32 tw, tl;
+
+    memset(&p, 0, sizeof(p));
+
+    p.in      = in;
+    p.out     = out;
+    p.hXForm  = hXForm;
+    p.nPlanesIn  = nPlanesIn;
+    p.nPlanesOut = nPlanesOut;
+    p.Tiled   = TIFFIsTiled(in);
+
+    if (p.Tiled) {
+
+        p.BufSizeIn  = TIFFTileSize(in);
+        p.BufSizeOut = TIFFTileSize(out);
+        p.Count      = TIFFNumberOfTiles(in) / nPlanesIn;
+
+        TIFFGetFieldDefaulted(in, TIFFTAG_TILEWIDTH,  &tw);
+        TIFFGetFieldDefaulted(in, TIFFTAG_TILELENGTH, &tl);
+        p.TilePixels = (int) tw * tl;
+    }
+    else {
+
+        p.BufSizeIn  = TIFFStripSize(in);
+        p.BufSizeOut = TIFFStripSize(out);
+        p.Count      = TIFFNumberOfStrips(in) / nPlanesIn;
+
+        TIFFGetFieldDefaulted(in, TIFFTAG_IMAGEWIDTH,   &p.Width);
+        TIFFGetFieldDefaulted(in, TIFFTAG_ROWSPERSTRIP, &p.RowsPerStrip);
+        TIFFGetFieldDefaulted(in, TIFFTAG_IMAGELENGTH,  &p.Length);
+
+        // It is possible to get infinite rows per strip
+        if (p.RowsPerStrip == 0 || p.RowsPerStrip > p.Length)
+            p.RowsPerStrip = p.Length;
+    }
+
+    p.UnitIn  = (size_t) p.BufSizeIn  * nPlanesIn;
+    p.UnitOut = (size_t) p.BufSizeOut * nPlanesOut;
+
+    // Two units per thread keep the workers busy, as long as the memory is reasonable
+    BatchSize = (ttile_t) (2 * Threads);
+    while (BatchSize > 1 && BatchSize * (p.UnitIn + p.UnitOut) > MAX_BATCH_MEMORY)
+        BatchSize--;
+
+    nBatches = (p.Count + BatchSize - 1) / BatchSize;
+
+    for (i=0; i < 3; i++) {
+
+        p.BufferIn[i]  = (unsigned char *) _TIFFmalloc((tmsize_t) (BatchSize * p.UnitIn));
+        if (!p.BufferIn[i]) OutOfMem(BatchSize * p.UnitIn);
+
+        p.BufferOut[i] = (unsigned char *) _TIFFmalloc((tmsize_t) (BatchSize * p.UnitOut));
+        if (!p.BufferOut[i]) OutOfMem(BatchSize * p.UnitOut);
+    }
+
+    // Batch n is read on round n, transformed on round n+1 and written on round n+2
+    for (Round = 0; Round < nBatches + 2 && rc; Round++) {
+
+        nJobs = 0;
+
+        if (Round < nBatches)
+            AddJob(Jobs, Cargo, &nJobs, &p, READ_JOB, Round, BatchSize, 0, 1);
+
+        if (Round >= 1 && Round <= nBatches) {
+
+            for (i=0; i < Threads; i++)
+                AddJob(Jobs, Cargo, &nJobs, &p, XFORM_JOB, Round - 1, BatchSize, i, Threads);
+        }
+
+        if (Round >= 2)
+            AddJob(Jobs, Cargo, &nJobs, &p, WRITE_JOB, Round - 2, BatchSize, 0, 1);
+
+        _cmsRunParallelJobs(NULL, (cmsUInt32Number) nJobs, PipelineJob, Cargo);
+
+        for (i=0; i < nJobs; i++)
+            if (Jobs[i].Failed) rc = 0;
+    }
+
+    for (i=0; i < 3; i++) {
+
+        _TIFFfree(p.BufferIn[i]);
+        _TIFFfree(p.BufferOut[i]);
+    }
+
+    return rc;
+}
+
+
 // Creates minimum required tags
 static
 void WriteOutputTags(TIFF *out, int Colorspace, int BytesPerSample)
@@ -780,6 +1015,7 @@ int TransformImage(TIFF* in, TIFF* out, const char *cDefInpProf)
     int bps = Width / 8;
     cmsUInt32Number dwFlags = 0;        
     int nPlanes;
+    cmsBool Pipelined;
 
     // Observer adaptation state (only meaningful on absolute colorimetric intent)
 
@@ -838,6 +1074,20 @@ int TransformImage(TIFF* in, TIFF* out, const char *cDefInpProf)
     if (_cmsLCMScolorSpace(cmsGetColorSpace(hIn)) != (int) T_COLORSPACE(wInput))
         FatalError("Input profile is not operating in proper color space");
 
+    // Planar stuff
+    if (T_PLANAR(wInput)) 
+        nPlanes = T_CHANNELS(wInput) + T_EXTRA(wInput);
+    else
+        nPlanes = 1;
+
+    // A single strip cannot be pipelined, but the transform itself can be split across threads
+    Pipelined = Threads > 1;
+    if (Pipelined && !TIFFIsTiled(in) && TIFFNumberOfStrips(in) / nPlanes < 2) {
+
+        Pipelined = FALSE;
+        dwFlags |= cmsFLAGS_PARALLEL;
+    }
+
 
     if (!lIsDeviceLink) 
         OutputColorSpace = _cmsLCMScolorSpace(cmsGetColorSpace(hOut));
@@ -891,14 +1141,14 @@ int TransformImage(TIFF* in, TIFF* out, const char *cDefInpProf)
 
     if (xform == NULL) return 0;
 
-    // Planar stuff
-    if (T_PLANAR(wInput)) 
-        nPlanes = T_CHANNELS(wInput) + T_EXTRA(wInput);
-    else
-        nPlanes = 1;
-
 
     // Handle tile by tile or strip by strip
+    if (Pipelined) {
+
+        PipelinedXform(xform, in, out, nPlanes,
+                       T_PLANAR(wOutput) ? T_CHANNELS(wOutput) + T_EXTRA(wOutput) : 1);
+    }
+    else
     if (TIFFIsTiled(in)) {
 
         TileBasedXform(xform, in, out, nPlanes);
@@ -945,6 +1195,7 @@ void Help(int level)
          fprintf(stderr, "\n");
 
          fprintf(stderr, "%cw<8,16,32> - Output depth. Use 32 for floating-point\n\n", SW);
+         fprintf(stderr, "%cj<n> - Use n threads, overlapping decoding, transform and encoding\n\n", SW);
          fprintf(stderr, "%ca - Handle channels > 4 as alpha\n", SW);
 
          fprintf(stderr, "%cn - Ignore embedded profile on input\n", SW);
@@ -1007,7 +1258,7 @@ void HandleSwitches(int argc, char *argv[])
 {
     int s;
 
-    while ((s=xgetopt(argc,argv,"aAeEbBw:W:nNvVGgh:H:i:I:o:O:P:p:t:T:c:C:l:L:M:m:K:k:S:s:D:d:")) != EOF) {
+    while ((s=xgetopt(argc,argv,"aAeEbBw:W:nNvVGgh:H:i:I:o:O:P:p:t:T:c:C:l:L:M:m:K:k:S:s:D:d:j:J:")) != EOF) {
 
         switch (s) {
 
@@ -1101,6 +1352,13 @@ void HandleSwitches(int argc, char *argv[])
                 FatalError("Only 8, 16 and 32 bps are supported");
             break;
 
+        case 'j':
+        case 'J':
+            Threads = atoi(xoptarg);
+            if (Threads < 1 || Threads > MAX_THREADS)
+                FatalError("Threads must be 1..%d", MAX_THREADS);
+            break;
+
         case 'k':
         case 'K':
             InkLimit = atof(xoptarg);